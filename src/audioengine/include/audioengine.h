@@ -15,6 +15,8 @@
 namespace MinimalAudioEngine
 {
 class DeviceManager;
+class EngineContext;
+class TrackManager;
 }
 
 namespace MinimalAudioEngine
@@ -39,6 +41,8 @@ enum class eAudioEngineCommand
   Play,
   Stop,
   SetDevice,
+  SetOutputStream,
+  SetHostOutput,
   SetParams,
   StoppedPlayback
 };
@@ -51,6 +55,14 @@ struct SetDevicePayload
   AudioDevice device;
 };
 
+/** @struct SetOutputStreamPayload
+ *  @brief Contains the parameters for the SetOutputStream API command
+ */
+struct SetOutputStreamPayload
+{
+  PcmOutputStreamPtr stream;
+};
+
 /** @struct SetStreamParamsPayload
  *  @brief Contains the parameters for the SetParams API command
  */
@@ -70,7 +82,9 @@ struct AudioMessage
   std::variant<
     std::monostate,
     SetDevicePayload,
+    SetOutputStreamPayload,
     SetStreamParamsPayload> payload;
+  int64_t issue_time_ns = 0;  // When the API call was made, for the command latency statistics
 };
 
 inline std::ostream& operator<<(std::ostream& os, const AudioMessage& message)
@@ -84,7 +98,9 @@ inline std::ostream& operator<<(std::ostream& os, const AudioMessage& message)
 struct AudioEngineStatistics
 {
   unsigned int tracks_playing;
-  unsigned int total_frames_processed;
+  uint64_t total_frames_processed;  // Transport clock; a 32-bit count wraps after about a day at 48 kHz
+  float callback_load;  // Fraction of the block period spent rendering
+  LatencyHistogramSnapshot command_latency;  // From an API call to the end of the first block it affected
 };
 
 /** @class AudioEngine
@@ -93,6 +109,7 @@ struct AudioEngineStatistics
 class AudioEngine : public IEngine<AudioMessage>, public Subject<AudioMessage>
 {
   friend class MinimalAudioEngine::DeviceManager;
+  friend class MinimalAudioEngine::EngineContext;
 
 public:
   static AudioEngine& instance()
@@ -103,9 +120,166 @@ public:
 
   AudioEngineStatistics get_statistics() const;
 
+  inline std::vector<float> get_output_peaks(bool reset = true)
+  {
+    return p_audio_interface->get_output_peaks(reset);
+  }
+
+  /** @brief Queue a parameter change for the callback. Immediate changes count toward the command latency.
+   */
+  inline bool push_parameter_change(ParameterChange change)
+  {
+    if (change.sample_time == 0 && change.issue_time_ns == 0)
+    {
+      change.issue_time_ns = latency_timestamp_ns();
+    }
+    return p_audio_interface->push_parameter_change(change);
+  }
+
+  inline uint64_t get_sample_time_at(std::chrono::steady_clock::time_point time) const
+  {
+    return p_audio_interface->get_sample_time_at(time);
+  }
+
+  inline uint64_t get_sample_time() const
+  {
+    return p_audio_interface->get_frames_processed();
+  }
+
+  uint64_t get_quantized_sample_time(double beats_per_minute, double beats = 1.0) const;
+
+  inline bool add_tap(const std::string &name, uint32_t source, uint32_t capacity_frames = AUDIO_TAP_DEFAULT_CAPACITY)
+  {
+    return p_audio_interface->add_tap(name, source, capacity_frames);
+  }
+
+  inline bool remove_tap(const std::string &name)
+  {
+    return p_audio_interface->remove_tap(name);
+  }
+
+  inline std::vector<std::string> get_tap_descriptions() const
+  {
+    return p_audio_interface->get_tap_descriptions();
+  }
+
+  /** @brief Record the record-armed tracks, and the master output if requested; see AudioInterface::start_recording
+   */
+  inline bool start_recording(const RecordingOptions &options)
+  {
+    return p_audio_interface->start_recording(options);
+  }
+
+  inline std::optional<RecordingStatistics> stop_recording()
+  {
+    return p_audio_interface->stop_recording();
+  }
+
+  /** @brief Start the running recording's takes at a transport sample, or with the next block for 0
+   */
+  inline bool punch_in(uint64_t sample_time = 0)
+  {
+    return p_audio_interface->punch_in(sample_time);
+  }
+
+  /** @brief End the running recording's takes at a transport sample, or with the next block for 0
+   */
+  inline bool punch_out(uint64_t sample_time = 0)
+  {
+    return p_audio_interface->punch_out(sample_time);
+  }
+
+  inline bool is_recording() const
+  {
+    return p_audio_interface->is_recording();
+  }
+
+  inline std::optional<RecordingStatistics> get_recording_statistics() const
+  {
+    return p_audio_interface->get_recording_statistics();
+  }
+
+  /** @brief Loop record the record-armed tracks, one take per pass; see AudioInterface::start_loop_recording
+   */
+  inline bool start_loop_recording(const LoopRecordingOptions &options)
+  {
+    return p_audio_interface->start_loop_recording(options);
+  }
+
+  inline std::optional<LoopRecordingStatistics> stop_loop_recording()
+  {
+    return p_audio_interface->stop_loop_recording();
+  }
+
+  /** @brief Choose the take a loop recorded track plays, or LOOP_TAKE_NONE
+   */
+  inline bool select_take(uint32_t track, int take)
+  {
+    return p_audio_interface->select_take(track, take);
+  }
+
+  inline int get_selected_take(uint32_t track) const
+  {
+    return p_audio_interface->get_selected_take(track);
+  }
+
+  inline std::vector<LoopTakeInfo> get_loop_takes(uint32_t track) const
+  {
+    return p_audio_interface->get_loop_takes(track);
+  }
+
+  inline bool is_loop_recording() const
+  {
+    return p_audio_interface->is_loop_recording();
+  }
+
+  /** @brief Measure the output-to-input round trip; see AudioInterface::measure_round_trip_latency
+   */
+  inline std::optional<LatencyMeasurement> measure_round_trip_latency(
+    const LatencyMeterOptions &options = {}, std::chrono::milliseconds timeout = std::chrono::seconds(5))
+  {
+    return p_audio_interface->measure_round_trip_latency(options, timeout);
+  }
+
+  /** @brief Feed the output back as input after a fixed delay, for backends without inputs
+   */
+  inline bool enable_virtual_loopback(uint32_t delay_frames, float gain = 1.0f)
+  {
+    return p_audio_interface->enable_virtual_loopback(delay_frames, gain);
+  }
+
+  inline void disable_virtual_loopback()
+  {
+    p_audio_interface->disable_virtual_loopback();
+  }
+
+  /** @brief Input channels opened with the output device, 0 for output only. Takes effect when the stream is next opened.
+   */
+  inline void set_input_channels(unsigned int input_channels) noexcept
+  {
+    p_audio_interface->set_input_channels(input_channels);
+  }
+
   void play();
   void stop();
+  void play_at(uint64_t sample_time);
+  void stop_at(uint64_t sample_time);
+
+  inline bool is_transport_rolling() const noexcept
+  {
+    return p_audio_interface->is_transport_rolling();
+  }
+
   void set_output_device(const AudioDevice& device);
+  void set_output_stream(const PcmOutputStreamPtr& stream);
+  void set_host_output(const unsigned int channels, const unsigned int sample_rate);
+
+  /** @brief Pull one block for a host application; see AudioInterface::render
+   */
+  inline bool render(float *const *output, unsigned int n_frames) noexcept
+  {
+    return p_audio_interface->render(output, n_frames);
+  }
   void set_stream_parameters(
     const unsigned int channels,
     const unsigned int sample_rate,
@@ -116,6 +290,16 @@ public:
     return m_state.load(std::memory_order_acquire);
   }
 
+  /** @brief True while a play request waits for the engine thread or the engine has not returned to Idle.
+   *  Lets a caller wait for playback it requested to finish without guessing how long the request takes.
+   */
+  inline bool is_playback_pending() const noexcept
+  {
+    const uint64_t requested = m_play_requests.load(std::memory_order_acquire);
+    return m_play_requests_handled.load(std::memory_order_acquire) != requested ||
+           get_state() != eAudioEngineState::Idle;
+  }
+
   inline AudioDevice get_output_device() const noexcept
   {
     return m_output_device;
@@ -131,11 +315,23 @@ public:
     return p_audio_interface->get_sample_rate();
   }
 
+  /** @brief True while the output stream runs and the sample clock advances
+   */
+  inline bool is_stream_running() const
+  {
+    return p_audio_interface->is_stream_running();
+  }
+
   inline unsigned int get_buffer_frames() const noexcept
   {
     return p_audio_interface->get_buffer_frames();
   }
 
+  inline float get_callback_load() const noexcept
+  {
+    return p_audio_interface->get_callback_load();
+  }
+
   void stop_thread()
   {
     stop();
@@ -148,9 +344,16 @@ public:
     IEngine::stop_thread();
   }
 
+  ~AudioEngine() override;
+
 private:
   AudioEngine();
 
+  inline void set_track_manager(TrackManager *track_manager) noexcept
+  {
+    p_audio_interface->set_track_manager(track_manager);
+  }
+
   std::vector<AudioDeviceInfo> get_devices();
 
   void run() override;
@@ -161,14 +364,24 @@ private:
   void update_state_running();
   void update_state_stopped();
 
+  bool push_transport_change(bool rolling, uint64_t sample_time, bool measure_latency);
+  void note_config_change(int64_t issue_time_ns);
+  void note_start_request(int64_t issue_time_ns);
+
   std::unique_ptr<AudioInterface> p_audio_interface;
 
   std::atomic<eAudioEngineState> m_state;
   std::atomic<unsigned int> m_tracks_playing;
-  std::atomic<uint64_t> m_total_frames_processed;
+  std::atomic<uint64_t> m_play_requests{0};          // Play commands pushed to the engine thread
+  std::atomic<uint64_t> m_play_requests_handled{0};  // Play commands it has taken
+
+  size_t m_load_probe_id;  // Lets shared background work back off while the callback is busy
 
   std::atomic<unsigned int> m_device_id;
   AudioDevice m_output_device;
+  PcmOutputStreamPtr m_output_stream;  // Replaces the device when set
+  bool m_host_output = false;          // Replaces the device and stream; the host calls render()
+  int64_t m_config_issue_time_ns = 0;  // Oldest configuration change not yet heard by a started stream, or its start request
 };
 
 }  // namespace MinimalAudioEngine
@@ -3,14 +3,69 @@
 
 #include <memory>
 #include <atomic>
+#include <array>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <optional>
 #include <rtaudio/RtAudio.h>
 
 #include "audiodevice.h"
+#include "ringbuffer.h"
+#include "audiotap.h"
+#include "latencymeter.h"
+#include "looprecorder.h"
+#include "recorder.h"
+#include "virtualloopback.h"
+#include "pcmstream.h"
+#include "latencyhistogram.h"
 #include "logger.h"
 
 namespace MinimalAudioEngine
 {
 
+class TrackManager;
+
+constexpr unsigned int AUDIO_METER_MAX_CHANNELS = 16;
+constexpr size_t AUDIO_PARAMETER_RING_SIZE = 4096;
+constexpr size_t AUDIO_PARAMETER_MAX_PENDING = 256;
+constexpr size_t AUDIO_TAP_MAX_TAPS = 8;
+constexpr unsigned int AUDIO_HOST_MAX_CHANNELS = 16;
+constexpr size_t AUDIO_RENDER_BUFFER_SAMPLES = 4096;  // Tracks and host blocks are rendered in chunks of this size
+constexpr unsigned int AUDIO_MAX_CHANNELS = 256;       // Keeps a render chunk at least 16 frames long
+
+static_assert(AUDIO_HOST_MAX_CHANNELS <= AUDIO_MAX_CHANNELS, "Host outputs must fit the render buffers");
+static_assert(AUDIO_MAX_CHANNELS <= AUDIO_RENDER_BUFFER_SAMPLES, "A render chunk must hold a frame");
+
+/** @enum eParameterTarget
+ *  @brief Mix parameters and transport commands that can be changed from the audio thread
+ */
+enum class eParameterTarget : uint8_t
+{
+  TrackGain,
+  TrackMute,
+  MasterGain,
+  Transport   // Non-zero value starts rendering the tracks, zero stops it
+};
+
+/** @struct ParameterChange
+ *  @brief A parameter change or command delivered to the audio callback.
+ *  sample_time is on the transport clock (see AudioInterface::get_frames_processed);
+ *  changes due at or before the current block, including 0, apply at its start.
+ *  The callback drains the queue at the start of every block, so a change pushed
+ *  while a stream is running lands at most one block later.
+ */
+struct ParameterChange
+{
+  uint64_t sample_time = 0;
+  uint32_t track_index = 0;
+  eParameterTarget target = eParameterTarget::MasterGain;
+  float value = 0.0f;
+  int64_t issue_time_ns = 0;  // See latency_timestamp_ns(); 0 to leave out of the command latency
+};
+
 /** @struct AudioDeviceInfo
  *  @brief Extends RtAudio::DeviceInfo to add additional fields
  */
@@ -42,7 +97,9 @@ struct AudioDeviceInfo : public RtAudio::DeviceInfo
 };
 
 /** @class AudioInterface
- *  @brief Wrapper around RtAudio for audio stream management
+ *  @brief Wrapper around RtAudio for audio stream management.
+ *  Can instead drive a raw PCM output stream from its own thread, for use without an audio device,
+ *  or be driven by a host application that pulls blocks with render() from its own callback.
  */
 class AudioInterface
 {
@@ -50,10 +107,28 @@ public:
   AudioInterface();
   ~AudioInterface();
 
+  /** @brief Render the tracks of this manager instead of the default TrackManager
+   */
+  inline void set_track_manager(TrackManager *track_manager) noexcept
+  {
+    m_track_manager = track_manager;
+  }
+
   bool open(const MinimalAudioEngine::AudioDevice &device);
+  bool open_stream(const PcmOutputStreamPtr &stream);
+  bool open_host();
   bool start();
   bool close();
 
+  bool render(float *const *output, unsigned int n_frames) noexcept;
+
+  /** @brief Ask an engine-driven stream to stop after the current block. No effect on devices.
+   */
+  inline void request_stop() noexcept
+  {
+    m_stop_requested.store(true, std::memory_order_release);
+  }
+
   inline void set_channels(unsigned int channels) noexcept
   {
     m_channels.store(channels, std::memory_order_relaxed);
@@ -64,6 +139,18 @@ public:
     return m_channels.load(std::memory_order_relaxed);
   }
 
+  /** @brief Input channels opened alongside the output on a device, 0 for output only. Takes effect on open().
+   */
+  inline void set_input_channels(unsigned int input_channels) noexcept
+  {
+    m_input_channels.store(input_channels, std::memory_order_relaxed);
+  }
+
+  inline unsigned int get_input_channels() const noexcept
+  {
+    return m_input_channels.load(std::memory_order_relaxed);
+  }
+
   inline void set_sample_rate(unsigned int sample_rate) noexcept
   {
     m_sample_rate.store(sample_rate, std::memory_order_relaxed);
@@ -101,23 +188,178 @@ public:
 
   inline bool is_stream_running() const
   {
-    return m_rtaudio.isStreamRunning();
+    if (m_host_driven.load(std::memory_order_acquire))
+    {
+      return m_host_running.load(std::memory_order_acquire);
+    }
+    return m_output_stream ? m_output_stream_running.load(std::memory_order_acquire) : m_rtaudio.isStreamRunning();
+  }
+
+  /** @brief True once every track with an input has played to its end since start()
+   */
+  inline bool is_end_of_input() const noexcept
+  {
+    return m_end_of_input.load(std::memory_order_acquire);
   }
 
-  void process_audio(float *output_buffer, unsigned int n_frames);
+  /** @brief True while the callback renders the tracks. Set by Transport changes.
+   */
+  inline bool is_transport_rolling() const noexcept
+  {
+    return m_transport_rolling.load(std::memory_order_acquire);
+  }
+
+  void process_audio(float *output_buffer, unsigned int n_frames, const float *input_buffer = nullptr);
+
+  std::vector<float> get_output_peaks(bool reset = true);
+
+  inline uint64_t get_frames_processed() const noexcept
+  {
+    return m_frames_processed.load(std::memory_order_relaxed);
+  }
+
+  /** @brief Fraction of the block period the callback spends rendering, held at recent peaks
+   */
+  inline float get_callback_load() const noexcept
+  {
+    return m_callback_load.load(std::memory_order_relaxed);
+  }
+
+  bool push_parameter_change(const ParameterChange &change);
+
+  /** @brief Time from issuing a timestamped command to the end of the first block it affected
+   */
+  inline LatencyHistogramSnapshot get_command_latency() const noexcept
+  {
+    return m_command_latency.snapshot();
+  }
+
+  /** @brief Measure a command that takes effect with the first block after start(), such as a stream parameter change
+   *  @param issue_time_ns See latency_timestamp_ns()
+   */
+  inline void measure_at_start(int64_t issue_time_ns) noexcept
+  {
+    m_start_issue_time_ns.store(issue_time_ns, std::memory_order_release);
+  }
+
+  uint64_t get_sample_time_at(std::chrono::steady_clock::time_point time) const;
+
+  inline float get_master_gain() const noexcept
+  {
+    return m_master_gain.load(std::memory_order_relaxed);
+  }
+
+  bool add_tap(const std::string &name, uint32_t source, uint32_t capacity_frames = AUDIO_TAP_DEFAULT_CAPACITY);
+  bool remove_tap(const std::string &name);
+  std::vector<std::string> get_tap_descriptions() const;
+
+  bool start_recording(const RecordingOptions &options);
+  std::optional<RecordingStatistics> stop_recording();
+  bool punch_in(uint64_t sample_time);
+  bool punch_out(uint64_t sample_time);
+  bool is_recording() const;
+  std::optional<RecordingStatistics> get_recording_statistics() const;
+
+  bool start_loop_recording(const LoopRecordingOptions &options);
+  std::optional<LoopRecordingStatistics> stop_loop_recording();
+  bool select_take(uint32_t track, int take);
+  int get_selected_take(uint32_t track) const;
+  std::vector<LoopTakeInfo> get_loop_takes(uint32_t track) const;
+  bool is_loop_recording() const;
+
+  std::optional<LatencyMeasurement> measure_round_trip_latency(const LatencyMeterOptions &options,
+                                                               std::chrono::milliseconds timeout);
+  bool enable_virtual_loopback(uint32_t delay_frames, float gain = 1.0f);
+  void disable_virtual_loopback();
 
   // Disable copy constructor and assignment operator
   AudioInterface(const AudioInterface & ) = delete;
   AudioInterface & operator=(const AudioInterface & ) = delete;
 
 private:
+  TrackManager &get_track_manager() const;
+
   RtAudio m_rtaudio;
+  TrackManager *m_track_manager = nullptr;  // nullptr for the default TrackManager
   std::atomic<bool> m_should_close{false};
 
   std::atomic<unsigned int> m_channels;
+  std::atomic<unsigned int> m_input_channels{0};
   std::atomic<unsigned int> m_sample_rate;
   std::atomic<unsigned int> m_buffer_frames;
 
+  // Engine-driven PCM output, used instead of RtAudio while set
+  void run_output_stream(std::stop_token stop_token);
+  PcmOutputStreamPtr m_output_stream;
+  std::jthread m_output_stream_thread;
+  std::atomic<bool> m_output_stream_running{false};
+  std::atomic<bool> m_stop_requested{false};
+
+  // Host-driven output: blocks are pulled by render() on the host's thread
+  std::atomic<bool> m_host_driven{false};
+  std::atomic<bool> m_host_running{false};
+  std::array<float, AUDIO_RENDER_BUFFER_SAMPLES> m_host_buffer{};  // Interleaved, before splitting into channels
+
+  // Metering, written by the audio callback
+  void update_meters(const float *output_buffer, unsigned int n_frames, unsigned int channels) noexcept;
+  std::array<std::atomic<float>, AUDIO_METER_MAX_CHANNELS> m_output_peaks{};
+  std::atomic<uint64_t> m_frames_processed{0};
+  void update_callback_load(std::chrono::steady_clock::time_point block_start_time, unsigned int n_frames) noexcept;
+  std::atomic<float> m_callback_load{0.0f};
+
+  // Parameter delivery. Producers serialize on the mutex; the callback never locks.
+  void collect_parameter_changes(uint64_t block_start) noexcept;
+  void apply_parameter_change(const ParameterChange &change) noexcept;
+  void begin_track_blocks(unsigned int n_frames, uint64_t block_start) noexcept;
+  void render_tracks(float *output_buffer, unsigned int n_frames, uint64_t sample_time) noexcept;
+  std::array<float, AUDIO_RENDER_BUFFER_SAMPLES> m_track_buffer{};  // One track at a time, mixed into the output
+  std::atomic<bool> m_end_of_input{false};
+  SpscRingBuffer<ParameterChange, AUDIO_PARAMETER_RING_SIZE> m_parameter_ring;
+  std::mutex m_parameter_producer_mutex;
+  std::array<ParameterChange, AUDIO_PARAMETER_MAX_PENDING> m_pending_changes{};  // Sorted by sample_time
+  size_t m_pending_count = 0;
+  std::atomic<float> m_master_gain{1.0f};
+  std::atomic<bool> m_transport_rolling{false};  // Written only by the callback
+
+  // Command latency, recorded by the callback at the end of the block that applied the command
+  void record_command_latency(size_t applied) noexcept;
+  LatencyHistogram m_command_latency;
+  std::atomic<int64_t> m_start_issue_time_ns{0};
+
+  // Shared-memory taps. The callback only reads the slots; taps are owned under the mutex.
+  void write_taps(uint32_t source, const float *output_buffer, unsigned int n_frames) noexcept;
+  void wait_for_callback_exit() const;
+  std::array<std::atomic<AudioTap *>, AUDIO_TAP_MAX_TAPS> m_tap_slots{};
+  std::vector<std::unique_ptr<AudioTap>> m_taps;
+  mutable std::mutex m_tap_mutex;
+  std::atomic<uint64_t> m_callback_epoch{0};  // Odd while process_audio is running
+
+  // Disk recording, published to the callback the same way as the taps
+  void write_recorder(uint32_t source, const float *output_buffer, unsigned int n_frames, uint64_t sample_time) noexcept;
+  std::atomic<Recorder *> m_recorder_slot{nullptr};
+  std::unique_ptr<Recorder> m_recorder;
+  mutable std::mutex m_recorder_mutex;
+
+  // Loop recording. Each track's selected take is a pointer inside the loop recorder,
+  // so switching takes never touches the slot or the callback's render path.
+  void process_loop_recorder(uint32_t track, float *track_buffer, unsigned int n_frames, uint64_t sample_time) noexcept;
+  std::atomic<LoopRecorder *> m_loop_recorder_slot{nullptr};
+  std::unique_ptr<LoopRecorder> m_loop_recorder;
+  mutable std::mutex m_loop_recorder_mutex;
+
+  // Round-trip latency measurement. Without device input, the virtual loopback feeds the output back.
+  void process_latency_meter(float *output_buffer, const float *input_buffer, unsigned int n_frames) noexcept;
+  std::atomic<LatencyMeter *> m_latency_meter_slot{nullptr};
+  std::atomic<VirtualLoopback *> m_loopback_slot{nullptr};
+  std::unique_ptr<VirtualLoopback> m_loopback;
+  std::mutex m_latency_mutex;
+
+  // Transport clock: sample position and steady time at the start of the last block (seqlock)
+  void update_clock(uint64_t block_start) noexcept;
+  std::atomic<uint32_t> m_clock_sequence{0};
+  std::atomic<uint64_t> m_clock_sample{0};
+  std::atomic<int64_t> m_clock_time_ns{0};
+
   // TEST
   std::atomic<bool> m_test_tone_enabled{false};
   std::atomic<double> m_test_tone_phase{0.0};
@@ -0,0 +1,123 @@
+#ifndef _AUDIO_TAP_H_
+#define _AUDIO_TAP_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "ringbuffer.h"
+
+namespace MinimalAudioEngine
+{
+
+constexpr uint32_t AUDIO_TAP_MAGIC = 0x4D415450;  // "MATP"
+constexpr uint32_t AUDIO_TAP_VERSION = 2;
+constexpr uint32_t AUDIO_TAP_SOURCE_MASTER = 0xFFFFFFFF;
+constexpr size_t AUDIO_TAP_HEADER_SIZE = 4096;  // Minimum; rounded up to the page size
+constexpr uint32_t AUDIO_TAP_DEFAULT_CAPACITY = 1 << 17;
+constexpr uint32_t AUDIO_TAP_BLOCKS_PER_RING = 8;  // Minimum capacity, in the largest blocks expected
+
+/** @struct AudioTapHeader
+ *  @brief Layout of the first page of a tap's shared memory object.
+ *
+ *  The audio data follows at data_offset as capacity_frames interleaved float frames.
+ *  The writer never waits for readers: it overwrites the oldest audio and publishes
+ *  write_position after each block. Each reader keeps its own read position
+ *  and detects that it fell behind by comparing against write_position, so any number
+ *  of readers can attach and detach at any time. Readers stay at least max_block_frames
+ *  behind the oldest frame, since the writer may be overwriting that much before it publishes.
+ */
+struct AudioTapHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t channels;
+  uint32_t sample_rate;
+  uint32_t capacity_frames;   // Power of two
+  uint32_t source;            // Track index, or AUDIO_TAP_SOURCE_MASTER
+  uint32_t data_offset;       // Page-aligned start of the audio data
+
+  alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> write_position;  // Total frames written
+  std::atomic<uint32_t> max_block_frames;                         // Largest block written or expected
+  alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> wake_sequence;   // Futex word, bumped after each block
+  std::atomic<uint32_t> waiting_readers;
+};
+
+static_assert(sizeof(AudioTapHeader) <= AUDIO_TAP_HEADER_SIZE, "AudioTapHeader must fit in the header page");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Tap positions must be lock-free to be shared between processes");
+
+/** @class AudioTap
+ *  @brief Writer side of a shared-memory audio tap, owned by the AudioInterface.
+ *  The data region is mapped twice back to back, so a block that wraps around the end
+ *  of the ring is still written with a single memcpy.
+ */
+class AudioTap
+{
+public:
+  static std::unique_ptr<AudioTap> create(const std::string &name, unsigned int channels, unsigned int sample_rate,
+                                          uint32_t capacity_frames, uint32_t source, uint32_t max_block_frames);
+  ~AudioTap();
+
+  void write(const float *interleaved, unsigned int frames, unsigned int channels) noexcept;
+
+  const std::string &get_name() const noexcept { return m_name; }
+  uint32_t get_source() const noexcept { return m_header->source; }
+  uint64_t get_frames_written() const noexcept { return m_header->write_position.load(std::memory_order_relaxed); }
+  std::string to_string() const;
+
+  // Disable copy constructor and assignment operator
+  AudioTap(const AudioTap &) = delete;
+  AudioTap &operator=(const AudioTap &) = delete;
+
+private:
+  AudioTap() = default;
+
+  std::string m_name;
+  AudioTapHeader *m_header = nullptr;
+  float *m_data = nullptr;
+  void *m_mapping = nullptr;
+  size_t m_mapping_size = 0;
+  size_t m_data_bytes = 0;
+  bool m_mirrored = false;
+};
+
+/** @class AudioTapReader
+ *  @brief Reader side of a shared-memory audio tap, for external processes and tests.
+ */
+class AudioTapReader
+{
+public:
+  static std::unique_ptr<AudioTapReader> open(const std::string &name, bool from_start = false);
+  ~AudioTapReader();
+
+  size_t read(float *interleaved, size_t max_frames);
+  bool wait(std::chrono::milliseconds timeout);
+
+  unsigned int get_channels() const noexcept { return m_header->channels; }
+  unsigned int get_sample_rate() const noexcept { return m_header->sample_rate; }
+  uint32_t get_source() const noexcept { return m_header->source; }
+  uint64_t get_dropped_frames() const noexcept { return m_dropped_frames; }
+  size_t get_available_frames() const noexcept;
+  uint64_t get_safe_capacity() const noexcept;
+
+  // Disable copy constructor and assignment operator
+  AudioTapReader(const AudioTapReader &) = delete;
+  AudioTapReader &operator=(const AudioTapReader &) = delete;
+
+private:
+  AudioTapReader() = default;
+
+  const AudioTapHeader *m_header = nullptr;
+  const float *m_data = nullptr;
+  void *m_mapping = nullptr;
+  size_t m_mapping_size = 0;
+  uint64_t m_read_position = 0;
+  uint64_t m_dropped_frames = 0;
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // _AUDIO_TAP_H_
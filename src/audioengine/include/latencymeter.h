@@ -0,0 +1,105 @@
+#ifndef _LATENCY_METER_H_
+#define _LATENCY_METER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace MinimalAudioEngine
+{
+
+/** @struct LatencyMeterOptions
+ *  @brief Excitation and search range of a round-trip latency measurement.
+ */
+struct LatencyMeterOptions
+{
+  unsigned int mls_order = 14;       // The excitation is a maximum length sequence of 2^order - 1 samples (10 to 18)
+  float level = 0.25f;               // Peak level of the excitation
+  double max_latency_seconds = 1.0;  // Longest round trip searched for
+  unsigned int output_channel = 0;   // Channel the excitation is played on; the others are silent
+  unsigned int input_channel = 0;    // Channel the excitation is captured from
+  double min_confidence = 4.0;       // Correlation peak over the strongest peak elsewhere, below which the result is rejected
+};
+
+/** @struct LatencyMeasurement
+ *  @brief Result of a round-trip latency measurement.
+ */
+struct LatencyMeasurement
+{
+  uint32_t round_trip_frames = 0;  // From a frame leaving the callback to it coming back as input
+  unsigned int sample_rate = 0;
+  double confidence = 0.0;
+  bool virtual_loopback = false;  // Measured through the virtual loopback, not the device
+
+  inline double get_milliseconds() const noexcept
+  {
+    return sample_rate > 0 ? 1000.0 * round_trip_frames / sample_rate : 0.0;
+  }
+
+  std::string to_string() const
+  {
+    return "LatencyMeasurement(RoundTrip=" + std::to_string(round_trip_frames) + " frames" +
+           ", Milliseconds=" + std::to_string(get_milliseconds()) +
+           ", Confidence=" + std::to_string(confidence) +
+           (virtual_loopback ? ", VirtualLoopback" : "") + ")";
+  }
+};
+
+/** @class LatencyMeter
+ *  @brief Measures round-trip latency by playing a maximum length sequence and cross-correlating it with the input.
+ *
+ *  The audio callback calls generate() on each output block and capture() on the input
+ *  block of the same callback. Both count frames from the first block, so the lag of the
+ *  correlation peak is the round trip as the callback sees it, buffering included.
+ *  An MLS correlates with itself to a single sharp peak, which stays well clear of the
+ *  noise floor at low levels. The analysis runs off the audio thread once capture is complete.
+ */
+class LatencyMeter
+{
+public:
+  static std::unique_ptr<LatencyMeter> create(const LatencyMeterOptions &options, unsigned int output_channels,
+                                               unsigned int sample_rate);
+
+  void generate(float *output, unsigned int frames) noexcept;
+  void capture(const float *input, unsigned int frames, unsigned int channels) noexcept;
+
+  inline bool is_complete() const noexcept
+  {
+    return m_captured_frames.load(std::memory_order_acquire) >= m_capture.size();
+  }
+
+  std::optional<LatencyMeasurement> analyze() const;
+
+  inline const std::vector<float> &get_sequence() const noexcept
+  {
+    return m_sequence;
+  }
+
+  static std::vector<float> generate_mls(unsigned int order, float level);
+
+  // Disable copy constructor and assignment operator
+  LatencyMeter(const LatencyMeter &) = delete;
+  LatencyMeter &operator=(const LatencyMeter &) = delete;
+
+private:
+  LatencyMeter() = default;
+
+  LatencyMeterOptions m_options;
+  unsigned int m_output_channels = 0;
+  unsigned int m_sample_rate = 0;
+  uint32_t m_max_latency_frames = 0;
+  std::vector<float> m_sequence;
+  std::vector<float> m_capture;  // One sequence plus the longest round trip
+
+  // Callback only
+  uint64_t m_generated_frames = 0;
+
+  std::atomic<uint64_t> m_captured_frames{0};
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // _LATENCY_METER_H_
@@ -0,0 +1,162 @@
+#ifndef _LOOP_RECORDER_H_
+#define _LOOP_RECORDER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace MinimalAudioEngine
+{
+
+constexpr unsigned int LOOP_RECORDER_DEFAULT_TAKES = 16;
+constexpr int LOOP_TAKE_NONE = -1;  // Selects no take, silencing a track's loop playback
+
+/** @struct LoopRecordingOptions
+ *  @brief Loop region and take storage of a loop recording.
+ *  The loop region repeats on the transport clock: pass k covers
+ *  [loop_start + k * loop_length, loop_start + (k + 1) * loop_length).
+ */
+struct LoopRecordingOptions
+{
+  std::filesystem::path directory;  // Receives track<N>_take<K>.wav for each finished pass
+  uint64_t loop_start = 0;          // Transport sample the first pass starts at
+  uint64_t loop_length = 0;         // Frames per pass
+  unsigned int max_takes = LOOP_RECORDER_DEFAULT_TAKES;  // Takes per track held in memory; later passes are dropped
+  bool auto_select = true;          // Play each track's newest take as soon as its pass ends
+};
+
+/** @struct LoopTakeInfo
+ *  @brief Description of one recorded pass.
+ */
+struct LoopTakeInfo
+{
+  unsigned int index = 0;
+  uint64_t start_sample = 0;  // Transport sample of the take's first frame
+  uint64_t frames = 0;        // Frames recorded so far, counted from the start of the pass
+  bool complete = false;
+  bool written = false;       // Saved to disk
+  std::filesystem::path path;
+
+  std::string to_string() const
+  {
+    return "LoopTake(Index=" + std::to_string(index) +
+           ", Start=" + std::to_string(start_sample) +
+           ", Frames=" + std::to_string(frames) +
+           ", State=" + (written ? "Written" : complete ? "Complete" : "Recording") + ")";
+  }
+};
+
+/** @struct LoopRecordingStatistics
+ *  @brief Counters of a running or finished loop recording.
+ */
+struct LoopRecordingStatistics
+{
+  unsigned int tracks = 0;
+  unsigned int takes = 0;
+  unsigned int takes_written = 0;
+  uint64_t passes_dropped = 0;  // Passes that found the track's take pool full
+  bool write_failed = false;
+
+  std::string to_string() const
+  {
+    return "LoopRecordingStatistics(Tracks=" + std::to_string(tracks) +
+           ", Takes=" + std::to_string(takes) +
+           ", TakesWritten=" + std::to_string(takes_written) +
+           ", PassesDropped=" + std::to_string(passes_dropped) +
+           ", WriteFailed=" + (write_failed ? "Yes" : "No") + ")";
+  }
+};
+
+/** @class LoopRecorder
+ *  @brief Records every pass over a loop region as a new take and plays back a selected take per track.
+ *
+ *  Takes live in one pool allocated up front, max_takes full-length passes per track,
+ *  so the callback only copies samples. A writer thread saves each take once its pass
+ *  has ended. Takes stay in memory after they are written: selecting a take swaps one
+ *  pointer that the callback reads at the next block, with no file access.
+ */
+class LoopRecorder
+{
+public:
+  static std::unique_ptr<LoopRecorder> create(const LoopRecordingOptions &options, const std::vector<uint32_t> &tracks,
+                                              unsigned int channels, unsigned int sample_rate);
+  ~LoopRecorder();
+
+  void process(uint32_t track, float *interleaved, unsigned int frames, unsigned int channels,
+               uint64_t sample_time) noexcept;
+  LoopRecordingStatistics finish();
+
+  bool select_take(uint32_t track, int take);
+  int get_selected_take(uint32_t track) const;
+  std::vector<LoopTakeInfo> get_takes(uint32_t track) const;
+
+  LoopRecordingStatistics get_statistics() const;
+  const LoopRecordingOptions &get_options() const noexcept { return m_options; }
+  std::string to_string() const;
+
+  // Disable copy constructor and assignment operator
+  LoopRecorder(const LoopRecorder &) = delete;
+  LoopRecorder &operator=(const LoopRecorder &) = delete;
+
+private:
+  enum class eTakeState : uint8_t
+  {
+    Free,
+    Recording,
+    Complete,
+    Written,
+    Failed,
+  };
+
+  struct Take
+  {
+    float *samples = nullptr;  // loop_length interleaved frames in the pool
+    unsigned int index = 0;
+    uint64_t start_sample = 0;  // Set before the take is counted
+    std::atomic<uint64_t> frames{0};
+    std::atomic<eTakeState> state{eTakeState::Free};
+  };
+
+  /** @brief Takes of one track
+   */
+  struct Stack
+  {
+    uint32_t track = 0;
+    std::unique_ptr<Take[]> takes;
+    std::atomic<unsigned int> take_count{0};  // Takes started; published after each one is set up
+    std::atomic<Take *> active{nullptr};      // Played by the callback
+    std::atomic<uint64_t> passes_dropped{0};
+
+    // Callback only
+    Take *recording = nullptr;
+    uint64_t pass = UINT64_MAX;
+  };
+
+  LoopRecorder() = default;
+
+  Stack *find_stack(uint32_t track) const noexcept;
+  void record(Stack &stack, const float *interleaved, unsigned int frames, uint64_t sample_time) noexcept;
+  void play(const Stack &stack, float *interleaved, unsigned int frames, uint64_t sample_time) const noexcept;
+  void run_writer(std::stop_token stop_token);
+  bool write_completed_takes();
+  std::filesystem::path get_take_path(uint32_t track, unsigned int index) const;
+
+  LoopRecordingOptions m_options;
+  unsigned int m_channels = 0;
+  unsigned int m_sample_rate = 0;
+  size_t m_take_stride = 0;  // Floats between takes in the pool, page-aligned
+  std::unique_ptr<float, void (*)(void *)> m_pool{nullptr, nullptr};
+  std::vector<std::unique_ptr<Stack>> m_stacks;
+  std::vector<Stack *> m_track_stacks;  // Indexed by track, nullptr where the track is not loop recorded
+  std::jthread m_writer;
+  bool m_finished = false;
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // _LOOP_RECORDER_H_
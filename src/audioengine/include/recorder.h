@@ -0,0 +1,166 @@
+#ifndef _RECORDER_H_
+#define _RECORDER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ringbuffer.h"
+#include "recordingfile.h"
+
+namespace MinimalAudioEngine
+{
+
+constexpr uint32_t RECORDER_SOURCE_MASTER = 0xFFFFFFFF;           // Same value as AUDIO_TAP_SOURCE_MASTER
+constexpr size_t RECORDER_CHUNK_BYTES = 256 * 1024;               // Writers flush whole chunks of this size
+constexpr unsigned int RECORDER_WRITER_THREADS = 2;
+constexpr std::chrono::milliseconds RECORDER_WRITER_INTERVAL{5};  // Writer sleep when no take has a full chunk
+constexpr uint64_t RECORDER_NO_PUNCH = UINT64_MAX;               // Punch point that is never reached
+
+static_assert(RECORDER_CHUNK_BYTES % RECORDING_FILE_ALIGNMENT == 0, "Recorder chunks must suit direct I/O");
+
+/** @struct RecordingOptions
+ *  @brief Where and how a recording is written.
+ */
+struct RecordingOptions
+{
+  std::filesystem::path directory;  // Receives track<N>.wav per armed track and master.wav
+  bool include_master = false;
+  bool direct_io = false;           // Bypass the page cache; falls back to buffered I/O where unsupported
+  double ring_seconds = 2.0;        // Audio each take can hold while its writer is behind
+  double pre_roll_seconds = 0.0;    // Audio from before the punch-in that goes into the take
+  double preallocate_seconds = 60.0;  // Disk space reserved ahead of the data at a time
+  BroadcastInfo broadcast_info;     // Written to every file; the time reference is set per take
+  uint32_t latency_compensation = 0;  // Frames the time references are moved earlier, e.g. a measured round trip
+
+  // Transport samples the takes start and end at. 0 punches in with the next block;
+  // RECORDER_NO_PUNCH only captures the pre-roll until Recorder::punch_in() is called.
+  uint64_t punch_in = 0;
+  uint64_t punch_out = RECORDER_NO_PUNCH;
+};
+
+/** @struct RecordingStatistics
+ *  @brief Counters of a running or finished recording.
+ */
+struct RecordingStatistics
+{
+  unsigned int takes = 0;
+  unsigned int takes_punched_in = 0;
+  uint64_t blocks_recorded = 0;
+  uint64_t blocks_dropped = 0;  // Lost because a take's ring was full or the block did not match its format
+  uint64_t bytes_written = 0;
+  bool write_failed = false;
+
+  std::string to_string() const
+  {
+    return "RecordingStatistics(Takes=" + std::to_string(takes) +
+           ", PunchedIn=" + std::to_string(takes_punched_in) +
+           ", BlocksRecorded=" + std::to_string(blocks_recorded) +
+           ", BlocksDropped=" + std::to_string(blocks_dropped) +
+           ", BytesWritten=" + std::to_string(bytes_written) +
+           ", WriteFailed=" + (write_failed ? "Yes" : "No") + ")";
+  }
+};
+
+/** @class Recorder
+ *  @brief Records tracks and the master output to disk without I/O on the audio thread.
+ *
+ *  Each source has a take: a byte ring the audio callback copies blocks into and a
+ *  RecordingFile. Writer threads drain the rings in RECORDER_CHUNK_BYTES pieces, which
+ *  start aligned in memory and on disk, so files can be written with direct I/O.
+ *  The callback never waits; a block that does not fit in its ring is dropped and counted.
+ *
+ *  Until a take is punched in, its ring is a circular capture buffer: the callback keeps
+ *  overwriting the oldest audio and the writers leave it alone. At the punch-in sample
+ *  the callback marks where the take starts, up to pre_roll_seconds earlier, and hands
+ *  the ring over to the writers. The punch-out sample marks where it ends. Both are
+ *  resolved by the callback to the exact frame; files are opened when the recorder is created.
+ */
+class Recorder
+{
+public:
+  static std::unique_ptr<Recorder> create(const RecordingOptions &options, const std::vector<uint32_t> &tracks,
+                                          unsigned int channels, unsigned int sample_rate);
+  ~Recorder();
+
+  void write(uint32_t source, const float *interleaved, unsigned int frames, unsigned int channels,
+             uint64_t sample_time) noexcept;
+  RecordingStatistics finish();
+
+  /** @brief Start the takes at a transport sample, or with the next block for 0. Has no effect once punched in.
+   */
+  inline void punch_in(uint64_t sample_time) noexcept
+  {
+    m_punch_in.store(sample_time, std::memory_order_release);
+  }
+
+  /** @brief End the takes at a transport sample, or with the next block for 0
+   */
+  inline void punch_out(uint64_t sample_time) noexcept
+  {
+    m_punch_out.store(sample_time, std::memory_order_release);
+  }
+
+  RecordingStatistics get_statistics() const;
+  const RecordingOptions &get_options() const noexcept { return m_options; }
+  std::string to_string() const;
+
+  // Disable copy constructor and assignment operator
+  Recorder(const Recorder &) = delete;
+  Recorder &operator=(const Recorder &) = delete;
+
+private:
+  /** @brief One source's ring and file. Positions count bytes since the recorder was created.
+   *  read_position belongs to the callback until punched_in is set, then to the writer.
+   */
+  struct Take
+  {
+    uint32_t source = 0;
+    unsigned int channels = 0;
+    RecordingFilePtr file;
+    std::unique_ptr<uint8_t, void (*)(void *)> ring{nullptr, nullptr};
+    size_t capacity = 0;  // Multiple of RECORDER_CHUNK_BYTES
+
+    // Callback only
+    bool punched_out = false;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> write_position{0};
+    std::atomic<bool> punched_in{false};
+    std::atomic<uint64_t> end_position{UINT64_MAX};
+    uint64_t start_sample_time = 0;  // Of the first frame in the file; set before punched_in
+    std::atomic<uint64_t> blocks_recorded{0};
+    std::atomic<uint64_t> blocks_dropped{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> read_position{0};
+    std::atomic<uint64_t> bytes_written{0};
+    std::atomic<bool> failed{false};
+  };
+
+  Recorder() = default;
+
+  Take *find_take(uint32_t source) const noexcept;
+  void update_punch(Take &take, uint64_t position, uint64_t sample_time, unsigned int frames) noexcept;
+  void run_writer(std::stop_token stop_token, size_t index);
+  bool flush(Take &take, bool final);
+
+  RecordingOptions m_options;
+  std::vector<std::unique_ptr<Take>> m_takes;
+  std::vector<Take *> m_track_takes;  // Indexed by track, nullptr where the track is not recorded
+  Take *m_master_take = nullptr;
+  uint64_t m_pre_roll_bytes = 0;
+  size_t m_frame_bytes = 0;
+  std::atomic<uint64_t> m_punch_in{RECORDER_NO_PUNCH};
+  std::atomic<uint64_t> m_punch_out{RECORDER_NO_PUNCH};
+  size_t m_writer_count = 0;
+  std::vector<std::jthread> m_writers;
+  bool m_finished = false;
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // _RECORDER_H_
@@ -0,0 +1,86 @@
+#ifndef _VIRTUAL_LOOPBACK_H_
+#define _VIRTUAL_LOOPBACK_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace MinimalAudioEngine
+{
+
+constexpr unsigned int VIRTUAL_LOOPBACK_CHUNK_FRAMES = 256;  // Most frames process() takes at a time
+
+/** @class VirtualLoopback
+ *  @brief Turns the output of a backend without inputs back into input, after a fixed delay.
+ *  Stands in for a loopback cable on PCM streams and host-driven output, so latency
+ *  measurement and anything else that needs an input can run without hardware.
+ *  Everything is allocated up front; process() is safe to call from the audio callback.
+ */
+class VirtualLoopback
+{
+public:
+  /** @param delay_frames Round trip to simulate
+   *  @param channels Channels of the output blocks, and of the input produced
+   *  @param gain Applied to the returned signal; a negative gain inverts it
+   */
+  VirtualLoopback(uint32_t delay_frames, unsigned int channels, float gain = 1.0f)
+    : m_delay_frames(delay_frames),
+      m_channels(channels),
+      m_gain(gain),
+      m_delay_line(static_cast<size_t>(delay_frames) * channels, 0.0f),
+      m_input(static_cast<size_t>(VIRTUAL_LOOPBACK_CHUNK_FRAMES) * channels, 0.0f)
+  {}
+
+  /** @brief Feed an output block and get the input block of the same callback
+   *  @param output Interleaved output, up to VIRTUAL_LOOPBACK_CHUNK_FRAMES frames
+   *  @param frames Number of frames
+   *  @return Interleaved input, valid until the next call
+   */
+  const float *process(const float *output, unsigned int frames) noexcept
+  {
+    frames = std::min(frames, VIRTUAL_LOOPBACK_CHUNK_FRAMES);
+    const size_t samples = static_cast<size_t>(frames) * m_channels;
+    if (m_delay_line.empty())
+    {
+      for (size_t i = 0; i < samples; ++i)
+      {
+        m_input[i] = output[i] * m_gain;
+      }
+      return m_input.data();
+    }
+
+    for (size_t i = 0; i < samples; ++i)
+    {
+      m_input[i] = m_delay_line[m_position] * m_gain;
+      m_delay_line[m_position] = output[i];
+      m_position = m_position + 1 == m_delay_line.size() ? 0 : m_position + 1;
+    }
+    return m_input.data();
+  }
+
+  inline uint32_t get_delay_frames() const noexcept
+  {
+    return m_delay_frames;
+  }
+
+  inline unsigned int get_channels() const noexcept
+  {
+    return m_channels;
+  }
+
+  // Disable copy constructor and assignment operator
+  VirtualLoopback(const VirtualLoopback &) = delete;
+  VirtualLoopback &operator=(const VirtualLoopback &) = delete;
+
+private:
+  uint32_t m_delay_frames;
+  unsigned int m_channels;
+  float m_gain;
+  std::vector<float> m_delay_line;  // delay_frames interleaved frames, oldest at m_position
+  std::vector<float> m_input;
+  size_t m_position = 0;
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // _VIRTUAL_LOOPBACK_H_
@@ -1,4 +1,5 @@
 #include "audioengine.h"
+#include "taskscheduler.h"
 
 #include <cmath>
 #include <stdexcept>
@@ -12,11 +13,19 @@ using namespace MinimalAudioEngine;
 AudioEngine::AudioEngine() : IEngine("AudioEngine"),
   m_state(eAudioEngineState::Idle),
   m_device_id(0),
-  m_tracks_playing(0),
-  m_total_frames_processed(0)
+  m_tracks_playing(0)
 {
   // Set up RtAudio
   p_audio_interface = std::make_unique<AudioInterface>();
+
+  m_load_probe_id = TaskScheduler::instance().add_load_probe([this]() { return get_callback_load(); });
+}
+
+/** @brief AudioEngine destructor
+ */
+AudioEngine::~AudioEngine()
+{
+  TaskScheduler::instance().remove_load_probe(m_load_probe_id);
 }
 
 /** @brief Return a copy of the AudioEngine statistics
@@ -26,11 +35,32 @@ AudioEngineStatistics AudioEngine::get_statistics() const
   AudioEngineStatistics statistics;
 
   statistics.tracks_playing = m_tracks_playing.load(std::memory_order_relaxed);
-  statistics.total_frames_processed = m_total_frames_processed.load(std::memory_order_relaxed);
+  statistics.total_frames_processed = p_audio_interface->get_frames_processed();
+  statistics.callback_load = p_audio_interface->get_callback_load();
+  statistics.command_latency = p_audio_interface->get_command_latency();
 
   return statistics;
 }
 
+/** @brief Get the next transport sample on a beat grid that a scheduled command can still reach.
+ *  The grid starts at transport sample 0, so every caller using the same tempo lands on the same samples.
+ *  @param beats_per_minute Tempo of the grid
+ *  @param beats Grid spacing in beats, e.g. 4 for a bar of 4/4
+ *  @return The first grid sample at least one buffer after the current position, or 0 for an invalid grid
+ */
+uint64_t AudioEngine::get_quantized_sample_time(double beats_per_minute, double beats) const
+{
+  unsigned int sample_rate = get_sample_rate();
+  if (beats_per_minute <= 0.0 || beats <= 0.0 || sample_rate == 0)
+  {
+    return 0;
+  }
+
+  double spacing = 60.0 / beats_per_minute * beats * static_cast<double>(sample_rate);
+  uint64_t earliest = get_sample_time() + get_buffer_frames();
+  return static_cast<uint64_t>(std::llround(std::ceil(static_cast<double>(earliest) / spacing) * spacing));
+}
+
 /** @brief Get a list of available audio devices
  *  @return A vector of available audio devices
  */
@@ -53,23 +83,54 @@ std::vector<AudioDeviceInfo> AudioEngine::get_devices()
 }
 
 /** @brief Play - External API
+ *  Opens the output if it is not running. If it is, the transport starts on the next block.
  */
 void AudioEngine::play()
 {
-  AudioMessage msg;
-  msg.command = eAudioEngineCommand::Play;
-  push_message(std::move(msg));
+  play_at(0);
 }
 
 /** @brief Stop - External API
+ *  Silences the output from the next block, then closes it.
  */
 void AudioEngine::stop()
 {
+  // Not measured: the output usually closes before the callback sees it
+  push_transport_change(false, 0, false);
+
+  // Let an engine-driven stream stop before rendering another block
+  p_audio_interface->request_stop();
+
   AudioMessage msg;
   msg.command = eAudioEngineCommand::Stop;
   push_message(std::move(msg));
 }
 
+/** @brief Play At - External API
+ *  - Transport sample to start rendering at; 0 or a past sample means the next block
+ *  Opens the output if it is not running. The callback starts the transport on the exact sample.
+ */
+void AudioEngine::play_at(uint64_t sample_time)
+{
+  push_transport_change(true, sample_time, sample_time == 0);
+
+  AudioMessage msg;
+  msg.command = eAudioEngineCommand::Play;
+  msg.issue_time_ns = latency_timestamp_ns();
+  m_play_requests.fetch_add(1, std::memory_order_acq_rel);
+  push_message(std::move(msg));
+}
+
+/** @brief Stop At - External API
+ *  - Transport sample to stop rendering at; 0 or a past sample means the next block
+ *  The output stays open and silent, so a following play_at() needs no device round trip.
+ *  Use stop() to close it.
+ */
+void AudioEngine::stop_at(uint64_t sample_time)
+{
+  push_transport_change(false, sample_time, sample_time == 0);
+}
+
 /** @brief Set Audio Output Device - External API
  *  - Audio Output Device ID
  */
@@ -78,6 +139,33 @@ void AudioEngine::set_output_device(const MinimalAudioEngine::AudioDevice& devic
   AudioMessage msg;
   msg.command = eAudioEngineCommand::SetDevice;
   msg.payload = SetDevicePayload{device};
+  msg.issue_time_ns = latency_timestamp_ns();
+  push_message(std::move(msg));
+}
+
+/** @brief Set Audio Output Stream - External API
+ *  - Raw PCM stream driven by the engine instead of an audio device
+ */
+void AudioEngine::set_output_stream(const PcmOutputStreamPtr& stream)
+{
+  AudioMessage msg;
+  msg.command = eAudioEngineCommand::SetOutputStream;
+  msg.payload = SetOutputStreamPayload{stream};
+  msg.issue_time_ns = latency_timestamp_ns();
+  push_message(std::move(msg));
+}
+
+/** @brief Set Host Output - External API
+ *  - Channels
+ *  - Sample Rate
+ *  Playback renders only when the host application calls render()
+ */
+void AudioEngine::set_host_output(const unsigned int channels, const unsigned int sample_rate)
+{
+  AudioMessage msg;
+  msg.command = eAudioEngineCommand::SetHostOutput;
+  msg.payload = SetStreamParamsPayload{channels, sample_rate, p_audio_interface->get_buffer_frames()};
+  msg.issue_time_ns = latency_timestamp_ns();
   push_message(std::move(msg));
 }
 
@@ -93,6 +181,7 @@ void AudioEngine::set_stream_parameters(const unsigned int channels,
   AudioMessage msg;
   msg.command = eAudioEngineCommand::SetParams;
   msg.payload = SetStreamParamsPayload{channels, sample_rate, buffer_frames};
+  msg.issue_time_ns = latency_timestamp_ns();
   push_message(std::move(msg));
 }
 
@@ -129,6 +218,7 @@ void AudioEngine::handle_messages()
         {
           LOG_INFO("AudioEngine: Change state to Start");
           new_state = eAudioEngineState::Start;
+          note_start_request(message->issue_time_ns);
         }
         break;
       case eAudioEngineCommand::Stop:
@@ -152,9 +242,47 @@ void AudioEngine::handle_messages()
 
           auto &payload = std::get<SetDevicePayload>(message->payload);
           m_output_device = payload.device;
+          m_output_stream.reset();
+          m_host_output = false;
+          note_config_change(message->issue_time_ns);
           LOG_INFO("AudioEngine: Set output device to " + payload.device.name);
         }
         break;
+      case eAudioEngineCommand::SetOutputStream:
+        {
+          LOG_INFO("AudioEngine: Received Command - SetOutputStream");
+
+          if (current_state != eAudioEngineState::Idle && current_state != eAudioEngineState::Stopped)
+          {
+            LOG_ERROR("AudioEngine: Cannot change output stream while running");
+            break;
+          }
+
+          m_output_stream = std::get<SetOutputStreamPayload>(message->payload).stream;
+          m_host_output = false;
+          note_config_change(message->issue_time_ns);
+          LOG_INFO("AudioEngine: Set output stream to " + m_output_stream->to_string());
+        }
+        break;
+      case eAudioEngineCommand::SetHostOutput:
+        {
+          LOG_INFO("AudioEngine: Received Command - SetHostOutput");
+
+          if (current_state != eAudioEngineState::Idle && current_state != eAudioEngineState::Stopped)
+          {
+            LOG_ERROR("AudioEngine: Cannot change to host output while running");
+            break;
+          }
+
+          auto &payload = std::get<SetStreamParamsPayload>(message->payload);
+          p_audio_interface->set_channels(payload.channels);
+          p_audio_interface->set_sample_rate(payload.sample_rate);
+          m_output_stream.reset();
+          m_host_output = true;
+          note_config_change(message->issue_time_ns);
+          LOG_INFO("AudioEngine: Set host output with channels: ", payload.channels, ", sample rate: ", payload.sample_rate);
+        }
+        break;
       case eAudioEngineCommand::SetParams:
         {
           LOG_INFO("AudioEngine: Received Command - SetParams");
@@ -171,6 +299,7 @@ void AudioEngine::handle_messages()
           p_audio_interface->set_channels(payload.channels);
           p_audio_interface->set_sample_rate(payload.sample_rate);
           p_audio_interface->set_buffer_frames(payload.buffer_frames);
+          note_config_change(message->issue_time_ns);
         }
         break;
       default:
@@ -182,6 +311,11 @@ void AudioEngine::handle_messages()
     {
       m_state.store(new_state, std::memory_order_release);
     }
+
+    if (message->command == eAudioEngineCommand::Play)
+    {
+      m_play_requests_handled.fetch_add(1, std::memory_order_acq_rel);
+    }
   }
 }
 
@@ -226,13 +360,23 @@ void AudioEngine::update_state_start()
     return;
   }
 
-  if (!p_audio_interface->open(m_output_device))
+  bool opened = m_host_output ? p_audio_interface->open_host()
+               : m_output_stream ? p_audio_interface->open_stream(m_output_stream)
+                                 : p_audio_interface->open(m_output_device);
+  if (!opened)
   {
     LOG_ERROR("AudioEngine: Failed to open audio interface.");
     m_state.store(eAudioEngineState::Idle, std::memory_order_release);
     return;
   }
 
+  // The first block of the new stream is the first one to hear configuration changes
+  if (m_config_issue_time_ns != 0)
+  {
+    p_audio_interface->measure_at_start(m_config_issue_time_ns);
+    m_config_issue_time_ns = 0;
+  }
+
   if (!p_audio_interface->start())
   {
     LOG_ERROR("AudioEngine: Failed to start audio interface.");
@@ -248,13 +392,55 @@ void AudioEngine::update_state_start()
  */
 void AudioEngine::update_state_running()
 {
-  if (!p_audio_interface->is_stream_running())
+  // Tracks flag the end of their input from the callback instead of stopping the engine themselves
+  if (!p_audio_interface->is_stream_running() || p_audio_interface->is_end_of_input())
   {
     LOG_INFO("AudioEngine: Finished playing audio... Change state to Stopped.");
     m_state.store(eAudioEngineState::Stopped, std::memory_order_release);
   }
 }
 
+/** @brief Queue a transport command on the audio callback's command ring.
+ *  Commands bypass the engine thread: the callback applies them on their sample,
+ *  at most one block after they are pushed to a running stream.
+ */
+bool AudioEngine::push_transport_change(bool rolling, uint64_t sample_time, bool measure_latency)
+{
+  ParameterChange change;
+  change.sample_time = sample_time;
+  change.target = eParameterTarget::Transport;
+  change.value = rolling ? 1.0f : 0.0f;
+  change.issue_time_ns = measure_latency ? latency_timestamp_ns() : 0;
+
+  if (!p_audio_interface->push_parameter_change(change))
+  {
+    LOG_ERROR("AudioEngine: Command queue is full, dropped transport ", rolling ? "start" : "stop");
+    return false;
+  }
+  return true;
+}
+
+/** @brief Remember the oldest configuration change for the command latency of the next stream start
+ */
+void AudioEngine::note_config_change(int64_t issue_time_ns)
+{
+  if (m_config_issue_time_ns == 0)
+  {
+    m_config_issue_time_ns = issue_time_ns;
+  }
+}
+
+/** @brief Time a pending configuration change from the start request at the latest.
+ *  The engine may sit idle for any time between the two; that wait is not command latency.
+ */
+void AudioEngine::note_start_request(int64_t issue_time_ns)
+{
+  if (m_config_issue_time_ns != 0 && issue_time_ns > m_config_issue_time_ns)
+  {
+    m_config_issue_time_ns = issue_time_ns;
+  }
+}
+
 /** @brief Update State - Stopped
  */
 void AudioEngine::update_state_stopped()
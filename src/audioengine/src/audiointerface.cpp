@@ -5,6 +5,10 @@
 #include "devicemanager.h"
 #include "logger.h"
 
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
 // Define M_PI if not already defined (Windows MSVC compatibility)
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -14,7 +18,7 @@ using namespace MinimalAudioEngine;
 
 /** @brief Audio callback function
  *  @param output_buffer Pointer to the output audio buffer
- *  @param input_buffer Pointer to the input audio buffer (not used here)
+ *  @param input_buffer Pointer to the input audio buffer, nullptr unless input channels were opened
  *  @param n_frames Number of frames to process
  *  @param stream_time Current stream time
  *  @param status Stream status
@@ -24,11 +28,6 @@ using namespace MinimalAudioEngine;
 int audio_callback(void *output_buffer, void *input_buffer, unsigned int n_frames,
                    double stream_time, RtAudioStreamStatus status, void *user_data) noexcept
 {
-  if (input_buffer == nullptr)
-  {
-    // TODO - Input buffer not implemented
-  }
-
   if (output_buffer == nullptr)
   {
     LOG_ERROR("AudioInterface: Null output buffer in audio callback");
@@ -42,7 +41,7 @@ int audio_callback(void *output_buffer, void *input_buffer, unsigned int n_frame
   }
 
   AudioInterface *audio_interface = reinterpret_cast<AudioInterface *>(user_data);
-  audio_interface->process_audio(static_cast<float *>(output_buffer), n_frames);
+  audio_interface->process_audio(static_cast<float *>(output_buffer), n_frames, static_cast<const float *>(input_buffer));
 
   return 0;
 }
@@ -55,6 +54,13 @@ AudioInterface::AudioInterface() : m_buffer_frames(512),
                                    m_test_tone_enabled(false)
 {}
 
+/** @brief Get the TrackManager whose tracks are rendered
+ */
+TrackManager &AudioInterface::get_track_manager() const
+{
+  return m_track_manager != nullptr ? *m_track_manager : TrackManager::instance();
+}
+
 /** @brief Open audio stream on specified device
  *  @param device Audio output device to open
  *  @return true on success, false on failure
@@ -64,11 +70,22 @@ bool AudioInterface::open(const MinimalAudioEngine::AudioDevice &device)
   LOG_INFO("Open AudioInterface on device: ", device.to_string(), " as output.");
   
   unsigned int channels = device.output_channels;
+  // The callback renders in chunks of the render buffers, which must hold at least a frame
+  if (channels > AUDIO_MAX_CHANNELS || get_channels() > AUDIO_MAX_CHANNELS)
+  {
+    LOG_ERROR("AudioInterface: Unsupported channel count, device: ", channels, ", stream: ", get_channels(),
+              ", maximum: ", AUDIO_MAX_CHANNELS);
+    return false;
+  }
+
   unsigned int sample_rate = m_sample_rate.load(std::memory_order_relaxed);
   unsigned int buffer_frames = m_buffer_frames.load(std::memory_order_relaxed);
 
   LOG_INFO("AudioInterface: Open stream on device: ", device.id, ", with channels: ", channels, ", sample rate: ", sample_rate, ", buffer frames: ", buffer_frames);
   RtAudio::StreamParameters params{device.id, channels, 0};
+  // Duplex streams deliver input in the same callback, which latency measurement relies on
+  unsigned int input_channels = std::min(get_input_channels(), device.input_channels);
+  RtAudio::StreamParameters input_params{device.id, input_channels, 0};
 
   for (const auto &id : get_device_ids())
   {
@@ -77,7 +94,7 @@ bool AudioInterface::open(const MinimalAudioEngine::AudioDevice &device)
 
   RtAudioErrorType rc;
   rc = m_rtaudio.openStream(&params,
-                            nullptr,
+                            input_channels > 0 ? &input_params : nullptr,
                             RTAUDIO_FLOAT32,
                             sample_rate,
                             &buffer_frames,
@@ -104,11 +121,75 @@ bool AudioInterface::open(const MinimalAudioEngine::AudioDevice &device)
   return true;
 }
 
+/** @brief Open a raw PCM output stream in place of an audio device.
+ *  The interface takes its channel count and sample rate from the stream.
+ *  @param stream Output stream to drive
+ *  @return true on success, false on failure
+ */
+bool AudioInterface::open_stream(const PcmOutputStreamPtr &stream)
+{
+  if (!stream || stream->has_failed())
+  {
+    LOG_ERROR("AudioInterface: Output stream is not usable.");
+    return false;
+  }
+
+  if (stream->get_format().channels == 0 || stream->get_format().channels > AUDIO_MAX_CHANNELS)
+  {
+    LOG_ERROR("AudioInterface: Unsupported output stream channels: ", stream->get_format().channels,
+              ", maximum: ", AUDIO_MAX_CHANNELS);
+    return false;
+  }
+
+  LOG_INFO("AudioInterface: Open output stream: ", stream->to_string(), ", buffer frames: ", get_buffer_frames());
+
+  set_channels(stream->get_format().channels);
+  set_sample_rate(stream->get_format().sample_rate);
+  m_output_stream = stream;
+  m_should_close.store(true, std::memory_order_release);
+  return true;
+}
+
+/** @brief Let the host application pull blocks with render() instead of opening a device.
+ *  Uses the channel count and sample rate already set on the interface.
+ *  @return true on success, false on failure
+ */
+bool AudioInterface::open_host()
+{
+  unsigned int channels = get_channels();
+  if (channels == 0 || channels > AUDIO_HOST_MAX_CHANNELS || get_sample_rate() == 0)
+  {
+    LOG_ERROR("AudioInterface: Unsupported host format, channels: ", channels, ", sample rate: ", get_sample_rate());
+    return false;
+  }
+
+  LOG_INFO("AudioInterface: Open host output with channels: ", channels, ", sample rate: ", get_sample_rate());
+  m_host_driven.store(true, std::memory_order_release);
+  m_should_close.store(true, std::memory_order_release);
+  return true;
+}
+
 /** @brief Start the audio stream
  *  @return true on success, false on failure
  */
 bool AudioInterface::start()
 {
+  m_end_of_input.store(false, std::memory_order_release);
+
+  if (m_host_driven.load(std::memory_order_acquire))
+  {
+    m_host_running.store(true, std::memory_order_release);
+    return true;
+  }
+
+  if (m_output_stream)
+  {
+    m_stop_requested.store(false, std::memory_order_release);
+    m_output_stream_running.store(true, std::memory_order_release);
+    m_output_stream_thread = std::jthread([this](std::stop_token stop_token) { run_output_stream(stop_token); });
+    return true;
+  }
+
   RtAudioErrorType rc = m_rtaudio.startStream();
   if (rc == RTAUDIO_SYSTEM_ERROR)
   {
@@ -134,6 +215,33 @@ bool AudioInterface::start()
  */
 bool AudioInterface::close()
 {
+  if (m_host_driven.load(std::memory_order_acquire))
+  {
+    // The host keeps calling render(); it plays silence from here on
+    m_host_running.store(false, std::memory_order_release);
+    wait_for_callback_exit();
+    m_host_driven.store(false, std::memory_order_release);
+    m_should_close.store(false, std::memory_order_release);
+    LOG_INFO("AudioInterface: Closed host output.");
+    return true;
+  }
+
+  if (m_output_stream)
+  {
+    if (m_output_stream_thread.joinable())
+    {
+      m_output_stream_thread.request_stop();
+      m_output_stream_thread.join();
+    }
+
+    m_output_stream->flush();
+    m_output_stream.reset();
+    m_output_stream_running.store(false, std::memory_order_release);
+    m_should_close.store(false, std::memory_order_release);
+    LOG_INFO("AudioInterface: Closed output stream.");
+    return true;
+  }
+
   try
   {
     if (m_rtaudio.isStreamRunning())
@@ -161,11 +269,97 @@ bool AudioInterface::close()
   return true;
 }
 
+/** @brief Output stream thread: render blocks and write them to the stream.
+ *  Realtime streams are paced by the clock; freewheeling streams by how fast the
+ *  consumer reads. Ends on stop, or when the stream fails.
+ */
+void AudioInterface::run_output_stream(std::stop_token stop_token)
+{
+  const unsigned int buffer_frames = std::max(1u, get_buffer_frames());
+  const unsigned int channels = get_channels();
+  const bool realtime = m_output_stream->get_pacing() == ePcmPacing::Realtime;
+  const auto block_duration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    std::chrono::duration<double>(static_cast<double>(buffer_frames) / get_sample_rate()));
+
+  std::vector<float> block(static_cast<size_t>(buffer_frames) * channels);
+  auto deadline = std::chrono::steady_clock::now();
+
+  while (!stop_token.stop_requested() && !m_stop_requested.load(std::memory_order_acquire) &&
+         !m_end_of_input.load(std::memory_order_acquire))
+  {
+    process_audio(block.data(), buffer_frames);
+    if (!m_output_stream->write_frames(block.data(), buffer_frames, channels))
+    {
+      LOG_ERROR("AudioInterface: Output stream failed, stopping.");
+      break;
+    }
+
+    if (realtime)
+    {
+      deadline += block_duration;
+      auto now = std::chrono::steady_clock::now();
+      if (deadline < now - block_duration)
+      {
+        // Fell more than a block behind (slow consumer); resynchronize instead of bursting
+        deadline = now;
+      }
+      std::this_thread::sleep_until(deadline);
+    }
+  }
+
+  m_output_stream_running.store(false, std::memory_order_release);
+}
+
+/** @brief Render a block for the host application, on the host's thread.
+ *  Processes tracks, scheduled parameter changes and the transport clock exactly as the
+ *  device callback does, without allocating, locking or waking any engine thread.
+ *  Plays silence until the engine has been started with a host output, and after it stops.
+ *  @param output One buffer per channel, n_frames long each (non-interleaved)
+ *  @param n_frames Number of frames to render; any size, split into chunks internally
+ *  @return True if the engine rendered the block, false if it was silenced
+ */
+bool AudioInterface::render(float *const *output, unsigned int n_frames) noexcept
+{
+  unsigned int channels = get_channels();
+  if (output == nullptr || channels == 0)
+  {
+    return false;
+  }
+
+  if (!m_host_running.load(std::memory_order_acquire))
+  {
+    for (unsigned int ch = 0; ch < channels; ++ch)
+    {
+      std::fill(output[ch], output[ch] + n_frames, 0.0f);
+    }
+    return false;
+  }
+
+  unsigned int chunk_frames = static_cast<unsigned int>(m_host_buffer.size() / channels);
+  for (unsigned int offset = 0; offset < n_frames; offset += chunk_frames)
+  {
+    unsigned int frames = std::min(chunk_frames, n_frames - offset);
+    process_audio(m_host_buffer.data(), frames);
+
+    for (unsigned int ch = 0; ch < channels; ++ch)
+    {
+      float *destination = output[ch] + offset;
+      for (unsigned int i = 0; i < frames; ++i)
+      {
+        destination[i] = m_host_buffer[static_cast<size_t>(i) * channels + ch];
+      }
+    }
+  }
+
+  return true;
+}
+
 /** @brief Process audio frames
  *  @param output_buffer Pointer to the output buffer
  *  @param n_frames Number of frames to process
+ *  @param input_buffer Interleaved device input of the same callback, or nullptr
  */
-void AudioInterface::process_audio(float *output_buffer, unsigned int n_frames)
+void AudioInterface::process_audio(float *output_buffer, unsigned int n_frames, const float *input_buffer)
 {
   if (m_test_tone_enabled.load(std::memory_order_relaxed))
   {
@@ -189,26 +383,830 @@ void AudioInterface::process_audio(float *output_buffer, unsigned int n_frames)
     return;
   }
 
+  // Pairs with the fence in wait_for_callback_exit(): either that thread sees the odd epoch,
+  // or this block sees the slot it cleared
+  m_callback_epoch.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const auto block_start_time = std::chrono::steady_clock::now();
+
   // Placeholder implementation - fill output buffer with silence
   std::fill(output_buffer, output_buffer + n_frames * get_channels(), 0.0f);
 
-  // TODO - Get output buffer from the Tracks in the TrackManager
-  MinimalAudioEngine::TrackManager &track_manager = MinimalAudioEngine::TrackManager::instance();
+  uint64_t block_start = m_frames_processed.load(std::memory_order_relaxed);
+  update_clock(block_start);
+  collect_parameter_changes(block_start);
+  begin_track_blocks(n_frames, block_start);
+
+  // Split the block at each scheduled change so it lands on its exact sample
+  unsigned int channels = get_channels();
+  unsigned int offset = 0;
+  size_t applied = 0;
+  while (offset < n_frames)
+  {
+    while (applied < m_pending_count && m_pending_changes[applied].sample_time <= block_start + offset)
+    {
+      apply_parameter_change(m_pending_changes[applied++]);
+    }
+
+    unsigned int end = n_frames;
+    if (applied < m_pending_count && m_pending_changes[applied].sample_time < block_start + n_frames)
+    {
+      end = static_cast<unsigned int>(m_pending_changes[applied].sample_time - block_start);
+    }
+
+    // A stopped transport leaves the rest of the block silent and the track positions where they are
+    if (m_transport_rolling.load(std::memory_order_relaxed))
+    {
+      render_tracks(output_buffer + static_cast<size_t>(offset) * channels, end - offset, block_start + offset);
+    }
+    offset = end;
+  }
+
+  process_latency_meter(output_buffer, input_buffer, n_frames);
+  update_meters(output_buffer, n_frames, channels);
+  write_taps(AUDIO_TAP_SOURCE_MASTER, output_buffer, n_frames);
+  write_recorder(RECORDER_SOURCE_MASTER, output_buffer, n_frames, block_start);
+  record_command_latency(applied);
+
+  std::move(m_pending_changes.begin() + applied, m_pending_changes.begin() + m_pending_count, m_pending_changes.begin());
+  m_pending_count -= applied;
+  update_callback_load(block_start_time, n_frames);
+
+  m_callback_epoch.fetch_add(1, std::memory_order_release);
+}
+
+/** @brief Glide each routed track's gain parameter and collect its MIDI for the whole block, before
+ *  it is split for parameter changes, so the events keep their offsets from the block's first frame.
+ *  @param n_frames Number of frames in the block
+ *  @param block_start Transport sample of the block's first frame
+ */
+void AudioInterface::begin_track_blocks(unsigned int n_frames, uint64_t block_start) noexcept
+{
+  MinimalAudioEngine::TrackManager &track_manager = get_track_manager();
+  const unsigned int sample_rate = get_sample_rate();
+  const bool host_driven = m_host_driven.load(std::memory_order_relaxed);
+
+  for (size_t i = 0; i < track_manager.get_track_count(); ++i)
+  {
+    const TrackPtr track = track_manager.get_track(i);
+    if (track->has_audio_output() || (host_driven && track->has_audio_input()))
+    {
+      track->apply_gain_parameter(n_frames, sample_rate);
+      track->process_midi_block(n_frames, sample_rate, block_start);
+    }
+  }
+}
+
+/** @brief Mix all tracks into part of the output buffer and apply the master gain.
+ *  Each track renders on its own into the track buffer so its taps see only that track.
+ *  Flags the end of input once every track's input has run out. Stopped tracks do not end
+ *  the stream, so they can be relaunched on any sample while the transport plays.
+ *  @param output_buffer Interleaved output at the first frame to render, already silenced
+ *  @param n_frames Number of frames to render
+ *  @param sample_time Transport sample of the first frame, for tracks' scheduled starts and stops
+ */
+void AudioInterface::render_tracks(float *output_buffer, unsigned int n_frames, uint64_t sample_time) noexcept
+{
+  MinimalAudioEngine::TrackManager &track_manager = get_track_manager();
+  const unsigned int channels = get_channels();
+  const unsigned int sample_rate = get_sample_rate();
+  // With a host output there is no device to route to; every track plays into the host's buffer
+  const bool host_driven = m_host_driven.load(std::memory_order_relaxed);
+  const unsigned int chunk_frames = static_cast<unsigned int>(m_track_buffer.size() / channels);
+
+  bool rendered = false;
+  bool playing = false;
+  for (unsigned int offset = 0; offset < n_frames; offset += chunk_frames)
+  {
+    unsigned int frames = std::min(chunk_frames, n_frames - offset);
+    size_t samples = static_cast<size_t>(frames) * channels;
+    float *output = output_buffer + static_cast<size_t>(offset) * channels;
+
+    for (size_t i = 0; i < track_manager.get_track_count(); ++i)
+    {
+      const TrackPtr track = track_manager.get_track(i);
+      // TODO - Check if audio output matches the interface settings
+      if (!track->has_audio_output() && !(host_driven && track->has_audio_input()))
+      {
+        continue;
+      }
+
+      std::fill(m_track_buffer.begin(), m_track_buffer.begin() + samples, 0.0f);
+      playing |= track->get_next_audio_frame(m_track_buffer.data(), frames, channels, sample_rate, sample_time + offset);
+      rendered = true;
+
+      write_taps(static_cast<uint32_t>(i), m_track_buffer.data(), frames);
+      write_recorder(static_cast<uint32_t>(i), m_track_buffer.data(), frames, sample_time + offset);
+      process_loop_recorder(static_cast<uint32_t>(i), m_track_buffer.data(), frames, sample_time + offset);
+      for (size_t s = 0; s < samples; ++s)
+      {
+        output[s] += m_track_buffer[s];
+      }
+    }
+  }
+
+  if (rendered && !playing)
+  {
+    m_end_of_input.store(true, std::memory_order_release);
+  }
+
+  float master_gain = m_master_gain.load(std::memory_order_relaxed);
+  if (master_gain != 1.0f)
+  {
+    for (size_t i = 0; i < static_cast<size_t>(n_frames) * get_channels(); ++i)
+    {
+      output_buffer[i] *= master_gain;
+    }
+  }
+}
+
+/** @brief Write a block to every tap on the given source
+ *  @param source Track index, or AUDIO_TAP_SOURCE_MASTER
+ */
+void AudioInterface::write_taps(uint32_t source, const float *output_buffer, unsigned int n_frames) noexcept
+{
+  for (auto &slot : m_tap_slots)
+  {
+    AudioTap *tap = slot.load(std::memory_order_acquire);
+    if (tap != nullptr && tap->get_source() == source)
+    {
+      tap->write(output_buffer, n_frames, get_channels());
+    }
+  }
+}
+
+/** @brief Add a shared-memory tap on the master output or a track.
+ *  @param name Shared memory name readers attach to.
+ *  @param source Track index, or AUDIO_TAP_SOURCE_MASTER.
+ *  @param capacity_frames Ring size in frames.
+ *  @return False if the name is in use, all slots are taken or the tap cannot be created.
+ */
+bool AudioInterface::add_tap(const std::string &name, uint32_t source, uint32_t capacity_frames)
+{
+  std::lock_guard<std::mutex> lock(m_tap_mutex);
+
+  auto slot = std::find_if(m_tap_slots.begin(), m_tap_slots.end(),
+                           [](const std::atomic<AudioTap *> &s) { return s.load(std::memory_order_relaxed) == nullptr; });
+  if (slot == m_tap_slots.end())
+  {
+    LOG_ERROR("AudioInterface: All ", AUDIO_TAP_MAX_TAPS, " tap slots are in use");
+    return false;
+  }
+
+  // Check before creating, which would replace the existing tap's shared memory
+  std::string object_name = name.starts_with("/") ? name : "/" + name;
+  for (const auto &existing : m_taps)
+  {
+    if (existing->get_name() == object_name)
+    {
+      LOG_ERROR("AudioInterface: A tap named ", name, " already exists");
+      return false;
+    }
+  }
+
+  // Device and stream blocks are written whole; host blocks in render buffer chunks
+  const uint32_t max_block_frames = std::max<uint32_t>(get_buffer_frames(),
+                                                       static_cast<uint32_t>(AUDIO_RENDER_BUFFER_SAMPLES / get_channels()));
+  auto tap = AudioTap::create(name, get_channels(), get_sample_rate(), capacity_frames, source, max_block_frames);
+  if (!tap)
+  {
+    return false;
+  }
+
+  slot->store(tap.get(), std::memory_order_release);
+  m_taps.push_back(std::move(tap));
+  return true;
+}
+
+/** @brief Remove a tap. Waits for a running callback to finish before freeing it.
+ *  @param name Name the tap was added with.
+ *  @return False if there is no such tap.
+ */
+bool AudioInterface::remove_tap(const std::string &name)
+{
+  std::lock_guard<std::mutex> lock(m_tap_mutex);
+
+  std::string object_name = name.starts_with("/") ? name : "/" + name;
+  auto it = std::find_if(m_taps.begin(), m_taps.end(),
+                         [&object_name](const std::unique_ptr<AudioTap> &tap) { return tap->get_name() == object_name; });
+  if (it == m_taps.end())
+  {
+    return false;
+  }
+
+  for (auto &slot : m_tap_slots)
+  {
+    AudioTap *expected = it->get();
+    slot.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel);
+  }
+
+  wait_for_callback_exit();
+  m_taps.erase(it);
+  return true;
+}
+
+/** @brief Describe all taps
+ */
+std::vector<std::string> AudioInterface::get_tap_descriptions() const
+{
+  std::lock_guard<std::mutex> lock(m_tap_mutex);
+
+  std::vector<std::string> descriptions;
+  for (const auto &tap : m_taps)
+  {
+    descriptions.push_back(tap->to_string());
+  }
+  return descriptions;
+}
+
+/** @brief Pass a block to the running recording, if any
+ *  @param source Track index, or RECORDER_SOURCE_MASTER
+ *  @param sample_time Transport sample of the first frame
+ */
+void AudioInterface::write_recorder(uint32_t source, const float *output_buffer, unsigned int n_frames,
+                                    uint64_t sample_time) noexcept
+{
+  Recorder *recorder = m_recorder_slot.load(std::memory_order_acquire);
+  if (recorder != nullptr)
+  {
+    recorder->write(source, output_buffer, n_frames, get_channels(), sample_time);
+  }
+}
+
+/** @brief Start recording every record-armed track, and the master output if requested.
+ *  Tracks are recorded as rendered, before the master gain, while the transport rolls.
+ *  With options.punch_in set to RECORDER_NO_PUNCH the sources are only captured into
+ *  the pre-roll buffer until punch_in() is called.
+ *  @param options Output directory, buffering and punch points.
+ *  @return False if a recording is already running or the files cannot be created.
+ */
+bool AudioInterface::start_recording(const RecordingOptions &options)
+{
+  std::lock_guard<std::mutex> lock(m_recorder_mutex);
+  if (m_recorder)
+  {
+    LOG_ERROR("AudioInterface: A recording is already running");
+    return false;
+  }
+
+  std::vector<uint32_t> tracks;
+  TrackManager &track_manager = get_track_manager();
   for (size_t i = 0; i < track_manager.get_track_count(); ++i)
   {
-    auto track = track_manager.get_track(i);
-    // TODO - Check if audio output matches the interface settings
-    if (track->has_audio_output())
+    if (track_manager.get_track(i)->is_record_armed())
     {
-      track->get_next_audio_frame(output_buffer, n_frames, get_channels(), get_sample_rate());
+      tracks.push_back(static_cast<uint32_t>(i));
     }
   }
+
+  auto recorder = Recorder::create(options, tracks, get_channels(), get_sample_rate());
+  if (!recorder)
+  {
+    return false;
+  }
+
+  m_recorder_slot.store(recorder.get(), std::memory_order_release);
+  m_recorder = std::move(recorder);
+  return true;
+}
+
+/** @brief Stop the recording and wait for its files to be written and closed.
+ *  @return The final counters, or nullopt if nothing was recording.
+ */
+std::optional<RecordingStatistics> AudioInterface::stop_recording()
+{
+  std::lock_guard<std::mutex> lock(m_recorder_mutex);
+  if (!m_recorder)
+  {
+    return std::nullopt;
+  }
+
+  m_recorder_slot.store(nullptr, std::memory_order_release);
+  wait_for_callback_exit();
+
+  RecordingStatistics statistics = m_recorder->finish();
+  m_recorder.reset();
+  return statistics;
+}
+
+/** @brief Start the running recording's takes at a transport sample.
+ *  @param sample_time Transport sample, or 0 for the next block.
+ *  @return False if nothing is recording.
+ */
+bool AudioInterface::punch_in(uint64_t sample_time)
+{
+  std::lock_guard<std::mutex> lock(m_recorder_mutex);
+  if (!m_recorder)
+  {
+    return false;
+  }
+
+  m_recorder->punch_in(sample_time);
+  return true;
+}
+
+/** @brief End the running recording's takes at a transport sample. The files stay open until stop_recording().
+ *  @param sample_time Transport sample, or 0 for the next block.
+ *  @return False if nothing is recording.
+ */
+bool AudioInterface::punch_out(uint64_t sample_time)
+{
+  std::lock_guard<std::mutex> lock(m_recorder_mutex);
+  if (!m_recorder)
+  {
+    return false;
+  }
+
+  m_recorder->punch_out(sample_time);
+  return true;
+}
+
+bool AudioInterface::is_recording() const
+{
+  std::lock_guard<std::mutex> lock(m_recorder_mutex);
+  return m_recorder != nullptr;
+}
+
+/** @brief Counters of the running recording, or nullopt if nothing is recording
+ */
+std::optional<RecordingStatistics> AudioInterface::get_recording_statistics() const
+{
+  std::lock_guard<std::mutex> lock(m_recorder_mutex);
+  if (!m_recorder)
+  {
+    return std::nullopt;
+  }
+  return m_recorder->get_statistics();
+}
+
+/** @brief Record a track's block into the loop recording, if any, and mix in its selected take.
+ *  Runs after the taps and the disk recorder, so those see the track without its takes.
+ *  @param track Track index
+ *  @param sample_time Transport sample of the first frame
+ */
+void AudioInterface::process_loop_recorder(uint32_t track, float *track_buffer, unsigned int n_frames,
+                                           uint64_t sample_time) noexcept
+{
+  LoopRecorder *loop_recorder = m_loop_recorder_slot.load(std::memory_order_acquire);
+  if (loop_recorder != nullptr)
+  {
+    loop_recorder->process(track, track_buffer, n_frames, get_channels(), sample_time);
+  }
+}
+
+/** @brief Loop record every record-armed track: each pass over the loop region becomes a new take.
+ *  Tracks are recorded as rendered while the transport rolls, and play their selected take on top.
+ *  @param options Loop region, takes kept in memory and output directory.
+ *  @return False if a loop recording is already running or the take pool cannot be allocated.
+ */
+bool AudioInterface::start_loop_recording(const LoopRecordingOptions &options)
+{
+  std::lock_guard<std::mutex> lock(m_loop_recorder_mutex);
+  if (m_loop_recorder)
+  {
+    LOG_ERROR("AudioInterface: A loop recording is already running");
+    return false;
+  }
+
+  std::vector<uint32_t> tracks;
+  TrackManager &track_manager = get_track_manager();
+  for (size_t i = 0; i < track_manager.get_track_count(); ++i)
+  {
+    if (track_manager.get_track(i)->is_record_armed())
+    {
+      tracks.push_back(static_cast<uint32_t>(i));
+    }
+  }
+
+  auto loop_recorder = LoopRecorder::create(options, tracks, get_channels(), get_sample_rate());
+  if (!loop_recorder)
+  {
+    return false;
+  }
+
+  m_loop_recorder_slot.store(loop_recorder.get(), std::memory_order_release);
+  m_loop_recorder = std::move(loop_recorder);
+  return true;
+}
+
+/** @brief Stop the loop recording and wait for its takes to be written. Takes stop playing.
+ *  @return The final counters, or nullopt if nothing was loop recording.
+ */
+std::optional<LoopRecordingStatistics> AudioInterface::stop_loop_recording()
+{
+  std::lock_guard<std::mutex> lock(m_loop_recorder_mutex);
+  if (!m_loop_recorder)
+  {
+    return std::nullopt;
+  }
+
+  m_loop_recorder_slot.store(nullptr, std::memory_order_release);
+  wait_for_callback_exit();
+
+  LoopRecordingStatistics statistics = m_loop_recorder->finish();
+  m_loop_recorder.reset();
+  return statistics;
+}
+
+/** @brief Choose the take a loop recorded track plays, from the next block on.
+ *  @param take Take index, or LOOP_TAKE_NONE.
+ *  @return False if nothing is loop recording or the take is not available.
+ */
+bool AudioInterface::select_take(uint32_t track, int take)
+{
+  std::lock_guard<std::mutex> lock(m_loop_recorder_mutex);
+  if (!m_loop_recorder)
+  {
+    LOG_ERROR("AudioInterface: No loop recording is running");
+    return false;
+  }
+  return m_loop_recorder->select_take(track, take);
+}
+
+int AudioInterface::get_selected_take(uint32_t track) const
+{
+  std::lock_guard<std::mutex> lock(m_loop_recorder_mutex);
+  return m_loop_recorder ? m_loop_recorder->get_selected_take(track) : LOOP_TAKE_NONE;
+}
+
+/** @brief Takes of a loop recorded track, empty if nothing is loop recording
+ */
+std::vector<LoopTakeInfo> AudioInterface::get_loop_takes(uint32_t track) const
+{
+  std::lock_guard<std::mutex> lock(m_loop_recorder_mutex);
+  return m_loop_recorder ? m_loop_recorder->get_takes(track) : std::vector<LoopTakeInfo>{};
+}
+
+bool AudioInterface::is_loop_recording() const
+{
+  std::lock_guard<std::mutex> lock(m_loop_recorder_mutex);
+  return m_loop_recorder != nullptr;
+}
+
+/** @brief Play the running latency measurement's excitation in place of the mix and capture the input.
+ *  The virtual loopback, when enabled, replaces the device input.
+ *  @param input_buffer Interleaved device input, or nullptr
+ */
+void AudioInterface::process_latency_meter(float *output_buffer, const float *input_buffer,
+                                           unsigned int n_frames) noexcept
+{
+  LatencyMeter *meter = m_latency_meter_slot.load(std::memory_order_acquire);
+  VirtualLoopback *loopback = m_loopback_slot.load(std::memory_order_acquire);
+  if (loopback != nullptr && loopback->get_channels() != get_channels())
+  {
+    // Enabled for another channel count; the interface was reopened since
+    loopback = nullptr;
+  }
+  if (meter == nullptr && loopback == nullptr)
+    return;
+
+  if (meter != nullptr)
+  {
+    meter->generate(output_buffer, n_frames);
+  }
+
+  if (loopback == nullptr)
+  {
+    meter->capture(input_buffer, n_frames, get_input_channels());
+    return;
+  }
+
+  // The loopback keeps running between measurements so its delay line holds real history
+  const unsigned int channels = loopback->get_channels();
+  for (unsigned int offset = 0; offset < n_frames; offset += VIRTUAL_LOOPBACK_CHUNK_FRAMES)
+  {
+    unsigned int frames = std::min(VIRTUAL_LOOPBACK_CHUNK_FRAMES, n_frames - offset);
+    const float *input = loopback->process(output_buffer + static_cast<size_t>(offset) * channels, frames);
+    if (meter != nullptr)
+    {
+      meter->capture(input, frames, channels);
+    }
+  }
+}
+
+/** @brief Measure the round trip from output to input by playing a maximum length sequence.
+ *  The excitation replaces the mix on every channel while the measurement runs. Needs a
+ *  running stream with input channels or the virtual loopback. Blocks until the capture
+ *  is complete; a host-driven interface must keep calling render() meanwhile.
+ *  @param options Excitation, channels and search range.
+ *  @param timeout Longest wait for the capture.
+ *  @return The round trip, or nullopt if it could not be measured.
+ */
+std::optional<LatencyMeasurement> AudioInterface::measure_round_trip_latency(const LatencyMeterOptions &options,
+                                                                             std::chrono::milliseconds timeout)
+{
+  std::lock_guard<std::mutex> lock(m_latency_mutex);
+  if (!is_stream_running())
+  {
+    LOG_ERROR("AudioInterface: Latency measurement needs a running stream");
+    return std::nullopt;
+  }
+
+  const bool has_input = m_loopback != nullptr || (!m_output_stream && !m_host_driven.load(std::memory_order_acquire) &&
+                                                   get_input_channels() > 0);
+  if (!has_input)
+  {
+    LOG_ERROR("AudioInterface: Latency measurement needs input channels or the virtual loopback");
+    return std::nullopt;
+  }
+
+  auto meter = LatencyMeter::create(options, get_channels(), get_sample_rate());
+  if (!meter)
+  {
+    return std::nullopt;
+  }
+
+  m_latency_meter_slot.store(meter.get(), std::memory_order_release);
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (!meter->is_complete() && std::chrono::steady_clock::now() < deadline && is_stream_running())
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  m_latency_meter_slot.store(nullptr, std::memory_order_release);
+  wait_for_callback_exit();
+
+  if (!meter->is_complete())
+  {
+    LOG_ERROR("AudioInterface: Latency measurement timed out");
+    return std::nullopt;
+  }
+
+  auto measurement = meter->analyze();
+  if (measurement.has_value())
+  {
+    measurement->virtual_loopback = m_loopback != nullptr;
+    LOG_INFO("AudioInterface: Round trip of ", measurement->to_string());
+  }
+  return measurement;
+}
+
+/** @brief Feed the output back as input after a fixed delay, for streams without a device input.
+ *  Replaces any loopback already enabled.
+ *  @param delay_frames Round trip to simulate.
+ *  @param gain Gain of the returned signal.
+ *  @return False if the interface has no channels yet.
+ */
+bool AudioInterface::enable_virtual_loopback(uint32_t delay_frames, float gain)
+{
+  if (get_channels() == 0)
+  {
+    LOG_ERROR("AudioInterface: Cannot loop back an interface without channels");
+    return false;
+  }
+
+  disable_virtual_loopback();
+
+  std::lock_guard<std::mutex> lock(m_latency_mutex);
+  m_loopback = std::make_unique<VirtualLoopback>(delay_frames, get_channels(), gain);
+  m_loopback_slot.store(m_loopback.get(), std::memory_order_release);
+  LOG_INFO("AudioInterface: Virtual loopback with ", delay_frames, " frames of delay");
+  return true;
+}
+
+void AudioInterface::disable_virtual_loopback()
+{
+  std::lock_guard<std::mutex> lock(m_latency_mutex);
+  if (!m_loopback)
+  {
+    return;
+  }
+
+  m_loopback_slot.store(nullptr, std::memory_order_release);
+  wait_for_callback_exit();
+  m_loopback.reset();
+}
+
+/** @brief Wait until a callback that may have seen a removed pointer has returned.
+ *  Call after clearing the slot. The slot store and the epoch load are a store followed by a
+ *  load of another variable, which acquire and release do not order; the seq_cst fence here and
+ *  the one after the callback enters do.
+ */
+void AudioInterface::wait_for_callback_exit() const
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  uint64_t epoch = m_callback_epoch.load(std::memory_order_acquire);
+  while ((epoch & 1) != 0 && m_callback_epoch.load(std::memory_order_acquire) == epoch)
+  {
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+}
+
+/** @brief Queue a parameter change for the audio callback.
+ *  @param change The change and the transport sample it applies at.
+ *  @return False if the queue is full and the change was dropped.
+ */
+bool AudioInterface::push_parameter_change(const ParameterChange &change)
+{
+  std::lock_guard<std::mutex> lock(m_parameter_producer_mutex);
+  return m_parameter_ring.try_push(change);
+}
+
+/** @brief Move queued changes into the pending list, keeping it sorted by sample time.
+ *  Changes stay in the ring while the pending list is full.
+ *  @param block_start Transport sample at the start of the current block
+ */
+void AudioInterface::collect_parameter_changes(uint64_t block_start) noexcept
+{
+  ParameterChange change;
+  while (m_pending_count < AUDIO_PARAMETER_MAX_PENDING && m_parameter_ring.try_pop(change))
+  {
+    change.sample_time = std::max(change.sample_time, block_start);
+
+    // Insert after changes with the same time so they apply in arrival order
+    auto end = m_pending_changes.begin() + m_pending_count;
+    auto position = std::upper_bound(m_pending_changes.begin(), end, change,
+      [](const ParameterChange &a, const ParameterChange &b) { return a.sample_time < b.sample_time; });
+    std::move_backward(position, end, end + 1);
+    *position = change;
+    ++m_pending_count;
+  }
+}
+
+/** @brief Apply a parameter change on the audio thread
+ */
+void AudioInterface::apply_parameter_change(const ParameterChange &change) noexcept
+{
+  if (change.target == eParameterTarget::MasterGain)
+  {
+    m_master_gain.store(change.value, std::memory_order_relaxed);
+    return;
+  }
+
+  if (change.target == eParameterTarget::Transport)
+  {
+    m_transport_rolling.store(change.value != 0.0f, std::memory_order_release);
+    return;
+  }
+
+  MinimalAudioEngine::TrackManager &track_manager = get_track_manager();
+  if (change.track_index >= track_manager.get_track_count())
+  {
+    return;
+  }
+
+  auto track = track_manager.get_track(change.track_index);
+  if (change.target == eParameterTarget::TrackGain)
+  {
+    track->set_gain(change.value);
+  }
+  else if (change.target == eParameterTarget::TrackMute)
+  {
+    track->set_muted(change.value != 0.0f);
+  }
+}
+
+/** @brief Record the latency of the timestamped commands this block applied, now that it is rendered
+ *  @param applied Number of pending changes applied in this block
+ */
+void AudioInterface::record_command_latency(size_t applied) noexcept
+{
+  int64_t start_issue_time_ns = m_start_issue_time_ns.exchange(0, std::memory_order_acq_rel);
+  int64_t now_ns = 0;
+  auto record = [&](int64_t issue_time_ns) {
+    if (now_ns == 0)
+    {
+      now_ns = latency_timestamp_ns();
+    }
+    m_command_latency.record(std::chrono::nanoseconds(now_ns - issue_time_ns));
+  };
+
+  if (start_issue_time_ns != 0)
+  {
+    record(start_issue_time_ns);
+  }
+
+  for (size_t i = 0; i < applied; ++i)
+  {
+    if (m_pending_changes[i].issue_time_ns != 0)
+    {
+      record(m_pending_changes[i].issue_time_ns);
+    }
+  }
+}
+
+/** @brief Publish the transport position and time of the current block
+ */
+void AudioInterface::update_clock(uint64_t block_start) noexcept
+{
+  int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+
+  uint32_t sequence = m_clock_sequence.load(std::memory_order_relaxed);
+  m_clock_sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  m_clock_sample.store(block_start, std::memory_order_relaxed);
+  m_clock_time_ns.store(now_ns, std::memory_order_relaxed);
+  m_clock_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+/** @brief Estimate the transport sample that will play at a given time.
+ *  Extrapolates from the start of the last block at the stream sample rate.
+ *  @param time A steady clock time, usually in the near future
+ *  @return Transport sample position, never before the last block
+ */
+uint64_t AudioInterface::get_sample_time_at(std::chrono::steady_clock::time_point time) const
+{
+  uint32_t sequence;
+  uint64_t sample;
+  int64_t time_ns;
+  do
+  {
+    sequence = m_clock_sequence.load(std::memory_order_acquire);
+    sample = m_clock_sample.load(std::memory_order_relaxed);
+    time_ns = m_clock_time_ns.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while ((sequence & 1) != 0 || sequence != m_clock_sequence.load(std::memory_order_relaxed));
+
+  if (time_ns == 0)
+  {
+    // No block processed yet
+    return sample;
+  }
+
+  int64_t target_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+  int64_t delta_frames = (target_ns - time_ns) * static_cast<int64_t>(get_sample_rate()) / 1000000000;
+  return delta_frames > 0 ? sample + static_cast<uint64_t>(delta_frames) : sample;
+}
+
+/** @brief Update output peak meters with the block just rendered
+ *  @param output_buffer Interleaved output buffer
+ *  @param n_frames Number of frames in the buffer
+ *  @param channels Number of interleaved channels
+ */
+void AudioInterface::update_meters(const float *output_buffer, unsigned int n_frames, unsigned int channels) noexcept
+{
+  unsigned int metered_channels = std::min(channels, AUDIO_METER_MAX_CHANNELS);
+
+  for (unsigned int ch = 0; ch < metered_channels; ++ch)
+  {
+    float peak = 0.0f;
+    for (unsigned int i = 0; i < n_frames; ++i)
+    {
+      peak = std::max(peak, std::abs(output_buffer[i * channels + ch]));
+    }
+
+    // Hold the highest peak until the next reader resets it
+    float held = m_output_peaks[ch].load(std::memory_order_relaxed);
+    while (peak > held && !m_output_peaks[ch].compare_exchange_weak(held, peak, std::memory_order_relaxed))
+    {
+    }
+  }
+
+  m_frames_processed.fetch_add(n_frames, std::memory_order_relaxed);
+}
+
+/** @brief Update the callback load with the block just rendered.
+ *  Rises to a new peak at once and decays over a few dozen blocks, so background
+ *  work backs off quickly and returns gradually.
+ *  @param block_start_time When process_audio started the block
+ *  @param n_frames Number of frames in the block
+ */
+void AudioInterface::update_callback_load(std::chrono::steady_clock::time_point block_start_time, unsigned int n_frames) noexcept
+{
+  unsigned int sample_rate = get_sample_rate();
+  if (sample_rate == 0 || n_frames == 0)
+  {
+    return;
+  }
+
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - block_start_time).count();
+  float load = static_cast<float>(elapsed * sample_rate / n_frames);
+
+  float held = m_callback_load.load(std::memory_order_relaxed);
+  m_callback_load.store(load > held ? load : held + 0.05f * (load - held), std::memory_order_relaxed);
+}
+
+/** @brief Get the output peak of each channel since the last reset
+ *  @param reset If true, the held peaks are cleared
+ *  @return Linear peak values, one per output channel
+ */
+std::vector<float> AudioInterface::get_output_peaks(bool reset)
+{
+  unsigned int channels = std::min(get_channels(), AUDIO_METER_MAX_CHANNELS);
+  std::vector<float> peaks(channels, 0.0f);
+
+  for (unsigned int ch = 0; ch < channels; ++ch)
+  {
+    peaks[ch] = reset ? m_output_peaks[ch].exchange(0.0f, std::memory_order_relaxed)
+                      : m_output_peaks[ch].load(std::memory_order_relaxed);
+  }
+
+  return peaks;
 }
 
 /** @brief AudioInterface destructor
  */
 AudioInterface::~AudioInterface()
 {
+  stop_recording();
+  stop_loop_recording();
+
+  if (m_output_stream || m_host_driven.load(std::memory_order_acquire))
+  {
+    close();
+    return;
+  }
+
   if (m_should_close.load(std::memory_order_acquire))
   {
     try
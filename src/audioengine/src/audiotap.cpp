@@ -0,0 +1,405 @@
+#include "audiotap.h"
+
+#include "logger.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+/** @brief Shared memory object names must start with a single slash
+ */
+std::string shm_name(const std::string &name)
+{
+  return name.starts_with("/") ? name : "/" + name;
+}
+
+#ifdef __linux__
+void futex_wake_all(std::atomic<uint32_t> *word)
+{
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+void futex_wait(std::atomic<uint32_t> *word, uint32_t expected, std::chrono::milliseconds timeout)
+{
+  timespec ts{static_cast<time_t>(timeout.count() / 1000), static_cast<long>((timeout.count() % 1000) * 1000000)};
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+}
+#endif
+
+}  // namespace
+
+#ifndef _WIN32
+
+/** @brief Create the shared memory object for a tap and map it.
+ *  An object with the same name left behind by a previous run is replaced.
+ *  @param name Shared memory name, e.g. "/mae_master".
+ *  @param channels Interleaved channels per frame.
+ *  @param sample_rate Sample rate, recorded for readers.
+ *  @param capacity_frames Ring size in frames, rounded up to a page-aligned power of two of at least
+ *  AUDIO_TAP_BLOCKS_PER_RING blocks.
+ *  @param source Track index, or AUDIO_TAP_SOURCE_MASTER.
+ *  @param max_block_frames Largest block the writer is expected to write, or 0 if unknown.
+ *  @return The tap, or nullptr on failure.
+ */
+std::unique_ptr<AudioTap> AudioTap::create(const std::string &name, unsigned int channels, unsigned int sample_rate,
+                                           uint32_t capacity_frames, uint32_t source, uint32_t max_block_frames)
+{
+  if (channels == 0)
+  {
+    LOG_ERROR("AudioTap: Cannot create a tap with zero channels");
+    return nullptr;
+  }
+
+  size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t frame_bytes = channels * sizeof(float);
+  // Readers keep a block clear of the writer, so the ring must hold several of them
+  size_t capacity = std::bit_ceil(std::max<size_t>({capacity_frames, 1024,
+                                                    static_cast<size_t>(max_block_frames) * AUDIO_TAP_BLOCKS_PER_RING}));
+  while ((capacity * frame_bytes) % page_size != 0)
+  {
+    capacity *= 2;
+  }
+
+  std::unique_ptr<AudioTap> tap(new AudioTap());
+  tap->m_name = shm_name(name);
+  tap->m_data_bytes = capacity * frame_bytes;
+  size_t data_offset = std::max(AUDIO_TAP_HEADER_SIZE, page_size);
+  size_t object_size = data_offset + tap->m_data_bytes;
+
+  shm_unlink(tap->m_name.c_str());
+  int fd = shm_open(tap->m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0 || ftruncate(fd, static_cast<off_t>(object_size)) != 0)
+  {
+    LOG_ERROR("AudioTap: Failed to create shared memory ", tap->m_name, ": ", std::strerror(errno));
+    if (fd >= 0)
+    {
+      close(fd);
+      shm_unlink(tap->m_name.c_str());
+    }
+    return nullptr;
+  }
+
+  // Reserve room for the data twice, then map the data pages over both halves
+  tap->m_mapping_size = object_size + tap->m_data_bytes;
+  void *base = mmap(nullptr, tap->m_mapping_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base != MAP_FAILED)
+  {
+    uint8_t *bytes = static_cast<uint8_t *>(base);
+    bool mapped = mmap(bytes, object_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED &&
+                  mmap(bytes + object_size, tap->m_data_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd,
+                       static_cast<off_t>(data_offset)) != MAP_FAILED;
+    if (mapped)
+    {
+      tap->m_mapping = base;
+      tap->m_mirrored = true;
+    }
+    else
+    {
+      munmap(base, tap->m_mapping_size);
+    }
+  }
+
+  if (!tap->m_mirrored)
+  {
+    // Fall back to a single mapping; wrapping blocks then take two copies
+    tap->m_mapping_size = object_size;
+    base = mmap(nullptr, object_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED)
+    {
+      LOG_ERROR("AudioTap: Failed to map shared memory ", tap->m_name, ": ", std::strerror(errno));
+      close(fd);
+      shm_unlink(tap->m_name.c_str());
+      return nullptr;
+    }
+    tap->m_mapping = base;
+  }
+  close(fd);
+
+  uint8_t *bytes = static_cast<uint8_t *>(tap->m_mapping);
+  tap->m_header = new (bytes) AudioTapHeader{};
+  tap->m_data = reinterpret_cast<float *>(bytes + data_offset);
+
+  // Fault the pages in now rather than in the audio callback
+  std::memset(tap->m_data, 0, tap->m_data_bytes);
+  mlock(tap->m_mapping, object_size);
+
+  tap->m_header->version = AUDIO_TAP_VERSION;
+  tap->m_header->channels = channels;
+  tap->m_header->sample_rate = sample_rate;
+  tap->m_header->capacity_frames = static_cast<uint32_t>(capacity);
+  tap->m_header->source = source;
+  tap->m_header->data_offset = static_cast<uint32_t>(data_offset);
+  tap->m_header->max_block_frames.store(max_block_frames, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  tap->m_header->magic = AUDIO_TAP_MAGIC;
+
+  LOG_INFO("AudioTap: Created ", tap->to_string());
+  return tap;
+}
+
+/** @brief Unmap and remove the shared memory object. Attached readers keep their mapping.
+ */
+AudioTap::~AudioTap()
+{
+  if (m_mapping != nullptr)
+  {
+    munmap(m_mapping, m_mapping_size);
+    shm_unlink(m_name.c_str());
+  }
+}
+
+/** @brief Append a block to the ring. Called from the audio callback.
+ *  Never blocks; readers that fall behind lose the oldest audio.
+ *  @param interleaved Interleaved samples
+ *  @param frames Number of frames
+ *  @param channels Channels in the block; the block is skipped if it does not match the tap
+ */
+void AudioTap::write(const float *interleaved, unsigned int frames, unsigned int channels) noexcept
+{
+  if (channels != m_header->channels || frames == 0)
+    return;
+
+  uint64_t position = m_header->write_position.load(std::memory_order_relaxed);
+  uint32_t capacity = m_header->capacity_frames;
+  if (frames > capacity)
+  {
+    interleaved += static_cast<size_t>(frames - capacity) * channels;
+    position += frames - capacity;
+    frames = capacity;
+  }
+
+  // A larger block than readers allow for is published before any of it is written
+  if (frames > m_header->max_block_frames.load(std::memory_order_relaxed))
+  {
+    m_header->max_block_frames.store(frames, std::memory_order_seq_cst);
+  }
+
+  size_t offset = static_cast<size_t>(position & (capacity - 1)) * channels;
+  size_t samples = static_cast<size_t>(frames) * channels;
+  if (m_mirrored)
+  {
+    std::memcpy(m_data + offset, interleaved, samples * sizeof(float));
+  }
+  else
+  {
+    size_t first = std::min(samples, static_cast<size_t>(capacity) * channels - offset);
+    std::memcpy(m_data + offset, interleaved, first * sizeof(float));
+    std::memcpy(m_data, interleaved + first, (samples - first) * sizeof(float));
+  }
+
+  m_header->write_position.store(position + frames, std::memory_order_release);
+  m_header->wake_sequence.fetch_add(1, std::memory_order_release);
+
+#ifdef __linux__
+  // Only enter the kernel when a reader is asleep
+  if (m_header->waiting_readers.load(std::memory_order_acquire) > 0)
+  {
+    futex_wake_all(&m_header->wake_sequence);
+  }
+#endif
+}
+
+/** @brief Attach to an existing tap.
+ *  @param name Shared memory name used when the tap was created.
+ *  @param from_start If true, start with the oldest audio still in the ring, otherwise with the next block.
+ *  @return The reader, or nullptr if the tap does not exist or is incompatible.
+ */
+std::unique_ptr<AudioTapReader> AudioTapReader::open(const std::string &name, bool from_start)
+{
+  std::string object_name = shm_name(name);
+  int fd = shm_open(object_name.c_str(), O_RDWR, 0);
+  if (fd < 0)
+  {
+    LOG_ERROR("AudioTapReader: Cannot open tap ", object_name, ": ", std::strerror(errno));
+    return nullptr;
+  }
+
+  struct stat status;
+  if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(AudioTapHeader))
+  {
+    LOG_ERROR("AudioTapReader: Tap ", object_name, " is not initialized");
+    close(fd);
+    return nullptr;
+  }
+
+  std::unique_ptr<AudioTapReader> reader(new AudioTapReader());
+  reader->m_mapping_size = static_cast<size_t>(status.st_size);
+  void *base = mmap(nullptr, reader->m_mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED)
+  {
+    LOG_ERROR("AudioTapReader: Failed to map tap ", object_name, ": ", std::strerror(errno));
+    return nullptr;
+  }
+  reader->m_mapping = base;
+
+  const auto *header = static_cast<const AudioTapHeader *>(base);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  size_t expected_size = static_cast<size_t>(header->data_offset) +
+                         static_cast<size_t>(header->capacity_frames) * header->channels * sizeof(float);
+  if (header->magic != AUDIO_TAP_MAGIC || header->version != AUDIO_TAP_VERSION || expected_size > reader->m_mapping_size)
+  {
+    LOG_ERROR("AudioTapReader: Tap ", object_name, " has an unsupported layout");
+    return nullptr;
+  }
+
+  reader->m_header = header;
+  reader->m_data = reinterpret_cast<const float *>(static_cast<const uint8_t *>(base) + header->data_offset);
+
+  uint64_t write_position = header->write_position.load(std::memory_order_acquire);
+  uint64_t oldest = write_position > header->capacity_frames ? write_position - header->capacity_frames : 0;
+  reader->m_read_position = from_start ? oldest : write_position;
+  return reader;
+}
+
+AudioTapReader::~AudioTapReader()
+{
+  if (m_mapping != nullptr)
+  {
+    munmap(m_mapping, m_mapping_size);
+  }
+}
+
+/** @brief Frames written since the last read, including any that will be dropped.
+ */
+size_t AudioTapReader::get_available_frames() const noexcept
+{
+  return static_cast<size_t>(m_header->write_position.load(std::memory_order_acquire) - m_read_position);
+}
+
+/** @brief Frames behind the write position a reader can still copy without the writer reaching them:
+ *  the ring less the largest block written, and never less than an eighth of it.
+ */
+uint64_t AudioTapReader::get_safe_capacity() const noexcept
+{
+  const uint64_t capacity = m_header->capacity_frames;
+  const uint64_t margin = std::max<uint64_t>(capacity / 8, m_header->max_block_frames.load(std::memory_order_seq_cst));
+  return capacity - std::min(margin, capacity - 1);
+}
+
+/** @brief Copy available frames out of the ring without blocking.
+ *  If the reader fell behind, the oldest frames are skipped and counted as dropped.
+ *  Frames the writer may be overwriting during the copy are dropped as well.
+ *  @param interleaved Destination, max_frames * channels samples.
+ *  @param max_frames Maximum frames to read.
+ *  @return Frames read.
+ */
+size_t AudioTapReader::read(float *interleaved, size_t max_frames)
+{
+  uint64_t capacity = m_header->capacity_frames;
+  uint64_t channels = m_header->channels;
+  // Keep clear of the block the writer is filling before it publishes it
+  uint64_t safe_capacity = get_safe_capacity();
+
+  uint64_t write_position = m_header->write_position.load(std::memory_order_acquire);
+  if (write_position - m_read_position > safe_capacity)
+  {
+    m_dropped_frames += write_position - safe_capacity - m_read_position;
+    m_read_position = write_position - safe_capacity;
+  }
+
+  size_t frames = static_cast<size_t>(std::min<uint64_t>(max_frames, write_position - m_read_position));
+  size_t offset = static_cast<size_t>(m_read_position & (capacity - 1));
+  size_t first = std::min<size_t>(frames, static_cast<size_t>(capacity) - offset);
+  std::memcpy(interleaved, m_data + offset * channels, first * channels * sizeof(float));
+  std::memcpy(interleaved + first * channels, m_data, (frames - first) * channels * sizeof(float));
+
+  // Discard anything the writer reached while we were copying
+  std::atomic_thread_fence(std::memory_order_acquire);
+  uint64_t after = m_header->write_position.load(std::memory_order_relaxed);
+  safe_capacity = std::min(safe_capacity, get_safe_capacity());  // The writer may have written a larger block
+  if (after > safe_capacity && after - safe_capacity > m_read_position)
+  {
+    size_t overwritten = static_cast<size_t>(std::min<uint64_t>(frames, after - safe_capacity - m_read_position));
+    std::memmove(interleaved, interleaved + overwritten * channels, (frames - overwritten) * channels * sizeof(float));
+    frames -= overwritten;
+    m_dropped_frames += overwritten;
+    m_read_position += overwritten;
+  }
+
+  m_read_position += frames;
+  return frames;
+}
+
+/** @brief Sleep until the writer publishes a block or the timeout expires.
+ *  @return True if frames are available.
+ */
+bool AudioTapReader::wait(std::chrono::milliseconds timeout)
+{
+  auto *header = const_cast<AudioTapHeader *>(m_header);
+  uint32_t sequence = header->wake_sequence.load(std::memory_order_acquire);
+  if (get_available_frames() > 0)
+    return true;
+
+  header->waiting_readers.fetch_add(1, std::memory_order_acq_rel);
+#ifdef __linux__
+  futex_wait(&header->wake_sequence, sequence, timeout);
+#else
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (header->wake_sequence.load(std::memory_order_acquire) == sequence && std::chrono::steady_clock::now() < deadline)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+#endif
+  header->waiting_readers.fetch_sub(1, std::memory_order_acq_rel);
+
+  return get_available_frames() > 0;
+}
+
+#else
+
+std::unique_ptr<AudioTap> AudioTap::create(const std::string &, unsigned int, unsigned int, uint32_t, uint32_t, uint32_t)
+{
+  LOG_ERROR("AudioTap: Shared memory taps are not supported on this platform");
+  return nullptr;
+}
+
+AudioTap::~AudioTap() {}
+void AudioTap::write(const float *, unsigned int, unsigned int) noexcept {}
+
+std::unique_ptr<AudioTapReader> AudioTapReader::open(const std::string &, bool)
+{
+  LOG_ERROR("AudioTapReader: Shared memory taps are not supported on this platform");
+  return nullptr;
+}
+
+AudioTapReader::~AudioTapReader() {}
+size_t AudioTapReader::get_available_frames() const noexcept { return 0; }
+uint64_t AudioTapReader::get_safe_capacity() const noexcept { return 0; }
+size_t AudioTapReader::read(float *, size_t) { return 0; }
+bool AudioTapReader::wait(std::chrono::milliseconds) { return false; }
+
+#endif
+
+/** @brief Describe the tap for listings
+ */
+std::string AudioTap::to_string() const
+{
+  return "AudioTap(Name=" + m_name +
+         ", Source=" + (m_header->source == AUDIO_TAP_SOURCE_MASTER ? std::string("Master") : "Track " + std::to_string(m_header->source)) +
+         ", Channels=" + std::to_string(m_header->channels) +
+         ", SampleRate=" + std::to_string(m_header->sample_rate) +
+         ", CapacityFrames=" + std::to_string(m_header->capacity_frames) +
+         ", FramesWritten=" + std::to_string(get_frames_written()) + ")";
+}
@@ -0,0 +1,253 @@
+#include "latencymeter.h"
+
+#include "logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+// Define M_PI if not already defined (Windows MSVC compatibility)
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+constexpr unsigned int MLS_MIN_ORDER = 10;
+constexpr unsigned int MLS_MAX_ORDER = 18;
+
+// Feedback masks of maximal-length Galois LFSRs, indexed by order - MLS_MIN_ORDER
+constexpr uint32_t MLS_TAPS[] = {0x240, 0x500, 0xE08, 0x1C80, 0x3802, 0x6000, 0xD008, 0x12000, 0x20400};
+
+/** @brief In-place iterative radix-2 FFT; the size must be a power of two
+ *  @param inverse True for the inverse transform, without the 1/N scaling
+ */
+void fft(std::vector<std::complex<double>> &data, bool inverse)
+{
+  const size_t n = data.size();
+  for (size_t i = 1, j = 0; i < n; ++i)
+  {
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1)
+    {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j)
+    {
+      std::swap(data[i], data[j]);
+    }
+  }
+
+  for (size_t length = 2; length <= n; length <<= 1)
+  {
+    const double angle = 2.0 * M_PI / static_cast<double>(length) * (inverse ? 1.0 : -1.0);
+    const std::complex<double> step(std::cos(angle), std::sin(angle));
+    for (size_t start = 0; start < n; start += length)
+    {
+      std::complex<double> twiddle(1.0, 0.0);
+      for (size_t k = 0; k < length / 2; ++k)
+      {
+        std::complex<double> even = data[start + k];
+        std::complex<double> odd = data[start + k + length / 2] * twiddle;
+        data[start + k] = even + odd;
+        data[start + k + length / 2] = even - odd;
+        twiddle *= step;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+/** @brief Generate the excitation and allocate the capture buffer.
+ *  @param options Sequence, level, channels and search range.
+ *  @param output_channels Channels of the output blocks generate() fills.
+ *  @param sample_rate Sample rate of the stream.
+ *  @return The meter, or nullptr if the options do not fit the stream.
+ */
+std::unique_ptr<LatencyMeter> LatencyMeter::create(const LatencyMeterOptions &options, unsigned int output_channels,
+                                                   unsigned int sample_rate)
+{
+  if (options.mls_order < MLS_MIN_ORDER || options.mls_order > MLS_MAX_ORDER)
+  {
+    LOG_ERROR("LatencyMeter: MLS order must be between ", MLS_MIN_ORDER, " and ", MLS_MAX_ORDER);
+    return nullptr;
+  }
+  if (sample_rate == 0 || options.output_channel >= output_channels)
+  {
+    LOG_ERROR("LatencyMeter: Cannot play on channel ", options.output_channel, " of ", output_channels,
+              " at ", sample_rate, " Hz");
+    return nullptr;
+  }
+
+  std::unique_ptr<LatencyMeter> meter(new LatencyMeter());
+  meter->m_options = options;
+  meter->m_output_channels = output_channels;
+  meter->m_sample_rate = sample_rate;
+  meter->m_max_latency_frames = static_cast<uint32_t>(std::max(options.max_latency_seconds, 0.0) * sample_rate);
+  meter->m_sequence = generate_mls(options.mls_order, options.level);
+  meter->m_capture.resize(meter->m_sequence.size() + meter->m_max_latency_frames, 0.0f);
+  return meter;
+}
+
+/** @brief One period of a maximum length sequence as +level/-level samples
+ *  @param order Register length, MLS_MIN_ORDER to MLS_MAX_ORDER; the sequence is 2^order - 1 samples long.
+ *  @return The sequence, or an empty vector for an unsupported order.
+ */
+std::vector<float> LatencyMeter::generate_mls(unsigned int order, float level)
+{
+  std::vector<float> sequence;
+  if (order < MLS_MIN_ORDER || order > MLS_MAX_ORDER)
+  {
+    return sequence;
+  }
+
+  const uint32_t taps = MLS_TAPS[order - MLS_MIN_ORDER];
+  const size_t length = (size_t{1} << order) - 1;
+  sequence.reserve(length);
+
+  uint32_t state = 1;
+  for (size_t i = 0; i < length; ++i)
+  {
+    const bool bit = state & 1;
+    sequence.push_back(bit ? level : -level);
+    state >>= 1;
+    if (bit)
+    {
+      state ^= taps;
+    }
+  }
+  return sequence;
+}
+
+/** @brief Overwrite an output block with the next part of the excitation, silence once it has played.
+ *  Called from the audio callback.
+ *  @param output Interleaved output block with the channel count given to create()
+ *  @param frames Number of frames
+ */
+void LatencyMeter::generate(float *output, unsigned int frames) noexcept
+{
+  std::fill(output, output + static_cast<size_t>(frames) * m_output_channels, 0.0f);
+
+  for (unsigned int i = 0; i < frames && m_generated_frames + i < m_sequence.size(); ++i)
+  {
+    output[static_cast<size_t>(i) * m_output_channels + m_options.output_channel] =
+      m_sequence[static_cast<size_t>(m_generated_frames + i)];
+  }
+  m_generated_frames += frames;
+}
+
+/** @brief Append the input block of the same callback to the capture. Called from the audio callback.
+ *  @param input Interleaved input block, or nullptr where the stream has no input
+ *  @param frames Number of frames
+ *  @param channels Channels in the input block
+ */
+void LatencyMeter::capture(const float *input, unsigned int frames, unsigned int channels) noexcept
+{
+  const uint64_t captured = m_captured_frames.load(std::memory_order_relaxed);
+  const size_t count = static_cast<size_t>(std::min<uint64_t>(frames, m_capture.size() - captured));
+  if (count == 0)
+    return;
+
+  float *destination = m_capture.data() + captured;
+  if (input == nullptr || m_options.input_channel >= channels)
+  {
+    std::fill(destination, destination + count, 0.0f);
+  }
+  else
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      destination[i] = input[i * channels + m_options.input_channel];
+    }
+  }
+  m_captured_frames.store(captured + count, std::memory_order_release);
+}
+
+/** @brief Cross-correlate the capture with the excitation and find the round trip.
+ *  Only meaningful once is_complete().
+ *  @return The round trip, or nullopt if no clear correlation peak was found.
+ */
+std::optional<LatencyMeasurement> LatencyMeter::analyze() const
+{
+  const size_t captured = static_cast<size_t>(m_captured_frames.load(std::memory_order_acquire));
+  if (captured < m_sequence.size())
+  {
+    LOG_ERROR("LatencyMeter: Captured ", captured, " of the ", m_sequence.size(), " frames needed");
+    return std::nullopt;
+  }
+
+  // Linear correlation through the FFT, padded so it does not wrap around
+  size_t size = 1;
+  while (size < captured + m_sequence.size())
+  {
+    size <<= 1;
+  }
+
+  std::vector<std::complex<double>> recorded(size);
+  std::vector<std::complex<double>> reference(size);
+  for (size_t i = 0; i < captured; ++i)
+  {
+    recorded[i] = m_capture[i];
+  }
+  for (size_t i = 0; i < m_sequence.size(); ++i)
+  {
+    reference[i] = m_sequence[i];
+  }
+
+  fft(recorded, false);
+  fft(reference, false);
+  for (size_t i = 0; i < size; ++i)
+  {
+    recorded[i] *= std::conj(reference[i]);
+  }
+  fft(recorded, true);
+
+  const size_t lags = std::min<size_t>(static_cast<size_t>(m_max_latency_frames) + 1, captured - m_sequence.size() + 1);
+  size_t peak_lag = 0;
+  double peak = 0.0;
+  for (size_t lag = 0; lag < lags; ++lag)
+  {
+    // The absolute value also finds a round trip that inverts polarity
+    double value = std::abs(recorded[lag].real());
+    if (value > peak)
+    {
+      peak = value;
+      peak_lag = lag;
+    }
+  }
+
+  if (peak <= 0.0)
+  {
+    LOG_ERROR("LatencyMeter: Nothing came back on input channel ", m_options.input_channel);
+    return std::nullopt;
+  }
+
+  // Band-limited converters smear the peak over a few frames; compare against peaks further away
+  const size_t guard = std::max<size_t>(4, m_sample_rate / 2000);
+  double runner_up = 0.0;
+  for (size_t lag = 0; lag < lags; ++lag)
+  {
+    if (lag + guard < peak_lag || lag > peak_lag + guard)
+    {
+      runner_up = std::max(runner_up, std::abs(recorded[lag].real()));
+    }
+  }
+
+  LatencyMeasurement measurement;
+  measurement.round_trip_frames = static_cast<uint32_t>(peak_lag);
+  measurement.sample_rate = m_sample_rate;
+  measurement.confidence = peak / std::max(runner_up, peak * 1e-6);
+  if (measurement.confidence < m_options.min_confidence)
+  {
+    LOG_WARNING("LatencyMeter: No clear round trip, ", measurement.to_string());
+    return std::nullopt;
+  }
+
+  LOG_INFO("LatencyMeter: Measured ", measurement.to_string());
+  return measurement;
+}
@@ -0,0 +1,427 @@
+#include "looprecorder.h"
+
+#include "filemanager.h"
+#include "logger.h"
+#include "recorder.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+using namespace MinimalAudioEngine;
+
+/** @brief Allocate the take pool, one stack of takes per track, and start the writer thread.
+ *  @param options Loop region, take count and output directory.
+ *  @param tracks Indexes of the tracks to loop record.
+ *  @param channels Channels of the blocks the callback will pass.
+ *  @param sample_rate Sample rate of the takes.
+ *  @return The loop recorder, or nullptr if the options are invalid or the pool cannot be allocated.
+ */
+std::unique_ptr<LoopRecorder> LoopRecorder::create(const LoopRecordingOptions &options,
+                                                   const std::vector<uint32_t> &tracks, unsigned int channels,
+                                                   unsigned int sample_rate)
+{
+  if (channels == 0 || sample_rate == 0)
+  {
+    LOG_ERROR("LoopRecorder: Invalid format, ", channels, " channels at ", sample_rate, " Hz");
+    return nullptr;
+  }
+  if (options.loop_length == 0 || options.max_takes == 0)
+  {
+    LOG_ERROR("LoopRecorder: Loop length and take count must be positive");
+    return nullptr;
+  }
+  if (tracks.empty())
+  {
+    LOG_ERROR("LoopRecorder: Nothing to record");
+    return nullptr;
+  }
+
+  std::error_code error;
+  std::filesystem::create_directories(options.directory, error);
+  if (error)
+  {
+    LOG_ERROR("LoopRecorder: Failed to create ", options.directory.string(), ": ", error.message());
+    return nullptr;
+  }
+
+  std::unique_ptr<LoopRecorder> recorder(new LoopRecorder());
+  recorder->m_options = options;
+  recorder->m_channels = channels;
+  recorder->m_sample_rate = sample_rate;
+
+  // Each take starts on a page of its own, so the writer can hand it to the file as it is
+  const size_t floats_per_page = RECORDING_FILE_ALIGNMENT / sizeof(float);
+  const size_t take_floats = static_cast<size_t>(options.loop_length) * channels;
+  recorder->m_take_stride = (take_floats + floats_per_page - 1) / floats_per_page * floats_per_page;
+
+  const size_t take_count = static_cast<size_t>(options.max_takes) * tracks.size();
+  const size_t pool_bytes = recorder->m_take_stride * take_count * sizeof(float);
+  recorder->m_pool = std::unique_ptr<float, void (*)(void *)>(
+    static_cast<float *>(std::aligned_alloc(RECORDING_FILE_ALIGNMENT, pool_bytes)), &std::free);
+  if (!recorder->m_pool)
+  {
+    LOG_ERROR("LoopRecorder: Failed to allocate ", pool_bytes, " bytes for ", take_count, " takes");
+    return nullptr;
+  }
+  // Fault the pages in now rather than in the audio callback. Takes start silent,
+  // which covers the part of a pass before recording started.
+  std::memset(recorder->m_pool.get(), 0, pool_bytes);
+
+  float *next = recorder->m_pool.get();
+  for (uint32_t track : tracks)
+  {
+    auto stack = std::make_unique<Stack>();
+    stack->track = track;
+    stack->takes = std::make_unique<Take[]>(options.max_takes);
+    for (unsigned int i = 0; i < options.max_takes; ++i)
+    {
+      stack->takes[i].samples = next;
+      stack->takes[i].index = i;
+      next += recorder->m_take_stride;
+    }
+
+    if (recorder->m_track_stacks.size() <= track)
+    {
+      recorder->m_track_stacks.resize(track + 1, nullptr);
+    }
+    recorder->m_track_stacks[track] = stack.get();
+    recorder->m_stacks.push_back(std::move(stack));
+  }
+
+  LoopRecorder *self = recorder.get();
+  recorder->m_writer = std::jthread([self](std::stop_token stop_token) { self->run_writer(stop_token); });
+
+  LOG_INFO("LoopRecorder: Started ", recorder->to_string());
+  return recorder;
+}
+
+/** @brief Finish the recording if finish() was not called
+ */
+LoopRecorder::~LoopRecorder()
+{
+  finish();
+}
+
+/** @brief Record a track's block into the take of the current pass, then mix its selected take in.
+ *  Called from the audio callback; never blocks. Blocks outside the loop region are
+ *  left alone, and blocks whose channel count differs are ignored.
+ *  @param track Track index
+ *  @param interleaved Interleaved samples, recorded and then replaced by the mix
+ *  @param frames Number of frames
+ *  @param channels Channels in the block
+ *  @param sample_time Transport sample of the first frame
+ */
+void LoopRecorder::process(uint32_t track, float *interleaved, unsigned int frames, unsigned int channels,
+                           uint64_t sample_time) noexcept
+{
+  Stack *stack = find_stack(track);
+  if (stack == nullptr || frames == 0 || channels != m_channels)
+    return;
+
+  record(*stack, interleaved, frames, sample_time);
+  play(*stack, interleaved, frames, sample_time);
+}
+
+/** @brief Copy a block into the takes of the passes it covers, starting a new take at each pass boundary
+ */
+void LoopRecorder::record(Stack &stack, const float *interleaved, unsigned int frames, uint64_t sample_time) noexcept
+{
+  const uint64_t loop_start = m_options.loop_start;
+  const uint64_t loop_length = m_options.loop_length;
+
+  uint64_t time = sample_time;
+  const uint64_t end = sample_time + frames;
+  while (time < end)
+  {
+    if (time < loop_start)
+    {
+      time = std::min(end, loop_start);
+      continue;
+    }
+
+    const uint64_t pass = (time - loop_start) / loop_length;
+    const uint64_t offset = (time - loop_start) % loop_length;
+    const uint64_t count = std::min(end - time, loop_length - offset);
+
+    if (pass != stack.pass)
+    {
+      if (stack.recording != nullptr)
+      {
+        stack.recording->state.store(eTakeState::Complete, std::memory_order_release);
+        if (m_options.auto_select)
+        {
+          stack.active.store(stack.recording, std::memory_order_release);
+        }
+      }
+
+      stack.pass = pass;
+      stack.recording = nullptr;
+      unsigned int started = stack.take_count.load(std::memory_order_relaxed);
+      if (started < m_options.max_takes)
+      {
+        Take &take = stack.takes[started];
+        take.start_sample = loop_start + pass * loop_length;
+        take.state.store(eTakeState::Recording, std::memory_order_relaxed);
+        stack.take_count.store(started + 1, std::memory_order_release);
+        stack.recording = &take;
+      }
+      else
+      {
+        stack.passes_dropped.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    if (stack.recording != nullptr)
+    {
+      std::memcpy(stack.recording->samples + offset * m_channels,
+                  interleaved + (time - sample_time) * m_channels,
+                  static_cast<size_t>(count) * m_channels * sizeof(float));
+      stack.recording->frames.store(offset + count, std::memory_order_release);
+    }
+    time += count;
+  }
+}
+
+/** @brief Add the selected take at the loop position of every frame in the block
+ */
+void LoopRecorder::play(const Stack &stack, float *interleaved, unsigned int frames, uint64_t sample_time) const noexcept
+{
+  const Take *take = stack.active.load(std::memory_order_acquire);
+  if (take == nullptr)
+    return;
+
+  const uint64_t loop_start = m_options.loop_start;
+  const uint64_t loop_length = m_options.loop_length;
+  const uint64_t take_frames = take->frames.load(std::memory_order_acquire);
+
+  uint64_t time = std::max(sample_time, loop_start);
+  const uint64_t end = sample_time + frames;
+  while (time < end)
+  {
+    const uint64_t offset = (time - loop_start) % loop_length;
+    const uint64_t count = std::min(end - time, loop_length - offset);
+    const uint64_t audible = offset < take_frames ? std::min(count, take_frames - offset) : 0;
+
+    float *out = interleaved + (time - sample_time) * m_channels;
+    const float *in = take->samples + offset * m_channels;
+    for (size_t i = 0; i < audible * m_channels; ++i)
+    {
+      out[i] += in[i];
+    }
+    time += count;
+  }
+}
+
+/** @brief Stop the writer and save every take not yet on disk, including the unfinished last pass.
+ *  The loop recorder must no longer be reachable from the audio callback.
+ *  @return The final counters.
+ */
+LoopRecordingStatistics LoopRecorder::finish()
+{
+  if (!m_finished)
+  {
+    if (m_writer.joinable())
+    {
+      m_writer.request_stop();
+      m_writer.join();
+    }
+
+    for (auto &stack : m_stacks)
+    {
+      if (stack->recording != nullptr)
+      {
+        stack->recording->state.store(eTakeState::Complete, std::memory_order_release);
+        stack->recording = nullptr;
+      }
+    }
+    write_completed_takes();
+    m_finished = true;
+
+    LoopRecordingStatistics statistics = get_statistics();
+    if (statistics.passes_dropped > 0 || statistics.write_failed)
+    {
+      LOG_WARNING("LoopRecorder: Finished with losses, ", statistics.to_string());
+    }
+    else
+    {
+      LOG_INFO("LoopRecorder: Finished, ", statistics.to_string());
+    }
+  }
+  return get_statistics();
+}
+
+/** @brief Choose the take a track plays. Takes effect with the callback's next block.
+ *  @param track Track index
+ *  @param take Take index, or LOOP_TAKE_NONE to stop playing takes on the track
+ *  @return False if the track is not loop recorded or the take has not finished recording.
+ */
+bool LoopRecorder::select_take(uint32_t track, int take)
+{
+  Stack *stack = find_stack(track);
+  if (stack == nullptr)
+  {
+    LOG_ERROR("LoopRecorder: Track ", track, " is not loop recorded");
+    return false;
+  }
+
+  if (take == LOOP_TAKE_NONE)
+  {
+    stack->active.store(nullptr, std::memory_order_release);
+    return true;
+  }
+
+  if (take < 0 || static_cast<unsigned int>(take) >= stack->take_count.load(std::memory_order_acquire) ||
+      stack->takes[take].state.load(std::memory_order_acquire) == eTakeState::Recording)
+  {
+    LOG_ERROR("LoopRecorder: Track ", track, " has no finished take ", take);
+    return false;
+  }
+
+  stack->active.store(&stack->takes[take], std::memory_order_release);
+  return true;
+}
+
+/** @brief Index of the take a track plays, or LOOP_TAKE_NONE
+ */
+int LoopRecorder::get_selected_take(uint32_t track) const
+{
+  const Stack *stack = find_stack(track);
+  if (stack == nullptr)
+    return LOOP_TAKE_NONE;
+
+  const Take *take = stack->active.load(std::memory_order_acquire);
+  return take == nullptr ? LOOP_TAKE_NONE : static_cast<int>(take->index);
+}
+
+/** @brief Takes a track has recorded so far, oldest first
+ */
+std::vector<LoopTakeInfo> LoopRecorder::get_takes(uint32_t track) const
+{
+  std::vector<LoopTakeInfo> takes;
+  const Stack *stack = find_stack(track);
+  if (stack == nullptr)
+    return takes;
+
+  unsigned int count = stack->take_count.load(std::memory_order_acquire);
+  for (unsigned int i = 0; i < count; ++i)
+  {
+    const Take &take = stack->takes[i];
+    eTakeState state = take.state.load(std::memory_order_acquire);
+
+    LoopTakeInfo info;
+    info.index = take.index;
+    info.start_sample = take.start_sample;
+    info.frames = take.frames.load(std::memory_order_acquire);
+    info.complete = state != eTakeState::Recording;
+    info.written = state == eTakeState::Written;
+    info.path = get_take_path(track, take.index);
+    takes.push_back(info);
+  }
+  return takes;
+}
+
+/** @brief Sum the counters of every track
+ */
+LoopRecordingStatistics LoopRecorder::get_statistics() const
+{
+  LoopRecordingStatistics statistics;
+  statistics.tracks = static_cast<unsigned int>(m_stacks.size());
+  for (const auto &stack : m_stacks)
+  {
+    unsigned int count = stack->take_count.load(std::memory_order_acquire);
+    statistics.takes += count;
+    statistics.passes_dropped += stack->passes_dropped.load(std::memory_order_relaxed);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+      eTakeState state = stack->takes[i].state.load(std::memory_order_acquire);
+      statistics.takes_written += state == eTakeState::Written ? 1 : 0;
+      statistics.write_failed |= state == eTakeState::Failed;
+    }
+  }
+  return statistics;
+}
+
+std::string LoopRecorder::to_string() const
+{
+  std::string description = "LoopRecorder(Directory=" + m_options.directory.string() + ", Tracks=";
+  for (size_t i = 0; i < m_stacks.size(); ++i)
+  {
+    description += (i > 0 ? "," : "") + std::to_string(m_stacks[i]->track);
+  }
+  return description + ", LoopStart=" + std::to_string(m_options.loop_start) +
+         ", LoopLength=" + std::to_string(m_options.loop_length) +
+         ", MaxTakes=" + std::to_string(m_options.max_takes) + ")";
+}
+
+/** @brief Takes of a track, or nullptr if it is not loop recorded
+ */
+LoopRecorder::Stack *LoopRecorder::find_stack(uint32_t track) const noexcept
+{
+  return track < m_track_stacks.size() ? m_track_stacks[track] : nullptr;
+}
+
+/** @brief Writer thread: save takes as their passes end
+ */
+void LoopRecorder::run_writer(std::stop_token stop_token)
+{
+  set_thread_name("LoopRecorder");
+
+  while (!stop_token.stop_requested())
+  {
+    if (!write_completed_takes())
+    {
+      std::this_thread::sleep_for(RECORDER_WRITER_INTERVAL);
+    }
+  }
+}
+
+/** @brief Save every completed take that is not on disk yet. The samples stay in the pool for playback.
+ *  @return True if any take was written.
+ */
+bool LoopRecorder::write_completed_takes()
+{
+  bool wrote = false;
+  for (auto &stack : m_stacks)
+  {
+    unsigned int count = stack->take_count.load(std::memory_order_acquire);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+      Take &take = stack->takes[i];
+      if (take.state.load(std::memory_order_acquire) != eTakeState::Complete)
+        continue;
+
+      bool written = false;
+      auto file = FileManager::instance().create_recording_file(get_take_path(stack->track, take.index), m_channels,
+                                                                m_sample_rate);
+      if (file.has_value())
+      {
+        BroadcastInfo broadcast_info;
+        broadcast_info.description = "Loop take " + std::to_string(take.index) + " of track " +
+                                     std::to_string(stack->track);
+        broadcast_info.set_origination_now();
+        broadcast_info.time_reference = take.start_sample;
+        file.value()->set_broadcast_info(broadcast_info);
+
+        const size_t bytes = static_cast<size_t>(take.frames.load(std::memory_order_acquire)) * m_channels * sizeof(float);
+        written = file.value()->write(take.samples, bytes);
+        written = file.value()->close() && written;
+      }
+
+      if (!written)
+      {
+        LOG_ERROR("LoopRecorder: Failed to write ", get_take_path(stack->track, take.index).string());
+      }
+      take.state.store(written ? eTakeState::Written : eTakeState::Failed, std::memory_order_release);
+      wrote = true;
+    }
+  }
+  return wrote;
+}
+
+/** @brief File a take is saved to
+ */
+std::filesystem::path LoopRecorder::get_take_path(uint32_t track, unsigned int index) const
+{
+  return m_options.directory / ("track" + std::to_string(track) + "_take" + std::to_string(index) + ".wav");
+}
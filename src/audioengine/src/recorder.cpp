@@ -0,0 +1,391 @@
+#include "recorder.h"
+
+#include "filemanager.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+
+using namespace MinimalAudioEngine;
+
+/** @brief Create a take for every source, open their files and start the writer threads.
+ *  @param options Output directory and buffering.
+ *  @param tracks Indexes of the tracks to record.
+ *  @param channels Channels of the blocks the callback will write.
+ *  @param sample_rate Sample rate of the recording.
+ *  @return The recorder, or nullptr if a file or ring cannot be created.
+ */
+std::unique_ptr<Recorder> Recorder::create(const RecordingOptions &options, const std::vector<uint32_t> &tracks,
+                                           unsigned int channels, unsigned int sample_rate)
+{
+  if (channels == 0 || sample_rate == 0)
+  {
+    LOG_ERROR("Recorder: Invalid format, ", channels, " channels at ", sample_rate, " Hz");
+    return nullptr;
+  }
+
+  std::vector<uint32_t> sources = tracks;
+  if (options.include_master)
+  {
+    sources.push_back(RECORDER_SOURCE_MASTER);
+  }
+  if (sources.empty())
+  {
+    LOG_ERROR("Recorder: Nothing to record");
+    return nullptr;
+  }
+
+  std::unique_ptr<Recorder> recorder(new Recorder());
+  recorder->m_options = options;
+
+  const size_t frame_bytes = channels * sizeof(float);
+  recorder->m_frame_bytes = frame_bytes;
+  recorder->m_pre_roll_bytes =
+    static_cast<uint64_t>(std::max(options.pre_roll_seconds, 0.0) * sample_rate) * frame_bytes;
+  recorder->m_punch_in.store(options.punch_in, std::memory_order_relaxed);
+  recorder->m_punch_out.store(options.punch_out, std::memory_order_relaxed);
+
+  // The pre-roll sits in the ring on top of the audio waiting for the writers
+  const double ring_bytes = std::max(options.ring_seconds, 0.1) * sample_rate * static_cast<double>(frame_bytes) +
+                            static_cast<double>(recorder->m_pre_roll_bytes);
+  const size_t ring_chunks = std::max<size_t>(2, static_cast<size_t>(std::ceil(ring_bytes / RECORDER_CHUNK_BYTES)));
+  const uint64_t preallocate_bytes =
+    static_cast<uint64_t>(std::max(options.preallocate_seconds, 0.0) * sample_rate) * frame_bytes;
+
+  for (uint32_t source : sources)
+  {
+    auto take = std::make_unique<Take>();
+    take->source = source;
+    take->channels = channels;
+    take->capacity = ring_chunks * RECORDER_CHUNK_BYTES;
+    take->ring = std::unique_ptr<uint8_t, void (*)(void *)>(
+      static_cast<uint8_t *>(std::aligned_alloc(RECORDING_FILE_ALIGNMENT, take->capacity)), &std::free);
+    if (!take->ring)
+    {
+      LOG_ERROR("Recorder: Failed to allocate ", take->capacity, " bytes for a take");
+      return nullptr;
+    }
+    // Fault the pages in now rather than in the audio callback
+    std::memset(take->ring.get(), 0, take->capacity);
+
+    std::string filename = source == RECORDER_SOURCE_MASTER ? "master.wav" : "track" + std::to_string(source) + ".wav";
+    auto file = FileManager::instance().create_recording_file(options.directory / filename, channels, sample_rate,
+                                                              preallocate_bytes, options.direct_io);
+    if (!file.has_value())
+    {
+      return nullptr;
+    }
+    take->file = file.value();
+
+    BroadcastInfo broadcast_info = options.broadcast_info;
+    if (broadcast_info.origination_date.empty())
+    {
+      broadcast_info.set_origination_now();
+    }
+    take->file->set_broadcast_info(broadcast_info);
+
+    if (source == RECORDER_SOURCE_MASTER)
+    {
+      recorder->m_master_take = take.get();
+    }
+    else
+    {
+      if (recorder->m_track_takes.size() <= source)
+      {
+        recorder->m_track_takes.resize(source + 1, nullptr);
+      }
+      recorder->m_track_takes[source] = take.get();
+    }
+    recorder->m_takes.push_back(std::move(take));
+  }
+
+  recorder->m_writer_count = std::min<size_t>(RECORDER_WRITER_THREADS, recorder->m_takes.size());
+  for (size_t i = 0; i < recorder->m_writer_count; ++i)
+  {
+    Recorder *self = recorder.get();
+    recorder->m_writers.emplace_back([self, i](std::stop_token stop_token) { self->run_writer(stop_token, i); });
+  }
+
+  LOG_INFO("Recorder: Started ", recorder->to_string());
+  return recorder;
+}
+
+/** @brief Finish the recording if finish() was not called
+ */
+Recorder::~Recorder()
+{
+  finish();
+}
+
+/** @brief Copy a block into a source's ring and resolve punch points inside it. Called from the audio callback.
+ *  Never blocks. Before the punch-in the oldest audio makes room; after it, a block that
+ *  does not fit is dropped, as is any block whose channel count differs.
+ *  @param source Track index, or RECORDER_SOURCE_MASTER
+ *  @param interleaved Interleaved samples
+ *  @param frames Number of frames
+ *  @param channels Channels in the block
+ *  @param sample_time Transport sample of the first frame; the first block's becomes the file's time reference
+ */
+void Recorder::write(uint32_t source, const float *interleaved, unsigned int frames, unsigned int channels,
+                     uint64_t sample_time) noexcept
+{
+  Take *take = find_take(source);
+  if (take == nullptr || frames == 0 || take->punched_out)
+    return;
+
+  if (channels != take->channels)
+  {
+    take->blocks_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  const size_t bytes = static_cast<size_t>(frames) * channels * sizeof(float);
+  const uint64_t position = take->write_position.load(std::memory_order_relaxed);
+  if (take->punched_in.load(std::memory_order_relaxed))
+  {
+    if (take->capacity - (position - take->read_position.load(std::memory_order_acquire)) < bytes)
+    {
+      take->blocks_dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  }
+  else if (position + bytes - take->read_position.load(std::memory_order_relaxed) > take->capacity)
+  {
+    // Capture buffer: forget the oldest audio, keeping whole frames
+    uint64_t oldest = position + bytes - take->capacity;
+    oldest += (m_frame_bytes - oldest % m_frame_bytes) % m_frame_bytes;
+    take->read_position.store(oldest, std::memory_order_relaxed);
+  }
+
+  size_t offset = static_cast<size_t>(position % take->capacity);
+  size_t first = std::min(bytes, take->capacity - offset);
+  std::memcpy(take->ring.get() + offset, interleaved, first);
+  std::memcpy(take->ring.get(), reinterpret_cast<const uint8_t *>(interleaved) + first, bytes - first);
+
+  take->write_position.store(position + bytes, std::memory_order_release);
+
+  update_punch(*take, position, sample_time, frames);
+  if (take->punched_in.load(std::memory_order_relaxed))
+  {
+    take->blocks_recorded.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+/** @brief Punch a take in or out if a punch point falls in the block just written.
+ *  The ring is assumed to hold consecutive transport samples, so the pre-roll's time
+ *  reference is off by any time the transport spent stopped during it.
+ *  @param position Ring position of the block's first frame
+ *  @param sample_time Transport sample of the block's first frame
+ *  @param frames Frames in the block
+ */
+void Recorder::update_punch(Take &take, uint64_t position, uint64_t sample_time, unsigned int frames) noexcept
+{
+  const uint64_t block_end = sample_time + frames;
+
+  if (!take.punched_in.load(std::memory_order_relaxed))
+  {
+    uint64_t punch_in = m_punch_in.load(std::memory_order_acquire);
+    if (punch_in == RECORDER_NO_PUNCH || punch_in >= block_end)
+    {
+      return;
+    }
+
+    uint64_t punch_sample = std::max(punch_in, sample_time);
+    uint64_t punch_position = position + (punch_sample - sample_time) * m_frame_bytes;
+    uint64_t oldest = take.read_position.load(std::memory_order_relaxed);
+    uint64_t start = punch_position - std::min(punch_position - oldest, m_pre_roll_bytes);
+
+    // Start on a page boundary where the buffer allows, so the file stays aligned for direct I/O
+    uint64_t alignment = std::lcm<uint64_t>(m_frame_bytes, RECORDING_FILE_ALIGNMENT);
+    if (start % alignment != 0)
+    {
+      uint64_t earlier = start - start % alignment;
+      if (earlier >= oldest)
+      {
+        start = earlier;
+      }
+      else if (earlier + alignment <= punch_position)
+      {
+        start = earlier + alignment;
+      }
+    }
+
+    take.start_sample_time = punch_sample - (punch_position - start) / m_frame_bytes;
+    take.read_position.store(start, std::memory_order_relaxed);
+    take.punched_in.store(true, std::memory_order_release);
+  }
+
+  uint64_t punch_out = m_punch_out.load(std::memory_order_acquire);
+  if (punch_out != RECORDER_NO_PUNCH && punch_out < block_end)
+  {
+    uint64_t end = position + (std::max(punch_out, sample_time) - sample_time) * m_frame_bytes;
+    take.end_position.store(end, std::memory_order_release);
+    take.punched_out = true;
+  }
+}
+
+/** @brief Stop the writers once they have written everything buffered, and close the files.
+ *  The recorder must no longer be reachable from the audio callback.
+ *  @return The final counters.
+ */
+RecordingStatistics Recorder::finish()
+{
+  if (!m_finished)
+  {
+    for (auto &writer : m_writers)
+    {
+      writer.request_stop();
+    }
+    for (auto &writer : m_writers)
+    {
+      if (writer.joinable())
+      {
+        writer.join();
+      }
+    }
+    m_finished = true;
+
+    RecordingStatistics statistics = get_statistics();
+    if (statistics.blocks_dropped > 0 || statistics.write_failed)
+    {
+      LOG_WARNING("Recorder: Finished with losses, ", statistics.to_string());
+    }
+    else
+    {
+      LOG_INFO("Recorder: Finished, ", statistics.to_string());
+    }
+  }
+  return get_statistics();
+}
+
+/** @brief Sum the counters of every take
+ */
+RecordingStatistics Recorder::get_statistics() const
+{
+  RecordingStatistics statistics;
+  statistics.takes = static_cast<unsigned int>(m_takes.size());
+  for (const auto &take : m_takes)
+  {
+    statistics.takes_punched_in += take->punched_in.load(std::memory_order_relaxed) ? 1 : 0;
+    statistics.blocks_recorded += take->blocks_recorded.load(std::memory_order_relaxed);
+    statistics.blocks_dropped += take->blocks_dropped.load(std::memory_order_relaxed);
+    statistics.bytes_written += take->bytes_written.load(std::memory_order_relaxed);
+    statistics.write_failed |= take->failed.load(std::memory_order_relaxed);
+  }
+  return statistics;
+}
+
+std::string Recorder::to_string() const
+{
+  std::string description = "Recorder(Directory=" + m_options.directory.string() + ", Takes=";
+  for (size_t i = 0; i < m_takes.size(); ++i)
+  {
+    description += (i > 0 ? "," : "") +
+                   (m_takes[i]->source == RECORDER_SOURCE_MASTER ? std::string("master") : std::to_string(m_takes[i]->source));
+  }
+  return description + ", DirectIO=" + (m_options.direct_io ? "Yes" : "No") + ")";
+}
+
+/** @brief Take of a source, or nullptr if it is not recorded
+ */
+Recorder::Take *Recorder::find_take(uint32_t source) const noexcept
+{
+  if (source == RECORDER_SOURCE_MASTER)
+  {
+    return m_master_take;
+  }
+  return source < m_track_takes.size() ? m_track_takes[source] : nullptr;
+}
+
+/** @brief Writer thread: flush whole chunks of its share of the takes, then drain them on stop
+ *  @param index Writer number; the writer owns every take whose position modulo the writer count matches.
+ */
+void Recorder::run_writer(std::stop_token stop_token, size_t index)
+{
+  set_thread_name("Recorder");
+
+  while (!stop_token.stop_requested())
+  {
+    bool wrote = false;
+    for (size_t i = index; i < m_takes.size(); i += m_writer_count)
+    {
+      wrote |= flush(*m_takes[i], false);
+    }
+
+    if (!wrote)
+    {
+      std::this_thread::sleep_for(RECORDER_WRITER_INTERVAL);
+    }
+  }
+
+  for (size_t i = index; i < m_takes.size(); i += m_writer_count)
+  {
+    Take &take = *m_takes[i];
+    // Whole chunks first, so only the tail leaves direct I/O
+    flush(take, false);
+    flush(take, true);
+
+    if (take.punched_in.load(std::memory_order_acquire))
+    {
+      BroadcastInfo broadcast_info = take.file->get_broadcast_info();
+      broadcast_info.time_reference =
+        take.start_sample_time - std::min<uint64_t>(take.start_sample_time, m_options.latency_compensation);
+      take.file->set_broadcast_info(broadcast_info);
+    }
+    if (!take.file->close())
+    {
+      take.failed.store(true, std::memory_order_relaxed);
+    }
+  }
+}
+
+/** @brief Write a take's buffered audio to its file.
+ *  @param final False to write whole chunks only, true to also write the partial tail.
+ *  @return True if anything was written.
+ */
+bool Recorder::flush(Take &take, bool final)
+{
+  // Until the punch-in the ring belongs to the callback. After a write failure
+  // it fills up and further blocks are counted as dropped.
+  if (!take.punched_in.load(std::memory_order_acquire) || take.failed.load(std::memory_order_relaxed))
+  {
+    return false;
+  }
+
+  uint64_t read_position = take.read_position.load(std::memory_order_relaxed);
+  uint64_t limit = std::min(take.write_position.load(std::memory_order_acquire),
+                            take.end_position.load(std::memory_order_acquire));
+  if (!final)
+  {
+    limit -= limit % RECORDER_CHUNK_BYTES;
+  }
+  if (limit <= read_position)
+  {
+    return false;
+  }
+  uint64_t available = limit - read_position;
+
+  bool wrote = false;
+  while (available > 0)
+  {
+    // Pieces never straddle the end of the ring, since its size is a multiple of the chunk size
+    size_t offset = static_cast<size_t>(read_position % take.capacity);
+    size_t bytes = static_cast<size_t>(std::min<uint64_t>(available, take.capacity - offset));
+    if (!take.file->write(take.ring.get() + offset, bytes))
+    {
+      LOG_ERROR("Recorder: Stopped writing ", take.file->get_filepath().string());
+      take.failed.store(true, std::memory_order_relaxed);
+      return wrote;
+    }
+
+    read_position += bytes;
+    available -= bytes;
+    take.bytes_written.fetch_add(bytes, std::memory_order_relaxed);
+    take.read_position.store(read_position, std::memory_order_release);
+    wrote = true;
+  }
+  return wrote;
+}
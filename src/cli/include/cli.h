@@ -1,21 +1,50 @@
 #ifndef __CLI_H__
 #define __CLI_H__
 
+#include <atomic>
+#include <mutex>
 #include <string>
 #include <memory>
 #include <vector>
+#include <istream>
+#include <cstdint>
+#include <optional>
 
 #include <replxx.hxx>
 
 #include "coreengine.h"
+#include "batchconverter.h"
+#include "pcmstream.h"
 
 namespace CLI { class App; }
+namespace MinimalAudioEngine { class ControlServer; class OscServer; class Track; }
 
 namespace GUI
 {
 
 constexpr const char *CLI_WELCOME_MESSAGE = "Welcome to the Minimal Audio Engine CommandLine! Type 'help' for a list of commands.\n";
 constexpr const char *CLI_PROMPT = "> ";
+constexpr const char *CLI_SCRIPT_COMMENT = "#";
+
+/** @enum eCommandLineMode
+ *  @brief How the CommandLine receives its commands
+ */
+enum class eCommandLineMode
+{
+  Interactive,  // replxx prompt
+  Headless,     // script file or arguments, no prompt
+};
+
+/** @enum eExitCode
+ *  @brief Process exit codes for headless mode
+ */
+enum class eExitCode : int
+{
+  Success = 0,
+  CommandFailed = 1,
+  ScriptNotFound = 2,
+  Interrupted = 130,
+};
 
 /** @class CommandLine
  *  @brief Command-Line Interface for interacting with the application
@@ -23,15 +52,26 @@ constexpr const char *CLI_PROMPT = "> ";
 class CommandLine
 {
 public:
-  CommandLine();
+  explicit CommandLine(eCommandLineMode mode = eCommandLineMode::Interactive);
   ~CommandLine();
 
   void run();
   void stop();
 
+  eExitCode run_commands(const std::vector<std::string> &commands, bool keep_going = false);
+  eExitCode run_script(std::istream &script, bool keep_going = false);
+  eExitCode run_script(const std::string &script_path, bool keep_going = false);
+
+  bool execute(const std::string &command_str);
+
+  bool start_control_server(const std::string &socket_path);
+  bool start_osc_server(uint16_t port);
+  eExitCode serve();
+
 private:
   void setup_commands();
   void setup_autocomplete();
+  void reset_options();
   
   // Autocomplete callback
   replxx::Replxx::completions_t completion_callback(std::string const& input, int& contextLen);
@@ -45,24 +85,118 @@ private:
   void cmd_add_track_audio_input_device(unsigned int track_id, unsigned int device_id);
   void cmd_add_track_audio_input_file(unsigned int track_id, const std::string& file_path);
   void cmd_add_track_audio_output_device(unsigned int track_id, unsigned int device_id);
+  void cmd_add_track_audio_input_pipe(unsigned int track_id, const std::string &path);
+  void cmd_set_output_pipe(const std::string &path);
+  std::optional<MinimalAudioEngine::PcmStreamFormat> get_pipe_format();
   void cmd_play_track(unsigned int track_id);
   void cmd_stop_track(unsigned int track_id);
+  void cmd_render(const std::string &output_directory);
+  void cmd_convert(const std::string &input_directory, const std::string &output_directory);
+  void cmd_wait();
+  void cmd_add_tap(const std::string &name);
+  void cmd_remove_tap(const std::string &name);
+  void cmd_list_taps();
+  void cmd_arm_track(unsigned int track_id, bool armed);
+  void cmd_start_recording(const std::string &directory);
+  void cmd_punch(bool punch_in);
+  void cmd_stop_recording();
+  void cmd_start_loop_recording(const std::string &directory);
+  void cmd_stop_loop_recording();
+  void cmd_list_takes(unsigned int track_id);
+  void cmd_select_take(unsigned int track_id, int take);
+  void cmd_measure_latency();
+  void cmd_start_midi_recording(const std::string &path);
+  void cmd_stop_midi_recording();
+  void cmd_set_mpe_layout();
+  void cmd_list_mpe_voices();
+  void cmd_learn_parameter(const std::string &name);
+  void cmd_unbind_parameter(const std::string &name);
+  void cmd_list_midi_bindings();
+  void cmd_list_parameters();
+  void cmd_set_parameter(const std::string &name, float value);
   
   void show_help();
+  void report_error(const std::string &message);
+  void ensure_engine_running();
+  bool execute_line(const std::string &line);
+  void detach_missing_files();
 
   static void handle_shutdown_signal(int signum);
 
+  eCommandLineMode m_mode;
   MinimalAudioEngine::CoreEngine m_engine;
   std::unique_ptr<::CLI::App> m_cli_app;
   std::unique_ptr<replxx::Replxx> m_replxx;
+  std::unique_ptr<MinimalAudioEngine::ControlServer> m_control_server;
+  std::unique_ptr<MinimalAudioEngine::OscServer> m_osc_server;
+
+  // Set by command handlers when the current command fails
+  bool m_command_failed = false;
+
+  /** @struct MissingFile
+   *  @brief A track input that failed to resolve in the background, handed back to the command thread
+   */
+  struct MissingFile
+  {
+    unsigned int track_id;
+    std::weak_ptr<MinimalAudioEngine::Track> track;
+    MinimalAudioEngine::WavFilePtr file;
+  };
+  std::vector<MissingFile> m_missing_files;
+  std::mutex m_missing_files_mutex;
 
   // Command argument storage
   unsigned int m_track_id;
   unsigned int m_input_device_id;
   unsigned int m_output_device_id;
   std::string m_input_file_path;
-
-  static bool m_app_running;
+  std::string m_pipe_path;
+  std::string m_pipe_format;
+  unsigned int m_pipe_channels;
+  unsigned int m_pipe_sample_rate;
+  bool m_pipe_freewheel;
+  std::string m_render_output_directory;
+  unsigned int m_render_segment_frames;
+  unsigned int m_render_threads;
+  bool m_render_no_stems;
+  bool m_render_no_mix;
+  std::string m_convert_input_directory;
+  std::string m_convert_output_directory;
+  unsigned int m_convert_sample_rate;
+  std::string m_convert_bit_depth;
+  std::string m_convert_format;
+  double m_convert_normalize_lufs;
+  double m_convert_normalize_peak;
+  unsigned int m_convert_threads;
+  MinimalAudioEngine::eNormalization m_convert_normalization;
+  std::string m_tap_name;
+  int m_tap_track;
+  double m_tap_seconds;
+  std::string m_record_directory;
+  bool m_record_master;
+  bool m_record_direct_io;
+  double m_record_pre_roll;
+  bool m_record_standby;
+  bool m_record_compensate;
+  uint64_t m_record_punch_sample;
+  uint64_t m_loop_start;
+  uint64_t m_loop_length;
+  unsigned int m_loop_takes;
+  int m_take_index;
+  int64_t m_latency_loopback;
+  unsigned int m_latency_input_channel;
+  unsigned int m_latency_output_channel;
+  std::string m_midi_record_path;
+  unsigned int m_midi_tolerance;
+  double m_midi_tempo;
+  unsigned int m_mpe_lower;
+  unsigned int m_mpe_upper;
+  float m_mpe_bend_range;
+  std::string m_parameter_name;
+  float m_parameter_value;
+
+  static std::atomic<bool> m_app_running;
+  static std::atomic<bool> m_interrupted;
 };
 
 }; // namespace GUI
@@ -4,7 +4,16 @@
 #include "trackmanager.h"
 #include "devicemanager.h"
 #include "filemanager.h"
+#include "wavfile.h"
+#include "pcmstream.h"
+#include "offlinerenderer.h"
+#include "batchconverter.h"
+#include "audioengine.h"
+#include "midiengine.h"
+#include "controlserver.h"
+#include "oscserver.h"
 #include "logger.h"
+#include "parameterregistry.h"
 
 #include <CLI/CLI.hpp>
 
@@ -14,25 +23,42 @@
 #include <chrono>
 #include <csignal>
 #include <algorithm>
+#include <fstream>
+#include <sstream>
 
 using namespace GUI;
 
-bool CommandLine::m_app_running = false;
+std::atomic<bool> CommandLine::m_app_running{false};
+std::atomic<bool> CommandLine::m_interrupted{false};
+
+// Written from the SIGINT handler
+static_assert(std::atomic<bool>::is_always_lock_free, "The shutdown flags must be lock-free");
 
 /** @brief Constructor for the CommandLine class.
- * Initializes CLI11 app and starts the CoreEngine thread.
+ *  Initializes CLI11 app. In interactive mode, also sets up replxx and starts the
+ *  CoreEngine thread. In headless mode the engine is only started by commands
+ *  that need real-time playback.
+ *  @param mode Interactive prompt or headless command execution.
  */
-CommandLine::CommandLine()
-  : m_cli_app(std::make_unique<::CLI::App>("Minimal Audio Engine CLI")),
-    m_replxx(std::make_unique<replxx::Replxx>())
+CommandLine::CommandLine(eCommandLineMode mode)
+  : m_mode(mode),
+    m_cli_app(std::make_unique<::CLI::App>("Minimal Audio Engine CLI"))
 {
   m_app_running = true;
   std::signal(SIGINT, CommandLine::handle_shutdown_signal);
+#ifdef SIGPIPE
+  // A PCM consumer going away should fail the write, not kill the process
+  std::signal(SIGPIPE, SIG_IGN);
+#endif
 
-  m_engine.start_thread();
-  
   setup_commands();
-  setup_autocomplete();
+
+  if (m_mode == eCommandLineMode::Interactive)
+  {
+    m_replxx = std::make_unique<replxx::Replxx>();
+    m_engine.start_thread();
+    setup_autocomplete();
+  }
 }
 
 /** @brief Destructor for the CommandLine class.
@@ -47,10 +73,35 @@ CommandLine::~CommandLine()
  */
 void CommandLine::stop()
 {
+  if (m_control_server)
+  {
+    m_control_server->stop();
+  }
+
+  if (m_osc_server)
+  {
+    m_osc_server->stop();
+  }
+
+  if (!m_engine.is_running())
+  {
+    return;
+  }
+
   m_engine.push_message({MinimalAudioEngine::CoreEngineMessage::eType::Shutdown, "CLI stop requested"});
   m_engine.stop_thread();
 }
 
+/** @brief Starts the CoreEngine thread if it is not already running.
+ */
+void CommandLine::ensure_engine_running()
+{
+  if (!m_engine.is_running())
+  {
+    m_engine.start_thread();
+  }
+}
+
 /** @brief Sets up autocomplete for the CLI.
  *  Configures replxx to use the completion callback.
  */
@@ -88,7 +139,7 @@ replxx::Replxx::completions_t CommandLine::completion_callback(std::string const
   
   // Base commands - always check these first
   std::vector<std::string> base_commands = {
-    "help", "quit", "midi-devices", "audio-devices", "track"
+    "help", "quit", "midi-devices", "audio-devices", "track", "output", "render", "convert", "wait", "tap", "record", "latency", "midi", "param"
   };
   
   if (tokens.empty())
@@ -165,6 +216,7 @@ replxx::Replxx::completions_t CommandLine::completion_callback(std::string const
       if (tokens[2] == "set-audio-input")
       {
         input_types.push_back("file");
+        input_types.push_back("pipe");
       }
       
       for (const auto& type : input_types)
@@ -209,6 +261,8 @@ replxx::Replxx::completions_t CommandLine::completion_callback(std::string const
  */
 void CommandLine::setup_commands()
 {
+  reset_options();
+
   m_cli_app->require_subcommand(0, 1);
   m_cli_app->fallthrough(); // Allow parsing to continue
   m_cli_app->allow_extras(); // Allow extra arguments for interactive mode
@@ -281,6 +335,17 @@ void CommandLine::setup_commands()
   track_input_file_cmd->callback([this]() {
     cmd_add_track_audio_input_file(m_track_id, m_input_file_path);
   });
+
+  // track <id> set-audio-input pipe <path> [--format F] [--channels N] [--sample-rate N]
+  auto track_input_pipe_cmd = track_input_cmd->add_subcommand("pipe", "Set audio input from a raw PCM pipe, file or stdin");
+  m_pipe_path = "";
+  track_input_pipe_cmd->add_option("path", m_pipe_path, "FIFO or file path, or - for stdin")->required();
+  track_input_pipe_cmd->add_option("--format", m_pipe_format, "Sample format: f32le, s16le, s24le or s32le");
+  track_input_pipe_cmd->add_option("--channels", m_pipe_channels, "Channels (0 = engine channels)");
+  track_input_pipe_cmd->add_option("--sample-rate", m_pipe_sample_rate, "Sample rate (0 = engine sample rate)");
+  track_input_pipe_cmd->callback([this]() {
+    cmd_add_track_audio_input_pipe(m_track_id, m_pipe_path);
+  });
   
   // track <id> set-audio-output
   auto track_output_cmd = track_cmd->add_subcommand("set-audio-output", "Set audio output for track");
@@ -294,6 +359,247 @@ void CommandLine::setup_commands()
   track_output_device_cmd->callback([this]() {
     cmd_add_track_audio_output_device(m_track_id, m_output_device_id);
   });
+
+  // output pipe <path> [--format F] [--channels N] [--sample-rate N] [--freewheel]
+  auto output_cmd = m_cli_app->add_subcommand("output", "Choose where the engine writes the mix");
+  output_cmd->require_subcommand(1);
+  auto output_pipe_cmd = output_cmd->add_subcommand("pipe", "Write the mix as raw PCM to a pipe, file or stdout");
+  output_pipe_cmd->add_option("path", m_pipe_path, "FIFO or file path, or - for stdout")->required();
+  output_pipe_cmd->add_option("--format", m_pipe_format, "Sample format: f32le, s16le, s24le or s32le");
+  output_pipe_cmd->add_option("--channels", m_pipe_channels, "Channels (0 = engine channels)");
+  output_pipe_cmd->add_option("--sample-rate", m_pipe_sample_rate, "Sample rate (0 = engine sample rate)");
+  output_pipe_cmd->add_flag("--freewheel", m_pipe_freewheel, "Write as fast as the reader accepts instead of in real time");
+  output_pipe_cmd->callback([this]() { cmd_set_output_pipe(m_pipe_path); });
+
+  // render <output_dir>
+  auto render_cmd = m_cli_app->add_subcommand("render", "Render all tracks to stem files and a mix");
+  m_render_output_directory = "";
+  render_cmd->add_option("output_dir", m_render_output_directory, "Output directory")->required();
+  render_cmd->add_option("--segment-frames", m_render_segment_frames, "Frames per render work unit");
+  render_cmd->add_option("--threads", m_render_threads, "Worker threads (0 = all cores)");
+  render_cmd->add_flag("--no-stems", m_render_no_stems, "Do not write per-track stems");
+  render_cmd->add_flag("--no-mix", m_render_no_mix, "Do not write the mix");
+  render_cmd->callback([this]() { cmd_render(m_render_output_directory); });
+
+  // convert <input_dir> <output_dir>
+  auto convert_cmd = m_cli_app->add_subcommand("convert", "Convert a folder of WAV files");
+  m_convert_input_directory = "";
+  m_convert_output_directory = "";
+  m_convert_normalization = MinimalAudioEngine::eNormalization::None;
+  convert_cmd->add_option("input_dir", m_convert_input_directory, "Input directory")->required();
+  convert_cmd->add_option("output_dir", m_convert_output_directory, "Output directory")->required();
+  convert_cmd->add_option("--sample-rate", m_convert_sample_rate, "Output sample rate (0 = keep)");
+  convert_cmd->add_option("--bit-depth", m_convert_bit_depth, "Output bit depth: 16, 24, 32 or float");
+  convert_cmd->add_option("--format", m_convert_format, "Output format: wav, flac or aiff");
+  auto lufs_opt = convert_cmd->add_option("--normalize-lufs", m_convert_normalize_lufs, "Normalize to integrated loudness (LUFS)");
+  auto peak_opt = convert_cmd->add_option("--normalize-peak", m_convert_normalize_peak, "Normalize to sample peak (dBFS)");
+  convert_cmd->add_option("--threads", m_convert_threads, "DSP worker threads (0 = all cores)");
+  convert_cmd->callback([this, lufs_opt, peak_opt]() {
+    m_convert_normalization = *lufs_opt ? MinimalAudioEngine::eNormalization::Loudness
+                            : *peak_opt ? MinimalAudioEngine::eNormalization::Peak
+                                        : MinimalAudioEngine::eNormalization::None;
+    cmd_convert(m_convert_input_directory, m_convert_output_directory);
+  });
+
+  // wait
+  auto wait_cmd = m_cli_app->add_subcommand("wait", "Wait for playback to finish");
+  wait_cmd->callback([this]() { cmd_wait(); });
+
+  // Shared-memory taps
+  auto tap_cmd = m_cli_app->add_subcommand("tap", "Shared-memory audio taps for external processes");
+  tap_cmd->require_subcommand(1);
+  m_tap_name = "";
+
+  // tap add <name> [--track N] [--seconds S]
+  auto tap_add_cmd = tap_cmd->add_subcommand("add", "Add a tap on the master output or a track");
+  tap_add_cmd->add_option("name", m_tap_name, "Shared memory name")->required();
+  tap_add_cmd->add_option("--track", m_tap_track, "Track ID (default: master output)");
+  tap_add_cmd->add_option("--seconds", m_tap_seconds, "Ring length in seconds");
+  tap_add_cmd->callback([this]() { cmd_add_tap(m_tap_name); });
+
+  // tap remove <name>
+  auto tap_remove_cmd = tap_cmd->add_subcommand("remove", "Remove a tap");
+  tap_remove_cmd->add_option("name", m_tap_name, "Shared memory name")->required();
+  tap_remove_cmd->callback([this]() { cmd_remove_tap(m_tap_name); });
+
+  // tap list
+  auto tap_list_cmd = tap_cmd->add_subcommand("list", "List taps");
+  tap_list_cmd->callback([this]() { cmd_list_taps(); });
+
+  // latency measure [--loopback FRAMES] [--input-channel N] [--output-channel N]
+  auto latency_cmd = m_cli_app->add_subcommand("latency", "Measure the round-trip latency of the audio output");
+  latency_cmd->require_subcommand(1);
+  auto latency_measure_cmd = latency_cmd->add_subcommand("measure", "Play a test sequence and time its return");
+  latency_measure_cmd->add_option("--loopback", m_latency_loopback, "Simulate a loopback cable with this delay in frames");
+  latency_measure_cmd->add_option("--input-channel", m_latency_input_channel, "Input channel to capture");
+  latency_measure_cmd->add_option("--output-channel", m_latency_output_channel, "Output channel to play on");
+  latency_measure_cmd->callback([this]() { cmd_measure_latency(); });
+
+  // MIDI recording
+  auto midi_cmd = m_cli_app->add_subcommand("midi", "Record incoming MIDI to a Standard MIDI File");
+  midi_cmd->require_subcommand(1);
+  m_midi_record_path = "";
+
+  // midi record <file> [--tolerance N] [--bpm X]
+  auto midi_record_cmd = midi_cmd->add_subcommand("record", "Start recording incoming MIDI");
+  midi_record_cmd->add_option("file", m_midi_record_path, "Output .mid file")->required();
+  midi_record_cmd->add_option("--tolerance", m_midi_tolerance, "Thin controller streams by this many steps (0 = keep all)");
+  midi_record_cmd->add_option("--bpm", m_midi_tempo, "Tempo of the file");
+  midi_record_cmd->callback([this]() { cmd_start_midi_recording(m_midi_record_path); });
+
+  // midi record-stop
+  auto midi_record_stop_cmd = midi_cmd->add_subcommand("record-stop", "Stop recording MIDI and write the file");
+  midi_record_stop_cmd->callback([this]() { cmd_stop_midi_recording(); });
+
+  // midi mpe [--lower N] [--upper N] [--bend-range S]
+  auto midi_mpe_cmd = midi_cmd->add_subcommand("mpe", "Set the MPE zones");
+  midi_mpe_cmd->add_option("--lower", m_mpe_lower, "Member channels of the lower zone (0 = off)");
+  midi_mpe_cmd->add_option("--upper", m_mpe_upper, "Member channels of the upper zone (0 = off)");
+  midi_mpe_cmd->add_option("--bend-range", m_mpe_bend_range, "Per-note pitch bend range in semitones");
+  midi_mpe_cmd->callback([this]() { cmd_set_mpe_layout(); });
+
+  // midi voices
+  auto midi_voices_cmd = midi_cmd->add_subcommand("voices", "List the sounding MPE voices");
+  midi_voices_cmd->callback([this]() { cmd_list_mpe_voices(); });
+
+  // midi learn|unbind <parameter>
+  m_parameter_name = "";
+  m_parameter_value = 0.0f;
+  auto midi_learn_cmd = midi_cmd->add_subcommand("learn", "Bind the next controller to move to a parameter");
+  midi_learn_cmd->add_option("parameter", m_parameter_name, "Parameter name, see 'param list'")->required();
+  midi_learn_cmd->callback([this]() { cmd_learn_parameter(m_parameter_name); });
+  auto midi_unbind_cmd = midi_cmd->add_subcommand("unbind", "Remove a parameter's controller bindings");
+  midi_unbind_cmd->add_option("parameter", m_parameter_name, "Parameter name")->required();
+  midi_unbind_cmd->callback([this]() { cmd_unbind_parameter(m_parameter_name); });
+
+  // midi bindings
+  auto midi_bindings_cmd = midi_cmd->add_subcommand("bindings", "List the controller bindings");
+  midi_bindings_cmd->callback([this]() { cmd_list_midi_bindings(); });
+
+  // Parameters
+  auto param_cmd = m_cli_app->add_subcommand("param", "List and set remotely controllable parameters");
+  param_cmd->require_subcommand(1);
+  auto param_list_cmd = param_cmd->add_subcommand("list", "List the parameters and their values");
+  param_list_cmd->callback([this]() { cmd_list_parameters(); });
+  auto param_set_cmd = param_cmd->add_subcommand("set", "Set a parameter");
+  param_set_cmd->add_option("parameter", m_parameter_name, "Parameter name")->required();
+  param_set_cmd->add_option("value", m_parameter_value, "Value within the parameter's range")->required();
+  param_set_cmd->callback([this]() { cmd_set_parameter(m_parameter_name, m_parameter_value); });
+
+  // Disk recording
+  auto record_cmd = m_cli_app->add_subcommand("record", "Record tracks and the master output to WAV files");
+  record_cmd->require_subcommand(1);
+  m_record_directory = "";
+  m_loop_length = 0;
+  m_take_index = MinimalAudioEngine::LOOP_TAKE_NONE;
+
+  // record arm|disarm <track_id>
+  auto record_arm_cmd = record_cmd->add_subcommand("arm", "Record a track with the next recording");
+  record_arm_cmd->add_option("track_id", m_track_id, "Track ID")->required();
+  record_arm_cmd->callback([this]() { cmd_arm_track(m_track_id, true); });
+  auto record_disarm_cmd = record_cmd->add_subcommand("disarm", "Stop recording a track with the next recording");
+  record_disarm_cmd->add_option("track_id", m_track_id, "Track ID")->required();
+  record_disarm_cmd->callback([this]() { cmd_arm_track(m_track_id, false); });
+
+  // record start <directory> [--master] [--direct-io] [--pre-roll S] [--standby]
+  auto record_start_cmd = record_cmd->add_subcommand("start", "Start recording the armed tracks");
+  record_start_cmd->add_option("directory", m_record_directory, "Output directory")->required();
+  record_start_cmd->add_flag("--master", m_record_master, "Also record the master output");
+  record_start_cmd->add_flag("--direct-io", m_record_direct_io, "Bypass the page cache");
+  record_start_cmd->add_option("--pre-roll", m_record_pre_roll, "Seconds of audio from before the punch-in to keep");
+  record_start_cmd->add_flag("--standby", m_record_standby, "Only fill the pre-roll buffer until punch-in");
+  record_start_cmd->add_flag("--compensate", m_record_compensate, "Move the takes earlier by the measured round trip");
+  record_start_cmd->callback([this]() { cmd_start_recording(m_record_directory); });
+
+  // record punch-in|punch-out [--at SAMPLE]
+  auto record_punch_in_cmd = record_cmd->add_subcommand("punch-in", "Start the takes");
+  record_punch_in_cmd->add_option("--at", m_record_punch_sample, "Transport sample (default: now)");
+  record_punch_in_cmd->callback([this]() { cmd_punch(true); });
+  auto record_punch_out_cmd = record_cmd->add_subcommand("punch-out", "End the takes");
+  record_punch_out_cmd->add_option("--at", m_record_punch_sample, "Transport sample (default: now)");
+  record_punch_out_cmd->callback([this]() { cmd_punch(false); });
+
+  // record stop
+  auto record_stop_cmd = record_cmd->add_subcommand("stop", "Stop recording and close the files");
+  record_stop_cmd->callback([this]() { cmd_stop_recording(); });
+
+  // record loop <directory> --length FRAMES [--start SAMPLE] [--takes N]
+  auto record_loop_cmd = record_cmd->add_subcommand("loop", "Loop record the armed tracks, one take per pass");
+  record_loop_cmd->add_option("directory", m_record_directory, "Output directory")->required();
+  record_loop_cmd->add_option("--length", m_loop_length, "Loop length in frames")->required();
+  record_loop_cmd->add_option("--start", m_loop_start, "Transport sample the loop starts at");
+  record_loop_cmd->add_option("--takes", m_loop_takes, "Takes per track kept in memory");
+  record_loop_cmd->callback([this]() { cmd_start_loop_recording(m_record_directory); });
+
+  // record loop-stop
+  auto record_loop_stop_cmd = record_cmd->add_subcommand("loop-stop", "Stop loop recording and write the last takes");
+  record_loop_stop_cmd->callback([this]() { cmd_stop_loop_recording(); });
+
+  // record takes <track_id>
+  auto record_takes_cmd = record_cmd->add_subcommand("takes", "List a track's loop takes");
+  record_takes_cmd->add_option("track_id", m_track_id, "Track ID")->required();
+  record_takes_cmd->callback([this]() { cmd_list_takes(m_track_id); });
+
+  // record take <track_id> <take>
+  auto record_take_cmd = record_cmd->add_subcommand("take", "Choose the loop take a track plays");
+  record_take_cmd->add_option("track_id", m_track_id, "Track ID")->required();
+  record_take_cmd->add_option("take", m_take_index, "Take index, -1 for none")->required();
+  record_take_cmd->callback([this]() { cmd_select_take(m_track_id, m_take_index); });
+}
+
+/** @brief Set the optional flags and options back to their defaults.
+ *  CLI11 only writes a bound variable when its option is given, so without this an option
+ *  given to one command would still apply to the next command that leaves it out.
+ */
+void CommandLine::reset_options()
+{
+  // track set-audio-input pipe and output pipe
+  m_pipe_format = "f32le";
+  m_pipe_channels = 0;
+  m_pipe_sample_rate = 0;
+  m_pipe_freewheel = false;
+
+  // render
+  m_render_segment_frames = 0;
+  m_render_threads = 0;
+  m_render_no_stems = false;
+  m_render_no_mix = false;
+
+  // convert
+  m_convert_sample_rate = 0;
+  m_convert_bit_depth = "24";
+  m_convert_format = "wav";
+  m_convert_normalize_lufs = 0.0;
+  m_convert_normalize_peak = 0.0;
+  m_convert_threads = 0;
+
+  // tap add
+  m_tap_track = -1;
+  m_tap_seconds = 0.0;
+
+  // latency measure
+  m_latency_loopback = -1;
+  m_latency_input_channel = 0;
+  m_latency_output_channel = 0;
+
+  // midi record
+  m_midi_tolerance = 0;
+  m_midi_tempo = 120.0;
+
+  // midi mpe
+  m_mpe_lower = 0;
+  m_mpe_upper = 0;
+  m_mpe_bend_range = MinimalAudioEngine::MPE_DEFAULT_NOTE_BEND_RANGE;
+
+  // record start, punch-in/out and loop
+  m_record_master = false;
+  m_record_direct_io = false;
+  m_record_pre_roll = 0.0;
+  m_record_standby = false;
+  m_record_compensate = false;
+  m_record_punch_sample = 0;
+  m_loop_start = 0;
+  m_loop_takes = MinimalAudioEngine::LOOP_RECORDER_DEFAULT_TAKES;
 }
 
 // ============================================================================
@@ -343,7 +649,7 @@ void CommandLine::cmd_get_track(unsigned int track_id)
   }
   catch (const std::exception &e)
   {
-    std::cout << "Error: " << e.what() << "\n";
+    report_error(e.what());
   }
 }
 
@@ -361,7 +667,7 @@ void CommandLine::cmd_add_track_audio_input_device(unsigned int track_id, unsign
   }
   catch (const std::exception &e)
   {
-    std::cout << "Error: " << e.what() << "\n";
+    report_error(e.what());
   }
 }
 
@@ -372,17 +678,43 @@ void CommandLine::cmd_add_track_audio_input_file(unsigned int track_id, const st
     auto track = MinimalAudioEngine::TrackManager::instance().get_track(track_id);
     std::cout << "Adding Audio File Input " << file_path << " to Track " << track_id << "...\n";
 
-    auto wav_file = MinimalAudioEngine::FileManager::instance().read_wav_file(file_path);
-    if (wav_file.has_value())
+    auto &file_manager = MinimalAudioEngine::FileManager::instance();
+    auto wav_file = file_manager.read_wav_file_deferred(file_path);
+
+    // A headless job should fail here rather than render silence later
+    if (m_mode == eCommandLineMode::Headless)
     {
-      track->add_audio_file_input(wav_file.value());
+      if (!wav_file->prefetch())
+      {
+        report_error("Audio file is missing or unreadable: " + file_path);
+        return;
+      }
+
+      track->add_audio_file_input(wav_file);
+      std::cout << "Added Audio File Input to Track\n";
+      std::cout << track->to_string() << "\n";
+      return;
     }
+
+    // Resolve the file in the background so the prompt is not blocked on slow storage.
+    // The loader thread only queues a missing file; the command thread reports and detaches it
+    track->add_audio_file_input(wav_file);
+    std::weak_ptr<MinimalAudioEngine::Track> weak_track = track;
+    file_manager.resolve_wav_files_async({wav_file},
+      [this, track_id, weak_track](MinimalAudioEngine::eFileEvent event, const MinimalAudioEngine::WavFilePtr &file) {
+        if (event == MinimalAudioEngine::eFileEvent::Missing)
+        {
+          std::lock_guard<std::mutex> lock(m_missing_files_mutex);
+          m_missing_files.push_back({track_id, weak_track, file});
+        }
+      },
+      MinimalAudioEngine::eLoadPriority::Interactive);
     std::cout << "Added Audio File Input to Track\n";
     std::cout << track->to_string() << "\n";
   }
   catch (const std::exception &e)
   {
-    std::cout << "Error: " << e.what() << "\n";
+    report_error(e.what());
   }
 }
 
@@ -400,7 +732,84 @@ void CommandLine::cmd_add_track_audio_output_device(unsigned int track_id, unsig
   }
   catch (const std::exception &e)
   {
-    std::cout << "Error: " << e.what() << "\n";
+    report_error(e.what());
+  }
+}
+
+/** @brief Builds the PCM stream format from the pipe options, defaulting to the engine settings.
+ *  @return The format, or nullopt if the sample format name is unknown.
+ */
+std::optional<MinimalAudioEngine::PcmStreamFormat> CommandLine::get_pipe_format()
+{
+  auto sample_format = MinimalAudioEngine::PcmStreamFormat::parse_sample_format(m_pipe_format);
+  if (!sample_format)
+  {
+    report_error("Unknown sample format: " + m_pipe_format);
+    return std::nullopt;
+  }
+
+  auto &audio_engine = MinimalAudioEngine::AudioEngine::instance();
+  MinimalAudioEngine::PcmStreamFormat format;
+  format.sample_format = *sample_format;
+  format.channels = m_pipe_channels != 0 ? m_pipe_channels : audio_engine.get_channels();
+  format.sample_rate = m_pipe_sample_rate != 0 ? m_pipe_sample_rate : audio_engine.get_sample_rate();
+  return format;
+}
+
+void CommandLine::cmd_add_track_audio_input_pipe(unsigned int track_id, const std::string &path)
+{
+  try
+  {
+    auto track = MinimalAudioEngine::TrackManager::instance().get_track(track_id);
+    auto format = get_pipe_format();
+    if (!format)
+    {
+      return;
+    }
+
+    auto stream = MinimalAudioEngine::FileManager::instance().open_pcm_input(path, *format);
+    if (!stream)
+    {
+      report_error("Cannot open PCM input: " + path);
+      return;
+    }
+
+    track->add_audio_stream_input(*stream);
+    std::cout << "Added Audio Stream Input to Track\n";
+    std::cout << track->to_string() << "\n";
+  }
+  catch (const std::exception &e)
+  {
+    report_error(e.what());
+  }
+}
+
+/** @brief Replaces the engine's output with a raw PCM stream. The mix of every track goes there.
+ */
+void CommandLine::cmd_set_output_pipe(const std::string &path)
+{
+  try
+  {
+    auto format = get_pipe_format();
+    if (!format)
+    {
+      return;
+    }
+
+    auto pacing = m_pipe_freewheel ? MinimalAudioEngine::ePcmPacing::Freewheel : MinimalAudioEngine::ePcmPacing::Realtime;
+    auto stream = MinimalAudioEngine::FileManager::instance().open_pcm_output(path, *format, pacing);
+    if (!stream)
+    {
+      report_error("Cannot open PCM output: " + path);
+      return;
+    }
+
+    MinimalAudioEngine::AudioEngine::instance().set_output_stream(*stream);
+    std::cout << "Writing the mix to " << (*stream)->to_string() << "\n";
+  }
+  catch (const std::exception &e)
+  {
+    report_error(e.what());
   }
 }
 
@@ -411,12 +820,14 @@ void CommandLine::cmd_play_track(unsigned int track_id)
     auto track = MinimalAudioEngine::TrackManager::instance().get_track(track_id);
     std::cout << "Playing Track " << track_id << "...\n";
 
+    ensure_engine_running();
+
     track->play();
     std::cout << "Track is now playing.\n";
   }
   catch (const std::exception &e)
   {
-    std::cout << "Error: " << e.what() << "\n";
+    report_error(e.what());
   }
 }
 
@@ -432,10 +843,498 @@ void CommandLine::cmd_stop_track(unsigned int track_id)
   }
   catch (const std::exception &e)
   {
-    std::cout << "Error: " << e.what() << "\n";
+    report_error(e.what());
+  }
+}
+
+void CommandLine::cmd_render(const std::string &output_directory)
+{
+  try
+  {
+    MinimalAudioEngine::OfflineRenderConfig config;
+    config.output_directory = output_directory;
+    config.thread_count = m_render_threads;
+    config.export_stems = !m_render_no_stems;
+    config.export_mix = !m_render_no_mix;
+    if (m_render_segment_frames != 0)
+    {
+      config.segment_frames = m_render_segment_frames;
+    }
+
+    std::cout << "Rendering tracks to " << output_directory << "...\n";
+
+    MinimalAudioEngine::OfflineRenderer renderer(config);
+    auto statistics = renderer.render(MinimalAudioEngine::TrackManager::instance().get_tracks());
+    if (statistics.files_written == 0)
+    {
+      report_error("Nothing was rendered");
+      return;
+    }
+
+    std::cout << "Rendered " << statistics.tracks_rendered << " tracks in " << statistics.elapsed_seconds
+              << " s (" << statistics.realtime_factor << "x realtime)\n";
+  }
+  catch (const std::exception &e)
+  {
+    report_error(e.what());
+  }
+}
+
+void CommandLine::cmd_convert(const std::string &input_directory, const std::string &output_directory)
+{
+  try
+  {
+    MinimalAudioEngine::BatchConvertConfig config;
+    config.output_directory = output_directory;
+    config.sample_rate = m_convert_sample_rate;
+    config.dsp_threads = m_convert_threads;
+    config.normalization = m_convert_normalization;
+    config.target_level = m_convert_normalization == MinimalAudioEngine::eNormalization::Peak ? m_convert_normalize_peak
+                                                                                              : m_convert_normalize_lufs;
+
+    int major_format;
+    if (m_convert_format == "wav")
+      major_format = SF_FORMAT_WAV;
+    else if (m_convert_format == "flac")
+      major_format = SF_FORMAT_FLAC;
+    else if (m_convert_format == "aiff")
+      major_format = SF_FORMAT_AIFF;
+    else
+    {
+      report_error("Unknown format: " + m_convert_format);
+      return;
+    }
+
+    int minor_format;
+    if (m_convert_bit_depth == "16")
+      minor_format = SF_FORMAT_PCM_16;
+    else if (m_convert_bit_depth == "24")
+      minor_format = SF_FORMAT_PCM_24;
+    else if (m_convert_bit_depth == "32")
+      minor_format = SF_FORMAT_PCM_32;
+    else if (m_convert_bit_depth == "float")
+      minor_format = SF_FORMAT_FLOAT;
+    else
+    {
+      report_error("Unknown bit depth: " + m_convert_bit_depth);
+      return;
+    }
+
+    config.format = major_format | minor_format;
+
+    std::cout << "Converting " << input_directory << " to " << output_directory << "...\n";
+
+    MinimalAudioEngine::BatchConverter converter(config);
+    auto progress = converter.convert_directory(input_directory,
+      [](const MinimalAudioEngine::BatchConvertProgress &progress) {
+        std::cout << "[" << (progress.files_converted + progress.files_failed) << "/" << progress.files_total << "] "
+                  << progress.last_file.filename().string() << "\n";
+      });
+
+    std::cout << "Converted " << progress.files_converted << " files (" << progress.files_failed << " failed) in "
+              << progress.elapsed_seconds << " s, " << progress.files_per_second << " files/s\n";
+
+    if (progress.files_failed > 0)
+    {
+      report_error(std::to_string(progress.files_failed) + " files failed to convert");
+    }
+  }
+  catch (const std::exception &e)
+  {
+    report_error(e.what());
+  }
+}
+
+void CommandLine::cmd_wait()
+{
+  // Queued play requests are taken by the engine thread
+  ensure_engine_running();
+
+  auto &audio_engine = MinimalAudioEngine::AudioEngine::instance();
+  while (m_app_running && audio_engine.is_playback_pending())
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
   }
 }
 
+void CommandLine::cmd_add_tap(const std::string &name)
+{
+  auto &audio_engine = MinimalAudioEngine::AudioEngine::instance();
+
+  uint32_t source = MinimalAudioEngine::AUDIO_TAP_SOURCE_MASTER;
+  if (m_tap_track >= 0)
+  {
+    if (static_cast<size_t>(m_tap_track) >= MinimalAudioEngine::TrackManager::instance().get_track_count())
+    {
+      report_error("No track with ID " + std::to_string(m_tap_track));
+      return;
+    }
+    source = static_cast<uint32_t>(m_tap_track);
+  }
+
+  uint32_t capacity_frames = MinimalAudioEngine::AUDIO_TAP_DEFAULT_CAPACITY;
+  if (m_tap_seconds > 0.0)
+  {
+    capacity_frames = static_cast<uint32_t>(m_tap_seconds * audio_engine.get_sample_rate());
+  }
+
+  if (!audio_engine.add_tap(name, source, capacity_frames))
+  {
+    report_error("Failed to add tap " + name);
+    return;
+  }
+
+  std::cout << "Added tap " << name << "\n";
+}
+
+void CommandLine::cmd_remove_tap(const std::string &name)
+{
+  if (!MinimalAudioEngine::AudioEngine::instance().remove_tap(name))
+  {
+    report_error("No tap named " + name);
+    return;
+  }
+
+  std::cout << "Removed tap " << name << "\n";
+}
+
+void CommandLine::cmd_list_taps()
+{
+  for (const auto &description : MinimalAudioEngine::AudioEngine::instance().get_tap_descriptions())
+  {
+    std::cout << description << "\n";
+  }
+}
+
+void CommandLine::cmd_arm_track(unsigned int track_id, bool armed)
+{
+  auto &track_manager = MinimalAudioEngine::TrackManager::instance();
+  if (track_id >= track_manager.get_track_count())
+  {
+    report_error("No track with ID " + std::to_string(track_id));
+    return;
+  }
+
+  track_manager.get_track(track_id)->set_record_armed(armed);
+  std::cout << (armed ? "Armed" : "Disarmed") << " track " << track_id << "\n";
+}
+
+void CommandLine::cmd_start_recording(const std::string &directory)
+{
+  MinimalAudioEngine::RecordingOptions options;
+  options.directory = directory;
+  options.include_master = m_record_master;
+  options.direct_io = m_record_direct_io;
+  options.pre_roll_seconds = m_record_pre_roll;
+  options.punch_in = m_record_standby ? MinimalAudioEngine::RECORDER_NO_PUNCH : 0;
+  if (m_record_compensate)
+  {
+    auto &audio_engine = MinimalAudioEngine::AudioEngine::instance();
+    auto profile = MinimalAudioEngine::DeviceManager::instance().get_audio_device_profile(audio_engine.get_output_device().name);
+    if (!profile.has_value())
+    {
+      report_error("No measured round trip for this device; run latency measure first");
+      return;
+    }
+    if (profile->sample_rate != audio_engine.get_sample_rate() || profile->buffer_frames != audio_engine.get_buffer_frames())
+    {
+      report_error("The round trip was measured at " + std::to_string(profile->sample_rate) + " Hz with " +
+                   std::to_string(profile->buffer_frames) + " frames per buffer; run latency measure again");
+      return;
+    }
+    options.latency_compensation = profile->round_trip_latency;
+  }
+
+  if (!MinimalAudioEngine::AudioEngine::instance().start_recording(options))
+  {
+    report_error("Failed to start recording to " + directory);
+    return;
+  }
+
+  std::cout << "Recording to " << directory << "\n";
+}
+
+void CommandLine::cmd_punch(bool punch_in)
+{
+  auto &audio_engine = MinimalAudioEngine::AudioEngine::instance();
+  bool ok = punch_in ? audio_engine.punch_in(m_record_punch_sample) : audio_engine.punch_out(m_record_punch_sample);
+  if (!ok)
+  {
+    report_error("Nothing is recording");
+    return;
+  }
+
+  std::cout << (punch_in ? "Punch-in" : "Punch-out") << " at "
+            << (m_record_punch_sample > 0 ? std::to_string(m_record_punch_sample) : std::string("next block")) << "\n";
+}
+
+void CommandLine::cmd_stop_recording()
+{
+  auto statistics = MinimalAudioEngine::AudioEngine::instance().stop_recording();
+  if (!statistics.has_value())
+  {
+    report_error("Nothing is recording");
+    return;
+  }
+
+  std::cout << statistics->to_string() << "\n";
+  if (statistics->blocks_dropped > 0 || statistics->write_failed)
+  {
+    report_error("The recording is incomplete");
+  }
+}
+
+void CommandLine::cmd_start_loop_recording(const std::string &directory)
+{
+  MinimalAudioEngine::LoopRecordingOptions options;
+  options.directory = directory;
+  options.loop_start = m_loop_start;
+  options.loop_length = m_loop_length;
+  options.max_takes = m_loop_takes;
+
+  if (!MinimalAudioEngine::AudioEngine::instance().start_loop_recording(options))
+  {
+    report_error("Failed to start loop recording to " + directory);
+    return;
+  }
+
+  std::cout << "Loop recording to " << directory << "\n";
+}
+
+void CommandLine::cmd_stop_loop_recording()
+{
+  auto statistics = MinimalAudioEngine::AudioEngine::instance().stop_loop_recording();
+  if (!statistics.has_value())
+  {
+    report_error("Nothing is loop recording");
+    return;
+  }
+
+  std::cout << statistics->to_string() << "\n";
+  if (statistics->passes_dropped > 0 || statistics->write_failed)
+  {
+    report_error("The loop recording is incomplete");
+  }
+}
+
+void CommandLine::cmd_list_takes(unsigned int track_id)
+{
+  auto &audio_engine = MinimalAudioEngine::AudioEngine::instance();
+  auto takes = audio_engine.get_loop_takes(track_id);
+  if (takes.empty())
+  {
+    std::cout << "No takes on track " << track_id << "\n";
+    return;
+  }
+
+  int selected = audio_engine.get_selected_take(track_id);
+  for (const auto &take : takes)
+  {
+    std::cout << (static_cast<int>(take.index) == selected ? "* " : "  ") << take.to_string() << "\n";
+  }
+}
+
+void CommandLine::cmd_select_take(unsigned int track_id, int take)
+{
+  if (!MinimalAudioEngine::AudioEngine::instance().select_take(track_id, take))
+  {
+    report_error("Cannot select take " + std::to_string(take) + " on track " + std::to_string(track_id));
+    return;
+  }
+
+  std::cout << "Track " << track_id << " plays "
+            << (take == MinimalAudioEngine::LOOP_TAKE_NONE ? std::string("no take") : "take " + std::to_string(take))
+            << "\n";
+}
+
+void CommandLine::cmd_measure_latency()
+{
+  ensure_engine_running();
+
+  auto &audio_engine = MinimalAudioEngine::AudioEngine::instance();
+  if (m_latency_loopback >= 0 && !audio_engine.enable_virtual_loopback(static_cast<uint32_t>(m_latency_loopback)))
+  {
+    report_error("Failed to enable the virtual loopback");
+    return;
+  }
+
+  MinimalAudioEngine::LatencyMeterOptions options;
+  options.input_channel = m_latency_input_channel;
+  options.output_channel = m_latency_output_channel;
+  auto profile = MinimalAudioEngine::DeviceManager::instance().measure_audio_device_latency(options);
+
+  if (m_latency_loopback >= 0)
+  {
+    audio_engine.disable_virtual_loopback();
+  }
+
+  if (!profile.has_value())
+  {
+    report_error("Failed to measure the round trip");
+    return;
+  }
+
+  std::cout << "Round trip: " << profile->round_trip_latency << " frames ("
+            << 1000.0 * profile->round_trip_latency / std::max(1u, profile->sample_rate) << " ms)"
+            << (profile->is_virtual ? ", virtual loopback, not stored" : "") << "\n";
+}
+
+void CommandLine::cmd_start_midi_recording(const std::string &path)
+{
+  auto &audio_engine = MinimalAudioEngine::AudioEngine::instance();
+
+  MinimalAudioEngine::MidiRecordingOptions options;
+  options.path = path;
+  if (audio_engine.get_sample_rate() > 0)
+  {
+    options.sample_rate = audio_engine.get_sample_rate();
+  }
+  options.tempo_bpm = m_midi_tempo;
+  options.controller_tolerance = m_midi_tolerance;
+  // A stopped stream's clock stands still; the recorder then times events itself
+  if (audio_engine.is_stream_running())
+  {
+    options.sample_clock = [&audio_engine](std::chrono::steady_clock::time_point arrival) {
+      return audio_engine.get_sample_time_at(arrival);
+    };
+  }
+
+  if (!MinimalAudioEngine::MidiEngine::instance().start_recording(options))
+  {
+    report_error("Failed to start recording MIDI to " + path);
+    return;
+  }
+
+  std::cout << "Recording MIDI to " << path << "\n";
+}
+
+void CommandLine::cmd_stop_midi_recording()
+{
+  auto statistics = MinimalAudioEngine::MidiEngine::instance().stop_recording();
+  if (!statistics.has_value())
+  {
+    report_error("MIDI is not recording");
+    return;
+  }
+
+  std::cout << statistics->to_string() << "\n";
+  if (statistics->events_dropped > 0 || statistics->write_failed)
+  {
+    report_error("The MIDI recording is incomplete");
+  }
+}
+
+void CommandLine::cmd_set_mpe_layout()
+{
+  MinimalAudioEngine::MpeZoneLayout layout;
+  layout.lower_members = m_mpe_lower;
+  layout.upper_members = m_mpe_upper;
+  layout.note_bend_range = m_mpe_bend_range;
+  MinimalAudioEngine::MidiEngine::instance().set_mpe_layout(layout);
+  std::cout << "MPE zones set with the next MIDI message: " << layout.to_string() << "\n";
+}
+
+void CommandLine::cmd_list_mpe_voices()
+{
+  const auto &voice_map = MinimalAudioEngine::MidiEngine::instance().get_mpe_voice_map();
+  std::cout << voice_map.get_layout().to_string() << "\n";
+
+  MinimalAudioEngine::MpeVoice voices[MinimalAudioEngine::MPE_MAX_VOICES];
+  size_t count = voice_map.get_active_voices(voices, MinimalAudioEngine::MPE_MAX_VOICES);
+  for (size_t i = 0; i < count; ++i)
+  {
+    std::cout << "  Channel " << static_cast<int>(voices[i].channel) + 1
+              << " Note " << static_cast<int>(voices[i].note)
+              << " Velocity " << static_cast<int>(voices[i].velocity)
+              << " Bend " << voices[i].pitch_bend
+              << " Pressure " << voices[i].pressure
+              << " Timbre " << voices[i].timbre << "\n";
+  }
+  std::cout << voice_map.get_statistics().to_string() << "\n";
+}
+
+void CommandLine::cmd_learn_parameter(const std::string &name)
+{
+  auto parameter = MinimalAudioEngine::ParameterRegistry::instance().find_parameter(name);
+  if (!parameter.has_value())
+  {
+    report_error("Unknown parameter " + name);
+    return;
+  }
+
+  MinimalAudioEngine::MidiEngine::instance().get_midi_learn().learn(*parameter);
+  std::cout << "Move a controller to bind it to " << name << "\n";
+}
+
+void CommandLine::cmd_unbind_parameter(const std::string &name)
+{
+  auto parameter = MinimalAudioEngine::ParameterRegistry::instance().find_parameter(name);
+  if (!parameter.has_value())
+  {
+    report_error("Unknown parameter " + name);
+    return;
+  }
+
+  MinimalAudioEngine::MidiEngine::instance().get_midi_learn().unbind(*parameter);
+  std::cout << "Removed the bindings of " << name << "\n";
+}
+
+void CommandLine::cmd_list_midi_bindings()
+{
+  auto &registry = MinimalAudioEngine::ParameterRegistry::instance();
+  auto bindings = MinimalAudioEngine::MidiEngine::instance().get_midi_learn().get_bindings();
+  if (bindings.empty())
+  {
+    std::cout << "No controller bindings.\n";
+    return;
+  }
+
+  for (const auto &binding : bindings)
+  {
+    auto info = registry.get_info(binding.parameter);
+    std::cout << "  " << binding.to_string() << " (" << (info.has_value() ? info->name : "?") << ")\n";
+  }
+}
+
+void CommandLine::cmd_list_parameters()
+{
+  auto &registry = MinimalAudioEngine::ParameterRegistry::instance();
+  auto parameters = registry.get_parameters();
+  if (parameters.empty())
+  {
+    std::cout << "No parameters.\n";
+    return;
+  }
+
+  for (size_t id = 0; id < parameters.size(); ++id)
+  {
+    std::cout << "  " << id << ": " << parameters[id].name << " = "
+              << registry.get_value(static_cast<MinimalAudioEngine::ParameterId>(id))
+              << " [" << parameters[id].minimum << ", " << parameters[id].maximum << "]\n";
+  }
+}
+
+void CommandLine::cmd_set_parameter(const std::string &name, float value)
+{
+  auto &registry = MinimalAudioEngine::ParameterRegistry::instance();
+  auto parameter = registry.find_parameter(name);
+  if (!parameter.has_value() || !registry.set_value(*parameter, value))
+  {
+    report_error("Unknown parameter " + name);
+    return;
+  }
+  std::cout << name << " = " << registry.get_value(*parameter) << "\n";
+}
+
+/** @brief Reports a failed command to the user and marks it as failed.
+ *  @param message The error message.
+ */
+void CommandLine::report_error(const std::string &message)
+{
+  m_command_failed = true;
+  std::cout << "Error: " << message << "\n";
+}
+
 /** @brief Signal handler for graceful shutdown on SIGINT (Ctrl+C).
  *  This function sets the app_running flag to false, allowing the main loop to exit cleanly.
  *
@@ -458,6 +1357,55 @@ void CommandLine::show_help()
   std::cout << "  track <track_id> set-audio-input device <device_id>   - Set audio input from device\n";
   std::cout << "  track <track_id> set-audio-input file <file_path>     - Set audio input from file\n";
   std::cout << "  track <track_id> set-audio-output device <device_id>  - Set audio output to device\n";
+  std::cout << "  track <track_id> set-audio-input pipe <path|-> [--format F] [--channels N] [--sample-rate N]\n";
+  std::cout << "                                                 - Set audio input from raw PCM (- is stdin)\n";
+  std::cout << "\n";
+  std::cout << "Output commands:\n";
+  std::cout << "  output pipe <path|-> [--format F] [--channels N] [--sample-rate N] [--freewheel]\n";
+  std::cout << "                                                 - Write the mix as raw PCM (- is stdout)\n";
+  std::cout << "\n";
+  std::cout << "Session commands:\n";
+  std::cout << "  render <output_dir> [--segment-frames N] [--threads N] [--no-stems] [--no-mix]\n";
+  std::cout << "                                                 - Render all tracks to stems and a mix\n";
+  std::cout << "  convert <input_dir> <output_dir> [--sample-rate N] [--bit-depth 16|24|32|float]\n";
+  std::cout << "          [--format wav|flac|aiff] [--normalize-lufs X | --normalize-peak X] [--threads N]\n";
+  std::cout << "                                                 - Convert a folder of WAV files\n";
+  std::cout << "  wait                                           - Wait for playback to finish\n";
+  std::cout << "\n";
+  std::cout << "Tap commands:\n";
+  std::cout << "  tap add <name> [--track N] [--seconds S]       - Publish the master output or a track in shared memory\n";
+  std::cout << "  tap remove <name>                              - Remove a tap\n";
+  std::cout << "  tap list                                       - List taps\n";
+  std::cout << "\n";
+  std::cout << "Latency commands:\n";
+  std::cout << "  latency measure [--loopback FRAMES] [--input-channel N] [--output-channel N]\n";
+  std::cout << "                                                 - Measure the round trip and store it in the device profile\n";
+  std::cout << "\n";
+  std::cout << "MIDI commands:\n";
+  std::cout << "  midi record <file> [--tolerance N] [--bpm X]   - Record incoming MIDI to a type 1 .mid file\n";
+  std::cout << "  midi record-stop                               - Stop recording MIDI and write the file\n";
+  std::cout << "  midi mpe [--lower N] [--upper N] [--bend-range S]\n";
+  std::cout << "                                                 - Set the MPE zones' member channels\n";
+  std::cout << "  midi voices                                    - List the sounding MPE voices\n";
+  std::cout << "  midi learn <parameter>                         - Bind the next controller or NRPN to move\n";
+  std::cout << "  midi unbind <parameter>                        - Remove a parameter's controller bindings\n";
+  std::cout << "  midi bindings                                  - List the controller bindings\n";
+  std::cout << "\n";
+  std::cout << "Parameter commands:\n";
+  std::cout << "  param list                                     - List the parameters, e.g. track0.gain\n";
+  std::cout << "  param set <parameter> <value>                  - Set a parameter\n";
+  std::cout << "\n";
+  std::cout << "Record commands:\n";
+  std::cout << "  record arm|disarm <track_id>                   - Choose the tracks to record\n";
+  std::cout << "  record start <dir> [--master] [--direct-io] [--pre-roll S] [--standby] [--compensate]\n";
+  std::cout << "                                                 - Record the armed tracks to <dir>/track<N>.wav\n";
+  std::cout << "  record punch-in|punch-out [--at SAMPLE]        - Start or end the takes, sample-accurately\n";
+  std::cout << "  record stop                                    - Stop recording and close the files\n";
+  std::cout << "  record loop <dir> --length N [--start S] [--takes K]\n";
+  std::cout << "                                                 - Record each pass over the loop as a new take\n";
+  std::cout << "  record loop-stop                               - Stop loop recording and write the last takes\n";
+  std::cout << "  record takes <track_id>                        - List a track's takes; * marks the one playing\n";
+  std::cout << "  record take <track_id> <take>                  - Play another take from the next block, -1 for none\n";
 }
 
 /** @brief Signal handler for graceful shutdown on SIGINT (Ctrl+C).
@@ -466,6 +1414,7 @@ void CommandLine::show_help()
  */
 void CommandLine::handle_shutdown_signal(int signum)
 {
+  m_interrupted = true;
   m_app_running = false;
 }
 
@@ -474,6 +1423,12 @@ void CommandLine::handle_shutdown_signal(int signum)
  */
 void CommandLine::run()
 {
+  if (m_mode != eCommandLineMode::Interactive)
+  {
+    LOG_ERROR("CommandLine: run() requires interactive mode.");
+    return;
+  }
+
   // Small delay to ensure engine thread starts properly
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
@@ -482,6 +1437,8 @@ void CommandLine::run()
   std::string command_str;
   while (m_app_running)
   {
+    detach_missing_files();
+
     const char *input = m_replxx->input(CLI_PROMPT);
     if (input == nullptr)
     {
@@ -499,35 +1456,254 @@ void CommandLine::run()
 
     m_replxx->history_add(command_str);
 
-    // Handle help specially
-    if (command_str == "help" || command_str == "h")
+    execute(command_str);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+
+  stop();
+}
+
+/** @brief Parses and executes a single command.
+ *  @param command_str The command line to execute.
+ *  @return True if the command succeeded, false on a parse error or command failure.
+ */
+bool CommandLine::execute(const std::string &command_str)
+{
+  // Handle help specially
+  if (command_str == "help" || command_str == "h")
+  {
+    show_help();
+    return true;
+  }
+
+  m_command_failed = false;
+
+  try
+  {
+    // Reset the app and the bound options for new parse
+    m_cli_app->clear();
+    reset_options();
+    
+    // Parse the command string
+    m_cli_app->parse(command_str);
+  }
+  catch (const ::CLI::ParseError &e)
+  {
+    // Handle parse errors gracefully
+    if (e.get_exit_code() == static_cast<int>(::CLI::ExitCodes::Success))
+    {
+      // This was --help or similar, already handled
+      return true;
+    }
+    std::cout << "Error: " << e.what() << "\n";
+    std::cout << "Type 'help' for available commands.\n";
+    return false;
+  }
+
+  return !m_command_failed;
+}
+
+/** @brief Reports the audio files that failed to resolve in the background and removes them
+ *  from their tracks. A missing file is never opened again, so the track would only play silence.
+ *  Called on the command thread, which owns the tracks' inputs.
+ */
+void CommandLine::detach_missing_files()
+{
+  std::vector<MissingFile> missing_files;
+  {
+    std::lock_guard<std::mutex> lock(m_missing_files_mutex);
+    missing_files.swap(m_missing_files);
+  }
+
+  for (const auto &missing : missing_files)
+  {
+    std::cout << "Warning: Audio file is missing or unreadable: " << missing.file->get_filepath().string() << "\n";
+
+    // Only if the track still plays this file; it may have been removed or given another input
+    auto track = missing.track.lock();
+    if (!track)
     {
-      show_help();
       continue;
     }
+    auto input = track->get_audio_input();
+    auto *wav_file = std::get_if<MinimalAudioEngine::WavFilePtr>(&input);
+    if (wav_file != nullptr && *wav_file == missing.file)
+    {
+      track->remove_audio_input();
+      std::cout << "Removed the audio file input from Track " << missing.track_id << "\n";
+    }
+  }
+}
+
+/** @brief Executes one line of a script or command list.
+ *  Blank lines and comments are skipped.
+ *  @param line The line to execute.
+ *  @return False if the command failed.
+ */
+bool CommandLine::execute_line(const std::string &line)
+{
+  auto begin = line.find_first_not_of(" \t\r");
+  if (begin == std::string::npos || line.compare(begin, std::char_traits<char>::length(CLI_SCRIPT_COMMENT), CLI_SCRIPT_COMMENT) == 0)
+  {
+    return true;
+  }
+
+  auto end = line.find_last_not_of(" \t\r");
+  std::string command_str = line.substr(begin, end - begin + 1);
+
+  LOG_INFO("CommandLine: Executing '", command_str, "'");
+  if (!execute(command_str))
+  {
+    LOG_ERROR("CommandLine: Command failed: ", command_str);
+    return false;
+  }
+  return true;
+}
 
-    try
+/** @brief Executes a list of commands without prompting.
+ *  @param commands The commands to execute, in order.
+ *  @param keep_going If true, continue after a failed command.
+ *  @return Success if every command succeeded.
+ */
+eExitCode CommandLine::run_commands(const std::vector<std::string> &commands, bool keep_going)
+{
+  eExitCode exit_code = eExitCode::Success;
+
+  for (const auto &command : commands)
+  {
+    if (!m_app_running)
     {
-      // Reset the app for new parse
-      m_cli_app->clear();
-      
-      // Parse the command string
-      m_cli_app->parse(command_str);
+      break;
     }
-    catch (const ::CLI::ParseError &e)
+
+    if (!execute_line(command))
     {
-      // Handle parse errors gracefully
-      if (e.get_exit_code() == static_cast<int>(::CLI::ExitCodes::Success))
+      exit_code = eExitCode::CommandFailed;
+      if (!keep_going)
       {
-        // This was --help or similar, already handled
-        continue;
+        break;
       }
-      std::cout << "Error: " << e.what() << "\n";
-      std::cout << "Type 'help' for available commands.\n";
     }
+  }
+
+  // quit is a normal end of script, but SIGINT is not
+  if (m_interrupted)
+  {
+    exit_code = eExitCode::Interrupted;
+  }
+
+  return exit_code;
+}
+
+/** @brief Starts serving the binary control protocol on a Unix domain socket.
+ *  The engine thread is started because it executes the control requests.
+ *  @param socket_path Filesystem path of the socket.
+ *  @return True if the server is listening.
+ */
+bool CommandLine::start_control_server(const std::string &socket_path)
+{
+  ensure_engine_running();
+
+  m_control_server = std::make_unique<MinimalAudioEngine::ControlServer>(m_engine, socket_path);
+  if (!m_control_server->start())
+  {
+    m_control_server.reset();
+    return false;
+  }
+
+  std::cout << "Control server listening on " << socket_path << "\n";
+  return true;
+}
 
+/** @brief Starts receiving OSC messages on a UDP port on the loopback interface.
+ *  @param port UDP port to bind.
+ *  @return True if the server is receiving.
+ */
+bool CommandLine::start_osc_server(uint16_t port)
+{
+  ensure_engine_running();
+
+  m_osc_server = std::make_unique<MinimalAudioEngine::OscServer>(m_engine, port);
+  if (!m_osc_server->start())
+  {
+    m_osc_server.reset();
+    return false;
+  }
+
+  std::cout << "OSC server listening on UDP port " << m_osc_server->get_port() << "\n";
+  return true;
+}
+
+/** @brief Blocks while the remote control servers handle clients, until SIGINT.
+ *  @return Success once the user stops the server, since SIGINT is how a server is stopped.
+ */
+eExitCode CommandLine::serve()
+{
+  if (!m_control_server && !m_osc_server)
+  {
+    LOG_ERROR("CommandLine: serve() requires a running control or OSC server.");
+    return eExitCode::CommandFailed;
+  }
+
+  while (m_app_running)
+  {
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
   }
 
-  stop();
+  return eExitCode::Success;
+}
+
+/** @brief Executes commands read line by line from a stream.
+ *  Each line runs as soon as it is read, so commands can be piped in as they are produced.
+ *  @param script The stream to read commands from.
+ *  @param keep_going If true, continue after a failed command.
+ *  @return Success if every command succeeded.
+ */
+eExitCode CommandLine::run_script(std::istream &script, bool keep_going)
+{
+  eExitCode exit_code = eExitCode::Success;
+
+  std::string line;
+  while (m_app_running && std::getline(script, line))
+  {
+    if (!execute_line(line))
+    {
+      exit_code = eExitCode::CommandFailed;
+      if (!keep_going)
+      {
+        break;
+      }
+    }
+  }
+
+  // quit is a normal end of script, but SIGINT is not
+  if (m_interrupted)
+  {
+    exit_code = eExitCode::Interrupted;
+  }
+
+  return exit_code;
+}
+
+/** @brief Executes commands from a script file.
+ *  @param script_path Path to the script, or "-" for standard input.
+ *  @param keep_going If true, continue after a failed command.
+ *  @return Success if every command succeeded.
+ */
+eExitCode CommandLine::run_script(const std::string &script_path, bool keep_going)
+{
+  if (script_path == "-")
+  {
+    return run_script(std::cin, keep_going);
+  }
+
+  std::ifstream script(script_path);
+  if (!script.is_open())
+  {
+    LOG_ERROR("CommandLine: Cannot open script file: ", script_path);
+    return eExitCode::ScriptNotFound;
+  }
+
+  return run_script(script, keep_going);
 }
\ No newline at end of file
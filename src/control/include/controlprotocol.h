@@ -0,0 +1,215 @@
+#ifndef __CONTROL_PROTOCOL_H__
+#define __CONTROL_PROTOCOL_H__
+
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace MinimalAudioEngine
+{
+
+/*
+ * Wire format
+ * -----------
+ * Every message is a frame: a little-endian u32 payload length followed by the payload.
+ * A payload starts with a u8 message type and a u32 request id, followed by a
+ * type-specific body. Strings are a u16 length followed by UTF-8 bytes.
+ *
+ * A Batch request body is a u16 count followed by that many complete frames. The server
+ * executes the batch in order on the engine thread and answers with one BatchResponse
+ * whose body has the same layout, holding one Response frame per request.
+ *
+ * Events are pushed to subscribed clients with request id 0.
+ */
+
+constexpr size_t CONTROL_FRAME_HEADER_SIZE = 4;
+constexpr uint32_t CONTROL_MAX_FRAME_SIZE = 1 << 20;
+constexpr uint16_t CONTROL_MAX_BATCH_REQUESTS = 1024;
+
+/** @enum eControlMessageType
+ *  @brief Control message types. Requests are below 0x80.
+ */
+enum class eControlMessageType : uint8_t
+{
+  // Requests
+  Ping = 0x01,
+  TrackAdd = 0x10,                  // -> u32 track_id
+  TrackRemove = 0x11,               // u32 track_id
+  TrackPlay = 0x12,                 // u32 track_id
+  TrackStop = 0x13,                 // u32 track_id
+  TrackSetAudioInputFile = 0x14,    // u32 track_id, string path
+  TrackSetAudioOutputDevice = 0x15, // u32 track_id, u32 device_id
+  TransportPlay = 0x20,
+  TransportStop = 0x21,
+  GetStatistics = 0x30,             // -> u32 tracks_playing, u64 frames_processed, u32 track_count, u8 engine_state
+  Subscribe = 0x40,                 // u32 event_mask
+  Unsubscribe = 0x41,               // u32 event_mask
+  Batch = 0x50,                     // u16 count, count request frames
+
+  // Server to client
+  Response = 0x80,                  // u8 status, string message, body
+  Event = 0x90,                     // u8 event, body
+  BatchResponse = 0xD0,             // u16 count, count response frames
+};
+
+/** @enum eControlStatus
+ *  @brief Result of a control request
+ */
+enum class eControlStatus : uint8_t
+{
+  Ok = 0,
+  Error = 1,
+  UnknownRequest = 2,
+  Malformed = 3,
+};
+
+/** @enum eControlEvent
+ *  @brief Events pushed to subscribed clients
+ */
+enum class eControlEvent : uint8_t
+{
+  PlaybackFinished = 1,
+  Meters = 2,                       // u32 channels, channels x f32 linear peak
+};
+
+constexpr uint32_t CONTROL_EVENT_MASK_PLAYBACK_FINISHED = 1u << 0;
+constexpr uint32_t CONTROL_EVENT_MASK_METERS = 1u << 1;
+
+/** @class ControlMessageWriter
+ *  @brief Appends one frame to a byte buffer. The length prefix is patched by finish(),
+ *  so frames can be nested by opening another writer on the same buffer.
+ */
+class ControlMessageWriter
+{
+public:
+  ControlMessageWriter(std::vector<uint8_t> &buffer, eControlMessageType type, uint32_t request_id);
+
+  void put_u8(uint8_t value);
+  void put_u16(uint16_t value);
+  void put_u32(uint32_t value);
+  void put_u64(uint64_t value);
+  void put_f32(float value);
+  void put_string(std::string_view value);
+  void put_bytes(std::span<const uint8_t> bytes);
+
+  size_t finish();
+
+private:
+  std::vector<uint8_t> &m_buffer;
+  size_t m_frame_start;
+};
+
+/** @class ControlMessageReader
+ *  @brief Reads fields from a payload in place. Strings and byte ranges are returned as
+ *  views into the payload, which must outlive them.
+ */
+class ControlMessageReader
+{
+public:
+  explicit ControlMessageReader(std::span<const uint8_t> payload) : m_payload(payload) {}
+
+  bool get_u8(uint8_t &value);
+  bool get_u16(uint16_t &value);
+  bool get_u32(uint32_t &value);
+  bool get_u64(uint64_t &value);
+  bool get_f32(float &value);
+  bool get_string(std::string_view &value);
+  bool get_bytes(size_t size, std::span<const uint8_t> &bytes);
+  bool get_frame(std::span<const uint8_t> &payload);
+
+  size_t remaining() const { return m_payload.size() - m_offset; }
+
+private:
+  std::span<const uint8_t> m_payload;
+  size_t m_offset = 0;
+};
+
+/** @class ControlFrameDecoder
+ *  @brief Splits a byte stream into frame payloads. A returned payload points into the
+ *  decoder's buffer and stays valid until the next call to feed().
+ */
+class ControlFrameDecoder
+{
+public:
+  void feed(std::span<const uint8_t> bytes);
+  std::optional<std::span<const uint8_t>> next_frame();
+
+  bool has_error() const { return m_error; }
+  size_t buffered() const { return m_buffer.size() - m_read_offset; }
+
+private:
+  std::vector<uint8_t> m_buffer;
+  size_t m_read_offset = 0;
+  bool m_error = false;
+};
+
+/** @struct ControlRequest
+ *  @brief A decoded request. Views point into the frame it was decoded from.
+ */
+struct ControlRequest
+{
+  eControlMessageType type = eControlMessageType::Ping;
+  uint32_t request_id = 0;
+  uint32_t track_id = 0;
+  uint32_t device_id = 0;
+  uint32_t event_mask = 0;
+  std::string_view path;
+  std::vector<std::span<const uint8_t>> batch;  // Nested request payloads
+};
+
+/** @struct ControlResponse
+ *  @brief A decoded response. Views point into the frame it was decoded from.
+ */
+struct ControlResponse
+{
+  uint32_t request_id = 0;
+  eControlStatus status = eControlStatus::Ok;
+  std::string_view message;
+  std::span<const uint8_t> body;
+};
+
+/** @struct ControlStatistics
+ *  @brief Body of a GetStatistics response
+ */
+struct ControlStatistics
+{
+  uint32_t tracks_playing = 0;
+  uint64_t total_frames_processed = 0;
+  uint32_t track_count = 0;
+  uint8_t engine_state = 0;
+};
+
+/** @struct ControlEvent
+ *  @brief A decoded event
+ */
+struct ControlEvent
+{
+  eControlEvent event = eControlEvent::PlaybackFinished;
+  std::vector<float> peaks;
+};
+
+bool is_control_request(eControlMessageType type);
+
+size_t encode_control_request(std::vector<uint8_t> &buffer, const ControlRequest &request);
+size_t encode_control_batch(std::vector<uint8_t> &buffer, uint32_t request_id, const std::vector<ControlRequest> &requests);
+size_t encode_control_response(std::vector<uint8_t> &buffer, uint32_t request_id, eControlStatus status,
+                               std::string_view message = {}, std::span<const uint8_t> body = {});
+size_t encode_control_statistics(std::vector<uint8_t> &buffer, uint32_t request_id, const ControlStatistics &statistics);
+size_t encode_control_event(std::vector<uint8_t> &buffer, eControlEvent event, std::span<const float> peaks = {});
+
+eControlStatus decode_control_request(std::span<const uint8_t> payload, ControlRequest &request);
+bool decode_control_response(std::span<const uint8_t> payload, ControlResponse &response);
+bool decode_control_batch_response(std::span<const uint8_t> payload, uint32_t &request_id,
+                                   std::vector<std::span<const uint8_t>> &responses);
+bool decode_control_statistics(std::span<const uint8_t> body, ControlStatistics &statistics);
+bool decode_control_event(std::span<const uint8_t> payload, ControlEvent &event);
+
+std::optional<eControlMessageType> peek_control_message_type(std::span<const uint8_t> payload);
+
+}  // namespace MinimalAudioEngine
+
+#endif  // __CONTROL_PROTOCOL_H__
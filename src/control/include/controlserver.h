@@ -0,0 +1,86 @@
+#ifndef __CONTROL_SERVER_H__
+#define __CONTROL_SERVER_H__
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "coreengine.h"
+#include "controlprotocol.h"
+
+namespace MinimalAudioEngine
+{
+
+constexpr const char *CONTROL_SERVER_THREAD_NAME = "ControlServerThread";
+constexpr std::chrono::milliseconds CONTROL_METER_INTERVAL{33};
+constexpr size_t CONTROL_MAX_PENDING_OUTPUT = 4 * 1024 * 1024;  // Meter events are dropped above this
+constexpr size_t CONTROL_MAX_CLIENTS = 64;
+
+/** @class ControlServer
+ *  @brief Serves the binary control protocol (see controlprotocol.h) on a Unix domain socket.
+ *
+ *  A single thread multiplexes all clients with poll(). Requests that touch tracks or the
+ *  transport are posted to the CoreEngine queue and answered from the engine thread;
+ *  pings, statistics and subscriptions are answered directly. Responses and events are
+ *  written back by the server thread, so a slow client never blocks the engine.
+ */
+class ControlServer
+{
+public:
+  ControlServer(CoreEngine &engine, std::filesystem::path socket_path);
+  ~ControlServer();
+
+  bool start();
+  void stop();
+
+  bool is_running() const noexcept { return m_running.load(std::memory_order_acquire); }
+  const std::filesystem::path &get_socket_path() const noexcept { return m_socket_path; }
+  size_t get_client_count() const noexcept { return m_client_count.load(std::memory_order_relaxed); }
+
+  // Disable copy constructor and assignment operator
+  ControlServer(const ControlServer &) = delete;
+  ControlServer &operator=(const ControlServer &) = delete;
+
+private:
+  struct Waker;
+  struct Session;
+  class PlaybackObserver;
+  typedef std::shared_ptr<Session> SessionPtr;
+
+  void run(std::stop_token stop_token);
+
+  void accept_clients();
+  bool read_client(const SessionPtr &session);
+  bool write_client(const SessionPtr &session);
+  void handle_frame(const SessionPtr &session, std::span<const uint8_t> payload);
+  void post_to_engine(const SessionPtr &session, std::span<const uint8_t> payload);
+  void broadcast_event(uint32_t event_mask, std::span<const uint8_t> frame, bool lossy);
+  void publish_meters();
+  void close_sockets();
+
+  static void execute_payload(Session &session, std::span<const uint8_t> payload, std::vector<uint8_t> &output);
+  static void execute_request(Session &session, const ControlRequest &request, std::vector<uint8_t> &output);
+
+  CoreEngine &m_engine;
+  std::filesystem::path m_socket_path;
+
+  int m_listen_fd = -1;
+  std::shared_ptr<Waker> m_waker;
+
+  std::jthread m_thread;
+  std::atomic<bool> m_running{false};
+  std::atomic<size_t> m_client_count{0};
+
+  std::vector<SessionPtr> m_sessions;  // Owned by the server thread
+  std::shared_ptr<PlaybackObserver> m_playback_observer;
+  std::chrono::steady_clock::time_point m_next_meter_time;
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // __CONTROL_SERVER_H__
@@ -0,0 +1,470 @@
+#include "controlprotocol.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+using namespace MinimalAudioEngine;
+
+/** @brief Begin a frame in the buffer with a placeholder length and the common header.
+ *  @param buffer Buffer to append to.
+ *  @param type Message type.
+ *  @param request_id Request id echoed in responses, 0 for events.
+ */
+ControlMessageWriter::ControlMessageWriter(std::vector<uint8_t> &buffer, eControlMessageType type, uint32_t request_id)
+  : m_buffer(buffer),
+    m_frame_start(buffer.size())
+{
+  put_u32(0);
+  put_u8(static_cast<uint8_t>(type));
+  put_u32(request_id);
+}
+
+void ControlMessageWriter::put_u8(uint8_t value)
+{
+  m_buffer.push_back(value);
+}
+
+void ControlMessageWriter::put_u16(uint16_t value)
+{
+  m_buffer.push_back(static_cast<uint8_t>(value));
+  m_buffer.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void ControlMessageWriter::put_u32(uint32_t value)
+{
+  for (int shift = 0; shift < 32; shift += 8)
+  {
+    m_buffer.push_back(static_cast<uint8_t>(value >> shift));
+  }
+}
+
+void ControlMessageWriter::put_u64(uint64_t value)
+{
+  for (int shift = 0; shift < 64; shift += 8)
+  {
+    m_buffer.push_back(static_cast<uint8_t>(value >> shift));
+  }
+}
+
+void ControlMessageWriter::put_f32(float value)
+{
+  put_u32(std::bit_cast<uint32_t>(value));
+}
+
+/** @brief Append a u16 length-prefixed string. Strings longer than 65535 bytes are truncated.
+ */
+void ControlMessageWriter::put_string(std::string_view value)
+{
+  uint16_t size = static_cast<uint16_t>(std::min<size_t>(value.size(), UINT16_MAX));
+  put_u16(size);
+  m_buffer.insert(m_buffer.end(), value.begin(), value.begin() + size);
+}
+
+void ControlMessageWriter::put_bytes(std::span<const uint8_t> bytes)
+{
+  m_buffer.insert(m_buffer.end(), bytes.begin(), bytes.end());
+}
+
+/** @brief Patch the frame's length prefix.
+ *  @return Total size of the frame including the length prefix.
+ */
+size_t ControlMessageWriter::finish()
+{
+  size_t frame_size = m_buffer.size() - m_frame_start;
+  uint32_t payload_size = static_cast<uint32_t>(frame_size - CONTROL_FRAME_HEADER_SIZE);
+  for (size_t i = 0; i < CONTROL_FRAME_HEADER_SIZE; ++i)
+  {
+    m_buffer[m_frame_start + i] = static_cast<uint8_t>(payload_size >> (8 * i));
+  }
+  return frame_size;
+}
+
+bool ControlMessageReader::get_u8(uint8_t &value)
+{
+  if (remaining() < 1)
+    return false;
+
+  value = m_payload[m_offset++];
+  return true;
+}
+
+bool ControlMessageReader::get_u16(uint16_t &value)
+{
+  if (remaining() < 2)
+    return false;
+
+  value = static_cast<uint16_t>(m_payload[m_offset] | (m_payload[m_offset + 1] << 8));
+  m_offset += 2;
+  return true;
+}
+
+bool ControlMessageReader::get_u32(uint32_t &value)
+{
+  if (remaining() < 4)
+    return false;
+
+  value = 0;
+  for (int i = 0; i < 4; ++i)
+  {
+    value |= static_cast<uint32_t>(m_payload[m_offset + i]) << (8 * i);
+  }
+  m_offset += 4;
+  return true;
+}
+
+bool ControlMessageReader::get_u64(uint64_t &value)
+{
+  if (remaining() < 8)
+    return false;
+
+  value = 0;
+  for (int i = 0; i < 8; ++i)
+  {
+    value |= static_cast<uint64_t>(m_payload[m_offset + i]) << (8 * i);
+  }
+  m_offset += 8;
+  return true;
+}
+
+bool ControlMessageReader::get_f32(float &value)
+{
+  uint32_t bits;
+  if (!get_u32(bits))
+    return false;
+
+  value = std::bit_cast<float>(bits);
+  return true;
+}
+
+bool ControlMessageReader::get_string(std::string_view &value)
+{
+  uint16_t size;
+  std::span<const uint8_t> bytes;
+  if (!get_u16(size) || !get_bytes(size, bytes))
+    return false;
+
+  value = std::string_view(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+  return true;
+}
+
+bool ControlMessageReader::get_bytes(size_t size, std::span<const uint8_t> &bytes)
+{
+  if (remaining() < size)
+    return false;
+
+  bytes = m_payload.subspan(m_offset, size);
+  m_offset += size;
+  return true;
+}
+
+/** @brief Read a nested length-prefixed frame.
+ *  @param payload Receives the nested frame's payload.
+ */
+bool ControlMessageReader::get_frame(std::span<const uint8_t> &payload)
+{
+  uint32_t size;
+  return get_u32(size) && size <= CONTROL_MAX_FRAME_SIZE && get_bytes(size, payload);
+}
+
+/** @brief Append bytes received from the stream.
+ *  Consumed bytes are compacted away first, which invalidates previously returned frames.
+ */
+void ControlFrameDecoder::feed(std::span<const uint8_t> bytes)
+{
+  if (m_read_offset > 0)
+  {
+    m_buffer.erase(m_buffer.begin(), m_buffer.begin() + m_read_offset);
+    m_read_offset = 0;
+  }
+
+  m_buffer.insert(m_buffer.end(), bytes.begin(), bytes.end());
+}
+
+/** @brief Get the next complete frame payload, if one has been received.
+ *  A frame larger than CONTROL_MAX_FRAME_SIZE puts the decoder into an error state.
+ */
+std::optional<std::span<const uint8_t>> ControlFrameDecoder::next_frame()
+{
+  if (m_error || buffered() < CONTROL_FRAME_HEADER_SIZE)
+    return std::nullopt;
+
+  ControlMessageReader reader(std::span<const uint8_t>(m_buffer).subspan(m_read_offset));
+  uint32_t payload_size = 0;
+  reader.get_u32(payload_size);
+
+  if (payload_size > CONTROL_MAX_FRAME_SIZE)
+  {
+    m_error = true;
+    return std::nullopt;
+  }
+
+  if (buffered() < CONTROL_FRAME_HEADER_SIZE + payload_size)
+    return std::nullopt;
+
+  auto payload = std::span<const uint8_t>(m_buffer).subspan(m_read_offset + CONTROL_FRAME_HEADER_SIZE, payload_size);
+  m_read_offset += CONTROL_FRAME_HEADER_SIZE + payload_size;
+  return payload;
+}
+
+/** @brief Check if a message type is a request a client may send
+ */
+bool MinimalAudioEngine::is_control_request(eControlMessageType type)
+{
+  switch (type)
+  {
+    case eControlMessageType::Ping:
+    case eControlMessageType::TrackAdd:
+    case eControlMessageType::TrackRemove:
+    case eControlMessageType::TrackPlay:
+    case eControlMessageType::TrackStop:
+    case eControlMessageType::TrackSetAudioInputFile:
+    case eControlMessageType::TrackSetAudioOutputDevice:
+    case eControlMessageType::TransportPlay:
+    case eControlMessageType::TransportStop:
+    case eControlMessageType::GetStatistics:
+    case eControlMessageType::Subscribe:
+    case eControlMessageType::Unsubscribe:
+    case eControlMessageType::Batch:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/** @brief Encode a single request. Batch requests use encode_control_batch().
+ *  @return Size of the encoded frame.
+ */
+size_t MinimalAudioEngine::encode_control_request(std::vector<uint8_t> &buffer, const ControlRequest &request)
+{
+  ControlMessageWriter writer(buffer, request.type, request.request_id);
+
+  switch (request.type)
+  {
+    case eControlMessageType::TrackRemove:
+    case eControlMessageType::TrackPlay:
+    case eControlMessageType::TrackStop:
+      writer.put_u32(request.track_id);
+      break;
+    case eControlMessageType::TrackSetAudioInputFile:
+      writer.put_u32(request.track_id);
+      writer.put_string(request.path);
+      break;
+    case eControlMessageType::TrackSetAudioOutputDevice:
+      writer.put_u32(request.track_id);
+      writer.put_u32(request.device_id);
+      break;
+    case eControlMessageType::Subscribe:
+    case eControlMessageType::Unsubscribe:
+      writer.put_u32(request.event_mask);
+      break;
+    default:
+      break;
+  }
+
+  return writer.finish();
+}
+
+/** @brief Encode several requests as one batch
+ *  @return Size of the encoded frame.
+ */
+size_t MinimalAudioEngine::encode_control_batch(std::vector<uint8_t> &buffer, uint32_t request_id, const std::vector<ControlRequest> &requests)
+{
+  ControlMessageWriter writer(buffer, eControlMessageType::Batch, request_id);
+  writer.put_u16(static_cast<uint16_t>(requests.size()));
+  for (const auto &request : requests)
+  {
+    encode_control_request(buffer, request);
+  }
+  return writer.finish();
+}
+
+/** @brief Encode a response frame
+ *  @return Size of the encoded frame.
+ */
+size_t MinimalAudioEngine::encode_control_response(std::vector<uint8_t> &buffer, uint32_t request_id, eControlStatus status,
+                                                   std::string_view message, std::span<const uint8_t> body)
+{
+  ControlMessageWriter writer(buffer, eControlMessageType::Response, request_id);
+  writer.put_u8(static_cast<uint8_t>(status));
+  writer.put_string(message);
+  writer.put_bytes(body);
+  return writer.finish();
+}
+
+/** @brief Encode a successful GetStatistics response
+ *  @return Size of the encoded frame.
+ */
+size_t MinimalAudioEngine::encode_control_statistics(std::vector<uint8_t> &buffer, uint32_t request_id, const ControlStatistics &statistics)
+{
+  ControlMessageWriter writer(buffer, eControlMessageType::Response, request_id);
+  writer.put_u8(static_cast<uint8_t>(eControlStatus::Ok));
+  writer.put_string({});
+  writer.put_u32(statistics.tracks_playing);
+  writer.put_u64(statistics.total_frames_processed);
+  writer.put_u32(statistics.track_count);
+  writer.put_u8(statistics.engine_state);
+  return writer.finish();
+}
+
+/** @brief Encode an event frame
+ *  @param peaks Per-channel peaks, only used by Meters events.
+ *  @return Size of the encoded frame.
+ */
+size_t MinimalAudioEngine::encode_control_event(std::vector<uint8_t> &buffer, eControlEvent event, std::span<const float> peaks)
+{
+  ControlMessageWriter writer(buffer, eControlMessageType::Event, 0);
+  writer.put_u8(static_cast<uint8_t>(event));
+  if (event == eControlEvent::Meters)
+  {
+    writer.put_u32(static_cast<uint32_t>(peaks.size()));
+    for (float peak : peaks)
+    {
+      writer.put_f32(peak);
+    }
+  }
+  return writer.finish();
+}
+
+/** @brief Decode a request payload.
+ *  @param payload Frame payload, without the length prefix.
+ *  @param request Receives the request. Its request_id is filled in whenever the header is readable.
+ *  @return Ok, Malformed for truncated or invalid bodies, or UnknownRequest.
+ */
+eControlStatus MinimalAudioEngine::decode_control_request(std::span<const uint8_t> payload, ControlRequest &request)
+{
+  ControlMessageReader reader(payload);
+  uint8_t type;
+  if (!reader.get_u8(type) || !reader.get_u32(request.request_id))
+    return eControlStatus::Malformed;
+
+  request.type = static_cast<eControlMessageType>(type);
+  if (!is_control_request(request.type))
+    return eControlStatus::UnknownRequest;
+
+  bool ok = true;
+  switch (request.type)
+  {
+    case eControlMessageType::TrackRemove:
+    case eControlMessageType::TrackPlay:
+    case eControlMessageType::TrackStop:
+      ok = reader.get_u32(request.track_id);
+      break;
+    case eControlMessageType::TrackSetAudioInputFile:
+      ok = reader.get_u32(request.track_id) && reader.get_string(request.path);
+      break;
+    case eControlMessageType::TrackSetAudioOutputDevice:
+      ok = reader.get_u32(request.track_id) && reader.get_u32(request.device_id);
+      break;
+    case eControlMessageType::Subscribe:
+    case eControlMessageType::Unsubscribe:
+      ok = reader.get_u32(request.event_mask);
+      break;
+    case eControlMessageType::Batch:
+    {
+      uint16_t count;
+      ok = reader.get_u16(count) && count <= CONTROL_MAX_BATCH_REQUESTS;
+      request.batch.clear();
+      request.batch.reserve(ok ? count : 0);
+      for (uint16_t i = 0; ok && i < count; ++i)
+      {
+        std::span<const uint8_t> nested;
+        ok = reader.get_frame(nested);
+        request.batch.push_back(nested);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+
+  return ok && reader.remaining() == 0 ? eControlStatus::Ok : eControlStatus::Malformed;
+}
+
+/** @brief Decode a response payload
+ */
+bool MinimalAudioEngine::decode_control_response(std::span<const uint8_t> payload, ControlResponse &response)
+{
+  ControlMessageReader reader(payload);
+  uint8_t type;
+  uint8_t status;
+  if (!reader.get_u8(type) || type != static_cast<uint8_t>(eControlMessageType::Response) ||
+      !reader.get_u32(response.request_id) || !reader.get_u8(status) || !reader.get_string(response.message))
+    return false;
+
+  response.status = static_cast<eControlStatus>(status);
+  return reader.get_bytes(reader.remaining(), response.body);
+}
+
+/** @brief Decode a batch response into its nested response payloads
+ */
+bool MinimalAudioEngine::decode_control_batch_response(std::span<const uint8_t> payload, uint32_t &request_id,
+                                                       std::vector<std::span<const uint8_t>> &responses)
+{
+  ControlMessageReader reader(payload);
+  uint8_t type;
+  uint16_t count;
+  if (!reader.get_u8(type) || type != static_cast<uint8_t>(eControlMessageType::BatchResponse) ||
+      !reader.get_u32(request_id) || !reader.get_u16(count))
+    return false;
+
+  responses.clear();
+  for (uint16_t i = 0; i < count; ++i)
+  {
+    std::span<const uint8_t> nested;
+    if (!reader.get_frame(nested))
+      return false;
+    responses.push_back(nested);
+  }
+  return reader.remaining() == 0;
+}
+
+/** @brief Decode the body of a GetStatistics response
+ */
+bool MinimalAudioEngine::decode_control_statistics(std::span<const uint8_t> body, ControlStatistics &statistics)
+{
+  ControlMessageReader reader(body);
+  return reader.get_u32(statistics.tracks_playing) &&
+         reader.get_u64(statistics.total_frames_processed) &&
+         reader.get_u32(statistics.track_count) &&
+         reader.get_u8(statistics.engine_state);
+}
+
+/** @brief Decode an event payload
+ */
+bool MinimalAudioEngine::decode_control_event(std::span<const uint8_t> payload, ControlEvent &event)
+{
+  ControlMessageReader reader(payload);
+  uint8_t type;
+  uint32_t request_id;
+  uint8_t event_type;
+  if (!reader.get_u8(type) || type != static_cast<uint8_t>(eControlMessageType::Event) ||
+      !reader.get_u32(request_id) || !reader.get_u8(event_type))
+    return false;
+
+  event.event = static_cast<eControlEvent>(event_type);
+  event.peaks.clear();
+  if (event.event == eControlEvent::Meters)
+  {
+    uint32_t channels;
+    if (!reader.get_u32(channels) || reader.remaining() != channels * sizeof(float))
+      return false;
+
+    event.peaks.resize(channels);
+    for (auto &peak : event.peaks)
+    {
+      reader.get_f32(peak);
+    }
+  }
+  return true;
+}
+
+/** @brief Read the message type of a payload without decoding it
+ */
+std::optional<eControlMessageType> MinimalAudioEngine::peek_control_message_type(std::span<const uint8_t> payload)
+{
+  if (payload.empty())
+    return std::nullopt;
+
+  return static_cast<eControlMessageType>(payload[0]);
+}
@@ -0,0 +1,686 @@
+#include "controlserver.h"
+
+#include "audioengine.h"
+#include "trackmanager.h"
+#include "devicemanager.h"
+#include "filemanager.h"
+#include "wavfile.h"
+#include "observer.h"
+#include "logger.h"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace MinimalAudioEngine;
+
+/** @struct ControlServer::Waker
+ *  @brief Self-pipe used to wake the server thread from other threads.
+ *  Shared with engine tasks so a task that outlives the server does nothing.
+ */
+struct ControlServer::Waker
+{
+  std::mutex mutex;
+  int read_fd = -1;
+  int write_fd = -1;
+
+  void wake();
+  void drain();
+  void close();
+};
+
+/** @struct ControlServer::Session
+ *  @brief State of one connected client
+ */
+struct ControlServer::Session
+{
+  int fd = -1;
+  std::shared_ptr<Waker> waker;
+
+  // Server thread only
+  ControlFrameDecoder decoder;
+  std::vector<uint8_t> output;
+  size_t output_offset = 0;
+
+  // Filled by engine tasks, moved to output by the server thread
+  std::mutex outbox_mutex;
+  std::vector<uint8_t> outbox;
+
+  std::atomic<uint32_t> event_mask{0};
+  std::atomic<uint32_t> pending_tasks{0};
+
+  size_t pending_output() const { return output.size() - output_offset; }
+};
+
+/** @class ControlServer::PlaybackObserver
+ *  @brief Flags the end of playback reported by the AudioEngine
+ */
+class ControlServer::PlaybackObserver : public Observer<AudioMessage>
+{
+public:
+  explicit PlaybackObserver(std::shared_ptr<Waker> waker) : m_waker(std::move(waker)) {}
+
+  void update(const AudioMessage &message) override
+  {
+    if (message.command == eAudioEngineCommand::StoppedPlayback)
+    {
+      m_finished.store(true, std::memory_order_release);
+      m_waker->wake();
+    }
+  }
+
+  bool consume() { return m_finished.exchange(false, std::memory_order_acq_rel); }
+
+private:
+  std::shared_ptr<Waker> m_waker;
+  std::atomic<bool> m_finished{false};
+};
+
+/** @brief ControlServer constructor
+ *  @param engine CoreEngine whose thread executes track and transport requests.
+ *  @param socket_path Filesystem path of the Unix domain socket.
+ */
+ControlServer::ControlServer(CoreEngine &engine, std::filesystem::path socket_path)
+  : m_engine(engine),
+    m_socket_path(std::move(socket_path))
+{
+}
+
+/** @brief ControlServer destructor. Stops the server if it is running.
+ */
+ControlServer::~ControlServer()
+{
+  stop();
+}
+
+/** @brief Execute a request payload and append the response to the output buffer.
+ *  Runs on the server thread for client-local requests, otherwise on the engine thread.
+ */
+void ControlServer::execute_payload(Session &session, std::span<const uint8_t> payload, std::vector<uint8_t> &output)
+{
+  ControlRequest request;
+  eControlStatus status = decode_control_request(payload, request);
+  if (status != eControlStatus::Ok)
+  {
+    encode_control_response(output, request.request_id, status,
+                            status == eControlStatus::Malformed ? "Malformed request" : "Unknown request");
+    return;
+  }
+
+  if (request.type != eControlMessageType::Batch)
+  {
+    execute_request(session, request, output);
+    return;
+  }
+
+  // The whole batch runs in one engine task, so no other command interleaves with it
+  ControlMessageWriter writer(output, eControlMessageType::BatchResponse, request.request_id);
+  writer.put_u16(static_cast<uint16_t>(request.batch.size()));
+  for (auto nested : request.batch)
+  {
+    ControlRequest nested_request;
+    eControlStatus nested_status = decode_control_request(nested, nested_request);
+    if (nested_status == eControlStatus::Ok && nested_request.type == eControlMessageType::Batch)
+    {
+      encode_control_response(output, nested_request.request_id, eControlStatus::Malformed, "Nested batches are not supported");
+    }
+    else if (nested_status != eControlStatus::Ok)
+    {
+      encode_control_response(output, nested_request.request_id, nested_status,
+                              nested_status == eControlStatus::Malformed ? "Malformed request" : "Unknown request");
+    }
+    else
+    {
+      execute_request(session, nested_request, output);
+    }
+  }
+  writer.finish();
+}
+
+/** @brief Execute a single decoded request and append its response.
+ */
+void ControlServer::execute_request(Session &session, const ControlRequest &request, std::vector<uint8_t> &output)
+{
+  try
+  {
+    switch (request.type)
+    {
+      case eControlMessageType::Ping:
+        break;
+      case eControlMessageType::TrackAdd:
+      {
+        size_t track_id = TrackManager::instance().add_track();
+        ControlMessageWriter writer(output, eControlMessageType::Response, request.request_id);
+        writer.put_u8(static_cast<uint8_t>(eControlStatus::Ok));
+        writer.put_string({});
+        writer.put_u32(static_cast<uint32_t>(track_id));
+        writer.finish();
+        return;
+      }
+      case eControlMessageType::TrackRemove:
+        TrackManager::instance().remove_track(request.track_id);
+        break;
+      case eControlMessageType::TrackPlay:
+        TrackManager::instance().get_track(request.track_id)->play();
+        break;
+      case eControlMessageType::TrackStop:
+        TrackManager::instance().get_track(request.track_id)->stop();
+        break;
+      case eControlMessageType::TrackSetAudioInputFile:
+      {
+        auto track = TrackManager::instance().get_track(request.track_id);
+        auto wav_file = FileManager::instance().read_wav_file_deferred(std::filesystem::path(request.path));
+        if (!wav_file->prefetch())
+        {
+          encode_control_response(output, request.request_id, eControlStatus::Error, "Audio file is missing or unreadable");
+          return;
+        }
+        track->add_audio_file_input(wav_file);
+        break;
+      }
+      case eControlMessageType::TrackSetAudioOutputDevice:
+      {
+        auto track = TrackManager::instance().get_track(request.track_id);
+        track->add_audio_device_output(DeviceManager::instance().get_audio_device(request.device_id));
+        break;
+      }
+      case eControlMessageType::TransportPlay:
+        AudioEngine::instance().play();
+        break;
+      case eControlMessageType::TransportStop:
+        AudioEngine::instance().stop();
+        break;
+      case eControlMessageType::GetStatistics:
+      {
+        auto &audio_engine = AudioEngine::instance();
+        auto engine_statistics = audio_engine.get_statistics();
+
+        ControlStatistics statistics;
+        statistics.tracks_playing = engine_statistics.tracks_playing;
+        statistics.total_frames_processed = engine_statistics.total_frames_processed;
+        statistics.track_count = static_cast<uint32_t>(TrackManager::instance().get_track_count());
+        statistics.engine_state = static_cast<uint8_t>(audio_engine.get_state());
+        encode_control_statistics(output, request.request_id, statistics);
+        return;
+      }
+      case eControlMessageType::Subscribe:
+        session.event_mask.fetch_or(request.event_mask, std::memory_order_relaxed);
+        break;
+      case eControlMessageType::Unsubscribe:
+        session.event_mask.fetch_and(~request.event_mask, std::memory_order_relaxed);
+        break;
+      default:
+        encode_control_response(output, request.request_id, eControlStatus::UnknownRequest, "Unknown request");
+        return;
+    }
+
+    encode_control_response(output, request.request_id, eControlStatus::Ok);
+  }
+  catch (const std::exception &e)
+  {
+    encode_control_response(output, request.request_id, eControlStatus::Error, e.what());
+  }
+}
+
+#ifndef _WIN32
+
+void ControlServer::Waker::wake()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (write_fd >= 0)
+  {
+    uint8_t byte = 1;
+    // A full pipe already guarantees a wakeup
+    [[maybe_unused]] ssize_t written = ::write(write_fd, &byte, 1);
+  }
+}
+
+void ControlServer::Waker::drain()
+{
+  uint8_t bytes[64];
+  while (::read(read_fd, bytes, sizeof(bytes)) > 0)
+  {
+  }
+}
+
+void ControlServer::Waker::close()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (read_fd >= 0)
+    ::close(read_fd);
+  if (write_fd >= 0)
+    ::close(write_fd);
+  read_fd = -1;
+  write_fd = -1;
+}
+
+namespace
+{
+
+bool set_non_blocking(int fd)
+{
+  int flags = fcntl(fd, F_GETFL, 0);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0 && fcntl(fd, F_SETFD, FD_CLOEXEC) == 0;
+}
+
+}  // namespace
+
+/** @brief Bind the socket and start the server thread.
+ *  A stale socket file left by a previous run is replaced.
+ *  @return True if the server is listening.
+ */
+bool ControlServer::start()
+{
+  if (is_running())
+    return true;
+
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  std::string path = m_socket_path.string();
+  if (path.empty() || path.size() >= sizeof(address.sun_path))
+  {
+    LOG_ERROR("ControlServer: Invalid socket path: ", path);
+    return false;
+  }
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+  std::error_code ec;
+  if (std::filesystem::exists(std::filesystem::symlink_status(m_socket_path, ec)))
+  {
+    if (!std::filesystem::is_socket(std::filesystem::symlink_status(m_socket_path, ec)))
+    {
+      LOG_ERROR("ControlServer: Refusing to replace non-socket file: ", path);
+      return false;
+    }
+    std::filesystem::remove(m_socket_path, ec);
+  }
+
+  m_waker = std::make_shared<Waker>();
+  int pipe_fds[2];
+  if (::pipe(pipe_fds) != 0 || !set_non_blocking(pipe_fds[0]) || !set_non_blocking(pipe_fds[1]))
+  {
+    LOG_ERROR("ControlServer: Failed to create wake pipe: ", std::strerror(errno));
+    return false;
+  }
+  m_waker->read_fd = pipe_fds[0];
+  m_waker->write_fd = pipe_fds[1];
+
+  m_listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (m_listen_fd < 0 || !set_non_blocking(m_listen_fd) ||
+      ::bind(m_listen_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+      ::listen(m_listen_fd, SOMAXCONN) != 0)
+  {
+    LOG_ERROR("ControlServer: Failed to listen on ", path, ": ", std::strerror(errno));
+    close_sockets();
+    return false;
+  }
+
+  m_playback_observer = std::make_shared<PlaybackObserver>(m_waker);
+  AudioEngine::instance().attach(m_playback_observer);
+
+  m_next_meter_time = std::chrono::steady_clock::now();
+  m_running.store(true, std::memory_order_release);
+  m_thread = std::jthread([this](std::stop_token stop_token) { run(stop_token); });
+
+  LOG_INFO("ControlServer: Listening on ", path);
+  return true;
+}
+
+/** @brief Stop the server thread, disconnect all clients and remove the socket file.
+ */
+void ControlServer::stop()
+{
+  if (!is_running())
+    return;
+
+  m_thread.request_stop();
+  m_waker->wake();
+  if (m_thread.joinable())
+  {
+    m_thread.join();
+  }
+
+  AudioEngine::instance().detach(m_playback_observer);
+  m_playback_observer.reset();
+
+  close_sockets();
+  m_running.store(false, std::memory_order_release);
+
+  LOG_INFO("ControlServer: Stopped");
+}
+
+/** @brief Close the listening socket, all client sockets and the wake pipe.
+ */
+void ControlServer::close_sockets()
+{
+  for (auto &session : m_sessions)
+  {
+    ::close(session->fd);
+  }
+  m_sessions.clear();
+  m_client_count.store(0, std::memory_order_relaxed);
+
+  if (m_listen_fd >= 0)
+  {
+    ::close(m_listen_fd);
+    m_listen_fd = -1;
+
+    std::error_code ec;
+    std::filesystem::remove(m_socket_path, ec);
+  }
+
+  if (m_waker)
+  {
+    m_waker->close();
+  }
+}
+
+/** @brief Server thread main loop
+ */
+void ControlServer::run(std::stop_token stop_token)
+{
+  std::vector<pollfd> poll_fds;
+
+  while (!stop_token.stop_requested())
+  {
+    bool meters_wanted = false;
+
+    poll_fds.clear();
+    poll_fds.push_back({m_waker->read_fd, POLLIN, 0});
+    poll_fds.push_back({m_listen_fd, POLLIN, 0});
+    for (auto &session : m_sessions)
+    {
+      short events = 0;
+      // Stop reading from a client that does not read its responses
+      if (session->pending_output() < CONTROL_MAX_PENDING_OUTPUT)
+        events |= POLLIN;
+      if (session->pending_output() > 0)
+        events |= POLLOUT;
+      poll_fds.push_back({session->fd, events, 0});
+
+      meters_wanted |= (session->event_mask.load(std::memory_order_relaxed) & CONTROL_EVENT_MASK_METERS) != 0;
+    }
+
+    int timeout_ms = -1;
+    if (meters_wanted)
+    {
+      auto until_meters = std::chrono::duration_cast<std::chrono::milliseconds>(m_next_meter_time - std::chrono::steady_clock::now());
+      timeout_ms = static_cast<int>(std::max<int64_t>(0, until_meters.count()));
+    }
+
+    if (::poll(poll_fds.data(), poll_fds.size(), timeout_ms) < 0 && errno != EINTR)
+    {
+      LOG_ERROR("ControlServer: poll failed: ", std::strerror(errno));
+      break;
+    }
+
+    if (poll_fds[0].revents & POLLIN)
+    {
+      m_waker->drain();
+    }
+
+    // Sessions accepted below are not in poll_fds yet
+    size_t polled_sessions = m_sessions.size();
+
+    if (poll_fds[1].revents & POLLIN)
+    {
+      accept_clients();
+    }
+
+    for (size_t i = 0; i < polled_sessions; ++i)
+    {
+      auto &session = m_sessions[i];
+      short revents = poll_fds[i + 2].revents;
+
+      bool open = true;
+      if (revents & POLLIN)
+      {
+        open = read_client(session);
+      }
+      else if (revents & (POLLERR | POLLHUP | POLLNVAL))
+      {
+        open = false;
+      }
+
+      if (!open)
+      {
+        ::close(session->fd);
+        session->fd = -1;
+      }
+    }
+
+    if (m_playback_observer->consume())
+    {
+      std::vector<uint8_t> frame;
+      encode_control_event(frame, eControlEvent::PlaybackFinished);
+      broadcast_event(CONTROL_EVENT_MASK_PLAYBACK_FINISHED, frame, false);
+    }
+
+    if (meters_wanted && std::chrono::steady_clock::now() >= m_next_meter_time)
+    {
+      publish_meters();
+      m_next_meter_time = std::chrono::steady_clock::now() + CONTROL_METER_INTERVAL;
+    }
+
+    for (auto &session : m_sessions)
+    {
+      if (session->fd < 0)
+        continue;
+
+      {
+        std::lock_guard<std::mutex> lock(session->outbox_mutex);
+        session->output.insert(session->output.end(), session->outbox.begin(), session->outbox.end());
+        session->outbox.clear();
+      }
+
+      if (session->pending_output() > 0 && !write_client(session))
+      {
+        ::close(session->fd);
+        session->fd = -1;
+      }
+    }
+
+    size_t before = m_sessions.size();
+    std::erase_if(m_sessions, [](const SessionPtr &session) { return session->fd < 0; });
+    if (m_sessions.size() != before)
+    {
+      LOG_INFO("ControlServer: ", before - m_sessions.size(), " client(s) disconnected");
+    }
+    m_client_count.store(m_sessions.size(), std::memory_order_relaxed);
+  }
+}
+
+/** @brief Accept all pending connections on the listening socket
+ */
+void ControlServer::accept_clients()
+{
+  while (true)
+  {
+    int fd = ::accept(m_listen_fd, nullptr, nullptr);
+    if (fd < 0)
+    {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+      {
+        LOG_ERROR("ControlServer: accept failed: ", std::strerror(errno));
+      }
+      return;
+    }
+
+    if (m_sessions.size() >= CONTROL_MAX_CLIENTS || !set_non_blocking(fd))
+    {
+      LOG_WARNING("ControlServer: Rejecting client connection");
+      ::close(fd);
+      continue;
+    }
+
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+    auto session = std::make_shared<Session>();
+    session->fd = fd;
+    session->waker = m_waker;
+    m_sessions.push_back(session);
+
+    LOG_INFO("ControlServer: Client connected. Total clients: ", m_sessions.size());
+  }
+}
+
+/** @brief Read available bytes from a client and handle every complete frame.
+ *  @return False if the client disconnected or violated the protocol.
+ */
+bool ControlServer::read_client(const SessionPtr &session)
+{
+  uint8_t buffer[16384];
+  while (true)
+  {
+    ssize_t received = ::recv(session->fd, buffer, sizeof(buffer), 0);
+    if (received == 0)
+      return false;
+
+    if (received < 0)
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+
+    session->decoder.feed(std::span<const uint8_t>(buffer, static_cast<size_t>(received)));
+    while (auto payload = session->decoder.next_frame())
+    {
+      handle_frame(session, *payload);
+    }
+
+    if (session->decoder.has_error())
+    {
+      LOG_WARNING("ControlServer: Dropping client that sent an oversized frame");
+      return false;
+    }
+
+    if (static_cast<size_t>(received) < sizeof(buffer))
+      return true;
+  }
+}
+
+/** @brief Write as much pending output as the socket accepts.
+ *  @return False if the client connection failed.
+ */
+bool ControlServer::write_client(const SessionPtr &session)
+{
+#ifdef MSG_NOSIGNAL
+  constexpr int send_flags = MSG_NOSIGNAL;
+#else
+  constexpr int send_flags = 0;
+#endif
+
+  while (session->pending_output() > 0)
+  {
+    ssize_t sent = ::send(session->fd, session->output.data() + session->output_offset, session->pending_output(), send_flags);
+    if (sent < 0)
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+
+    session->output_offset += static_cast<size_t>(sent);
+  }
+
+  session->output.clear();
+  session->output_offset = 0;
+  return true;
+}
+
+/** @brief Dispatch one request frame. Client-local requests are answered directly unless
+ *  earlier engine requests from the same client are still pending, which keeps responses
+ *  in request order.
+ */
+void ControlServer::handle_frame(const SessionPtr &session, std::span<const uint8_t> payload)
+{
+  auto type = peek_control_message_type(payload);
+  bool local = type && (*type == eControlMessageType::Ping ||
+                        *type == eControlMessageType::GetStatistics ||
+                        *type == eControlMessageType::Subscribe ||
+                        *type == eControlMessageType::Unsubscribe);
+
+  if (local && session->pending_tasks.load(std::memory_order_acquire) == 0)
+  {
+    execute_payload(*session, payload, session->output);
+    return;
+  }
+
+  post_to_engine(session, payload);
+}
+
+/** @brief Copy a request payload into a CoreEngine command.
+ *  The response is queued in the session outbox and the server thread is woken to send it.
+ */
+void ControlServer::post_to_engine(const SessionPtr &session, std::span<const uint8_t> payload)
+{
+  session->pending_tasks.fetch_add(1, std::memory_order_acq_rel);
+
+  CoreEngineMessage message;
+  message.type = CoreEngineMessage::eType::Command;
+  message.info = "ControlServer request";
+  message.task = [weak_session = std::weak_ptr<Session>(session),
+                  request = std::vector<uint8_t>(payload.begin(), payload.end())]() {
+    auto session = weak_session.lock();
+    if (!session)
+      return;
+
+    std::vector<uint8_t> output;
+    execute_payload(*session, request, output);
+    {
+      std::lock_guard<std::mutex> lock(session->outbox_mutex);
+      session->outbox.insert(session->outbox.end(), output.begin(), output.end());
+    }
+    session->pending_tasks.fetch_sub(1, std::memory_order_acq_rel);
+    session->waker->wake();
+  };
+
+  m_engine.push_message(std::move(message));
+}
+
+/** @brief Queue an event frame for every session subscribed to it.
+ *  @param lossy If true, sessions with a large backlog skip the event.
+ */
+void ControlServer::broadcast_event(uint32_t event_mask, std::span<const uint8_t> frame, bool lossy)
+{
+  for (auto &session : m_sessions)
+  {
+    if (session->fd < 0 || (session->event_mask.load(std::memory_order_relaxed) & event_mask) == 0)
+      continue;
+
+    if (lossy && session->pending_output() >= CONTROL_MAX_PENDING_OUTPUT)
+      continue;
+
+    session->output.insert(session->output.end(), frame.begin(), frame.end());
+  }
+}
+
+/** @brief Read and reset the output peak meters and send them to subscribers
+ */
+void ControlServer::publish_meters()
+{
+  auto peaks = AudioEngine::instance().get_output_peaks();
+
+  std::vector<uint8_t> frame;
+  encode_control_event(frame, eControlEvent::Meters, peaks);
+  broadcast_event(CONTROL_EVENT_MASK_METERS, frame, true);
+}
+
+#else
+
+void ControlServer::Waker::wake() {}
+void ControlServer::Waker::drain() {}
+void ControlServer::Waker::close() {}
+
+bool ControlServer::start()
+{
+  LOG_ERROR("ControlServer: Unix domain sockets are not supported on this platform");
+  return false;
+}
+
+void ControlServer::stop() {}
+void ControlServer::close_sockets() {}
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef __BATCH_CONVERTER_H__
+#define __BATCH_CONVERTER_H__
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <sndfile.h>
+
+namespace MinimalAudioEngine
+{
+
+/** @enum eNormalization
+ *  @brief Level normalization applied during conversion.
+ */
+enum class eNormalization
+{
+  None,
+  Peak,      // Target level in dBFS
+  Loudness,  // Target level in LUFS
+};
+
+/** @struct BatchConvertConfig
+ *  @brief Parameters for a batch conversion.
+ */
+struct BatchConvertConfig
+{
+  std::filesystem::path output_directory = ".";
+  unsigned int sample_rate = 0;                   // 0 keeps the source sample rate
+  int format = SF_FORMAT_WAV | SF_FORMAT_PCM_24;  // libsndfile major and minor format
+  eNormalization normalization = eNormalization::None;
+  double target_level = -23.0;
+  unsigned int dsp_threads = 0;                   // 0 uses all hardware threads
+  unsigned int reader_threads = 2;
+  unsigned int writer_threads = 2;
+  size_t queue_depth = 4;                         // Files buffered between stages
+  size_t memory_budget_bytes = 512u * 1024 * 1024;
+};
+
+/** @struct BatchConvertProgress
+ *  @brief Progress and throughput of a batch conversion.
+ */
+struct BatchConvertProgress
+{
+  size_t files_total = 0;
+  size_t files_converted = 0;
+  size_t files_failed = 0;
+  uint64_t frames_processed = 0;
+  uint64_t bytes_read = 0;
+  uint64_t bytes_written = 0;
+  double elapsed_seconds = 0.0;
+  double files_per_second = 0.0;
+  double frames_per_second = 0.0;
+  std::filesystem::path last_file;
+
+  std::string to_string() const
+  {
+    return "BatchConvertProgress(Files=" + std::to_string(files_converted + files_failed) + "/" + std::to_string(files_total) +
+           ", Failed=" + std::to_string(files_failed) +
+           ", FramesProcessed=" + std::to_string(frames_processed) +
+           ", BytesRead=" + std::to_string(bytes_read) +
+           ", BytesWritten=" + std::to_string(bytes_written) +
+           ", ElapsedSeconds=" + std::to_string(elapsed_seconds) +
+           ", FilesPerSecond=" + std::to_string(files_per_second) +
+           ", FramesPerSecond=" + std::to_string(frames_per_second) + ")";
+  }
+};
+
+typedef std::function<void(const BatchConvertProgress &)> BatchConvertProgressCallback;
+
+/** @class BatchConverter
+ *  @brief Converts many audio files through a bounded reader -> DSP -> writer pipeline.
+ *  Reader and writer threads overlap disk I/O with resampling, normalization and
+ *  format conversion on the DSP workers. Bounded queues and a memory budget cap
+ *  the audio held in flight regardless of how many files are queued.
+ */
+class BatchConverter
+{
+public:
+  explicit BatchConverter(const BatchConvertConfig &config);
+  ~BatchConverter() = default;
+
+  BatchConverter(const BatchConverter &) = delete;
+  BatchConverter &operator=(const BatchConverter &) = delete;
+
+  BatchConvertProgress convert_directory(const std::filesystem::path &input_directory,
+                                         BatchConvertProgressCallback callback = nullptr);
+  BatchConvertProgress convert_files(const std::vector<std::filesystem::path> &files,
+                                     BatchConvertProgressCallback callback = nullptr);
+
+  std::filesystem::path get_output_path(const std::filesystem::path &input_path) const;
+
+private:
+  struct Job;
+  class MemoryBudget;
+
+  std::unique_ptr<Job> read_file(const std::filesystem::path &path, MemoryBudget &budget) const;
+  void process_job(Job &job) const;
+  bool write_job(Job &job) const;
+
+  BatchConvertConfig m_config;
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // __BATCH_CONVERTER_H__
@@ -0,0 +1,58 @@
+#ifndef __LOUDNESS_METER_H__
+#define __LOUDNESS_METER_H__
+
+#include <cstdint>
+#include <vector>
+
+namespace MinimalAudioEngine
+{
+
+constexpr double LOUDNESS_SILENCE = -70.0;  // LUFS, also the absolute gate
+
+/** @class LoudnessMeter
+ *  @brief Integrated loudness measurement following ITU-R BS.1770-4.
+ *  Applies K-weighting, 400 ms blocks with 75% overlap, and the absolute
+ *  (-70 LUFS) and relative (-10 LU) gates.
+ */
+class LoudnessMeter
+{
+public:
+  LoudnessMeter(unsigned int channels, unsigned int sample_rate);
+
+  void process(const float *samples, uint64_t frames);
+  double get_integrated_loudness() const;
+
+  static double measure(const std::vector<float> &samples, unsigned int channels, unsigned int sample_rate);
+  static float measure_peak(const std::vector<float> &samples);
+
+private:
+  struct Biquad
+  {
+    double b0, b1, b2, a1, a2;
+    double z1 = 0.0;
+    double z2 = 0.0;
+
+    inline double process(double x)
+    {
+      double y = b0 * x + z1;
+      z1 = b1 * x - a1 * y + z2;
+      z2 = b2 * x - a2 * y;
+      return y;
+    }
+  };
+
+  unsigned int m_channels;
+  unsigned int m_step_frames;  // 100 ms
+
+  std::vector<Biquad> m_shelf;     // Per channel
+  std::vector<Biquad> m_highpass;  // Per channel
+  std::vector<double> m_channel_weights;
+
+  std::vector<double> m_step_energy;  // Weighted energy of each completed 100 ms step
+  double m_current_energy = 0.0;
+  unsigned int m_current_frames = 0;
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // __LOUDNESS_METER_H__
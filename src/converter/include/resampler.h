@@ -0,0 +1,44 @@
+#ifndef __RESAMPLER_H__
+#define __RESAMPLER_H__
+
+#include <vector>
+#include <cstdint>
+
+namespace MinimalAudioEngine
+{
+
+constexpr unsigned int RESAMPLER_DEFAULT_HALF_TAPS = 16;
+constexpr unsigned int RESAMPLER_TABLE_RESOLUTION = 512;  // Kernel samples per input sample
+
+/** @class Resampler
+ *  @brief Band-limited sample rate converter using a windowed-sinc kernel.
+ *  The kernel is tabulated once at construction, so one Resampler can be shared
+ *  by several threads converting different buffers.
+ */
+class Resampler
+{
+public:
+  Resampler(unsigned int input_rate, unsigned int output_rate, unsigned int half_taps = RESAMPLER_DEFAULT_HALF_TAPS);
+
+  std::vector<float> process(const std::vector<float> &input, unsigned int channels) const;
+
+  uint64_t get_output_frames(uint64_t input_frames) const;
+
+  inline bool is_passthrough() const noexcept
+  {
+    return m_input_rate == m_output_rate;
+  }
+
+private:
+  float kernel(double x) const;
+
+  unsigned int m_input_rate;
+  unsigned int m_output_rate;
+  unsigned int m_half_taps;
+  double m_step;  // Input frames per output frame
+  std::vector<float> m_kernel_table;
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // __RESAMPLER_H__
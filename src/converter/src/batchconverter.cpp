@@ -0,0 +1,441 @@
+#include "batchconverter.h"
+
+#include "resampler.h"
+#include "loudnessmeter.h"
+#include "boundedqueue.h"
+#include "filemanager.h"
+#include "wavfile.h"
+#include "wavwriter.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <random>
+#include <thread>
+
+using namespace MinimalAudioEngine;
+
+/** @struct BatchConverter::Job
+ *  @brief One file moving through the pipeline.
+ */
+struct BatchConverter::Job
+{
+  std::filesystem::path input_path;
+  std::filesystem::path output_path;
+  std::vector<float> samples;
+  unsigned int channels = 0;
+  unsigned int sample_rate = 0;
+  uint64_t input_frames = 0;
+  uint64_t input_bytes = 0;
+  size_t reserved_bytes = 0;
+};
+
+/** @class BatchConverter::MemoryBudget
+ *  @brief Caps the bytes of audio held by jobs in flight.
+ *  A job larger than the whole budget is admitted alone.
+ */
+class BatchConverter::MemoryBudget
+{
+public:
+  explicit MemoryBudget(size_t capacity) : m_capacity(std::max<size_t>(capacity, 1)) {}
+
+  /** @brief Blocks until bytes are available.
+   *  @return The number of bytes reserved, which must be passed to release().
+   */
+  size_t acquire(size_t bytes)
+  {
+    bytes = std::min(bytes, m_capacity);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this, bytes] { return m_used + bytes <= m_capacity; });
+    m_used += bytes;
+    return bytes;
+  }
+
+  void release(size_t bytes)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_used -= std::min(bytes, m_used);
+    }
+    m_condition.notify_all();
+  }
+
+private:
+  const size_t m_capacity;
+  size_t m_used = 0;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+};
+
+/** @brief Returns the file extension matching a libsndfile major format.
+ */
+static std::string extension_for_format(int format)
+{
+  switch (format & SF_FORMAT_TYPEMASK)
+  {
+    case SF_FORMAT_AIFF:
+      return ".aiff";
+    case SF_FORMAT_FLAC:
+      return ".flac";
+    default:
+      return ".wav";
+  }
+}
+
+/** @brief BatchConverter constructor
+ *  @param config Conversion parameters.
+ */
+BatchConverter::BatchConverter(const BatchConvertConfig &config):
+  m_config(config)
+{
+}
+
+/** @brief Gets the path a converted file is written to.
+ *  @param input_path The source file.
+ *  @return The output path, in the output directory with the target format's extension.
+ */
+std::filesystem::path BatchConverter::get_output_path(const std::filesystem::path &input_path) const
+{
+  std::filesystem::path filename = input_path.filename();
+  filename.replace_extension(extension_for_format(m_config.format));
+  return m_config.output_directory / filename;
+}
+
+/** @brief Converts every WAV file in a directory.
+ *  @param input_directory The directory to convert.
+ *  @param callback Optional progress callback, invoked after each file.
+ *  @return Final progress and throughput.
+ *  @throws std::runtime_error if the directory does not exist.
+ */
+BatchConvertProgress BatchConverter::convert_directory(const std::filesystem::path &input_directory,
+                                                       BatchConvertProgressCallback callback)
+{
+  return convert_files(FileManager::instance().list_wav_files_in_directory(input_directory), callback);
+}
+
+/** @brief Converts a list of files.
+ *  Blocks until every file has been written or has failed.
+ *  @param files The files to convert.
+ *  @param callback Optional progress callback, invoked after each file from a writer thread.
+ *  @return Final progress and throughput.
+ */
+BatchConvertProgress BatchConverter::convert_files(const std::vector<std::filesystem::path> &files,
+                                                   BatchConvertProgressCallback callback)
+{
+  BatchConvertProgress progress;
+  progress.files_total = files.size();
+
+  if (files.empty())
+  {
+    return progress;
+  }
+
+  const auto start_time = std::chrono::steady_clock::now();
+
+  const unsigned int dsp_threads = m_config.dsp_threads != 0 ? m_config.dsp_threads
+                                                             : std::max(1u, std::thread::hardware_concurrency());
+  const unsigned int reader_threads = std::max(1u, m_config.reader_threads);
+  const unsigned int writer_threads = std::max(1u, m_config.writer_threads);
+
+  LOG_INFO("BatchConverter: Converting ", files.size(), " files with ", reader_threads, " readers, ",
+           dsp_threads, " DSP workers and ", writer_threads, " writers.");
+
+  MemoryBudget budget(m_config.memory_budget_bytes);
+  BoundedQueue<std::unique_ptr<Job>> dsp_queue(m_config.queue_depth);
+  BoundedQueue<std::unique_ptr<Job>> write_queue(m_config.queue_depth);
+
+  std::atomic<size_t> next_file{0};
+  std::atomic<unsigned int> readers_running{reader_threads};
+  std::atomic<unsigned int> dsp_running{dsp_threads};
+  std::mutex progress_mutex;
+
+  // Called once per file from whichever stage finished with it
+  auto report = [&](const Job *job, const std::filesystem::path &path, bool success) {
+    std::lock_guard<std::mutex> lock(progress_mutex);
+
+    if (success)
+    {
+      progress.files_converted++;
+      progress.frames_processed += job->input_frames;
+      progress.bytes_read += job->input_bytes;
+
+      std::error_code ec;
+      auto size = std::filesystem::file_size(job->output_path, ec);
+      progress.bytes_written += ec ? 0 : size;
+    }
+    else
+    {
+      progress.files_failed++;
+    }
+
+    progress.last_file = path;
+    progress.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    if (progress.elapsed_seconds > 0.0)
+    {
+      progress.files_per_second = (progress.files_converted + progress.files_failed) / progress.elapsed_seconds;
+      progress.frames_per_second = progress.frames_processed / progress.elapsed_seconds;
+    }
+
+    if (callback)
+    {
+      callback(progress);
+    }
+  };
+
+  // Frees a job's audio before releasing its share of the budget
+  auto release_job = [&](Job &job) {
+    job.samples = std::vector<float>();
+    budget.release(job.reserved_bytes);
+    job.reserved_bytes = 0;
+  };
+
+  // A file that throws in any stage is reported as failed; the stage carries on with the next
+  // file, so the running counts still reach zero and the queues close
+
+  {
+    std::vector<std::jthread> threads;
+
+    for (unsigned int i = 0; i < reader_threads; ++i)
+    {
+      threads.emplace_back([&]() {
+        set_thread_name("ConvertReader");
+
+        size_t index;
+        while ((index = next_file.fetch_add(1, std::memory_order_relaxed)) < files.size())
+        {
+          std::unique_ptr<Job> job;
+          try
+          {
+            job = read_file(files[index], budget);
+          }
+          catch (const std::exception &e)
+          {
+            LOG_ERROR("BatchConverter: Failed to read ", files[index].string(), ": ", e.what());
+          }
+
+          if (!job)
+          {
+            report(nullptr, files[index], false);
+            continue;
+          }
+
+          dsp_queue.push(std::move(job));
+        }
+
+        if (readers_running.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+          dsp_queue.close();
+        }
+      });
+    }
+
+    for (unsigned int i = 0; i < dsp_threads; ++i)
+    {
+      threads.emplace_back([&]() {
+        set_thread_name("ConvertDsp");
+
+        while (auto job = dsp_queue.pop())
+        {
+          try
+          {
+            process_job(**job);
+          }
+          catch (const std::exception &e)
+          {
+            LOG_ERROR("BatchConverter: Failed to process ", (*job)->input_path.string(), ": ", e.what());
+            release_job(**job);
+            report(nullptr, (*job)->input_path, false);
+            continue;
+          }
+
+          write_queue.push(std::move(*job));
+        }
+
+        if (dsp_running.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+          write_queue.close();
+        }
+      });
+    }
+
+    for (unsigned int i = 0; i < writer_threads; ++i)
+    {
+      threads.emplace_back([&]() {
+        set_thread_name("ConvertWriter");
+
+        while (auto job = write_queue.pop())
+        {
+          bool success = false;
+          try
+          {
+            success = write_job(**job);
+          }
+          catch (const std::exception &e)
+          {
+            LOG_ERROR("BatchConverter: Failed to write ", (*job)->output_path.string(), ": ", e.what());
+          }
+
+          release_job(**job);
+          report(job->get(), (*job)->input_path, success);
+        }
+      });
+    }
+  }
+
+  LOG_INFO("BatchConverter: Finished. ", progress.to_string());
+  return progress;
+}
+
+/** @brief Reader stage - loads a whole file once memory is available for it.
+ *  @return The job, or nullptr if the file could not be read.
+ */
+std::unique_ptr<BatchConverter::Job> BatchConverter::read_file(const std::filesystem::path &path, MemoryBudget &budget) const
+{
+  auto file = FileManager::instance().read_wav_file(path);
+  if (!file.has_value() || file.value()->get_channels() == 0)
+  {
+    LOG_ERROR("BatchConverter: Cannot read ", path.string());
+    return nullptr;
+  }
+
+  WavFilePtr wav_file = file.value();
+
+  auto job = std::make_unique<Job>();
+  job->input_path = path;
+  job->output_path = get_output_path(path);
+  job->channels = wav_file->get_channels();
+  job->sample_rate = wav_file->get_sample_rate();
+  job->input_frames = static_cast<uint64_t>(std::max<sf_count_t>(wav_file->get_frame_count(), 0));
+
+  std::error_code ec;
+  auto size = std::filesystem::file_size(path, ec);
+  job->input_bytes = ec ? 0 : size;
+
+  // Reserve room for the source and the resampled copy
+  const unsigned int output_rate = m_config.sample_rate != 0 ? m_config.sample_rate : job->sample_rate;
+  const double ratio = static_cast<double>(output_rate) / static_cast<double>(job->sample_rate);
+  const double samples = static_cast<double>(job->input_frames) * job->channels;
+  job->reserved_bytes = budget.acquire(static_cast<size_t>(samples * sizeof(float) * (1.0 + ratio)));
+
+  sf_count_t read = 0;
+  try
+  {
+    job->samples.resize(static_cast<size_t>(job->input_frames) * job->channels);
+    read = wav_file->read_frames(job->samples, static_cast<sf_count_t>(job->input_frames));
+  }
+  catch (...)
+  {
+    // The job never reaches a stage that would release its reservation
+    budget.release(job->reserved_bytes);
+    throw;
+  }
+
+  if (read < 0 || static_cast<uint64_t>(read) != job->input_frames)
+  {
+    LOG_WARNING("BatchConverter: Short read from ", path.string(), " (", read, " of ", job->input_frames, " frames)");
+    job->input_frames = static_cast<uint64_t>(std::max<sf_count_t>(read, 0));
+    job->samples.resize(static_cast<size_t>(job->input_frames) * job->channels);
+  }
+
+  return job;
+}
+
+/** @brief DSP stage - resamples, normalizes and prepares samples for the target format.
+ */
+void BatchConverter::process_job(Job &job) const
+{
+  if (m_config.sample_rate != 0 && m_config.sample_rate != job.sample_rate)
+  {
+    Resampler resampler(job.sample_rate, m_config.sample_rate);
+    job.samples = resampler.process(job.samples, job.channels);
+    job.sample_rate = m_config.sample_rate;
+  }
+
+  double gain_db = 0.0;
+  switch (m_config.normalization)
+  {
+    case eNormalization::Peak:
+    {
+      float peak = LoudnessMeter::measure_peak(job.samples);
+      if (peak > 0.0f)
+      {
+        gain_db = m_config.target_level - 20.0 * std::log10(peak);
+      }
+      break;
+    }
+    case eNormalization::Loudness:
+    {
+      double loudness = LoudnessMeter::measure(job.samples, job.channels, job.sample_rate);
+      if (std::isfinite(loudness))
+      {
+        gain_db = m_config.target_level - loudness;
+      }
+      break;
+    }
+    default:
+      break;
+  }
+
+  if (gain_db != 0.0)
+  {
+    const float gain = static_cast<float>(std::pow(10.0, gain_db / 20.0));
+    for (float &sample : job.samples)
+    {
+      sample *= gain;
+    }
+  }
+
+  const int subformat = m_config.format & SF_FORMAT_SUBMASK;
+  if (subformat == SF_FORMAT_FLOAT || subformat == SF_FORMAT_DOUBLE)
+  {
+    return;
+  }
+
+  // Integer targets: TPDF dither for 16 bits and below, then clip to full scale
+  float dither = 0.0f;
+  if (subformat == SF_FORMAT_PCM_16)
+  {
+    dither = 1.0f / 32768.0f;
+  }
+  else if (subformat == SF_FORMAT_PCM_S8 || subformat == SF_FORMAT_PCM_U8)
+  {
+    dither = 1.0f / 128.0f;
+  }
+
+  thread_local std::minstd_rand random_engine{std::random_device{}()};
+  std::uniform_real_distribution<float> distribution(-0.5f, 0.5f);
+
+  for (float &sample : job.samples)
+  {
+    if (dither != 0.0f)
+    {
+      sample += dither * (distribution(random_engine) + distribution(random_engine));
+    }
+    sample = std::clamp(sample, -1.0f, 1.0f);
+  }
+}
+
+/** @brief Writer stage - writes the converted file.
+ *  @return True on success.
+ */
+bool BatchConverter::write_job(Job &job) const
+{
+  auto writer = FileManager::instance().create_wav_file(job.output_path, job.channels, job.sample_rate, m_config.format);
+  if (!writer.has_value())
+  {
+    LOG_ERROR("BatchConverter: Cannot create ", job.output_path.string());
+    return false;
+  }
+
+  const sf_count_t frames = static_cast<sf_count_t>(job.samples.size() / job.channels);
+  const bool success = writer.value()->write_frames(job.samples.data(), frames) == frames;
+  writer.value()->close();
+
+  return success;
+}
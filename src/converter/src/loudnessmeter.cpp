@@ -0,0 +1,171 @@
+#include "loudnessmeter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+// Define M_PI if not already defined (Windows MSVC compatibility)
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+using namespace MinimalAudioEngine;
+
+constexpr unsigned int STEPS_PER_BLOCK = 4;  // 400 ms blocks, 100 ms hop
+constexpr double RELATIVE_GATE = -10.0;
+
+/** @brief Converts mean-square energy to LUFS.
+ */
+static double energy_to_loudness(double energy)
+{
+  return energy > 0.0 ? -0.691 + 10.0 * std::log10(energy) : -std::numeric_limits<double>::infinity();
+}
+
+/** @brief LoudnessMeter constructor
+ *  @param channels Number of interleaved channels.
+ *  @param sample_rate Sample rate of the audio to be measured.
+ */
+LoudnessMeter::LoudnessMeter(unsigned int channels, unsigned int sample_rate):
+  m_channels(channels),
+  m_step_frames(std::max(sample_rate / 10, 1u))
+{
+  if (channels == 0 || sample_rate == 0)
+  {
+    throw std::invalid_argument("LoudnessMeter: Channels and sample rate must be non-zero");
+  }
+
+  // K-weighting filters derived for the actual sample rate
+  const double rate = static_cast<double>(sample_rate);
+
+  double f0 = 1681.974450955533;
+  double gain = 3.999843853973347;
+  double q = 0.7071752369554196;
+  double k = std::tan(M_PI * f0 / rate);
+  double vh = std::pow(10.0, gain / 20.0);
+  double vb = std::pow(vh, 0.4996667741545416);
+  double a0 = 1.0 + k / q + k * k;
+
+  Biquad shelf{(vh + vb * k / q + k * k) / a0,
+               2.0 * (k * k - vh) / a0,
+               (vh - vb * k / q + k * k) / a0,
+               2.0 * (k * k - 1.0) / a0,
+               (1.0 - k / q + k * k) / a0};
+
+  f0 = 38.13547087602444;
+  q = 0.5003270373238773;
+  k = std::tan(M_PI * f0 / rate);
+  a0 = 1.0 + k / q + k * k;
+
+  Biquad highpass{1.0, -2.0, 1.0,
+                  2.0 * (k * k - 1.0) / a0,
+                  (1.0 - k / q + k * k) / a0};
+
+  m_shelf.assign(channels, shelf);
+  m_highpass.assign(channels, highpass);
+
+  // 5.1 layout: L R C LFE Ls Rs - LFE is excluded, surrounds are boosted
+  m_channel_weights.assign(channels, 1.0);
+  if (channels == 6)
+  {
+    m_channel_weights[3] = 0.0;
+    m_channel_weights[4] = 1.41;
+    m_channel_weights[5] = 1.41;
+  }
+}
+
+/** @brief Feeds interleaved samples into the meter.
+ *  @param samples Interleaved samples.
+ *  @param frames Number of frames.
+ */
+void LoudnessMeter::process(const float *samples, uint64_t frames)
+{
+  for (uint64_t i = 0; i < frames; ++i)
+  {
+    const float *frame = samples + i * m_channels;
+    for (unsigned int ch = 0; ch < m_channels; ++ch)
+    {
+      double filtered = m_highpass[ch].process(m_shelf[ch].process(frame[ch]));
+      m_current_energy += m_channel_weights[ch] * filtered * filtered;
+    }
+
+    if (++m_current_frames == m_step_frames)
+    {
+      m_step_energy.push_back(m_current_energy / m_step_frames);
+      m_current_energy = 0.0;
+      m_current_frames = 0;
+    }
+  }
+}
+
+/** @brief Computes the gated integrated loudness of everything processed so far.
+ *  @return Loudness in LUFS, or -infinity if all blocks fall below the absolute gate.
+ */
+double LoudnessMeter::get_integrated_loudness() const
+{
+  if (m_step_energy.size() < STEPS_PER_BLOCK)
+  {
+    return -std::numeric_limits<double>::infinity();
+  }
+
+  std::vector<double> blocks;
+  blocks.reserve(m_step_energy.size());
+  for (size_t i = 0; i + STEPS_PER_BLOCK <= m_step_energy.size(); ++i)
+  {
+    double energy = 0.0;
+    for (unsigned int j = 0; j < STEPS_PER_BLOCK; ++j)
+    {
+      energy += m_step_energy[i + j];
+    }
+    blocks.push_back(energy / STEPS_PER_BLOCK);
+  }
+
+  auto gated_mean = [&blocks](double threshold) {
+    double sum = 0.0;
+    size_t count = 0;
+    for (double energy : blocks)
+    {
+      if (energy_to_loudness(energy) > threshold)
+      {
+        sum += energy;
+        count++;
+      }
+    }
+    return count > 0 ? sum / static_cast<double>(count) : 0.0;
+  };
+
+  double absolute_gated = gated_mean(LOUDNESS_SILENCE);
+  if (absolute_gated <= 0.0)
+  {
+    return -std::numeric_limits<double>::infinity();
+  }
+
+  return energy_to_loudness(gated_mean(energy_to_loudness(absolute_gated) + RELATIVE_GATE));
+}
+
+/** @brief Measures the integrated loudness of a whole buffer.
+ *  @param samples Interleaved samples.
+ *  @param channels Number of interleaved channels.
+ *  @param sample_rate Sample rate of the audio.
+ *  @return Loudness in LUFS.
+ */
+double LoudnessMeter::measure(const std::vector<float> &samples, unsigned int channels, unsigned int sample_rate)
+{
+  LoudnessMeter meter(channels, sample_rate);
+  meter.process(samples.data(), samples.size() / channels);
+  return meter.get_integrated_loudness();
+}
+
+/** @brief Finds the sample peak of a buffer.
+ *  @param samples Samples, interleaved or not.
+ *  @return The largest absolute sample value.
+ */
+float LoudnessMeter::measure_peak(const std::vector<float> &samples)
+{
+  float peak = 0.0f;
+  for (float sample : samples)
+  {
+    peak = std::max(peak, std::abs(sample));
+  }
+  return peak;
+}
@@ -0,0 +1,125 @@
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// Define M_PI if not already defined (Windows MSVC compatibility)
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+using namespace MinimalAudioEngine;
+
+/** @brief Resampler constructor
+ *  @param input_rate Sample rate of the input buffers.
+ *  @param output_rate Sample rate to convert to.
+ *  @param half_taps Kernel half-width in input samples; higher is sharper and slower.
+ *  @throws std::invalid_argument if either rate is zero.
+ */
+Resampler::Resampler(unsigned int input_rate, unsigned int output_rate, unsigned int half_taps):
+  m_input_rate(input_rate),
+  m_output_rate(output_rate),
+  m_half_taps(std::max(half_taps, 1u))
+{
+  if (input_rate == 0 || output_rate == 0)
+  {
+    throw std::invalid_argument("Resampler: Sample rates must be non-zero");
+  }
+
+  m_step = static_cast<double>(input_rate) / static_cast<double>(output_rate);
+
+  // Lower the cutoff below the output Nyquist when downsampling
+  const double cutoff = std::min(1.0, 1.0 / m_step) * 0.97;
+
+  const size_t table_size = static_cast<size_t>(m_half_taps) * RESAMPLER_TABLE_RESOLUTION + 2;
+  m_kernel_table.resize(table_size);
+
+  for (size_t i = 0; i < table_size; ++i)
+  {
+    double x = static_cast<double>(i) / RESAMPLER_TABLE_RESOLUTION;
+    if (x >= m_half_taps)
+    {
+      m_kernel_table[i] = 0.0f;
+      continue;
+    }
+
+    double sinc = (x == 0.0) ? 1.0 : std::sin(M_PI * cutoff * x) / (M_PI * cutoff * x);
+
+    // Blackman window over [-half_taps, half_taps]
+    double n = 0.5 + x / (2.0 * m_half_taps);
+    double window = 0.42 - 0.5 * std::cos(2.0 * M_PI * n) + 0.08 * std::cos(4.0 * M_PI * n);
+
+    m_kernel_table[i] = static_cast<float>(cutoff * sinc * window);
+  }
+}
+
+/** @brief Evaluates the kernel by linear interpolation of the table.
+ *  @param x Distance from the kernel centre, in input samples.
+ */
+float Resampler::kernel(double x) const
+{
+  double position = std::abs(x) * RESAMPLER_TABLE_RESOLUTION;
+  size_t index = static_cast<size_t>(position);
+  if (index + 1 >= m_kernel_table.size())
+  {
+    return 0.0f;
+  }
+
+  float frac = static_cast<float>(position - static_cast<double>(index));
+  return m_kernel_table[index] + frac * (m_kernel_table[index + 1] - m_kernel_table[index]);
+}
+
+/** @brief Number of output frames produced for a given input length.
+ */
+uint64_t Resampler::get_output_frames(uint64_t input_frames) const
+{
+  return static_cast<uint64_t>(std::ceil(static_cast<double>(input_frames) / m_step));
+}
+
+/** @brief Converts a whole interleaved buffer to the output sample rate.
+ *  @param input Interleaved samples at the input rate.
+ *  @param channels Number of interleaved channels.
+ *  @return Interleaved samples at the output rate.
+ */
+std::vector<float> Resampler::process(const std::vector<float> &input, unsigned int channels) const
+{
+  if (channels == 0 || is_passthrough())
+  {
+    return input;
+  }
+
+  const int64_t input_frames = static_cast<int64_t>(input.size() / channels);
+  const uint64_t output_frames = get_output_frames(static_cast<uint64_t>(input_frames));
+  const int64_t half_taps = static_cast<int64_t>(m_half_taps);
+
+  std::vector<float> output(static_cast<size_t>(output_frames) * channels, 0.0f);
+  std::vector<float> weights(static_cast<size_t>(2 * half_taps));
+
+  for (uint64_t n = 0; n < output_frames; ++n)
+  {
+    const double t = static_cast<double>(n) * m_step;
+    const int64_t centre = static_cast<int64_t>(std::floor(t));
+    const int64_t first = std::max<int64_t>(centre - half_taps + 1, 0);
+    const int64_t last = std::min<int64_t>(centre + half_taps, input_frames - 1);
+
+    // Weights are shared by all channels of this frame
+    for (int64_t i = first; i <= last; ++i)
+    {
+      weights[static_cast<size_t>(i - first)] = kernel(t - static_cast<double>(i));
+    }
+
+    float *out = &output[static_cast<size_t>(n) * channels];
+    for (int64_t i = first; i <= last; ++i)
+    {
+      const float weight = weights[static_cast<size_t>(i - first)];
+      const float *in = &input[static_cast<size_t>(i) * channels];
+      for (unsigned int ch = 0; ch < channels; ++ch)
+      {
+        out[ch] += weight * in[ch];
+      }
+    }
+  }
+
+  return output;
+}
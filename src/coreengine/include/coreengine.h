@@ -1,11 +1,17 @@
 #ifndef __CORE_ENGINE_H__
 #define __CORE_ENGINE_H__
 
+#include <functional>
+#include <string>
+
 #include "engine.h"
 
 namespace MinimalAudioEngine
 {
 
+class AudioEngine;
+class MidiEngine;
+
 constexpr const char *CORE_ENGINE_THREAD_NAME = "CoreEngineThread";
 
 /** @struct CoreEngineMessage
@@ -17,10 +23,12 @@ struct CoreEngineMessage
   {
     Shutdown,
     Restart,
-    Custom
+    Custom,
+    Command
   } type;
 
   std::string info; // Optional additional information
+  std::function<void()> task{}; // Work to run on the CoreEngine thread for Command messages
 };
 
 /** @class CoreEngine
@@ -30,6 +38,15 @@ class CoreEngine : public IEngine<CoreEngineMessage>
 {
 public:
   CoreEngine() : IEngine<CoreEngineMessage>(CORE_ENGINE_THREAD_NAME) {}
+
+  /** @brief Construct a CoreEngine that drives a context's engines instead of the default ones
+   */
+  CoreEngine(AudioEngine &audio_engine, MidiEngine &midi_engine)
+    : IEngine<CoreEngineMessage>(CORE_ENGINE_THREAD_NAME),
+      m_audio_engine(&audio_engine),
+      m_midi_engine(&midi_engine)
+  {}
+
   ~CoreEngine() override = default;
 
   void start_thread();
@@ -39,6 +56,12 @@ private:
 
   void run() override;
   void handle_messages() override;
+
+  AudioEngine &get_audio_engine() const;
+  MidiEngine &get_midi_engine() const;
+
+  AudioEngine *m_audio_engine = nullptr;  // nullptr for the default engines
+  MidiEngine *m_midi_engine = nullptr;
 };
 
 }; // namespace MinimalAudioEngine
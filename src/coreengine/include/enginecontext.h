@@ -0,0 +1,81 @@
+#ifndef __ENGINE_CONTEXT_H__
+#define __ENGINE_CONTEXT_H__
+
+#include <memory>
+
+#include "coreengine.h"
+
+namespace MinimalAudioEngine
+{
+
+class AudioEngine;
+class MidiEngine;
+class TrackManager;
+class FileManager;
+class DeviceManager;
+
+/** @class EngineContext
+ *  @brief One engine session: its audio and MIDI engines, tracks, files, devices and command thread.
+ *
+ *  A constructed EngineContext owns a fresh set of subsystems wired to each other only,
+ *  so several sessions can run side by side in one process. The context returned by
+ *  get_default() owns nothing and refers to the singletons; code that still uses
+ *  X::instance() sees the default session. The Logger is process-wide and shared.
+ *
+ *  A session can be embedded in another application's audio callback: after
+ *  set_host_output() the engine opens no device and the host pulls each block with
+ *  render(). Control calls such as Track::play() still go through the engine threads.
+ */
+class EngineContext
+{
+public:
+  EngineContext();
+  ~EngineContext();
+
+  static EngineContext &get_default();
+
+  void start();
+  void stop();
+
+  void set_host_output(unsigned int channels, unsigned int sample_rate);
+  bool render(float *const *output, unsigned int frames) noexcept;
+
+  inline bool is_default() const
+  {
+    return this == &get_default();
+  }
+
+  inline AudioEngine &get_audio_engine() const noexcept { return *m_audio_engine; }
+  inline MidiEngine &get_midi_engine() const noexcept { return *m_midi_engine; }
+  inline TrackManager &get_track_manager() const noexcept { return *m_track_manager; }
+  inline FileManager &get_file_manager() const noexcept { return *m_file_manager; }
+  inline DeviceManager &get_device_manager() const noexcept { return *m_device_manager; }
+  inline CoreEngine &get_core_engine() const noexcept { return *m_core_engine; }
+
+  // Disable copy constructor and assignment operator
+  EngineContext(const EngineContext &) = delete;
+  EngineContext &operator=(const EngineContext &) = delete;
+
+private:
+  struct DefaultTag {};
+  explicit EngineContext(DefaultTag);
+
+  // Owned subsystems; only the CoreEngine for the default context. Declared in construction order.
+  std::unique_ptr<AudioEngine> m_audio_engine_owned;
+  std::unique_ptr<MidiEngine> m_midi_engine_owned;
+  std::unique_ptr<TrackManager> m_track_manager_owned;
+  std::unique_ptr<FileManager> m_file_manager_owned;
+  std::unique_ptr<DeviceManager> m_device_manager_owned;
+  std::unique_ptr<CoreEngine> m_core_engine_owned;
+
+  AudioEngine *m_audio_engine;
+  MidiEngine *m_midi_engine;
+  TrackManager *m_track_manager;
+  FileManager *m_file_manager;
+  DeviceManager *m_device_manager;
+  CoreEngine *m_core_engine;
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // __ENGINE_CONTEXT_H__
@@ -8,15 +8,25 @@ using namespace MinimalAudioEngine;
 void CoreEngine::start_thread()
 {
   IEngine<CoreEngineMessage>::start_thread();
-  MinimalAudioEngine::AudioEngine::instance().start_thread();
-  MinimalAudioEngine::MidiEngine::instance().start_thread();
+  get_audio_engine().start_thread();
+  get_midi_engine().start_thread();
 }
 
 void CoreEngine::stop_thread()
 {
   IEngine<CoreEngineMessage>::stop_thread();
-  MinimalAudioEngine::AudioEngine::instance().stop_thread();
-  MinimalAudioEngine::MidiEngine::instance().stop_thread();
+  get_audio_engine().stop_thread();
+  get_midi_engine().stop_thread();
+}
+
+AudioEngine &CoreEngine::get_audio_engine() const
+{
+  return m_audio_engine != nullptr ? *m_audio_engine : AudioEngine::instance();
+}
+
+MidiEngine &CoreEngine::get_midi_engine() const
+{
+  return m_midi_engine != nullptr ? *m_midi_engine : MidiEngine::instance();
 }
 
 void CoreEngine::run()
@@ -48,6 +58,19 @@ void CoreEngine::handle_messages()
         LOG_INFO("CoreEngine: Received Custom message - ", message.info);
         // Handle custom message logic here
         break;
+      case CoreEngineMessage::eType::Command:
+        if (message.task)
+        {
+          try
+          {
+            message.task();
+          }
+          catch (const std::exception &e)
+          {
+            LOG_ERROR("CoreEngine: Command failed (", message.info, ") - ", e.what());
+          }
+        }
+        break;
       default:
         LOG_ERROR("CoreEngine: Unknown message type received");
         break;
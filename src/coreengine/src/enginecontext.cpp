@@ -0,0 +1,101 @@
+#include "enginecontext.h"
+
+#include "audioengine.h"
+#include "midiengine.h"
+#include "trackmanager.h"
+#include "filemanager.h"
+#include "devicemanager.h"
+
+using namespace MinimalAudioEngine;
+
+/** @brief Create an isolated session with its own subsystems.
+ *  Threads are not started until start().
+ */
+EngineContext::EngineContext()
+  : m_audio_engine_owned(new AudioEngine()),
+    m_midi_engine_owned(new MidiEngine()),
+    m_track_manager_owned(new TrackManager()),
+    m_file_manager_owned(new FileManager()),
+    m_device_manager_owned(new DeviceManager()),
+    m_core_engine_owned(std::make_unique<CoreEngine>(*m_audio_engine_owned, *m_midi_engine_owned)),
+    m_audio_engine(m_audio_engine_owned.get()),
+    m_midi_engine(m_midi_engine_owned.get()),
+    m_track_manager(m_track_manager_owned.get()),
+    m_file_manager(m_file_manager_owned.get()),
+    m_device_manager(m_device_manager_owned.get()),
+    m_core_engine(m_core_engine_owned.get())
+{
+  // Wire the subsystems to each other instead of to the singletons
+  m_audio_engine->set_track_manager(m_track_manager);
+  m_track_manager->set_engines(m_audio_engine, m_midi_engine);
+  m_device_manager->set_engines(m_audio_engine, m_midi_engine);
+}
+
+/** @brief Create the default session around the singletons
+ */
+EngineContext::EngineContext(DefaultTag)
+  : m_core_engine_owned(std::make_unique<CoreEngine>()),
+    m_audio_engine(&AudioEngine::instance()),
+    m_midi_engine(&MidiEngine::instance()),
+    m_track_manager(&TrackManager::instance()),
+    m_file_manager(&FileManager::instance()),
+    m_device_manager(&DeviceManager::instance()),
+    m_core_engine(m_core_engine_owned.get())
+{
+}
+
+/** @brief Stop the session's threads, then release its tracks before the engines they refer to.
+ *  The default context leaves the singletons to their owners.
+ */
+EngineContext::~EngineContext()
+{
+  if (m_track_manager_owned)
+  {
+    stop();
+    m_track_manager_owned->clear_tracks();
+  }
+}
+
+/** @brief Get the context that wraps the singleton subsystems
+ */
+EngineContext &EngineContext::get_default()
+{
+  static EngineContext instance{DefaultTag{}};
+  return instance;
+}
+
+/** @brief Start the command, audio and MIDI threads of this session
+ */
+void EngineContext::start()
+{
+  m_core_engine->start_thread();
+}
+
+/** @brief Stop the command, audio and MIDI threads of this session
+ */
+void EngineContext::stop()
+{
+  m_core_engine->stop_thread();
+}
+
+/** @brief Render through the host application instead of an audio device.
+ *  Takes effect on the audio thread; call before playing.
+ *  @param channels Number of buffers passed to render()
+ *  @param sample_rate Sample rate of the host's callback
+ */
+void EngineContext::set_host_output(unsigned int channels, unsigned int sample_rate)
+{
+  m_audio_engine->set_host_output(channels, sample_rate);
+}
+
+/** @brief Render one block on the calling thread, for use inside a host's audio callback.
+ *  Tracks, scheduled parameter changes and the transport advance by exactly this block.
+ *  Does not allocate, lock or hand off to the engine threads.
+ *  @param output One buffer per channel, frames long each
+ *  @param frames Number of frames to render
+ *  @return False if the engine is not playing; the buffers are then silenced
+ */
+bool EngineContext::render(float *const *output, unsigned int frames) noexcept
+{
+  return m_audio_engine->render(output, frames);
+}
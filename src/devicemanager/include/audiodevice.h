@@ -1,11 +1,35 @@
 #ifndef __AUDIO_DEVICE_H__
 #define __AUDIO_DEVICE_H__
 
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
 #include "device.h"
 
 namespace MinimalAudioEngine
 {
 
+/** @struct AudioDeviceProfile
+ *  @brief Measured properties of an audio device, kept by the DeviceManager per device name.
+ */
+struct AudioDeviceProfile
+{
+  uint32_t round_trip_latency = 0;  // Frames from output to input, as seen by the callback
+  unsigned int sample_rate = 0;     // The round trip was measured at
+  unsigned int buffer_frames = 0;   // The round trip was measured with
+  bool is_virtual = false;          // Measured through the virtual loopback; never stored for the device
+
+  std::string to_string() const
+  {
+    return "AudioDeviceProfile(RoundTripLatency=" + std::to_string(round_trip_latency) +
+           ", SampleRate=" + std::to_string(sample_rate) +
+           ", BufferFrames=" + std::to_string(buffer_frames) +
+           (is_virtual ? ", Virtual" : "") + ")";
+  }
+};
+
 /** @class AudioDevice
  *  @brief Audio device
  */
@@ -23,6 +47,7 @@ public:
   unsigned int duplex_channels;
   std::vector<unsigned int> sample_rates;
   unsigned int preferred_sample_rate;
+  std::optional<AudioDeviceProfile> profile;  // Set once the device has been measured
 
   bool is_input() const override
   {
@@ -1,6 +1,9 @@
 #ifndef __DEVICE_MANAGER_H__
 #define __DEVICE_MANAGER_H__
 
+#include <chrono>
+#include <map>
+#include <mutex>
 #include <vector>
 #include <string>
 #include <optional>
@@ -9,15 +12,22 @@
 #include "device.h"
 #include "audiodevice.h"
 #include "mididevice.h"
+#include "latencymeter.h"
 
 namespace MinimalAudioEngine
 {
 
+class AudioEngine;
+class MidiEngine;
+class EngineContext;
+
 /** @class DeviceManager
  *  @brief Singleton class to manage audio and MIDI devices
  */
 class DeviceManager
 {
+  friend class MinimalAudioEngine::EngineContext;
+
 public:
   static DeviceManager& instance()
   {
@@ -36,9 +46,29 @@ public:
   std::optional<MidiDevice> get_default_midi_input_device();
   std::optional<MidiDevice> get_default_midi_output_device();
 
+  void set_audio_device_profile(const std::string &name, const AudioDeviceProfile &profile);
+  std::optional<AudioDeviceProfile> get_audio_device_profile(const std::string &name) const;
+  std::optional<AudioDeviceProfile> measure_audio_device_latency(
+    const LatencyMeterOptions &options = {}, std::chrono::milliseconds timeout = std::chrono::seconds(5));
+
+  ~DeviceManager() = default;
+
 private:
   DeviceManager() = default;
-  ~DeviceManager() = default;
+
+  /** @brief Query a context's engines instead of the default ones
+   */
+  void set_engines(AudioEngine *audio_engine, MidiEngine *midi_engine)
+  {
+    m_audio_engine = audio_engine;
+    m_midi_engine = midi_engine;
+  }
+
+  AudioEngine *m_audio_engine = nullptr;  // nullptr for the default engines
+  MidiEngine *m_midi_engine = nullptr;
+
+  std::map<std::string, AudioDeviceProfile> m_audio_device_profiles;  // By device name
+  mutable std::mutex m_profile_mutex;
 
   DeviceManager(const DeviceManager&) = delete;
   DeviceManager& operator=(const DeviceManager&) = delete;
@@ -7,7 +7,8 @@ using namespace MinimalAudioEngine;
 std::vector<AudioDevice> DeviceManager::get_audio_devices() const
 {
   std::vector<AudioDevice> devices;
-  auto audio_devices = MinimalAudioEngine::AudioEngine::instance().get_devices();
+  auto &audio_engine = m_audio_engine != nullptr ? *m_audio_engine : MinimalAudioEngine::AudioEngine::instance();
+  auto audio_devices = audio_engine.get_devices();
 
   size_t index = 0;
   for (const auto& info : audio_devices)
@@ -22,6 +23,7 @@ std::vector<AudioDevice> DeviceManager::get_audio_devices() const
     device.is_default_output = info.isDefaultOutput;
     device.sample_rates = info.sampleRates;
     device.preferred_sample_rate = info.preferredSampleRate;
+    device.profile = get_audio_device_profile(device.name);
     devices.push_back(device);
   }
 
@@ -45,7 +47,8 @@ AudioDevice DeviceManager::get_audio_device(const unsigned int id) const
 std::vector<MidiDevice> DeviceManager::get_midi_devices() const
 {
   std::vector<MidiDevice> devices;
-  auto midi_devices = MinimalAudioEngine::MidiEngine::instance().get_ports();
+  auto &midi_engine = m_midi_engine != nullptr ? *m_midi_engine : MinimalAudioEngine::MidiEngine::instance();
+  auto midi_devices = midi_engine.get_ports();
 
   for (const auto &port : midi_devices)
   {
@@ -126,4 +129,58 @@ std::optional<MidiDevice> DeviceManager::get_default_midi_output_device() {
 
 
   return std::nullopt;
-}
\ No newline at end of file
+}
+
+/** @brief Store the measured properties of a device
+ *  @param name Device name, which unlike the ID stays the same across sessions
+ */
+void DeviceManager::set_audio_device_profile(const std::string &name, const AudioDeviceProfile &profile)
+{
+  std::lock_guard<std::mutex> lock(m_profile_mutex);
+  m_audio_device_profiles[name] = profile;
+}
+
+std::optional<AudioDeviceProfile> DeviceManager::get_audio_device_profile(const std::string &name) const
+{
+  std::lock_guard<std::mutex> lock(m_profile_mutex);
+  auto it = m_audio_device_profiles.find(name);
+  if (it == m_audio_device_profiles.end())
+  {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+/** @brief Measure the round trip of the running output and record it in that device's profile.
+ *  The audio engine must be running with input channels or a virtual loopback. A round trip
+ *  through the virtual loopback says nothing about the device, so it is returned marked
+ *  virtual and the stored profile is left alone.
+ *  @param options Excitation, channels and search range.
+ *  @param timeout Longest wait for the measurement.
+ *  @return The measured profile, or nullopt if the round trip could not be measured.
+ */
+std::optional<AudioDeviceProfile> DeviceManager::measure_audio_device_latency(const LatencyMeterOptions &options,
+                                                                              std::chrono::milliseconds timeout)
+{
+  auto &audio_engine = m_audio_engine != nullptr ? *m_audio_engine : MinimalAudioEngine::AudioEngine::instance();
+  auto measurement = audio_engine.measure_round_trip_latency(options, timeout);
+  if (!measurement.has_value())
+  {
+    return std::nullopt;
+  }
+
+  std::string name = audio_engine.get_output_device().name;
+  AudioDeviceProfile profile = get_audio_device_profile(name).value_or(AudioDeviceProfile{});
+  profile.round_trip_latency = measurement->round_trip_frames;
+  profile.sample_rate = measurement->sample_rate;
+  profile.buffer_frames = audio_engine.get_buffer_frames();
+  profile.is_virtual = measurement->virtual_loopback;
+  if (profile.is_virtual)
+  {
+    LOG_WARNING("DeviceManager: Round trip measured through the virtual loopback; not stored for ", name);
+    return profile;
+  }
+
+  set_audio_device_profile(name, profile);
+  return profile;
+}
@@ -0,0 +1,76 @@
+#ifndef __BROADCAST_INFO_H__
+#define __BROADCAST_INFO_H__
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <string>
+
+namespace MinimalAudioEngine
+{
+
+/** @struct BroadcastInfo
+ *  @brief Contents of a Broadcast Wave (BWF) "bext" chunk.
+ *  Text fields longer than the chunk allows are truncated when written.
+ */
+struct BroadcastInfo
+{
+  std::string description;           // Up to 256 characters
+  std::string originator;            // Up to 32 characters
+  std::string originator_reference;  // Up to 32 characters
+  std::string origination_date;      // yyyy-mm-dd
+  std::string origination_time;      // hh:mm:ss
+  uint64_t time_reference = 0;       // Position of the first sample, in samples
+
+  /** @brief Set the origination date and time to the current local time
+   */
+  void set_origination_now()
+  {
+    std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    char date[11];
+    char time[9];
+    std::strftime(date, sizeof(date), "%Y-%m-%d", &local);
+    std::strftime(time, sizeof(time), "%H:%M:%S", &local);
+    origination_date = date;
+    origination_time = time;
+  }
+
+  /** @brief The time reference as hh:mm:ss:ff timecode
+   *  @param sample_rate Sample rate of the file.
+   *  @param frames_per_second Timecode frame rate.
+   */
+  std::string get_timecode(unsigned int sample_rate, unsigned int frames_per_second = 25) const
+  {
+    if (sample_rate == 0 || frames_per_second == 0)
+    {
+      return "00:00:00:00";
+    }
+
+    uint64_t seconds = time_reference / sample_rate;
+    uint64_t frame = (time_reference % sample_rate) * frames_per_second / sample_rate;
+    char timecode[32];
+    std::snprintf(timecode, sizeof(timecode), "%02llu:%02llu:%02llu:%02llu",
+                  static_cast<unsigned long long>(seconds / 3600), static_cast<unsigned long long>(seconds / 60 % 60),
+                  static_cast<unsigned long long>(seconds % 60), static_cast<unsigned long long>(frame));
+    return timecode;
+  }
+
+  std::string to_string() const
+  {
+    return "BroadcastInfo(Description=" + description +
+           ", Originator=" + originator +
+           ", Origination=" + origination_date + " " + origination_time +
+           ", TimeReference=" + std::to_string(time_reference) + ")";
+  }
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // __BROADCAST_INFO_H__
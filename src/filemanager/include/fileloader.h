@@ -0,0 +1,159 @@
+#ifndef __FILE_LOADER_H__
+#define __FILE_LOADER_H__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace MinimalAudioEngine
+{
+
+class WavFile;
+typedef std::shared_ptr<WavFile> WavFilePtr;
+
+// Loads are I/O bound, so use more workers than cores on slow storage
+constexpr unsigned int FILE_LOADER_MIN_THREADS = 4;
+constexpr unsigned int FILE_LOADER_MAX_THREADS = 32;
+
+/** @enum eLoadPriority
+ *  @brief Order in which queued loads are started. Loads of equal priority start in submission order.
+ */
+enum class eLoadPriority
+{
+  Background,   // Prefetching, project scans
+  Normal,
+  Interactive,  // Something the user is waiting on
+};
+
+/** @class FileLoader
+ *  @brief Pool of I/O threads that runs file jobs from a priority queue.
+ *  Threads are started on the first submission, so an idle FileManager costs nothing.
+ */
+class FileLoader
+{
+public:
+  /** @brief A queued job. Called with true instead of running when it is cancelled while queued.
+   */
+  typedef std::function<void(bool cancelled)> Job;
+
+  explicit FileLoader(unsigned int thread_count);
+  ~FileLoader();
+
+  void submit(eLoadPriority priority, Job job);
+  void cancel_all();
+
+  size_t get_queued_count() const;
+
+  inline unsigned int get_thread_count() const noexcept
+  {
+    return m_thread_count;
+  }
+
+  // Disable copy constructor and assignment operator
+  FileLoader(const FileLoader &) = delete;
+  FileLoader &operator=(const FileLoader &) = delete;
+
+private:
+  struct QueuedJob
+  {
+    eLoadPriority priority = eLoadPriority::Normal;
+    uint64_t sequence = 0;
+    Job job;
+
+    bool operator<(const QueuedJob &other) const
+    {
+      // std::priority_queue pops the largest: highest priority, then oldest
+      return priority != other.priority ? priority < other.priority : sequence > other.sequence;
+    }
+  };
+
+  void run(std::stop_token stop_token);
+
+  unsigned int m_thread_count;
+  std::vector<std::jthread> m_threads;
+
+  std::priority_queue<QueuedJob> m_queue;
+  uint64_t m_next_sequence = 0;
+  mutable std::mutex m_mutex;
+  std::condition_variable_any m_condition;
+};
+
+/** @class WavFileLoad
+ *  @brief Handle to a WAV file being opened in the background.
+ *  The result is the same as FileManager::read_wav_file, or nullopt if the load was cancelled.
+ *  Copies share the same load.
+ */
+class WavFileLoad
+{
+  friend class FileManager;
+
+public:
+  typedef std::optional<WavFilePtr> Result;
+
+  /** @brief Wait for the load and get its result
+   */
+  inline Result get() const
+  {
+    return m_future.get();
+  }
+
+  inline bool is_ready() const
+  {
+    return m_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  }
+
+  template <typename Rep, typename Period>
+  bool wait_for(const std::chrono::duration<Rep, Period> &timeout) const
+  {
+    return m_future.wait_for(timeout) == std::future_status::ready;
+  }
+
+  inline std::shared_future<Result> get_future() const
+  {
+    return m_future;
+  }
+
+  void cancel();
+
+  /** @brief True if cancel() stopped the load before it opened the file
+   */
+  bool is_cancelled() const noexcept;
+
+  std::filesystem::path get_path() const;
+
+private:
+  /** @brief Shared by the handle and the queued job. Whichever claims it first sets the result.
+   */
+  struct State
+  {
+    std::filesystem::path path;
+    std::promise<Result> promise;
+    std::atomic<bool> claimed{false};
+    std::atomic<bool> cancelled{false};
+
+    inline bool claim() noexcept
+    {
+      return !claimed.exchange(true, std::memory_order_acq_rel);
+    }
+  };
+
+  explicit WavFileLoad(std::shared_ptr<State> state);
+
+  std::shared_ptr<State> m_state;
+  std::shared_future<Result> m_future;
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // __FILE_LOADER_H__
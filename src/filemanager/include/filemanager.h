@@ -2,23 +2,42 @@
 #define __FILE_SYSTEM_H__
 
 #include "input.h"
+#include "fileloader.h"
 
+#include <cstdint>
 #include <filesystem>
 #include <vector>
 #include <string>
 #include <memory>
 #include <optional>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 
 namespace MinimalAudioEngine
 {
 
 // Forward declaration
 class WavFile;
+class WavFileReader;
+class WavWriter;
+class RecordingFile;
 class MidiFile;
+class PcmInputStream;
+class PcmOutputStream;
+struct PcmStreamFormat;
+enum class ePcmPacing;
+class EngineContext;
 
 // Type definitions
 typedef std::shared_ptr<WavFile> WavFilePtr;
+typedef std::unique_ptr<WavFileReader> WavFileReaderPtr;
+typedef std::shared_ptr<WavWriter> WavWriterPtr;
+typedef std::shared_ptr<RecordingFile> RecordingFilePtr;
 typedef std::shared_ptr<MidiFile> MidiFilePtr;
+typedef std::shared_ptr<PcmInputStream> PcmInputStreamPtr;
+typedef std::shared_ptr<PcmOutputStream> PcmOutputStreamPtr;
 
 /** @class File
  *  @brief Base class for various file types 
@@ -63,11 +82,24 @@ enum class PathType
   All,
 };
 
+/** @enum eFileEvent
+ *  @brief File events reported by background resolution.
+ */
+enum class eFileEvent
+{
+  Resolved,
+  Missing,
+};
+
+typedef std::function<void(eFileEvent, const WavFilePtr &)> FileEventCallback;
+
 /** @class FileManager
  *  @brief Singleton class for managing file system operations.
  */
 class FileManager
 {
+  friend class MinimalAudioEngine::EngineContext;
+
 public:
   static FileManager& instance()
   {
@@ -133,13 +165,48 @@ public:
     return path.is_relative() ? std::filesystem::current_path() / path.lexically_normal() : path;
   }
 
-	void save_to_wav_file(std::vector<float> audio_buffer, const std::filesystem::path &path);
+  bool save_to_wav_file(const std::vector<float> &audio_buffer, const std::filesystem::path &path,
+                        unsigned int channels = 2, unsigned int sample_rate = 44100);
   std::optional<WavFilePtr> read_wav_file(const std::filesystem::path &path);
   std::optional<MidiFilePtr> read_midi_file(const std::filesystem::path &path);
+  std::optional<WavWriterPtr> create_wav_file(const std::filesystem::path &path,
+                                              unsigned int channels,
+                                              unsigned int sample_rate,
+                                              int format = 0);
+  std::optional<RecordingFilePtr> create_recording_file(const std::filesystem::path &path,
+                                                        unsigned int channels,
+                                                        unsigned int sample_rate,
+                                                        uint64_t preallocate_bytes = 0,
+                                                        bool direct_io = false);
+  std::optional<PcmInputStreamPtr> open_pcm_input(const std::string &path, const PcmStreamFormat &format);
+  std::optional<PcmOutputStreamPtr> open_pcm_output(const std::string &path, const PcmStreamFormat &format,
+                                                    ePcmPacing pacing);
+
+  WavFilePtr read_wav_file_deferred(const std::filesystem::path &path);
+  std::vector<WavFilePtr> read_wav_files_deferred(const std::vector<std::filesystem::path> &paths,
+                                                  FileEventCallback callback = nullptr);
+  void resolve_wav_files_async(const std::vector<WavFilePtr> &files, FileEventCallback callback = nullptr,
+                               eLoadPriority priority = eLoadPriority::Normal);
+  void wait_for_pending_resolves();
+
+  WavFileLoad load_wav_file_async(const std::filesystem::path &path, eLoadPriority priority = eLoadPriority::Normal);
+  std::vector<WavFileLoad> load_wav_files_async(const std::vector<std::filesystem::path> &paths,
+                                                eLoadPriority priority = eLoadPriority::Normal);
+  void cancel_pending_loads();
+
+  virtual ~FileManager();
 
 private:
-  FileManager() = default;
-  virtual ~FileManager() = default;
+  FileManager();
+
+  void finish_resolve();
+
+  size_t m_pending_resolves = 0;
+  std::mutex m_resolve_mutex;
+  std::condition_variable m_resolve_condition;
+
+  // Declared last so its threads are joined before the state their jobs use is destroyed
+  std::unique_ptr<FileLoader> m_loader;
 
   FileManager(const FileManager&) = delete;
   FileManager& operator=(const FileManager&) = delete;
@@ -0,0 +1,216 @@
+#ifndef __PCM_STREAM_H__
+#define __PCM_STREAM_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "filemanager.h"
+
+namespace MinimalAudioEngine
+{
+
+constexpr const char *PCM_STREAM_STDIO_PATH = "-";        // stdin for inputs, stdout for outputs
+constexpr size_t PCM_STREAM_IO_CHUNK_SIZE = 1 << 16;      // Bytes per read() or write() call
+constexpr size_t PCM_STREAM_BUFFER_SIZE = 1 << 20;        // Bytes buffered between the stream and the engine
+constexpr int PCM_STREAM_PIPE_SIZE = 1 << 20;             // Requested kernel pipe buffer (Linux)
+constexpr int PCM_STREAM_OPEN_TIMEOUT_MS = 5000;          // Longest wait for a reader to open an output FIFO
+
+/** @enum ePcmSampleFormat
+ *  @brief Sample encodings of a raw PCM stream. All are little-endian and interleaved.
+ */
+enum class ePcmSampleFormat
+{
+  Float32,
+  Int16,
+  Int24,
+  Int32,
+};
+
+/** @enum ePcmPacing
+ *  @brief How fast an output stream is fed.
+ */
+enum class ePcmPacing
+{
+  Realtime,   // One block per block duration, like an audio device
+  Freewheel,  // As fast as the consumer accepts data
+};
+
+/** @struct PcmStreamFormat
+ *  @brief Layout of a headerless PCM stream.
+ */
+struct PcmStreamFormat
+{
+  ePcmSampleFormat sample_format = ePcmSampleFormat::Float32;
+  unsigned int channels = 2;
+  unsigned int sample_rate = 44100;
+
+  size_t get_bytes_per_sample() const noexcept
+  {
+    switch (sample_format)
+    {
+      case ePcmSampleFormat::Int16:
+        return 2;
+      case ePcmSampleFormat::Int24:
+        return 3;
+      default:
+        return 4;
+    }
+  }
+
+  size_t get_bytes_per_frame() const noexcept
+  {
+    return get_bytes_per_sample() * channels;
+  }
+
+  std::string to_string() const;
+
+  static std::optional<ePcmSampleFormat> parse_sample_format(const std::string &name);
+};
+
+/** @class PcmInputStream
+ *  @brief Raw PCM read from a pipe, FIFO, file or stdin.
+ *
+ *  A reader thread pulls large chunks from the descriptor straight into a byte ring;
+ *  the audio callback converts whole frames out of the ring without blocking. When the
+ *  producer cannot keep up the callback plays silence and counts an underrun.
+ */
+class PcmInputStream
+{
+  friend class FileManager;
+
+public:
+  ~PcmInputStream();
+
+  PcmInputStream(const PcmInputStream &) = delete;
+  PcmInputStream &operator=(const PcmInputStream &) = delete;
+
+  void start();
+  void close();
+
+  unsigned int read_frames(float *output_buffer, unsigned int frames, unsigned int channels) noexcept;
+
+  inline const PcmStreamFormat &get_format() const noexcept
+  {
+    return m_format;
+  }
+
+  inline std::string get_path() const
+  {
+    return m_path;
+  }
+
+  /** @brief True once the writer closed the stream and every buffered frame was read.
+   */
+  inline bool is_finished() const noexcept
+  {
+    return m_end_of_stream.load(std::memory_order_acquire) &&
+           m_write_position.load(std::memory_order_acquire) - m_read_position.load(std::memory_order_relaxed) <
+             m_format.get_bytes_per_frame();
+  }
+
+  inline uint64_t get_underruns() const noexcept
+  {
+    return m_underruns.load(std::memory_order_relaxed);
+  }
+
+  inline uint64_t get_frames_read() const noexcept
+  {
+    return m_frames_read.load(std::memory_order_relaxed);
+  }
+
+  std::string to_string() const;
+
+private:
+  PcmInputStream(const std::string &path, const PcmStreamFormat &format);
+
+  void run(std::stop_token stop_token);
+
+  std::string m_path;
+  PcmStreamFormat m_format;
+  int m_fd = -1;
+  bool m_owns_fd = false;
+
+  // Byte ring, a whole number of frames long so a frame never wraps
+  std::vector<uint8_t> m_buffer;
+  alignas(64) std::atomic<uint64_t> m_write_position{0};
+  alignas(64) std::atomic<uint64_t> m_read_position{0};
+  std::atomic<bool> m_end_of_stream{false};
+
+  std::atomic<uint64_t> m_underruns{0};
+  std::atomic<uint64_t> m_frames_read{0};
+
+  std::jthread m_thread;
+};
+
+/** @class PcmOutputStream
+ *  @brief Raw PCM written to a pipe, FIFO, file or stdout.
+ *
+ *  Frames are converted into a large buffer that is written in as few calls as possible.
+ *  Realtime streams flush every block to keep latency down; freewheeling streams flush
+ *  when the buffer fills and rely on the consumer for back-pressure.
+ */
+class PcmOutputStream
+{
+  friend class FileManager;
+
+public:
+  ~PcmOutputStream();
+
+  PcmOutputStream(const PcmOutputStream &) = delete;
+  PcmOutputStream &operator=(const PcmOutputStream &) = delete;
+
+  bool write_frames(const float *input_buffer, unsigned int frames, unsigned int channels);
+  bool flush();
+  void close();
+
+  inline const PcmStreamFormat &get_format() const noexcept
+  {
+    return m_format;
+  }
+
+  inline ePcmPacing get_pacing() const noexcept
+  {
+    return m_pacing;
+  }
+
+  inline std::string get_path() const
+  {
+    return m_path;
+  }
+
+  inline bool has_failed() const noexcept
+  {
+    return m_failed.load(std::memory_order_acquire);
+  }
+
+  inline uint64_t get_frames_written() const noexcept
+  {
+    return m_frames_written.load(std::memory_order_relaxed);
+  }
+
+  std::string to_string() const;
+
+private:
+  PcmOutputStream(const std::string &path, const PcmStreamFormat &format, ePcmPacing pacing);
+
+  std::string m_path;
+  PcmStreamFormat m_format;
+  ePcmPacing m_pacing;
+  int m_fd = -1;
+  bool m_owns_fd = false;
+
+  std::vector<uint8_t> m_buffer;
+  size_t m_buffered = 0;
+
+  std::atomic<bool> m_failed{false};
+  std::atomic<uint64_t> m_frames_written{0};
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // __PCM_STREAM_H__
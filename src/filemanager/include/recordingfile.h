@@ -0,0 +1,123 @@
+#ifndef __RECORDING_FILE_H__
+#define __RECORDING_FILE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "filemanager.h"
+#include "broadcastinfo.h"
+
+namespace MinimalAudioEngine
+{
+
+constexpr size_t RECORDING_FILE_ALIGNMENT = 4096;    // Buffer, offset and size alignment for direct I/O
+constexpr size_t RECORDING_FILE_HEADER_SIZE = 4096;  // WAV header padded with a JUNK chunk, so audio starts aligned
+
+/** @class RecordingFile
+ *  @brief 32-bit float WAV file written in large chunks by a recorder's writer thread.
+ *
+ *  Disk space is reserved ahead of the data with fallocate so long recordings do not
+ *  fragment or stall on allocation; the reservation grows in steps as the file fills and
+ *  the unused tail is released on close. With direct I/O the page cache is bypassed, so
+ *  chunks must start in memory aligned to RECORDING_FILE_ALIGNMENT and be a multiple of
+ *  it in size; an unaligned write (the final tail) drops back to buffered I/O.
+ *  The header is written on open and rewritten with the final sizes on close.
+ *
+ *  Files are Broadcast Wave with a "bext" chunk. Room for an RF64 "ds64" chunk is kept
+ *  as a JUNK chunk ahead of "fmt ", so a file that grows past 4 GB is turned into RF64
+ *  by rewriting the header page alone.
+ */
+class RecordingFile
+{
+  friend class FileManager;
+
+public:
+  ~RecordingFile();
+
+  RecordingFile(const RecordingFile &) = delete;
+  RecordingFile &operator=(const RecordingFile &) = delete;
+
+  bool write(const void *data, size_t bytes);
+  bool close();
+
+  /** @brief Set the "bext" contents written with the header on close
+   */
+  inline void set_broadcast_info(const BroadcastInfo &broadcast_info)
+  {
+    m_broadcast_info = broadcast_info;
+  }
+
+  inline const BroadcastInfo &get_broadcast_info() const noexcept
+  {
+    return m_broadcast_info;
+  }
+
+  /** @brief True once the data no longer fits the 32-bit sizes of a plain WAV file
+   */
+  inline bool is_rf64() const noexcept
+  {
+    return RECORDING_FILE_HEADER_SIZE - 8 + m_data_bytes > UINT32_MAX;
+  }
+
+  inline bool is_open() const noexcept
+  {
+    return m_fd >= 0;
+  }
+
+  inline bool is_direct_io() const noexcept
+  {
+    return m_direct_io;
+  }
+
+  inline std::filesystem::path get_filepath() const
+  {
+    return m_filepath;
+  }
+
+  inline unsigned int get_channels() const noexcept
+  {
+    return m_channels;
+  }
+
+  inline unsigned int get_sample_rate() const noexcept
+  {
+    return m_sample_rate;
+  }
+
+  inline uint64_t get_bytes_written() const noexcept
+  {
+    return m_data_bytes;
+  }
+
+  inline uint64_t get_frames_written() const noexcept
+  {
+    return m_data_bytes / (static_cast<uint64_t>(m_channels) * sizeof(float));
+  }
+
+  std::string to_string() const;
+
+private:
+  RecordingFile(const std::filesystem::path &path, unsigned int channels, unsigned int sample_rate,
+                uint64_t preallocate_bytes, bool direct_io);
+
+  bool write_header();
+  void reserve(uint64_t end);
+
+  std::filesystem::path m_filepath;
+  unsigned int m_channels;
+  unsigned int m_sample_rate;
+  int m_fd = -1;
+  bool m_direct_io = false;
+
+  BroadcastInfo m_broadcast_info;
+  uint64_t m_data_bytes = 0;
+  uint64_t m_reserved_bytes = 0;  // File bytes reserved so far, header included
+  uint64_t m_reserve_step;
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // __RECORDING_FILE_H__
@@ -1,19 +1,63 @@
 #ifndef __WAV_FILE_H__
 #define __WAV_FILE_H__
 
+#include <atomic>
 #include <filesystem>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <sndfile.h>
 #include <vector>
 
 #include "filemanager.h"
+#include "broadcastinfo.h"
 
 namespace MinimalAudioEngine
 {
 
+/** @enum eWavFileState
+ *  @brief Resolution state of a WavFile handle.
+ */
+enum class eWavFileState
+{
+  Unresolved,
+  Resolved,
+  Missing,
+};
+
+/** @class WavFileReader
+ *  @brief An independent read handle on a WavFile for positional reads.
+ *  Keeps its own position, so reads that continue where the last one ended need no seek.
+ *  A handle is used by one thread at a time; open one per worker or pool them.
+ */
+class WavFileReader
+{
+friend class WavFile;
+
+public:
+  ~WavFileReader()
+  {
+    sf_close(m_sndfile);
+  }
+
+  sf_count_t read_frames_at(float *buffer, sf_count_t offset, sf_count_t frames_to_read);
+
+  // Disable copy constructor and assignment operator
+  WavFileReader(const WavFileReader &) = delete;
+  WavFileReader &operator=(const WavFileReader &) = delete;
+
+private:
+  explicit WavFileReader(SNDFILE *sndfile): m_sndfile(sndfile) {}
+
+  SNDFILE *m_sndfile;
+  sf_count_t m_position = 0;
+};
+
 /** @class AudioFile
  *  @brief Class for handling audio file operations.
+ *  A WavFile may be created as a placeholder which only opens the underlying
+ *  file on first use (playback, prefetch or header query).
  */
 class WavFile : public File
 {
@@ -22,27 +66,60 @@ friend class FileManager;
 public:
   virtual ~WavFile() = default;
 
+  bool open() const;
+
+  /** @brief Opens the file ahead of playback so the first read does not block.
+   *  @return True if the file is available, false if it is missing or unreadable.
+   */
+  inline bool prefetch() const
+  {
+    return open();
+  }
+
+  inline eWavFileState get_state() const noexcept
+  {
+    return m_state.load(std::memory_order_acquire);
+  }
+
+  inline bool is_resolved() const noexcept
+  {
+    return get_state() == eWavFileState::Resolved;
+  }
+
   unsigned int get_sample_rate() const
   {
+    open();
     return (unsigned int)m_sfinfo.samplerate;
   }
 
   unsigned int get_channels() const
   {
+    open();
     return (unsigned int)m_sfinfo.channels;
   }
 
+  sf_count_t get_frame_count() const
+  {
+    open();
+    return m_sfinfo.frames;
+  }
+
   unsigned int get_format() const
   {
+    open();
     return (unsigned int)m_sfinfo.format;
   }
 
   std::string get_format_string() const
   {
-    switch (m_sfinfo.format & SF_FORMAT_TYPEMASK)
+    switch (get_format() & SF_FORMAT_TYPEMASK)
     {
       case SF_FORMAT_WAV:
         return "WAV";
+      case SF_FORMAT_RF64:
+        return "RF64";
+      case SF_FORMAT_W64:
+        return "W64";
       case SF_FORMAT_AIFF:
         return "AIFF";
       case SF_FORMAT_FLAC:
@@ -52,10 +129,32 @@ public:
     }
   }
 
+  /** @brief Contents of the file's Broadcast Wave "bext" chunk, if it has one
+   */
+  std::optional<BroadcastInfo> get_broadcast_info() const
+  {
+    open();
+    return m_broadcast_info;
+  }
+
   sf_count_t read_frames(std::vector<float>& buffer, sf_count_t frames_to_read);
+  sf_count_t read_frames(float *buffer, sf_count_t frames_to_read);
+  sf_count_t read_frames_at(float *buffer, sf_count_t offset, sf_count_t frames_to_read) const;
+  WavFileReaderPtr open_reader() const;
 
   std::string to_string() const override
   {
+    // Do not force the file open just to print it
+    switch (get_state())
+    {
+      case eWavFileState::Unresolved:
+        return "WavFile(Path=" + m_filepath.string() + ", State=Unresolved)";
+      case eWavFileState::Missing:
+        return "WavFile(Path=" + m_filepath.string() + ", State=Missing)";
+      default:
+        break;
+    }
+
     return "WavFile(Path=" + m_filepath.string() +
            ", Format=" + get_format_string() +
            ", SampleRate=" + std::to_string(get_sample_rate()) +
@@ -63,12 +162,15 @@ public:
   }
 
 private:
-  WavFile(const std::filesystem::path &path);
+  WavFile(const std::filesystem::path &path, bool deferred = false);
 
-  SF_INFO m_sfinfo;
-  std::shared_ptr<SNDFILE> m_sndfile;
+  mutable std::mutex m_open_mutex;
+  mutable std::atomic<eWavFileState> m_state{eWavFileState::Unresolved};
+  mutable SF_INFO m_sfinfo{};
+  mutable std::optional<BroadcastInfo> m_broadcast_info;
+  mutable std::shared_ptr<SNDFILE> m_sndfile;
 };
 
 }  // namespace MinimalAudioEngine
 
-#endif  // __WAV_FILE_H__
\ No newline at end of file
+#endif  // __WAV_FILE_H__
@@ -0,0 +1,79 @@
+#ifndef __WAV_WRITER_H__
+#define __WAV_WRITER_H__
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <sndfile.h>
+
+#include "filemanager.h"
+#include "broadcastinfo.h"
+
+namespace MinimalAudioEngine
+{
+
+constexpr int WAV_WRITER_DEFAULT_FORMAT = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+
+/** @class WavWriter
+ *  @brief Class for writing interleaved float audio to a WAV file.
+ *  WAV files are written as RF64 and downgraded to plain WAV on close if they stay below 4 GB.
+ */
+class WavWriter
+{
+friend class FileManager;
+
+public:
+  ~WavWriter();
+
+  WavWriter(const WavWriter &) = delete;
+  WavWriter &operator=(const WavWriter &) = delete;
+
+  sf_count_t write_frames(const float *buffer, sf_count_t frames);
+  bool set_broadcast_info(const BroadcastInfo &broadcast_info);
+  void close();
+
+  inline bool is_open() const noexcept
+  {
+    return m_sndfile != nullptr;
+  }
+
+  inline std::filesystem::path get_filepath() const
+  {
+    return m_filepath;
+  }
+
+  inline unsigned int get_channels() const noexcept
+  {
+    return (unsigned int)m_sfinfo.channels;
+  }
+
+  inline unsigned int get_sample_rate() const noexcept
+  {
+    return (unsigned int)m_sfinfo.samplerate;
+  }
+
+  inline sf_count_t get_frames_written() const noexcept
+  {
+    return m_frames_written;
+  }
+
+  std::string to_string() const
+  {
+    return "WavWriter(Path=" + m_filepath.string() +
+           ", SampleRate=" + std::to_string(get_sample_rate()) +
+           ", Channels=" + std::to_string(get_channels()) +
+           ", FramesWritten=" + std::to_string(m_frames_written) + ")";
+  }
+
+private:
+  WavWriter(const std::filesystem::path &path, unsigned int channels, unsigned int sample_rate, int format);
+
+  std::filesystem::path m_filepath;
+  SF_INFO m_sfinfo{};
+  SNDFILE *m_sndfile = nullptr;
+  sf_count_t m_frames_written = 0;
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // __WAV_WRITER_H__
@@ -0,0 +1,138 @@
+#include "fileloader.h"
+#include "logger.h"
+
+#include <algorithm>
+
+using namespace MinimalAudioEngine;
+
+/** @brief FileLoader constructor
+ *  @param thread_count Number of I/O threads, started on the first submission.
+ */
+FileLoader::FileLoader(unsigned int thread_count) : m_thread_count(std::max(1u, thread_count))
+{}
+
+/** @brief Cancel queued jobs and join the threads. Jobs already running finish first.
+ */
+FileLoader::~FileLoader()
+{
+  cancel_all();
+
+  for (auto &thread : m_threads)
+  {
+    thread.request_stop();
+  }
+  m_condition.notify_all();
+  m_threads.clear();
+}
+
+/** @brief Queue a job.
+ *  @param priority Higher priorities start first.
+ *  @param job Called on an I/O thread, or with cancelled set by cancel_all().
+ */
+void FileLoader::submit(eLoadPriority priority, Job job)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_threads.empty())
+    {
+      LOG_INFO("FileLoader: Starting ", m_thread_count, " I/O threads.");
+      for (unsigned int i = 0; i < m_thread_count; ++i)
+      {
+        m_threads.emplace_back([this](std::stop_token stop_token) { run(stop_token); });
+      }
+    }
+
+    m_queue.push(QueuedJob{priority, m_next_sequence++, std::move(job)});
+  }
+  m_condition.notify_one();
+}
+
+/** @brief Cancel every job that has not started yet.
+ *  Each is called with cancelled set, on the calling thread.
+ */
+void FileLoader::cancel_all()
+{
+  std::priority_queue<QueuedJob> cancelled;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    cancelled.swap(m_queue);
+  }
+
+  while (!cancelled.empty())
+  {
+    cancelled.top().job(true);
+    cancelled.pop();
+  }
+}
+
+/** @brief Get the number of jobs waiting for a thread
+ */
+size_t FileLoader::get_queued_count() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_queue.size();
+}
+
+/** @brief I/O thread: run jobs in priority order until stopped
+ */
+void FileLoader::run(std::stop_token stop_token)
+{
+  set_thread_name("FileLoader");
+
+  while (true)
+  {
+    QueuedJob queued;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if (!m_condition.wait(lock, stop_token, [this] { return !m_queue.empty(); }))
+      {
+        return;
+      }
+
+      queued = m_queue.top();
+      m_queue.pop();
+    }
+
+    try
+    {
+      queued.job(false);
+    }
+    catch (const std::exception &e)
+    {
+      LOG_ERROR("FileLoader: Job failed: ", e.what());
+    }
+  }
+}
+
+/** @brief Wrap a load's shared state
+ */
+WavFileLoad::WavFileLoad(std::shared_ptr<State> state)
+  : m_state(std::move(state)),
+    m_future(m_state->promise.get_future().share())
+{}
+
+/** @brief Cancel the load if it has not started. The result becomes nullopt right away.
+ *  A load that is already opening the file completes normally.
+ */
+void WavFileLoad::cancel()
+{
+  if (m_state->claim())
+  {
+    m_state->cancelled.store(true, std::memory_order_release);
+    m_state->promise.set_value(std::nullopt);
+  }
+}
+
+/** @brief True if cancel() stopped the load before it opened the file
+ */
+bool WavFileLoad::is_cancelled() const noexcept
+{
+  return m_state->cancelled.load(std::memory_order_acquire);
+}
+
+/** @brief Get the path the load was requested with
+ */
+std::filesystem::path WavFileLoad::get_path() const
+{
+  return m_state->path;
+}
@@ -1,10 +1,30 @@
 #include "filemanager.h"
 #include "wavfile.h"
+#include "wavwriter.h"
+#include "recordingfile.h"
 #include "midifile.h"
+#include "pcmstream.h"
 #include "logger.h"
 
+#include <algorithm>
+#include <atomic>
+
 using namespace MinimalAudioEngine;
 
+/** @brief FileManager constructor. The I/O threads start with the first background load.
+ */
+FileManager::FileManager()
+  : m_loader(std::make_unique<FileLoader>(
+      std::clamp(std::thread::hardware_concurrency(), FILE_LOADER_MIN_THREADS, FILE_LOADER_MAX_THREADS)))
+{}
+
+/** @brief FileManager destructor. Cancels queued loads and waits for running ones.
+ */
+FileManager::~FileManager()
+{
+  m_loader.reset();
+}
+
 /** @brief Lists the contents of a directory.
  *  @param path The path to the directory to list.
  *  @param type The type of contents to list (directories, files, or all).
@@ -90,9 +110,32 @@ std::vector<std::filesystem::path> FileManager::list_midi_files_in_directory(con
   return midi_files;
 }
 
-void FileManager::save_to_wav_file(std::vector<float> audio_buffer, const std::filesystem::path &path)
+/** @brief Writes interleaved audio to a 32-bit float WAV file.
+ *  @param audio_buffer Interleaved samples.
+ *  @param path The path of the file to create. Parent directories are created if needed.
+ *  @param channels Number of interleaved channels.
+ *  @param sample_rate Sample rate of the audio data.
+ *  @return True if every frame was written.
+ */
+bool FileManager::save_to_wav_file(const std::vector<float> &audio_buffer, const std::filesystem::path &path,
+                                   unsigned int channels, unsigned int sample_rate)
 {
+  if (channels == 0 || audio_buffer.size() % channels != 0)
+  {
+    LOG_ERROR("FileManager: Buffer of ", audio_buffer.size(), " samples does not hold whole ", channels, "-channel frames.");
+    return false;
+  }
+
+  auto writer = create_wav_file(path, channels, sample_rate);
+  if (!writer.has_value())
+  {
+    return false;
+  }
 
+  sf_count_t frames = static_cast<sf_count_t>(audio_buffer.size() / channels);
+  bool ok = writer.value()->write_frames(audio_buffer.data(), frames) == frames;
+  writer.value()->close();
+  return ok;
 }
 
 /** @brief Loads audio data from a WAV file.
@@ -116,7 +159,15 @@ std::optional<WavFilePtr> FileManager::read_wav_file(const std::filesystem::path
     return std::nullopt;
   }
 
-  return WavFilePtr(new WavFile(absolute_path));
+  try
+  {
+    return WavFilePtr(new WavFile(absolute_path));
+  }
+  catch (const std::exception &e)
+  {
+    LOG_ERROR("FileManager: ", e.what());
+    return std::nullopt;
+  }
 }
 
 /** @brief Loads audio data from a WAV file.
@@ -136,4 +187,269 @@ std::optional<MidiFilePtr> FileManager::read_midi_file(const std::filesystem::pa
   }
 
   return MidiFilePtr(new MidiFile(absolute_path));
-}
\ No newline at end of file
+}
+
+/** @brief Creates a WAV file for writing.
+ *  @param path The path of the file to create. Parent directories are created if needed.
+ *  @param channels Number of interleaved channels.
+ *  @param sample_rate Sample rate of the audio data.
+ *  @param format libsndfile format flags, or 0 for 32-bit float WAV.
+ *  @return A WavWriter for the new file, or std::nullopt on failure.
+ */
+std::optional<WavWriterPtr> FileManager::create_wav_file(const std::filesystem::path &path,
+                                                         unsigned int channels,
+                                                         unsigned int sample_rate,
+                                                         int format)
+{
+  std::filesystem::path absolute_path = convert_to_absolute(path);
+
+  try
+  {
+    if (absolute_path.has_parent_path())
+    {
+      std::filesystem::create_directories(absolute_path.parent_path());
+    }
+
+    return WavWriterPtr(new WavWriter(absolute_path, channels, sample_rate,
+                                      format != 0 ? format : WAV_WRITER_DEFAULT_FORMAT));
+  }
+  catch (const std::exception &e)
+  {
+    LOG_ERROR("FileManager: ", e.what());
+    return std::nullopt;
+  }
+}
+
+/** @brief Creates a WAV file for long recordings written in large chunks.
+ *  @param path The path of the file to create. Parent directories are created if needed.
+ *  @param channels Number of interleaved channels.
+ *  @param sample_rate Sample rate of the audio data.
+ *  @param preallocate_bytes Disk space to reserve ahead of the data at a time, 0 for none.
+ *  @param direct_io Bypass the page cache where the file system supports it.
+ *  @return The recording file, or std::nullopt on failure.
+ */
+std::optional<RecordingFilePtr> FileManager::create_recording_file(const std::filesystem::path &path,
+                                                                   unsigned int channels,
+                                                                   unsigned int sample_rate,
+                                                                   uint64_t preallocate_bytes,
+                                                                   bool direct_io)
+{
+  std::filesystem::path absolute_path = convert_to_absolute(path);
+
+  try
+  {
+    if (absolute_path.has_parent_path())
+    {
+      std::filesystem::create_directories(absolute_path.parent_path());
+    }
+
+    return RecordingFilePtr(new RecordingFile(absolute_path, channels, sample_rate, preallocate_bytes, direct_io));
+  }
+  catch (const std::exception &e)
+  {
+    LOG_ERROR("FileManager: ", e.what());
+    return std::nullopt;
+  }
+}
+
+/** @brief Opens a raw PCM source.
+ *  @param path File or FIFO path, or "-" for stdin.
+ *  @param format Layout of the incoming samples.
+ *  @return The stream, or nullopt if it cannot be opened. Reading starts with PcmInputStream::start().
+ */
+std::optional<PcmInputStreamPtr> FileManager::open_pcm_input(const std::string &path, const PcmStreamFormat &format)
+{
+  try
+  {
+    return PcmInputStreamPtr(new PcmInputStream(path, format));
+  }
+  catch (const std::exception &e)
+  {
+    LOG_ERROR("FileManager: ", e.what());
+    return std::nullopt;
+  }
+}
+
+/** @brief Opens a raw PCM sink.
+ *  @param path File or FIFO path, or "-" for stdout.
+ *  @param format Layout of the outgoing samples.
+ *  @param pacing Realtime or freewheel.
+ *  @return The stream, or nullopt if it cannot be opened.
+ */
+std::optional<PcmOutputStreamPtr> FileManager::open_pcm_output(const std::string &path, const PcmStreamFormat &format,
+                                                               ePcmPacing pacing)
+{
+  try
+  {
+    return PcmOutputStreamPtr(new PcmOutputStream(path, format, pacing));
+  }
+  catch (const std::exception &e)
+  {
+    LOG_ERROR("FileManager: ", e.what());
+    return std::nullopt;
+  }
+}
+
+/** @brief Creates a placeholder for a WAV file without touching the disk.
+ *  The file is opened on first playback, prefetch or header query.
+ *  @param path The path to the WAV file.
+ *  @return An unresolved WavFile handle.
+ */
+WavFilePtr FileManager::read_wav_file_deferred(const std::filesystem::path &path)
+{
+  // Lexical only - canonicalizing would stat the file
+  return WavFilePtr(new WavFile(convert_to_absolute(path), true));
+}
+
+/** @brief Creates placeholders for a list of WAV files and resolves them in the background.
+ *  Returns immediately; missing files are reported through the callback.
+ *  @param paths The paths to the WAV files.
+ *  @param callback Optional callback invoked from a worker thread as each file is resolved.
+ *  @return Unresolved WavFile handles, in the same order as paths.
+ */
+std::vector<WavFilePtr> FileManager::read_wav_files_deferred(const std::vector<std::filesystem::path> &paths,
+                                                             FileEventCallback callback)
+{
+  std::vector<WavFilePtr> files;
+  files.reserve(paths.size());
+
+  for (const auto &path : paths)
+  {
+    files.push_back(read_wav_file_deferred(path));
+  }
+
+  resolve_wav_files_async(files, callback);
+  return files;
+}
+
+/** @brief Reads the headers of a set of WAV files in parallel on the I/O threads.
+ *  @param files The files to resolve. Already resolved files are reported as soon as a thread picks them up.
+ *  @param callback Optional callback invoked from an I/O thread as each file is resolved.
+ *  @param priority Queue priority relative to other loads.
+ */
+void FileManager::resolve_wav_files_async(const std::vector<WavFilePtr> &files, FileEventCallback callback,
+                                          eLoadPriority priority)
+{
+  if (files.empty())
+  {
+    return;
+  }
+
+  LOG_INFO("FileManager: Resolving ", files.size(), " files in the background.");
+
+  {
+    std::lock_guard<std::mutex> lock(m_resolve_mutex);
+    m_pending_resolves += files.size();
+  }
+
+  for (const auto &file : files)
+  {
+    m_loader->submit(priority, [this, file, callback](bool cancelled)
+    {
+      if (!cancelled)
+      {
+        bool resolved = file->open();
+        if (!resolved)
+        {
+          LOG_WARNING("FileManager: Referenced file is missing: ", file->get_filepath().string());
+        }
+
+        if (callback)
+        {
+          callback(resolved ? eFileEvent::Resolved : eFileEvent::Missing, file);
+        }
+      }
+
+      finish_resolve();
+    });
+  }
+}
+
+/** @brief Blocks until all background resolution has completed or been cancelled.
+ */
+void FileManager::wait_for_pending_resolves()
+{
+  std::unique_lock<std::mutex> lock(m_resolve_mutex);
+  m_resolve_condition.wait(lock, [this] { return m_pending_resolves == 0; });
+}
+
+/** @brief Count a resolve job as done and wake waiters when none are left
+ */
+void FileManager::finish_resolve()
+{
+  std::lock_guard<std::mutex> lock(m_resolve_mutex);
+  if (--m_pending_resolves == 0)
+  {
+    m_resolve_condition.notify_all();
+  }
+}
+
+/** @brief Opens a WAV file on an I/O thread instead of the caller's.
+ *  Canonicalizing, stat and the header read all happen in the background.
+ *  @param path The path to the WAV file.
+ *  @param priority Queue priority relative to other loads.
+ *  @return A handle whose result matches read_wav_file; it can be waited on or cancelled.
+ */
+WavFileLoad FileManager::load_wav_file_async(const std::filesystem::path &path, eLoadPriority priority)
+{
+  auto state = std::make_shared<WavFileLoad::State>();
+  state->path = path;
+  WavFileLoad load(state);
+
+  m_loader->submit(priority, [this, state](bool cancelled)
+  {
+    // cancel() on the handle may have claimed the load first
+    if (!state->claim())
+    {
+      return;
+    }
+
+    if (cancelled)
+    {
+      state->cancelled.store(true, std::memory_order_release);
+      state->promise.set_value(std::nullopt);
+      return;
+    }
+
+    std::optional<WavFilePtr> result;
+    try
+    {
+      result = read_wav_file(state->path);
+    }
+    catch (const std::exception &e)
+    {
+      LOG_ERROR("FileManager: Failed to load ", state->path.string(), ": ", e.what());
+    }
+    state->promise.set_value(std::move(result));
+  });
+
+  return load;
+}
+
+/** @brief Opens a batch of WAV files on the I/O threads. The loads overlap, up to one per thread.
+ *  @param paths The paths to the WAV files.
+ *  @param priority Queue priority relative to other loads.
+ *  @return One handle per path, in the same order.
+ */
+std::vector<WavFileLoad> FileManager::load_wav_files_async(const std::vector<std::filesystem::path> &paths,
+                                                           eLoadPriority priority)
+{
+  std::vector<WavFileLoad> loads;
+  loads.reserve(paths.size());
+
+  for (const auto &path : paths)
+  {
+    loads.push_back(load_wav_file_async(path, priority));
+  }
+
+  LOG_INFO("FileManager: Queued ", paths.size(), " files for loading.");
+  return loads;
+}
+
+/** @brief Cancels every load and resolve that has not started yet.
+ *  Cancelled loads complete with nullopt; cancelled resolves report no event.
+ */
+void FileManager::cancel_pending_loads()
+{
+  m_loader->cancel_all();
+}
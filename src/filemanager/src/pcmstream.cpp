@@ -0,0 +1,514 @@
+#include "pcmstream.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+constexpr int PCM_STREAM_POLL_TIMEOUT_MS = 50;
+
+/** @brief Decode one little-endian sample to a float in [-1, 1]
+ */
+inline float decode_sample(const uint8_t *data, ePcmSampleFormat format) noexcept
+{
+  switch (format)
+  {
+    case ePcmSampleFormat::Int16:
+      return static_cast<float>(static_cast<int16_t>(data[0] | (data[1] << 8))) / 32768.0f;
+    case ePcmSampleFormat::Int24:
+    {
+      int32_t value = static_cast<int32_t>((static_cast<uint32_t>(data[0]) << 8) | (static_cast<uint32_t>(data[1]) << 16) |
+                                           (static_cast<uint32_t>(data[2]) << 24)) >> 8;
+      return static_cast<float>(value) / 8388608.0f;
+    }
+    case ePcmSampleFormat::Int32:
+    {
+      int32_t value = static_cast<int32_t>(data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24));
+      return static_cast<float>(static_cast<double>(value) / 2147483648.0);
+    }
+    default:
+    {
+      uint32_t bits = data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+      float value;
+      std::memcpy(&value, &bits, sizeof(value));
+      return value;
+    }
+  }
+}
+
+/** @brief Encode one sample as little-endian, clipping integer formats
+ */
+inline void encode_sample(float sample, uint8_t *data, ePcmSampleFormat format) noexcept
+{
+  uint32_t bits;
+  switch (format)
+  {
+    case ePcmSampleFormat::Int16:
+      bits = static_cast<uint32_t>(static_cast<int32_t>(std::lrint(std::clamp(sample, -1.0f, 1.0f) * 32767.0f)));
+      data[0] = static_cast<uint8_t>(bits);
+      data[1] = static_cast<uint8_t>(bits >> 8);
+      return;
+    case ePcmSampleFormat::Int24:
+      bits = static_cast<uint32_t>(static_cast<int32_t>(std::lrint(std::clamp(sample, -1.0f, 1.0f) * 8388607.0f)));
+      data[0] = static_cast<uint8_t>(bits);
+      data[1] = static_cast<uint8_t>(bits >> 8);
+      data[2] = static_cast<uint8_t>(bits >> 16);
+      return;
+    case ePcmSampleFormat::Int32:
+      bits = static_cast<uint32_t>(static_cast<int32_t>(std::llrint(std::clamp(static_cast<double>(sample), -1.0, 1.0) * 2147483647.0)));
+      break;
+    default:
+      std::memcpy(&bits, &sample, sizeof(bits));
+      break;
+  }
+
+  data[0] = static_cast<uint8_t>(bits);
+  data[1] = static_cast<uint8_t>(bits >> 8);
+  data[2] = static_cast<uint8_t>(bits >> 16);
+  data[3] = static_cast<uint8_t>(bits >> 24);
+}
+
+const char *sample_format_name(ePcmSampleFormat format)
+{
+  switch (format)
+  {
+    case ePcmSampleFormat::Int16:
+      return "s16le";
+    case ePcmSampleFormat::Int24:
+      return "s24le";
+    case ePcmSampleFormat::Int32:
+      return "s32le";
+    default:
+      return "f32le";
+  }
+}
+
+#ifndef _WIN32
+/** @brief Ask for a larger kernel buffer if the descriptor is a pipe, so bursts need fewer wakeups
+ */
+void enlarge_pipe_buffer(int fd)
+{
+#ifdef F_SETPIPE_SZ
+  struct stat status;
+  if (fstat(fd, &status) == 0 && S_ISFIFO(status.st_mode))
+  {
+    fcntl(fd, F_SETPIPE_SZ, PCM_STREAM_PIPE_SIZE);
+  }
+#else
+  (void)fd;
+#endif
+}
+#endif
+
+}  // namespace
+
+/** @brief Parse a sample format name such as "f32le" or "s16"
+ *  @return The format, or nullopt if the name is unknown.
+ */
+std::optional<ePcmSampleFormat> PcmStreamFormat::parse_sample_format(const std::string &name)
+{
+  std::string base = name.ends_with("le") ? name.substr(0, name.size() - 2) : name;
+  if (base == "f32")
+    return ePcmSampleFormat::Float32;
+  if (base == "s16")
+    return ePcmSampleFormat::Int16;
+  if (base == "s24")
+    return ePcmSampleFormat::Int24;
+  if (base == "s32")
+    return ePcmSampleFormat::Int32;
+  return std::nullopt;
+}
+
+std::string PcmStreamFormat::to_string() const
+{
+  return std::string(sample_format_name(sample_format)) + ", " + std::to_string(channels) + " ch, " +
+         std::to_string(sample_rate) + " Hz";
+}
+
+#ifndef _WIN32
+
+/** @brief Opens a raw PCM source.
+ *  Opening a FIFO does not wait for a writer; the stream stays silent until one connects.
+ *  @param path File or FIFO path, or "-" for stdin.
+ *  @param format Layout of the incoming samples.
+ *  @throws std::runtime_error if the source cannot be opened.
+ */
+PcmInputStream::PcmInputStream(const std::string &path, const PcmStreamFormat &format):
+  m_path(path),
+  m_format(format)
+{
+  if (format.channels == 0)
+  {
+    throw std::runtime_error("PCM stream needs at least one channel: " + path);
+  }
+
+  if (path == PCM_STREAM_STDIO_PATH)
+  {
+    m_fd = STDIN_FILENO;
+  }
+  else
+  {
+    m_fd = ::open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (m_fd < 0)
+    {
+      throw std::runtime_error("Failed to open PCM stream " + path + ": " + std::strerror(errno));
+    }
+    m_owns_fd = true;
+
+    // Reads are gated by poll(), so the descriptor itself can block
+    int flags = fcntl(m_fd, F_GETFL, 0);
+    fcntl(m_fd, F_SETFL, flags & ~O_NONBLOCK);
+    posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  }
+
+  enlarge_pipe_buffer(m_fd);
+
+  size_t frame_bytes = format.get_bytes_per_frame();
+  m_buffer.resize(std::max<size_t>(1, PCM_STREAM_BUFFER_SIZE / frame_bytes) * frame_bytes);
+}
+
+/** @brief Stops the reader thread and closes the descriptor.
+ */
+PcmInputStream::~PcmInputStream()
+{
+  close();
+}
+
+/** @brief Starts the reader thread. Does nothing if it is already running.
+ */
+void PcmInputStream::start()
+{
+  if (m_thread.joinable() || m_fd < 0)
+  {
+    return;
+  }
+
+  m_thread = std::jthread([this](std::stop_token stop_token) { run(stop_token); });
+  LOG_INFO("PcmInputStream: Reading ", to_string());
+}
+
+/** @brief Stops the reader thread and closes the descriptor. Buffered frames can still be read.
+ */
+void PcmInputStream::close()
+{
+  if (m_thread.joinable())
+  {
+    m_thread.request_stop();
+    m_thread.join();
+  }
+
+  if (m_owns_fd && m_fd >= 0)
+  {
+    ::close(m_fd);
+  }
+  m_fd = -1;
+  m_end_of_stream.store(true, std::memory_order_release);
+}
+
+/** @brief Reader thread: fill the ring with large reads until end of stream
+ */
+void PcmInputStream::run(std::stop_token stop_token)
+{
+  const uint64_t capacity = m_buffer.size();
+
+  while (!stop_token.stop_requested())
+  {
+    uint64_t write_position = m_write_position.load(std::memory_order_relaxed);
+    uint64_t free_bytes = capacity - (write_position - m_read_position.load(std::memory_order_acquire));
+    if (free_bytes == 0)
+    {
+      // Full; the engine frees a block's worth every callback
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      continue;
+    }
+
+    pollfd poll_fd{m_fd, POLLIN, 0};
+    int ready = ::poll(&poll_fd, 1, PCM_STREAM_POLL_TIMEOUT_MS);
+    if (ready == 0 || (ready < 0 && errno == EINTR))
+    {
+      continue;
+    }
+
+    size_t offset = static_cast<size_t>(write_position % capacity);
+    size_t chunk = static_cast<size_t>(std::min<uint64_t>({free_bytes, capacity - offset, static_cast<uint64_t>(PCM_STREAM_IO_CHUNK_SIZE)}));
+    ssize_t received = ready < 0 ? -1 : ::read(m_fd, m_buffer.data() + offset, chunk);
+    if (received > 0)
+    {
+      m_write_position.store(write_position + static_cast<uint64_t>(received), std::memory_order_release);
+    }
+    else if (received == 0)
+    {
+      LOG_INFO("PcmInputStream: End of stream on ", m_path);
+      break;
+    }
+    else if (errno != EINTR && errno != EAGAIN)
+    {
+      LOG_ERROR("PcmInputStream: Read failed on ", m_path, ": ", std::strerror(errno));
+      break;
+    }
+  }
+
+  m_end_of_stream.store(true, std::memory_order_release);
+}
+
+/** @brief Converts buffered frames into the output. Called from the audio callback; never blocks.
+ *  @param output_buffer Interleaved output, frames * channels long. Overwritten.
+ *  @param frames Number of frames wanted.
+ *  @param channels Output channels; extra channels are silenced, missing ones dropped.
+ *  @return Frames read; the rest of the buffer is silenced.
+ */
+unsigned int PcmInputStream::read_frames(float *output_buffer, unsigned int frames, unsigned int channels) noexcept
+{
+  const size_t frame_bytes = m_format.get_bytes_per_frame();
+  const size_t sample_bytes = m_format.get_bytes_per_sample();
+  const uint64_t capacity = m_buffer.size();
+  const unsigned int mapped_channels = std::min(channels, m_format.channels);
+
+  uint64_t read_position = m_read_position.load(std::memory_order_relaxed);
+  uint64_t available = (m_write_position.load(std::memory_order_acquire) - read_position) / frame_bytes;
+  unsigned int frames_read = static_cast<unsigned int>(std::min<uint64_t>(frames, available));
+
+  // The ring holds whole frames, so only the frame position wraps
+  size_t offset = static_cast<size_t>(read_position % capacity);
+  for (unsigned int i = 0; i < frames_read; ++i)
+  {
+    const uint8_t *frame = m_buffer.data() + offset;
+    float *out = output_buffer + static_cast<size_t>(i) * channels;
+    for (unsigned int ch = 0; ch < mapped_channels; ++ch)
+    {
+      out[ch] = decode_sample(frame + ch * sample_bytes, m_format.sample_format);
+    }
+    std::fill(out + mapped_channels, out + channels, 0.0f);
+
+    offset += frame_bytes;
+    if (offset == capacity)
+    {
+      offset = 0;
+    }
+  }
+
+  std::fill(output_buffer + static_cast<size_t>(frames_read) * channels,
+            output_buffer + static_cast<size_t>(frames) * channels, 0.0f);
+
+  m_read_position.store(read_position + static_cast<uint64_t>(frames_read) * frame_bytes, std::memory_order_release);
+  m_frames_read.fetch_add(frames_read, std::memory_order_relaxed);
+  if (frames_read < frames && !m_end_of_stream.load(std::memory_order_acquire))
+  {
+    m_underruns.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  return frames_read;
+}
+
+/** @brief Opens a raw PCM sink.
+ *  For stdout, the descriptor is duplicated and stdout is pointed at stderr so that
+ *  log and console output cannot corrupt the audio. Opening a FIFO waits up to
+ *  PCM_STREAM_OPEN_TIMEOUT_MS for a reader, polling instead of blocking in open().
+ *  @param path File or FIFO path, or "-" for stdout. Existing files are truncated.
+ *  @param format Layout of the outgoing samples.
+ *  @param pacing Realtime or freewheel; used by the engine driving the stream.
+ *  @throws std::runtime_error if the sink cannot be opened.
+ */
+PcmOutputStream::PcmOutputStream(const std::string &path, const PcmStreamFormat &format, ePcmPacing pacing):
+  m_path(path),
+  m_format(format),
+  m_pacing(pacing)
+{
+  if (format.channels == 0)
+  {
+    throw std::runtime_error("PCM stream needs at least one channel: " + path);
+  }
+
+  if (path == PCM_STREAM_STDIO_PATH)
+  {
+    std::fflush(stdout);
+    m_fd = ::dup(STDOUT_FILENO);
+    if (m_fd < 0 || ::dup2(STDERR_FILENO, STDOUT_FILENO) < 0)
+    {
+      throw std::runtime_error(std::string("Failed to take over stdout: ") + std::strerror(errno));
+    }
+  }
+  else
+  {
+    // A FIFO without a reader fails with ENXIO instead of blocking until one appears
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(PCM_STREAM_OPEN_TIMEOUT_MS);
+    while ((m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NONBLOCK, 0644)) < 0 &&
+           errno == ENXIO && std::chrono::steady_clock::now() < deadline)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (m_fd < 0)
+    {
+      throw std::runtime_error("Failed to open PCM stream " + path + ": " +
+                               (errno == ENXIO ? std::string("no reader on the FIFO") : std::strerror(errno)));
+    }
+
+    // Writes are paced by the engine, so the descriptor itself can block
+    int flags = fcntl(m_fd, F_GETFL, 0);
+    fcntl(m_fd, F_SETFL, flags & ~O_NONBLOCK);
+  }
+  m_owns_fd = true;
+
+  enlarge_pipe_buffer(m_fd);
+
+  size_t frame_bytes = format.get_bytes_per_frame();
+  m_buffer.resize(std::max<size_t>(1, PCM_STREAM_BUFFER_SIZE / frame_bytes) * frame_bytes);
+}
+
+/** @brief Flushes and closes the stream.
+ */
+PcmOutputStream::~PcmOutputStream()
+{
+  close();
+}
+
+/** @brief Converts frames into the output buffer, writing it out when full.
+ *  Realtime streams are flushed after every call.
+ *  @param input_buffer Interleaved samples, frames * channels long.
+ *  @param frames Number of frames.
+ *  @param channels Channels in the input; extra stream channels are silenced.
+ *  @return False if the stream has failed, e.g. because the reader went away.
+ */
+bool PcmOutputStream::write_frames(const float *input_buffer, unsigned int frames, unsigned int channels)
+{
+  if (m_fd < 0 || has_failed())
+  {
+    return false;
+  }
+
+  const size_t frame_bytes = m_format.get_bytes_per_frame();
+  const size_t sample_bytes = m_format.get_bytes_per_sample();
+  const unsigned int mapped_channels = std::min(channels, m_format.channels);
+
+  for (unsigned int i = 0; i < frames; ++i)
+  {
+    if (m_buffered + frame_bytes > m_buffer.size() && !flush())
+    {
+      return false;
+    }
+
+    uint8_t *frame = m_buffer.data() + m_buffered;
+    const float *in = input_buffer + static_cast<size_t>(i) * channels;
+    for (unsigned int ch = 0; ch < m_format.channels; ++ch)
+    {
+      encode_sample(ch < mapped_channels ? in[ch] : 0.0f, frame + ch * sample_bytes, m_format.sample_format);
+    }
+    m_buffered += frame_bytes;
+  }
+
+  m_frames_written.fetch_add(frames, std::memory_order_relaxed);
+  return m_pacing == ePcmPacing::Realtime ? flush() : true;
+}
+
+/** @brief Writes out everything buffered, blocking until the consumer has taken it.
+ *  @return False if the write failed; the stream is then marked as failed.
+ */
+bool PcmOutputStream::flush()
+{
+  size_t written = 0;
+  while (written < m_buffered && m_fd >= 0)
+  {
+    size_t chunk = std::min(m_buffered - written, PCM_STREAM_IO_CHUNK_SIZE);
+    ssize_t result = ::write(m_fd, m_buffer.data() + written, chunk);
+    if (result < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+
+      LOG_ERROR("PcmOutputStream: Write failed on ", m_path, ": ", std::strerror(errno));
+      m_failed.store(true, std::memory_order_release);
+      m_buffered = 0;
+      return false;
+    }
+    written += static_cast<size_t>(result);
+  }
+
+  m_buffered = 0;
+  return true;
+}
+
+/** @brief Flushes buffered frames and closes the descriptor.
+ */
+void PcmOutputStream::close()
+{
+  if (m_fd < 0)
+  {
+    return;
+  }
+
+  if (!has_failed())
+  {
+    flush();
+  }
+
+  if (m_owns_fd)
+  {
+    ::close(m_fd);
+  }
+  m_fd = -1;
+}
+
+#else
+
+PcmInputStream::PcmInputStream(const std::string &path, const PcmStreamFormat &format):
+  m_path(path),
+  m_format(format)
+{
+  throw std::runtime_error("PCM streams are not supported on this platform");
+}
+
+PcmInputStream::~PcmInputStream() {}
+void PcmInputStream::start() {}
+void PcmInputStream::close() {}
+void PcmInputStream::run(std::stop_token) {}
+unsigned int PcmInputStream::read_frames(float *, unsigned int, unsigned int) noexcept { return 0; }
+
+PcmOutputStream::PcmOutputStream(const std::string &path, const PcmStreamFormat &format, ePcmPacing pacing):
+  m_path(path),
+  m_format(format),
+  m_pacing(pacing)
+{
+  throw std::runtime_error("PCM streams are not supported on this platform");
+}
+
+PcmOutputStream::~PcmOutputStream() {}
+bool PcmOutputStream::write_frames(const float *, unsigned int, unsigned int) { return false; }
+bool PcmOutputStream::flush() { return false; }
+void PcmOutputStream::close() {}
+
+#endif
+
+std::string PcmInputStream::to_string() const
+{
+  return "PcmInputStream(Path=" + m_path +
+         ", Format=" + m_format.to_string() +
+         ", FramesRead=" + std::to_string(get_frames_read()) +
+         ", Underruns=" + std::to_string(get_underruns()) + ")";
+}
+
+std::string PcmOutputStream::to_string() const
+{
+  return "PcmOutputStream(Path=" + m_path +
+         ", Format=" + m_format.to_string() +
+         ", Pacing=" + (m_pacing == ePcmPacing::Realtime ? "Realtime" : "Freewheel") +
+         ", FramesWritten=" + std::to_string(get_frames_written()) + ")";
+}
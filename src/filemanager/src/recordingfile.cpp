@@ -0,0 +1,317 @@
+#include "recordingfile.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+constexpr uint16_t WAVE_FORMAT_IEEE_FLOAT = 3;
+constexpr uint32_t WAV_FMT_CHUNK_SIZE = 16;
+constexpr uint32_t WAV_DS64_CHUNK_SIZE = 28;   // RIFF size, data size, sample count, empty table
+constexpr uint32_t WAV_BEXT_CHUNK_SIZE = 602;  // Version 2 fields, no coding history
+constexpr uint32_t WAV_MAX_CHUNK_SIZE = 0xFFFFFFFF;
+
+inline void put_tag(uint8_t *data, const char *tag) noexcept
+{
+  std::memcpy(data, tag, 4);
+}
+
+inline void put_u16(uint8_t *data, uint16_t value) noexcept
+{
+  data[0] = static_cast<uint8_t>(value);
+  data[1] = static_cast<uint8_t>(value >> 8);
+}
+
+inline void put_u32(uint8_t *data, uint32_t value) noexcept
+{
+  for (int i = 0; i < 4; ++i)
+  {
+    data[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+inline void put_u64(uint8_t *data, uint64_t value) noexcept
+{
+  put_u32(data, static_cast<uint32_t>(value));
+  put_u32(data + 4, static_cast<uint32_t>(value >> 32));
+}
+
+/** @brief Copy text into a fixed-size field, truncated and zero-padded
+ */
+inline void put_text(uint8_t *data, const std::string &text, size_t size) noexcept
+{
+  std::memcpy(data, text.data(), std::min(text.size(), size));
+}
+
+}  // namespace
+
+#ifndef _WIN32
+
+/** @brief Create the file, reserve its first stretch of disk and write a provisional header.
+ *  @param path File to create or truncate.
+ *  @param channels Interleaved channels per frame.
+ *  @param sample_rate Sample rate.
+ *  @param preallocate_bytes Disk space reserved at a time, 0 for none.
+ *  @param direct_io Bypass the page cache if the file system allows it.
+ *  @throws std::runtime_error if the file cannot be created.
+ */
+RecordingFile::RecordingFile(const std::filesystem::path &path, unsigned int channels, unsigned int sample_rate,
+                             uint64_t preallocate_bytes, bool direct_io)
+  : m_filepath(path),
+    m_channels(channels),
+    m_sample_rate(sample_rate),
+    m_reserve_step(preallocate_bytes)
+{
+  if (channels == 0 || sample_rate == 0)
+  {
+    throw std::runtime_error("Invalid recording format for " + path.string());
+  }
+
+  int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+#ifdef O_DIRECT
+  if (direct_io)
+  {
+    m_fd = ::open(path.c_str(), flags | O_DIRECT, 0644);
+    m_direct_io = m_fd >= 0;
+    if (m_fd < 0 && errno == EINVAL)
+    {
+      LOG_WARNING("RecordingFile: Direct I/O is not supported for ", path.string(), ", using buffered writes.");
+    }
+  }
+#endif
+  if (m_fd < 0)
+  {
+    m_fd = ::open(path.c_str(), flags, 0644);
+  }
+  if (m_fd < 0)
+  {
+    throw std::runtime_error("Failed to create recording file " + path.string() + ": " + std::strerror(errno));
+  }
+
+  reserve(RECORDING_FILE_HEADER_SIZE);
+  if (!write_header())
+  {
+    ::close(m_fd);
+    m_fd = -1;
+    throw std::runtime_error("Failed to write recording header to " + path.string());
+  }
+}
+
+/** @brief Append audio data.
+ *  @param data Interleaved float frames; aligned to RECORDING_FILE_ALIGNMENT for direct I/O.
+ *  @param bytes Size in bytes; a multiple of RECORDING_FILE_ALIGNMENT for direct I/O.
+ *  @return False on a write error.
+ */
+bool RecordingFile::write(const void *data, size_t bytes)
+{
+  if (m_fd < 0)
+  {
+    return false;
+  }
+
+#ifdef O_DIRECT
+  if (m_direct_io && (reinterpret_cast<uintptr_t>(data) % RECORDING_FILE_ALIGNMENT != 0 ||
+                      bytes % RECORDING_FILE_ALIGNMENT != 0 || m_data_bytes % RECORDING_FILE_ALIGNMENT != 0))
+  {
+    // Normally only the final tail is unaligned; finish it through the page cache
+    fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) & ~O_DIRECT);
+    m_direct_io = false;
+  }
+#endif
+
+  const uint64_t offset = RECORDING_FILE_HEADER_SIZE + m_data_bytes;
+  reserve(offset + bytes);
+
+  const uint8_t *source = static_cast<const uint8_t *>(data);
+  size_t written = 0;
+  while (written < bytes)
+  {
+    ssize_t result = ::pwrite(m_fd, source + written, bytes - written, static_cast<off_t>(offset + written));
+    if (result < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      LOG_ERROR("RecordingFile: Write failed on ", m_filepath.string(), ": ", std::strerror(errno));
+      return false;
+    }
+    written += static_cast<size_t>(result);
+  }
+
+  m_data_bytes += bytes;
+  return true;
+}
+
+/** @brief Write the final header, release unused reserved space and close the file.
+ *  @return False if the header could not be written.
+ */
+bool RecordingFile::close()
+{
+  if (m_fd < 0)
+  {
+    return true;
+  }
+
+  bool ok = write_header();
+  if (::ftruncate(m_fd, static_cast<off_t>(RECORDING_FILE_HEADER_SIZE + m_data_bytes)) != 0)
+  {
+    LOG_WARNING("RecordingFile: Failed to trim ", m_filepath.string(), ": ", std::strerror(errno));
+  }
+
+  ::close(m_fd);
+  m_fd = -1;
+  LOG_INFO("RecordingFile: Closed ", to_string());
+  return ok;
+}
+
+/** @brief Write the header for the data written so far, as RF64 once the sizes pass 4 GB.
+ *  Layout: RIFF, JUNK or ds64, fmt, bext, JUNK padding, data.
+ */
+bool RecordingFile::write_header()
+{
+  // The header page goes through the same descriptor, so it must be aligned for direct I/O
+  std::unique_ptr<uint8_t, decltype(&std::free)> header(
+    static_cast<uint8_t *>(std::aligned_alloc(RECORDING_FILE_ALIGNMENT, RECORDING_FILE_HEADER_SIZE)), &std::free);
+  if (!header)
+  {
+    return false;
+  }
+
+  uint8_t *data = header.get();
+  std::memset(data, 0, RECORDING_FILE_HEADER_SIZE);
+
+  const uint32_t block_align = m_channels * static_cast<uint32_t>(sizeof(float));
+  const uint64_t riff_size = RECORDING_FILE_HEADER_SIZE - 8 + m_data_bytes;
+  const bool rf64 = is_rf64();
+
+  put_tag(data, rf64 ? "RF64" : "RIFF");
+  put_u32(data + 4, rf64 ? WAV_MAX_CHUNK_SIZE : static_cast<uint32_t>(riff_size));
+  put_tag(data + 8, "WAVE");
+
+  // Same size either way, so the upgrade never moves the audio
+  uint8_t *ds64 = data + 12;
+  put_tag(ds64, rf64 ? "ds64" : "JUNK");
+  put_u32(ds64 + 4, WAV_DS64_CHUNK_SIZE);
+  if (rf64)
+  {
+    put_u64(ds64 + 8, riff_size);
+    put_u64(ds64 + 16, m_data_bytes);
+    put_u64(ds64 + 24, get_frames_written());
+  }
+
+  uint8_t *fmt = ds64 + 8 + WAV_DS64_CHUNK_SIZE;
+  put_tag(fmt, "fmt ");
+  put_u32(fmt + 4, WAV_FMT_CHUNK_SIZE);
+  put_u16(fmt + 8, WAVE_FORMAT_IEEE_FLOAT);
+  put_u16(fmt + 10, static_cast<uint16_t>(m_channels));
+  put_u32(fmt + 12, m_sample_rate);
+  put_u32(fmt + 16, m_sample_rate * block_align);
+  put_u16(fmt + 20, static_cast<uint16_t>(block_align));
+  put_u16(fmt + 22, 32);
+
+  uint8_t *bext = fmt + 8 + WAV_FMT_CHUNK_SIZE;
+  put_tag(bext, "bext");
+  put_u32(bext + 4, WAV_BEXT_CHUNK_SIZE);
+  put_text(bext + 8, m_broadcast_info.description, 256);
+  put_text(bext + 264, m_broadcast_info.originator, 32);
+  put_text(bext + 296, m_broadcast_info.originator_reference, 32);
+  put_text(bext + 328, m_broadcast_info.origination_date, 10);
+  put_text(bext + 338, m_broadcast_info.origination_time, 8);
+  put_u64(bext + 346, m_broadcast_info.time_reference);
+  put_u16(bext + 354, 2);  // Version, with loudness fields left at zero
+
+  uint8_t *junk = bext + 8 + WAV_BEXT_CHUNK_SIZE;
+  const uint32_t junk_size = static_cast<uint32_t>(data + RECORDING_FILE_HEADER_SIZE - 8 - (junk + 8));
+  put_tag(junk, "JUNK");
+  put_u32(junk + 4, junk_size);
+
+  uint8_t *chunk = junk + 8 + junk_size;
+  put_tag(chunk, "data");
+  put_u32(chunk + 4, rf64 ? WAV_MAX_CHUNK_SIZE : static_cast<uint32_t>(m_data_bytes));
+
+  size_t written = 0;
+  while (written < RECORDING_FILE_HEADER_SIZE)
+  {
+    ssize_t result = ::pwrite(m_fd, data + written, RECORDING_FILE_HEADER_SIZE - written, static_cast<off_t>(written));
+    if (result < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (result < 0)
+    {
+      LOG_ERROR("RecordingFile: Header write failed on ", m_filepath.string(), ": ", std::strerror(errno));
+      return false;
+    }
+    written += static_cast<size_t>(result);
+  }
+  return true;
+}
+
+/** @brief Make sure disk space is reserved up to a file offset, a whole step at a time.
+ *  Reservation is best effort; a file system without fallocate just allocates as it writes.
+ */
+void RecordingFile::reserve(uint64_t end)
+{
+  if (m_reserve_step == 0 || end <= m_reserved_bytes)
+  {
+    return;
+  }
+
+  uint64_t target = std::max(end, m_reserved_bytes + m_reserve_step);
+#ifdef __linux__
+  // Keep the size so readers and the final header only ever see written data
+  if (::fallocate(m_fd, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(m_reserved_bytes),
+                  static_cast<off_t>(target - m_reserved_bytes)) != 0)
+  {
+    LOG_WARNING("RecordingFile: Cannot reserve space for ", m_filepath.string(), ": ", std::strerror(errno));
+    m_reserve_step = 0;
+    return;
+  }
+#endif
+  m_reserved_bytes = target;
+}
+
+#else
+
+RecordingFile::RecordingFile(const std::filesystem::path &path, unsigned int channels, unsigned int sample_rate,
+                             uint64_t preallocate_bytes, bool)
+  : m_filepath(path), m_channels(channels), m_sample_rate(sample_rate), m_reserve_step(preallocate_bytes)
+{
+  throw std::runtime_error("Recording files are not supported on this platform");
+}
+
+bool RecordingFile::write(const void *, size_t) { return false; }
+bool RecordingFile::close() { return true; }
+bool RecordingFile::write_header() { return false; }
+void RecordingFile::reserve(uint64_t) {}
+
+#endif
+
+/** @brief Close the file if it is still open
+ */
+RecordingFile::~RecordingFile()
+{
+  close();
+}
+
+std::string RecordingFile::to_string() const
+{
+  return "RecordingFile(Path=" + m_filepath.string() +
+         ", SampleRate=" + std::to_string(m_sample_rate) +
+         ", Channels=" + std::to_string(m_channels) +
+         ", FramesWritten=" + std::to_string(get_frames_written()) +
+         ", DirectIO=" + (m_direct_io ? "Yes" : "No") + ")";
+}
@@ -1,30 +1,191 @@
 #include "wavfile.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 
 using namespace MinimalAudioEngine;
 
-/** @brief Constructs an AudioFile object and opens the specified WAV file.
+namespace
+{
+
+/** @brief Text of a fixed-size bext field, which is not terminated when full
+ */
+template <size_t N>
+std::string field_text(const char (&field)[N])
+{
+  return std::string(field, strnlen(field, N));
+}
+
+BroadcastInfo read_broadcast_info(const SF_BROADCAST_INFO &bext)
+{
+  BroadcastInfo info;
+  info.description = field_text(bext.description);
+  info.originator = field_text(bext.originator);
+  info.originator_reference = field_text(bext.originator_reference);
+  info.origination_date = field_text(bext.origination_date);
+  info.origination_time = field_text(bext.origination_time);
+  info.time_reference = (static_cast<uint64_t>(bext.time_reference_high) << 32) | bext.time_reference_low;
+  return info;
+}
+
+}  // namespace
+
+/** @brief Constructs an AudioFile object for the specified WAV file.
  *  @param path The path to the WAV file to open.
- *  @throws std::runtime_error if the file cannot be opened.
+ *  @param deferred If true, the file is left unopened until first use.
+ *  @throws std::runtime_error if the file cannot be opened and deferred is false.
  */
-WavFile::WavFile(const std::filesystem::path &path):
+WavFile::WavFile(const std::filesystem::path &path, bool deferred):
   File(path, eInputType::AudioFile)
 {
-  m_sndfile = std::shared_ptr<SNDFILE>(
-      sf_open(path.string().c_str(), SFM_READ, &m_sfinfo),
+  if (deferred)
+  {
+    return;
+  }
+
+  if (!open())
+  {
+    throw std::runtime_error("Failed to open WAV file: " + path.string());
+  }
+}
+
+/** @brief Opens the underlying file and reads its header, if not already done.
+ *  Safe to call from multiple threads; only the first caller touches the disk.
+ *  @return True if the file is open, false if it is missing or unreadable.
+ */
+bool WavFile::open() const
+{
+  eWavFileState state = m_state.load(std::memory_order_acquire);
+  if (state != eWavFileState::Unresolved)
+  {
+    return state == eWavFileState::Resolved;
+  }
+
+  std::lock_guard<std::mutex> lock(m_open_mutex);
+
+  // Another thread may have resolved the file while we waited
+  state = m_state.load(std::memory_order_acquire);
+  if (state != eWavFileState::Unresolved)
+  {
+    return state == eWavFileState::Resolved;
+  }
+
+  SF_INFO sfinfo{};
+  std::shared_ptr<SNDFILE> sndfile(
+      sf_open(m_filepath.string().c_str(), SFM_READ, &sfinfo),
       [](SNDFILE *f)
       { if (f) sf_close(f); });
 
-  if (!m_sndfile)
+  if (!sndfile)
   {
-    throw std::runtime_error("Failed to open WAV file: " + path.string());
+    LOG_WARNING("WavFile: Failed to open ", m_filepath.string());
+    m_state.store(eWavFileState::Missing, std::memory_order_release);
+    return false;
+  }
+
+  // RF64 and W64 files report their 64-bit frame counts through the same SF_INFO
+  SF_BROADCAST_INFO bext{};
+  if (sf_command(sndfile.get(), SFC_GET_BROADCAST_INFO, &bext, sizeof(bext)) == SF_TRUE)
+  {
+    m_broadcast_info = read_broadcast_info(bext);
   }
+
+  m_sfinfo = sfinfo;
+  m_sndfile = std::move(sndfile);
+  m_state.store(eWavFileState::Resolved, std::memory_order_release);
+  return true;
 }
 
 sf_count_t WavFile::read_frames(std::vector<float> &buffer, sf_count_t frames_to_read)
 {
-  if (m_sndfile)
+  if (open())
   {
     return sf_readf_float(m_sndfile.get(), const_cast<float *>(buffer.data()), frames_to_read);
   }
   return 0;
-}
\ No newline at end of file
+}
+
+/** @brief Reads frames at the streaming position into a caller-owned buffer.
+ *  Does not allocate, so it may be called from the audio callback once the file is open.
+ *  @param buffer Destination for interleaved samples, frames_to_read * channels long.
+ *  @param frames_to_read Number of frames to read.
+ *  @return The number of frames read.
+ */
+sf_count_t WavFile::read_frames(float *buffer, sf_count_t frames_to_read)
+{
+  if (buffer != nullptr && open())
+  {
+    return sf_readf_float(m_sndfile.get(), buffer, frames_to_read);
+  }
+  return 0;
+}
+
+/** @brief Reads frames from an absolute position using an independent file handle.
+ *  Does not disturb the streaming position used by read_frames, so several
+ *  threads may read different regions of the same file concurrently.
+ *  Opens a handle for this one read; use open_reader() for repeated reads.
+ *  @param buffer Destination for interleaved samples, frames_to_read * channels long.
+ *  @param offset Frame position to start reading from.
+ *  @param frames_to_read Number of frames to read.
+ *  @return The number of frames read.
+ */
+sf_count_t WavFile::read_frames_at(float *buffer, sf_count_t offset, sf_count_t frames_to_read) const
+{
+  if (buffer == nullptr)
+  {
+    return 0;
+  }
+
+  WavFileReaderPtr reader = open_reader();
+  return reader ? reader->read_frames_at(buffer, offset, frames_to_read) : 0;
+}
+
+/** @brief Opens an independent handle for positional reads.
+ *  @return The handle, or nullptr if the file is missing or cannot be opened.
+ */
+WavFileReaderPtr WavFile::open_reader() const
+{
+  if (!open())
+  {
+    return nullptr;
+  }
+
+  SF_INFO sfinfo{};
+  SNDFILE *sndfile = sf_open(m_filepath.string().c_str(), SFM_READ, &sfinfo);
+  if (sndfile == nullptr)
+  {
+    LOG_ERROR("WavFile: Failed to open ", m_filepath.string(), " for positional read");
+    return nullptr;
+  }
+
+  return WavFileReaderPtr(new WavFileReader(sndfile));
+}
+
+/** @brief Reads frames from an absolute position, seeking only if the last read ended elsewhere.
+ *  @param buffer Destination for interleaved samples, frames_to_read * channels long.
+ *  @param offset Frame position to start reading from.
+ *  @param frames_to_read Number of frames to read.
+ *  @return The number of frames read.
+ */
+sf_count_t WavFileReader::read_frames_at(float *buffer, sf_count_t offset, sf_count_t frames_to_read)
+{
+  if (buffer == nullptr)
+  {
+    return 0;
+  }
+
+  if (offset != m_position)
+  {
+    if (sf_seek(m_sndfile, offset, SEEK_SET) < 0)
+    {
+      return 0;
+    }
+    m_position = offset;
+  }
+
+  sf_count_t read = sf_readf_float(m_sndfile, buffer, frames_to_read);
+  m_position += std::max<sf_count_t>(read, 0);
+  return read;
+}
@@ -0,0 +1,114 @@
+#include "wavwriter.h"
+#include "logger.h"
+
+#include <cstring>
+#include <stdexcept>
+
+using namespace MinimalAudioEngine;
+
+/** @brief Constructs a WavWriter and creates the specified file.
+ *  @param path The path of the file to create. An existing file is overwritten.
+ *  @param channels Number of interleaved channels.
+ *  @param sample_rate Sample rate of the audio data.
+ *  @param format libsndfile major/minor format flags.
+ *  @throws std::runtime_error if the file cannot be created.
+ */
+WavWriter::WavWriter(const std::filesystem::path &path, unsigned int channels, unsigned int sample_rate, int format):
+  m_filepath(path)
+{
+  m_sfinfo.channels = static_cast<int>(channels);
+  m_sfinfo.samplerate = static_cast<int>(sample_rate);
+  m_sfinfo.format = format;
+
+  // Write WAV as RF64 so the file can outgrow 4 GB; small files are downgraded on close
+  const bool rf64 = (format & SF_FORMAT_TYPEMASK) == SF_FORMAT_WAV;
+  if (rf64)
+  {
+    m_sfinfo.format = (format & ~SF_FORMAT_TYPEMASK) | SF_FORMAT_RF64;
+  }
+
+  if (!sf_format_check(&m_sfinfo))
+  {
+    throw std::runtime_error("Invalid WAV format for file: " + path.string());
+  }
+
+  m_sndfile = sf_open(path.string().c_str(), SFM_WRITE, &m_sfinfo);
+  if (m_sndfile == nullptr)
+  {
+    throw std::runtime_error("Failed to create WAV file: " + path.string() + " (" + sf_strerror(nullptr) + ")");
+  }
+
+  if (rf64)
+  {
+    sf_command(m_sndfile, SFC_RF64_AUTO_DOWNGRADE, nullptr, SF_TRUE);
+  }
+}
+
+/** @brief Destructor. Finalizes the file header if still open.
+ */
+WavWriter::~WavWriter()
+{
+  close();
+}
+
+/** @brief Appends interleaved frames to the file.
+ *  @param buffer Interleaved samples, frames * channels long.
+ *  @param frames Number of frames to write.
+ *  @return The number of frames written.
+ */
+sf_count_t WavWriter::write_frames(const float *buffer, sf_count_t frames)
+{
+  if (m_sndfile == nullptr || buffer == nullptr || frames <= 0)
+  {
+    return 0;
+  }
+
+  sf_count_t written = sf_writef_float(m_sndfile, buffer, frames);
+  if (written != frames)
+  {
+    LOG_ERROR("WavWriter: Short write to ", m_filepath.string(), ": ", sf_strerror(m_sndfile));
+  }
+
+  m_frames_written += written;
+  return written;
+}
+
+/** @brief Adds a Broadcast Wave "bext" chunk. Must be called before the first frame is written.
+ *  @param broadcast_info Chunk contents.
+ *  @return False if the file is not open, frames were already written or the format has no bext chunk.
+ */
+bool WavWriter::set_broadcast_info(const BroadcastInfo &broadcast_info)
+{
+  if (m_sndfile == nullptr || m_frames_written > 0)
+  {
+    return false;
+  }
+
+  SF_BROADCAST_INFO info{};
+  std::strncpy(info.description, broadcast_info.description.c_str(), sizeof(info.description));
+  std::strncpy(info.originator, broadcast_info.originator.c_str(), sizeof(info.originator));
+  std::strncpy(info.originator_reference, broadcast_info.originator_reference.c_str(), sizeof(info.originator_reference));
+  std::strncpy(info.origination_date, broadcast_info.origination_date.c_str(), sizeof(info.origination_date));
+  std::strncpy(info.origination_time, broadcast_info.origination_time.c_str(), sizeof(info.origination_time));
+  info.time_reference_low = static_cast<uint32_t>(broadcast_info.time_reference);
+  info.time_reference_high = static_cast<uint32_t>(broadcast_info.time_reference >> 32);
+  info.version = 2;
+
+  if (sf_command(m_sndfile, SFC_SET_BROADCAST_INFO, &info, sizeof(info)) != SF_TRUE)
+  {
+    LOG_WARNING("WavWriter: Cannot add broadcast info to ", m_filepath.string());
+    return false;
+  }
+  return true;
+}
+
+/** @brief Closes the file, writing the final header.
+ */
+void WavWriter::close()
+{
+  if (m_sndfile != nullptr)
+  {
+    sf_close(m_sndfile);
+    m_sndfile = nullptr;
+  }
+}
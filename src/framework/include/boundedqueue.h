@@ -0,0 +1,98 @@
+#ifndef __BOUNDED_QUEUE_H_
+#define __BOUNDED_QUEUE_H_
+
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+#include <optional>
+
+namespace MinimalAudioEngine
+{
+
+/** @class BoundedQueue
+ *  @brief A thread-safe FIFO with a fixed capacity, for pipelines between worker threads.
+ *  Producers block while the queue is full, which bounds the memory held in flight.
+ */
+template <typename T>
+class BoundedQueue
+{
+public:
+  explicit BoundedQueue(size_t capacity) : m_capacity(capacity > 0 ? capacity : 1) {}
+
+  /** @brief Push an item onto the queue, blocking while the queue is full.
+   *  @param item The item to be added to the queue.
+   *  @return False if the queue was closed and the item was not added.
+   */
+  bool push(T item)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_not_full.wait(lock, [this] { return m_closed || m_queue.size() < m_capacity; });
+
+    if (m_closed)
+    {
+      return false;
+    }
+
+    m_queue.push(std::move(item));
+    m_not_empty.notify_one();
+    return true;
+  }
+
+  /** @brief Pop an item from the queue, blocking until one is available.
+   *  @return The item at the front of the queue, or std::nullopt once the queue
+   *  is closed and drained.
+   */
+  std::optional<T> pop()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_not_empty.wait(lock, [this] { return m_closed || !m_queue.empty(); });
+
+    if (m_queue.empty())
+    {
+      return std::nullopt;
+    }
+
+    T item = std::move(m_queue.front());
+    m_queue.pop();
+    m_not_full.notify_one();
+    return item;
+  }
+
+  /** @brief Close the queue.
+   *  Blocked producers return false; consumers drain the remaining items and
+   *  then receive std::nullopt.
+   */
+  void close()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_closed = true;
+    }
+
+    m_not_empty.notify_all();
+    m_not_full.notify_all();
+  }
+
+  size_t size() const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queue.size();
+  }
+
+  size_t capacity() const noexcept
+  {
+    return m_capacity;
+  }
+
+private:
+  std::queue<T> m_queue;
+  const size_t m_capacity;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_not_empty;
+  std::condition_variable m_not_full;
+  bool m_closed = false;
+};
+
+} // namespace MinimalAudioEngine
+
+#endif  // __BOUNDED_QUEUE_H_
@@ -28,12 +28,13 @@ public:
     if (m_running.load(std::memory_order_acquire))
       return;
 
+    m_ready.store(false, std::memory_order_release);
     m_running.store(true, std::memory_order_release);
     m_thread = std::jthread(&IEngine::_run, this);
 
     // Block until the thread signals it's ready
     auto start_time = std::chrono::steady_clock::now();
-    while (!m_running.load(std::memory_order_acquire))
+    while (!m_ready.load(std::memory_order_acquire))
     {
       if (std::chrono::steady_clock::now() - start_time > std::chrono::seconds(5))
       {
@@ -50,6 +51,12 @@ public:
       return;
     m_running.store(false, std::memory_order_release);
     m_message_queue.stop();
+
+    // Join here rather than in ~IEngine, which runs after the derived members are gone
+    if (m_thread.joinable() && m_thread.get_id() != std::this_thread::get_id())
+    {
+      m_thread.join();
+    }
   }
 
   void push_message(const T& msg) { m_message_queue.push(msg); }
@@ -72,8 +79,9 @@ protected:
       set_thread_name(m_thread_name);
     }
 
-    // Signal that the thread is ready
-    m_running.store(true, std::memory_order_release);
+    // Signal that the thread is ready. m_running was set by start_thread, and may already
+    // have been cleared by a stop_thread that got here first.
+    m_ready.store(true, std::memory_order_release);
 
     LOG_INFO("Thread Started");
 
@@ -90,6 +98,7 @@ private:
   MessageQueue<T> m_message_queue;
   std::jthread m_thread;
   std::atomic<bool> m_running{false};
+  std::atomic<bool> m_ready{false};
   std::mutex m_mutex;
 };
 
@@ -0,0 +1,138 @@
+#ifndef __LATENCY_HISTOGRAM_H_
+#define __LATENCY_HISTOGRAM_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace MinimalAudioEngine
+{
+
+// Bucket i counts latencies in [2^i, 2^(i+1)) microseconds, bucket 0 from zero and the last one without a limit
+constexpr size_t LATENCY_HISTOGRAM_BUCKETS = 24;
+
+/** @brief Steady clock time in nanoseconds, as stored with timestamped commands
+ */
+inline int64_t latency_timestamp_ns() noexcept
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/** @struct LatencyHistogramSnapshot
+ *  @brief A copy of a LatencyHistogram's counters.
+ */
+struct LatencyHistogramSnapshot
+{
+  std::array<uint64_t, LATENCY_HISTOGRAM_BUCKETS> buckets{};
+  uint64_t count = 0;
+  uint64_t total_us = 0;
+  uint64_t max_us = 0;
+
+  /** @brief Upper bound of bucket i in microseconds
+   */
+  static constexpr uint64_t bucket_limit_us(size_t i) noexcept
+  {
+    return uint64_t{2} << i;
+  }
+
+  inline double get_mean_us() const noexcept
+  {
+    return count == 0 ? 0.0 : static_cast<double>(total_us) / static_cast<double>(count);
+  }
+
+  /** @brief Upper bound of the bucket holding the given fraction of samples, capped at the maximum
+   *  @param fraction 0.5 for the median, 0.99 for the 99th percentile
+   */
+  uint64_t get_percentile_us(double fraction) const noexcept
+  {
+    if (count == 0)
+      return 0;
+
+    uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * static_cast<double>(count) + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; ++i)
+    {
+      seen += buckets[i];
+      if (seen >= target)
+        return i + 1 < LATENCY_HISTOGRAM_BUCKETS ? std::min(bucket_limit_us(i), max_us) : max_us;
+    }
+    return max_us;
+  }
+
+  std::string to_string() const
+  {
+    return "LatencyHistogram(Count=" + std::to_string(count) +
+           ", Mean=" + std::to_string(static_cast<uint64_t>(get_mean_us())) + "us" +
+           ", P50<=" + std::to_string(get_percentile_us(0.5)) + "us" +
+           ", P99<=" + std::to_string(get_percentile_us(0.99)) + "us" +
+           ", Max=" + std::to_string(max_us) + "us)";
+  }
+};
+
+/** @class LatencyHistogram
+ *  @brief Log2-bucketed latency counters.
+ *  record() only does relaxed atomic updates, so the audio callback can call it.
+ *  Readers may see a sample in count before its bucket; snapshots are for monitoring.
+ */
+class LatencyHistogram
+{
+public:
+  void record(std::chrono::nanoseconds latency) noexcept
+  {
+    uint64_t us = latency.count() > 0 ? static_cast<uint64_t>(latency.count()) / 1000 : 0;
+
+    size_t bucket = 0;
+    while (bucket + 1 < LATENCY_HISTOGRAM_BUCKETS && us >= LatencyHistogramSnapshot::bucket_limit_us(bucket))
+    {
+      ++bucket;
+    }
+
+    m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_total_us.fetch_add(us, std::memory_order_relaxed);
+
+    uint64_t max = m_max_us.load(std::memory_order_relaxed);
+    while (us > max && !m_max_us.compare_exchange_weak(max, us, std::memory_order_relaxed))
+    {
+    }
+  }
+
+  LatencyHistogramSnapshot snapshot() const noexcept
+  {
+    LatencyHistogramSnapshot snapshot;
+    for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; ++i)
+    {
+      snapshot.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+    }
+    snapshot.count = m_count.load(std::memory_order_relaxed);
+    snapshot.total_us = m_total_us.load(std::memory_order_relaxed);
+    snapshot.max_us = m_max_us.load(std::memory_order_relaxed);
+    return snapshot;
+  }
+
+  void reset() noexcept
+  {
+    for (auto &bucket : m_buckets)
+    {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_total_us.store(0, std::memory_order_relaxed);
+    m_max_us.store(0, std::memory_order_relaxed);
+  }
+
+private:
+  std::array<std::atomic<uint64_t>, LATENCY_HISTOGRAM_BUCKETS> m_buckets{};
+  std::atomic<uint64_t> m_count{0};
+  std::atomic<uint64_t> m_total_us{0};
+  std::atomic<uint64_t> m_max_us{0};
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // __LATENCY_HISTOGRAM_H_
@@ -0,0 +1,109 @@
+#ifndef __PARAMETER_REGISTRY_H_
+#define __PARAMETER_REGISTRY_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ringbuffer.h"
+
+namespace MinimalAudioEngine
+{
+
+typedef uint32_t ParameterId;
+
+constexpr size_t PARAMETER_MAX_PARAMETERS = 256;
+constexpr ParameterId PARAMETER_NO_ID = UINT32_MAX;
+constexpr float PARAMETER_DEFAULT_SMOOTHING_MS = 10.0f;
+
+/** @struct ParameterInfo
+ *  @brief Describes a parameter when it is registered.
+ */
+struct ParameterInfo
+{
+  std::string name;
+  float minimum = 0.0f;
+  float maximum = 1.0f;
+  float default_value = 0.0f;
+  float smoothing_ms = PARAMETER_DEFAULT_SMOOTHING_MS;  // Time constant of the glide to a new value, 0 for none
+
+  std::string to_string() const
+  {
+    return "Parameter(Name=" + name +
+           ", Min=" + std::to_string(minimum) +
+           ", Max=" + std::to_string(maximum) +
+           ", Default=" + std::to_string(default_value) +
+           ", SmoothingMs=" + std::to_string(smoothing_ms) + ")";
+  }
+};
+
+/** @class ParameterRegistry
+ *  @brief Global registry of the parameters that can be controlled remotely, e.g. from MIDI.
+ *
+ *  Parameters get dense ids in registration order and are never removed, so an id can be
+ *  stored anywhere and used as a plain index. Each parameter lives in its own cache line:
+ *  any thread sets its target without locking, and the audio callback of the one consumer
+ *  that owns it glides towards the target with advance(). Only registration and name
+ *  lookups take the mutex.
+ */
+class ParameterRegistry
+{
+public:
+  static ParameterRegistry &instance()
+  {
+    static ParameterRegistry instance;
+    return instance;
+  }
+
+  std::optional<ParameterId> register_parameter(const ParameterInfo &info);
+  std::optional<ParameterId> find_parameter(const std::string &name) const;
+  std::optional<ParameterInfo> get_info(ParameterId id) const;
+  std::vector<ParameterInfo> get_parameters() const;
+
+  /** @brief Number of registered parameters; ids run from 0 to one less than this
+   */
+  size_t get_parameter_count() const noexcept { return m_count.load(std::memory_order_acquire); }
+
+  bool set_value(ParameterId id, float value) noexcept;
+  bool set_normalized(ParameterId id, float normalized) noexcept;
+  float get_value(ParameterId id) const noexcept;
+  float get_smoothed_value(ParameterId id) const noexcept;
+  float advance(ParameterId id, unsigned int frames, unsigned int sample_rate) noexcept;
+
+  std::string to_string() const;
+
+  // Disable copy constructor and assignment operator
+  ParameterRegistry(const ParameterRegistry &) = delete;
+  ParameterRegistry &operator=(const ParameterRegistry &) = delete;
+
+private:
+  ParameterRegistry() = default;
+
+  /** @struct Slot
+   *  @brief A parameter as the real-time side sees it. The range is written before the id is published.
+   */
+  struct alignas(CACHE_LINE_SIZE) Slot
+  {
+    std::atomic<float> target{0.0f};
+    std::atomic<float> current{0.0f};  // Written by advance() only
+    float minimum = 0.0f;
+    float maximum = 1.0f;
+    float smoothing_ms = 0.0f;
+  };
+
+  std::array<Slot, PARAMETER_MAX_PARAMETERS> m_slots;
+  std::atomic<size_t> m_count{0};
+
+  // Registration and lookups by name
+  std::vector<ParameterInfo> m_infos;
+  mutable std::mutex m_mutex;
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // __PARAMETER_REGISTRY_H_
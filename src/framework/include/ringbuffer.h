@@ -0,0 +1,102 @@
+#ifndef __RING_BUFFER_H_
+#define __RING_BUFFER_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace MinimalAudioEngine
+{
+
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+/** @class SpscRingBuffer
+ *  @brief A wait-free single-producer, single-consumer FIFO with a fixed capacity.
+ *  Neither side allocates or locks, so it can hand data to or from the audio callback.
+ *  Exactly one thread may push and exactly one thread may pop.
+ */
+template <typename T, size_t Capacity>
+class SpscRingBuffer
+{
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+  /** @brief Push an item. Producer thread only.
+   *  @param item The item to be added.
+   *  @return False if the buffer is full.
+   */
+  bool try_push(const T &item) noexcept
+  {
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_cached_head == Capacity)
+    {
+      m_cached_head = m_head.load(std::memory_order_acquire);
+      if (tail - m_cached_head == Capacity)
+        return false;
+    }
+
+    m_buffer[tail & (Capacity - 1)] = item;
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /** @brief Pop the oldest item. Consumer thread only.
+   *  @param item Receives the item.
+   *  @return False if the buffer is empty.
+   */
+  bool try_pop(T &item) noexcept
+  {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    if (head == m_cached_tail)
+    {
+      m_cached_tail = m_tail.load(std::memory_order_acquire);
+      if (head == m_cached_tail)
+        return false;
+    }
+
+    item = m_buffer[head & (Capacity - 1)];
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /** @brief Peek at the oldest item without removing it. Consumer thread only.
+   *  @return Pointer to the item, or nullptr if the buffer is empty.
+   */
+  const T *front() noexcept
+  {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    if (head == m_cached_tail)
+    {
+      m_cached_tail = m_tail.load(std::memory_order_acquire);
+      if (head == m_cached_tail)
+        return nullptr;
+    }
+
+    return &m_buffer[head & (Capacity - 1)];
+  }
+
+  /** @brief Approximate number of items, exact when called from either side while the other is idle.
+   */
+  size_t size() const noexcept
+  {
+    return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+  }
+
+  bool empty() const noexcept { return size() == 0; }
+  static constexpr size_t capacity() noexcept { return Capacity; }
+
+private:
+  // Consumer side
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_head{0};
+  size_t m_cached_tail = 0;
+
+  // Producer side
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail{0};
+  size_t m_cached_head = 0;
+
+  alignas(CACHE_LINE_SIZE) std::array<T, Capacity> m_buffer{};
+};
+
+} // namespace MinimalAudioEngine
+
+#endif // __RING_BUFFER_H_
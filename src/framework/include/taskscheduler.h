@@ -0,0 +1,195 @@
+#ifndef __TASK_SCHEDULER_H_
+#define __TASK_SCHEDULER_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace MinimalAudioEngine
+{
+
+class TaskScheduler;
+
+constexpr float TASK_SCHEDULER_HIGH_LOAD = 0.75f;  // Audio callback load above which only High tasks start
+constexpr auto TASK_SCHEDULER_THROTTLE_INTERVAL = std::chrono::milliseconds(1);
+
+/** @enum eTaskPriority
+ *  @brief Priority classes. A class only runs when no higher class has work.
+ */
+enum class eTaskPriority
+{
+  Background,  // Peak files, analysis; runs only while the audio thread has headroom
+  Normal,      // Offline rendering, decoding
+  High,        // Work the user is waiting on; never held back
+};
+
+constexpr size_t TASK_PRIORITY_COUNT = 3;
+
+/** @struct TaskSchedulerStatistics
+ *  @brief Counters since the scheduler started.
+ */
+struct TaskSchedulerStatistics
+{
+  uint64_t tasks_run = 0;
+  uint64_t tasks_stolen = 0;       // Taken from another worker's queue
+  uint64_t deadlines_missed = 0;   // Started after their deadline
+  uint64_t throttled_waits = 0;    // Times a worker held back for the audio thread
+
+  std::string to_string() const
+  {
+    return "TaskSchedulerStatistics(Run=" + std::to_string(tasks_run) +
+           ", Stolen=" + std::to_string(tasks_stolen) +
+           ", DeadlinesMissed=" + std::to_string(deadlines_missed) +
+           ", ThrottledWaits=" + std::to_string(throttled_waits) + ")";
+  }
+};
+
+/** @class TaskGroup
+ *  @brief Tracks a set of submitted tasks so the submitter can wait for all of them.
+ *  Waiting on a worker thread runs other queued tasks instead of blocking the worker.
+ */
+class TaskGroup
+{
+  friend class TaskScheduler;
+
+public:
+  TaskGroup() = default;
+  ~TaskGroup() { wait(); }
+
+  void wait();
+
+  inline bool is_done() const noexcept
+  {
+    return m_pending.load(std::memory_order_acquire) == 0;
+  }
+
+  // Disable copy constructor and assignment operator
+  TaskGroup(const TaskGroup &) = delete;
+  TaskGroup &operator=(const TaskGroup &) = delete;
+
+private:
+  void add() noexcept;
+  void finish();
+
+  std::atomic<size_t> m_pending{0};
+  TaskScheduler *m_scheduler = nullptr;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+};
+
+/** @class TaskScheduler
+ *  @brief Shared pool for non-real-time work, with one thread per core less one for audio.
+ *
+ *  Tasks submitted from a worker go to that worker's own queue and run newest first;
+ *  idle workers steal the oldest from others. Tasks from other threads, and any task
+ *  with a deadline, go to a shared queue where earlier deadlines run first. While a
+ *  registered load probe (the audio callback load) is above TASK_SCHEDULER_HIGH_LOAD,
+ *  only High tasks are started.
+ */
+class TaskScheduler
+{
+public:
+  typedef std::function<void()> Task;
+  typedef std::function<float()> LoadProbe;
+  typedef std::chrono::steady_clock::time_point Deadline;
+
+  static TaskScheduler &instance()
+  {
+    static TaskScheduler instance(std::max(2u, std::thread::hardware_concurrency()) - 1);
+    return instance;
+  }
+
+  explicit TaskScheduler(unsigned int thread_count);
+  ~TaskScheduler();
+
+  void submit(Task task, eTaskPriority priority = eTaskPriority::Normal, std::optional<Deadline> deadline = std::nullopt);
+  void submit(TaskGroup &group, Task task, eTaskPriority priority = eTaskPriority::Normal,
+              std::optional<Deadline> deadline = std::nullopt);
+
+  bool run_one();
+  bool is_worker_thread() const noexcept;
+
+  size_t add_load_probe(LoadProbe probe);
+  void remove_load_probe(size_t id);
+  float get_load() const;
+
+  TaskSchedulerStatistics get_statistics() const;
+
+  inline unsigned int get_thread_count() const noexcept
+  {
+    return static_cast<unsigned int>(m_workers.size());
+  }
+
+  // Disable copy constructor and assignment operator
+  TaskScheduler(const TaskScheduler &) = delete;
+  TaskScheduler &operator=(const TaskScheduler &) = delete;
+
+private:
+  struct Entry
+  {
+    Task task;
+    TaskGroup *group = nullptr;
+    std::optional<Deadline> deadline;
+    uint64_t sequence = 0;
+  };
+
+  struct EntryOrder
+  {
+    // std::priority_queue pops the largest: earliest deadline, then tasks without one oldest first
+    bool operator()(const Entry &a, const Entry &b) const
+    {
+      if (a.deadline.has_value() != b.deadline.has_value())
+        return !a.deadline.has_value();
+      if (a.deadline.has_value() && *a.deadline != *b.deadline)
+        return *a.deadline > *b.deadline;
+      return a.sequence > b.sequence;
+    }
+  };
+
+  struct Worker
+  {
+    std::mutex mutex;
+    std::array<std::deque<Entry>, TASK_PRIORITY_COUNT> queues;
+    std::jthread thread;
+  };
+
+  void push(Entry entry, eTaskPriority priority);
+  std::optional<Entry> take(size_t self, bool &throttled);
+  std::optional<Entry> take_from(size_t self, size_t priority);
+  void execute(Entry &entry);
+  void run(std::stop_token stop_token, size_t index);
+
+  std::vector<std::unique_ptr<Worker>> m_workers;
+
+  // Shared queue, one per priority class
+  std::array<std::priority_queue<Entry, std::vector<Entry>, EntryOrder>, TASK_PRIORITY_COUNT> m_shared;
+  uint64_t m_next_sequence = 0;
+  std::mutex m_mutex;
+  std::condition_variable_any m_condition;
+  std::atomic<size_t> m_queued{0};
+
+  mutable std::mutex m_probe_mutex;
+  std::vector<std::pair<size_t, LoadProbe>> m_probes;
+  size_t m_next_probe_id = 1;
+
+  std::atomic<uint64_t> m_tasks_run{0};
+  std::atomic<uint64_t> m_tasks_stolen{0};
+  std::atomic<uint64_t> m_deadlines_missed{0};
+  std::atomic<uint64_t> m_throttled_waits{0};
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // __TASK_SCHEDULER_H_
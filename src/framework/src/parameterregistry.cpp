@@ -0,0 +1,177 @@
+#include "parameterregistry.h"
+
+#include "logger.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+constexpr float PARAMETER_SETTLE_FRACTION = 1.0e-4f;  // Of the range; a glide this close snaps to its target
+
+}  // namespace
+
+/** @brief Register a parameter, or look it up if one with the same name exists.
+ *  @param info Name, range, default value and smoothing time.
+ *  @return The parameter's id, or std::nullopt for an invalid range or a full registry.
+ */
+std::optional<ParameterId> ParameterRegistry::register_parameter(const ParameterInfo &info)
+{
+  if (info.name.empty() || !(info.minimum < info.maximum))
+  {
+    LOG_ERROR("ParameterRegistry: Invalid parameter ", info.to_string());
+    return std::nullopt;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto existing = std::find_if(m_infos.begin(), m_infos.end(),
+                               [&info](const ParameterInfo &registered) { return registered.name == info.name; });
+  if (existing != m_infos.end())
+  {
+    return static_cast<ParameterId>(existing - m_infos.begin());
+  }
+
+  if (m_infos.size() == PARAMETER_MAX_PARAMETERS)
+  {
+    LOG_ERROR("ParameterRegistry: No room for parameter ", info.name);
+    return std::nullopt;
+  }
+
+  ParameterInfo registered = info;
+  registered.default_value = std::clamp(info.default_value, info.minimum, info.maximum);
+  registered.smoothing_ms = std::max(0.0f, info.smoothing_ms);
+
+  const auto id = static_cast<ParameterId>(m_infos.size());
+  Slot &slot = m_slots[id];
+  slot.minimum = registered.minimum;
+  slot.maximum = registered.maximum;
+  slot.smoothing_ms = registered.smoothing_ms;
+  slot.target.store(registered.default_value, std::memory_order_relaxed);
+  slot.current.store(registered.default_value, std::memory_order_relaxed);
+  m_infos.push_back(registered);
+
+  // Publish the slot
+  m_count.store(m_infos.size(), std::memory_order_release);
+  LOG_INFO("ParameterRegistry: Registered ", id, ": ", registered.to_string());
+  return id;
+}
+
+std::optional<ParameterId> ParameterRegistry::find_parameter(const std::string &name) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = std::find_if(m_infos.begin(), m_infos.end(),
+                         [&name](const ParameterInfo &registered) { return registered.name == name; });
+  if (it == m_infos.end())
+  {
+    return std::nullopt;
+  }
+  return static_cast<ParameterId>(it - m_infos.begin());
+}
+
+std::optional<ParameterInfo> ParameterRegistry::get_info(ParameterId id) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (id >= m_infos.size())
+  {
+    return std::nullopt;
+  }
+  return m_infos[id];
+}
+
+std::vector<ParameterInfo> ParameterRegistry::get_parameters() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_infos;
+}
+
+/** @brief Set a parameter's target value. Any thread; never locks.
+ *  @param id The parameter.
+ *  @param value The value, clamped to the parameter's range.
+ *  @return False for an unknown id.
+ */
+bool ParameterRegistry::set_value(ParameterId id, float value) noexcept
+{
+  if (id >= get_parameter_count() || std::isnan(value))
+    return false;
+
+  Slot &slot = m_slots[id];
+  slot.target.store(std::clamp(value, slot.minimum, slot.maximum), std::memory_order_relaxed);
+  return true;
+}
+
+/** @brief Set a parameter's target from a position in its range, as a controller sends it. Any thread; never locks.
+ *  @param id The parameter.
+ *  @param normalized 0 for the minimum to 1 for the maximum.
+ *  @return False for an unknown id.
+ */
+bool ParameterRegistry::set_normalized(ParameterId id, float normalized) noexcept
+{
+  if (id >= get_parameter_count() || std::isnan(normalized))
+    return false;
+
+  const Slot &slot = m_slots[id];
+  return set_value(id, slot.minimum + std::clamp(normalized, 0.0f, 1.0f) * (slot.maximum - slot.minimum));
+}
+
+/** @brief The value last set, or 0 for an unknown id
+ */
+float ParameterRegistry::get_value(ParameterId id) const noexcept
+{
+  if (id >= get_parameter_count())
+    return 0.0f;
+  return m_slots[id].target.load(std::memory_order_relaxed);
+}
+
+/** @brief The value the consumer reached with its last advance(), or 0 for an unknown id
+ */
+float ParameterRegistry::get_smoothed_value(ParameterId id) const noexcept
+{
+  if (id >= get_parameter_count())
+    return 0.0f;
+  return m_slots[id].current.load(std::memory_order_relaxed);
+}
+
+/** @brief Glide a parameter towards its target over a block and return the value for the block.
+ *  Called from the audio callback by the parameter's one consumer; never locks or allocates.
+ *  The glide is a one-pole with the parameter's smoothing time, evaluated for the whole block at once.
+ *  @param id The parameter.
+ *  @param frames Frames in the block.
+ *  @param sample_rate Sample rate of the block.
+ *  @return The smoothed value, or 0 for an unknown id.
+ */
+float ParameterRegistry::advance(ParameterId id, unsigned int frames, unsigned int sample_rate) noexcept
+{
+  if (id >= get_parameter_count())
+    return 0.0f;
+
+  Slot &slot = m_slots[id];
+  const float target = slot.target.load(std::memory_order_relaxed);
+  float current = slot.current.load(std::memory_order_relaxed);
+  if (current == target)
+    return current;
+
+  const float time_constant = slot.smoothing_ms * 0.001f * static_cast<float>(sample_rate);
+  if (time_constant <= 1.0f)
+  {
+    current = target;
+  }
+  else
+  {
+    current = target + (current - target) * std::exp(-static_cast<float>(frames) / time_constant);
+    if (std::fabs(current - target) <= PARAMETER_SETTLE_FRACTION * (slot.maximum - slot.minimum))
+    {
+      current = target;
+    }
+  }
+
+  slot.current.store(current, std::memory_order_relaxed);
+  return current;
+}
+
+std::string ParameterRegistry::to_string() const
+{
+  return "ParameterRegistry(Parameters=" + std::to_string(get_parameter_count()) + ")";
+}
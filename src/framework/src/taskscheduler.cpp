@@ -0,0 +1,377 @@
+#include "taskscheduler.h"
+#include "logger.h"
+
+#include <limits>
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+constexpr size_t NO_WORKER = std::numeric_limits<size_t>::max();
+
+// The scheduler and queue index of the worker running on this thread, if any
+thread_local TaskScheduler *t_scheduler = nullptr;
+thread_local size_t t_worker_index = NO_WORKER;
+
+}  // namespace
+
+/** @brief Wait for every task submitted with this group
+ */
+void TaskGroup::wait()
+{
+  while (!is_done())
+  {
+    if (m_scheduler != nullptr && m_scheduler->is_worker_thread())
+    {
+      // Blocking here could starve the pool; help with queued work instead
+      if (!m_scheduler->run_one())
+      {
+        std::this_thread::yield();
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this] { return is_done(); });
+  }
+
+  // The last task may still hold the mutex while notifying
+  std::lock_guard<std::mutex> lock(m_mutex);
+}
+
+/** @brief Count a task submitted with this group
+ */
+void TaskGroup::add() noexcept
+{
+  m_pending.fetch_add(1, std::memory_order_acq_rel);
+}
+
+/** @brief Count a task as finished and wake waiters after the last one
+ */
+void TaskGroup::finish()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+  {
+    m_condition.notify_all();
+  }
+}
+
+/** @brief TaskScheduler constructor
+ *  @param thread_count Number of worker threads, at least one.
+ */
+TaskScheduler::TaskScheduler(unsigned int thread_count)
+{
+  thread_count = std::max(1u, thread_count);
+  LOG_INFO("TaskScheduler: Starting ", thread_count, " workers.");
+
+  for (unsigned int i = 0; i < thread_count; ++i)
+  {
+    m_workers.push_back(std::make_unique<Worker>());
+  }
+
+  // Start only once every queue exists, since workers steal from each other
+  for (size_t i = 0; i < m_workers.size(); ++i)
+  {
+    m_workers[i]->thread = std::jthread([this, i](std::stop_token stop_token) { run(stop_token, i); });
+  }
+}
+
+/** @brief Stop the workers. Tasks still queued run on the calling thread so no group waits forever.
+ */
+TaskScheduler::~TaskScheduler()
+{
+  for (auto &worker : m_workers)
+  {
+    worker->thread.request_stop();
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+  }
+  m_condition.notify_all();
+
+  for (auto &worker : m_workers)
+  {
+    if (worker->thread.joinable())
+    {
+      worker->thread.join();
+    }
+  }
+
+  while (m_queued.load(std::memory_order_acquire) > 0)
+  {
+    for (size_t priority = TASK_PRIORITY_COUNT; priority-- > 0;)
+    {
+      while (auto entry = take_from(NO_WORKER, priority))
+      {
+        execute(*entry);
+      }
+    }
+  }
+}
+
+/** @brief Queue a task.
+ *  @param task Work to run on a worker thread.
+ *  @param priority Priority class.
+ *  @param deadline Optional time the task should have started by. Earlier deadlines run first within a class.
+ */
+void TaskScheduler::submit(Task task, eTaskPriority priority, std::optional<Deadline> deadline)
+{
+  Entry entry;
+  entry.task = std::move(task);
+  entry.deadline = deadline;
+  push(std::move(entry), priority);
+}
+
+/** @brief Queue a task as part of a group.
+ */
+void TaskScheduler::submit(TaskGroup &group, Task task, eTaskPriority priority, std::optional<Deadline> deadline)
+{
+  group.m_scheduler = this;
+  group.add();
+
+  Entry entry;
+  entry.task = std::move(task);
+  entry.group = &group;
+  entry.deadline = deadline;
+  push(std::move(entry), priority);
+}
+
+/** @brief Run one queued task on the calling thread, if the audio load allows it.
+ *  @return False if there was nothing to run.
+ */
+bool TaskScheduler::run_one()
+{
+  bool throttled = false;
+  auto entry = take(is_worker_thread() ? t_worker_index : NO_WORKER, throttled);
+  if (!entry)
+  {
+    return false;
+  }
+
+  execute(*entry);
+  return true;
+}
+
+/** @brief True when called from one of this scheduler's workers
+ */
+bool TaskScheduler::is_worker_thread() const noexcept
+{
+  return t_scheduler == this;
+}
+
+/** @brief Register a real-time load source, such as an audio callback.
+ *  @param probe Returns the load as the fraction of the callback period in use. Called from workers.
+ *  @return Id for remove_load_probe().
+ */
+size_t TaskScheduler::add_load_probe(LoadProbe probe)
+{
+  std::lock_guard<std::mutex> lock(m_probe_mutex);
+  size_t id = m_next_probe_id++;
+  m_probes.emplace_back(id, std::move(probe));
+  return id;
+}
+
+/** @brief Unregister a load source. It is not called again once this returns.
+ */
+void TaskScheduler::remove_load_probe(size_t id)
+{
+  std::lock_guard<std::mutex> lock(m_probe_mutex);
+  std::erase_if(m_probes, [id](const std::pair<size_t, LoadProbe> &probe) { return probe.first == id; });
+}
+
+/** @brief Get the highest load reported by any probe
+ */
+float TaskScheduler::get_load() const
+{
+  std::lock_guard<std::mutex> lock(m_probe_mutex);
+  float load = 0.0f;
+  for (const auto &probe : m_probes)
+  {
+    load = std::max(load, probe.second());
+  }
+  return load;
+}
+
+/** @brief Return a copy of the scheduler statistics
+ */
+TaskSchedulerStatistics TaskScheduler::get_statistics() const
+{
+  TaskSchedulerStatistics statistics;
+  statistics.tasks_run = m_tasks_run.load(std::memory_order_relaxed);
+  statistics.tasks_stolen = m_tasks_stolen.load(std::memory_order_relaxed);
+  statistics.deadlines_missed = m_deadlines_missed.load(std::memory_order_relaxed);
+  statistics.throttled_waits = m_throttled_waits.load(std::memory_order_relaxed);
+  return statistics;
+}
+
+/** @brief Put a task on the calling worker's own queue, or on the shared queue
+ */
+void TaskScheduler::push(Entry entry, eTaskPriority priority)
+{
+  size_t index = static_cast<size_t>(priority);
+
+  if (!entry.deadline.has_value() && is_worker_thread())
+  {
+    Worker &worker = *m_workers[t_worker_index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.queues[index].push_back(std::move(entry));
+    m_queued.fetch_add(1, std::memory_order_acq_rel);
+  }
+  else
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    entry.sequence = m_next_sequence++;
+    m_shared[index].push(std::move(entry));
+    m_queued.fetch_add(1, std::memory_order_acq_rel);
+  }
+
+  // Take the lock so a worker between its check and its wait cannot miss the wakeup
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+  }
+  m_condition.notify_one();
+}
+
+/** @brief Take the next task for a worker, highest class first.
+ *  @param self The worker's index, or NO_WORKER for a helping thread.
+ *  @param throttled Set when lower-class work is waiting because the audio load is high.
+ */
+std::optional<TaskScheduler::Entry> TaskScheduler::take(size_t self, bool &throttled)
+{
+  const size_t lowest = get_load() >= TASK_SCHEDULER_HIGH_LOAD ? static_cast<size_t>(eTaskPriority::High) : 0;
+
+  for (size_t priority = TASK_PRIORITY_COUNT; priority-- > lowest;)
+  {
+    if (auto entry = take_from(self, priority))
+    {
+      return entry;
+    }
+  }
+
+  throttled = lowest > 0 && m_queued.load(std::memory_order_acquire) > 0;
+  return std::nullopt;
+}
+
+/** @brief Take a task of one class: deadlines first, then the worker's newest, then the
+ *  oldest shared task, then the oldest task of another worker.
+ */
+std::optional<TaskScheduler::Entry> TaskScheduler::take_from(size_t self, size_t priority)
+{
+  auto pop_shared = [this, priority](bool deadline_only) -> std::optional<Entry> {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto &queue = m_shared[priority];
+    if (queue.empty() || (deadline_only && !queue.top().deadline.has_value()))
+    {
+      return std::nullopt;
+    }
+
+    // top() is const only to protect the ordering, which pop() no longer needs
+    Entry entry = std::move(const_cast<Entry &>(queue.top()));
+    queue.pop();
+    m_queued.fetch_sub(1, std::memory_order_acq_rel);
+    return entry;
+  };
+
+  if (auto entry = pop_shared(true))
+  {
+    return entry;
+  }
+
+  if (self != NO_WORKER)
+  {
+    Worker &worker = *m_workers[self];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    auto &queue = worker.queues[priority];
+    if (!queue.empty())
+    {
+      Entry entry = std::move(queue.back());
+      queue.pop_back();
+      m_queued.fetch_sub(1, std::memory_order_acq_rel);
+      return entry;
+    }
+  }
+
+  if (auto entry = pop_shared(false))
+  {
+    return entry;
+  }
+
+  for (size_t offset = 1; offset <= m_workers.size(); ++offset)
+  {
+    size_t victim = self == NO_WORKER ? offset - 1 : (self + offset) % m_workers.size();
+    if (victim == self)
+    {
+      continue;
+    }
+
+    Worker &worker = *m_workers[victim];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    auto &queue = worker.queues[priority];
+    if (!queue.empty())
+    {
+      Entry entry = std::move(queue.front());
+      queue.pop_front();
+      m_queued.fetch_sub(1, std::memory_order_acq_rel);
+      m_tasks_stolen.fetch_add(1, std::memory_order_relaxed);
+      return entry;
+    }
+  }
+
+  return std::nullopt;
+}
+
+/** @brief Run a task and account for it
+ */
+void TaskScheduler::execute(Entry &entry)
+{
+  if (entry.deadline.has_value() && std::chrono::steady_clock::now() > *entry.deadline)
+  {
+    m_deadlines_missed.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  try
+  {
+    entry.task();
+  }
+  catch (const std::exception &e)
+  {
+    LOG_ERROR("TaskScheduler: Task failed: ", e.what());
+  }
+
+  m_tasks_run.fetch_add(1, std::memory_order_relaxed);
+  if (entry.group != nullptr)
+  {
+    entry.group->finish();
+  }
+}
+
+/** @brief Worker thread: run tasks, hold back while the audio thread is loaded, sleep when idle
+ */
+void TaskScheduler::run(std::stop_token stop_token, size_t index)
+{
+  t_scheduler = this;
+  t_worker_index = index;
+  set_thread_name("TaskWorker");
+
+  while (!stop_token.stop_requested())
+  {
+    bool throttled = false;
+    if (auto entry = take(index, throttled))
+    {
+      execute(*entry);
+      continue;
+    }
+
+    if (throttled)
+    {
+      m_throttled_waits.fetch_add(1, std::memory_order_relaxed);
+      std::this_thread::sleep_for(TASK_SCHEDULER_THROTTLE_INTERVAL);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, stop_token, [this] { return m_queued.load(std::memory_order_acquire) > 0; });
+  }
+}
@@ -1,17 +1,98 @@
 #include "cli.h"
 #include "logger.h"
 
+#include <CLI/CLI.hpp>
+
+#include <string>
+#include <vector>
+
 using namespace GUI;
 
 /** @brief Main function for the Digital Audio Workstation application.
+ *  With no arguments, starts the interactive command line. With --script or
+ *  --command, runs the given commands headless and exits. --control-socket and --osc-port
+ *  also accept remote control, and --serve keeps serving without a prompt.
  *  @return Exit status of the application (0 for success, non-zero for failure).
  */
-int main()
+int main(int argc, char **argv)
 {
+  ::CLI::App app("Minimal Audio Engine");
+
+  std::string script_path;
+  std::vector<std::string> commands;
+  bool keep_going = false;
+  std::string control_socket;
+  uint16_t osc_port = 0;
+  bool serve = false;
+
+  app.add_option("-s,--script", script_path, "Run commands from a script file ('-' for stdin) and exit");
+  app.add_option("-c,--command", commands, "Run a command and exit (repeatable)");
+  app.add_flag("-k,--keep-going", keep_going, "Continue after a failed command");
+  app.add_option("--control-socket", control_socket, "Serve the binary control protocol on a Unix domain socket");
+  app.add_option("--osc-port", osc_port, "Receive OSC messages on a UDP port on the loopback interface");
+  app.add_flag("--serve", serve, "With --control-socket or --osc-port, serve without a prompt until interrupted");
+
+  try
+  {
+    app.parse(argc, argv);
+  }
+  catch (const ::CLI::ParseError &e)
+  {
+    return app.exit(e);
+  }
+
   LOG_INFO("Embedded Audio Engine");
   LOG_INFO("---------------------");
 
+  if (serve && control_socket.empty() && osc_port == 0)
+  {
+    LOG_ERROR("--serve requires --control-socket or --osc-port");
+    return static_cast<int>(eExitCode::CommandFailed);
+  }
+
+  if (!script_path.empty() || !commands.empty() || serve)
+  {
+    CommandLine cli(eCommandLineMode::Headless);
+
+    if ((!control_socket.empty() && !cli.start_control_server(control_socket)) ||
+        (osc_port != 0 && !cli.start_osc_server(osc_port)))
+    {
+      return static_cast<int>(eExitCode::CommandFailed);
+    }
+
+    eExitCode exit_code = eExitCode::Success;
+    if (!commands.empty())
+    {
+      exit_code = cli.run_commands(commands, keep_going);
+    }
+
+    if (!script_path.empty() && (exit_code == eExitCode::Success || keep_going))
+    {
+      eExitCode script_exit_code = cli.run_script(script_path, keep_going);
+      if (exit_code == eExitCode::Success)
+      {
+        exit_code = script_exit_code;
+      }
+    }
+
+    if (serve && exit_code == eExitCode::Success)
+    {
+      exit_code = cli.serve();
+    }
+
+    LOG_INFO("Shutting down application...");
+    return static_cast<int>(exit_code);
+  }
+
   CommandLine cli;
+  if (!control_socket.empty())
+  {
+    cli.start_control_server(control_socket);
+  }
+  if (osc_port != 0)
+  {
+    cli.start_osc_server(osc_port);
+  }
   cli.run();
 
   LOG_INFO("Shutting down application...");
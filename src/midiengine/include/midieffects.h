@@ -0,0 +1,601 @@
+#ifndef _MIDI_EFFECTS_H_
+#define _MIDI_EFFECTS_H_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <utility>
+
+namespace MinimalAudioEngine
+{
+
+constexpr size_t MIDI_EVENT_LIST_CAPACITY = 512;  // Events per block a track can carry
+constexpr size_t MIDI_EFFECT_MAX_NOTES = 16;      // Notes held at once by note repeat and the arpeggiator
+
+/** @struct MidiEvent
+ *  @brief A channel message placed on a frame of the current block.
+ */
+struct MidiEvent
+{
+  uint32_t offset = 0;  // Frames from the start of the block
+  uint8_t status = 0;
+  uint8_t data1 = 0;
+  uint8_t data2 = 0;
+
+  uint8_t get_type() const noexcept { return status & 0xF0; }
+  uint8_t get_channel() const noexcept { return status & 0x0F; }
+  bool is_note_on() const noexcept { return get_type() == 0x90 && data2 > 0; }
+  bool is_note_off() const noexcept { return get_type() == 0x80 || (get_type() == 0x90 && data2 == 0); }
+  bool is_note() const noexcept { return get_type() == 0x80 || get_type() == 0x90; }
+};
+
+/** @struct MidiBlockContext
+ *  @brief The block the events belong to.
+ */
+struct MidiBlockContext
+{
+  uint64_t sample_time = 0;  // Transport sample of the first frame
+  uint32_t frames = 0;
+  uint32_t sample_rate = 0;
+};
+
+/** @class MidiEventList
+ *  @brief The events of one block, in offset order, in fixed storage.
+ *  Effects edit the list in place; nothing allocates, so it can live on the audio thread.
+ */
+class MidiEventList
+{
+public:
+  /** @brief Append an event. Keep offsets ascending, or call sort() afterwards.
+   *  @return False if the list is full; the event is counted as dropped.
+   */
+  bool push(const MidiEvent &event) noexcept
+  {
+    if (m_size == m_events.size())
+    {
+      ++m_dropped;
+      return false;
+    }
+    m_events[m_size++] = event;
+    return true;
+  }
+
+  void clear() noexcept { m_size = 0; }
+  size_t size() const noexcept { return m_size; }
+  bool empty() const noexcept { return m_size == 0; }
+  bool full() const noexcept { return m_size == m_events.size(); }
+  static constexpr size_t capacity() noexcept { return MIDI_EVENT_LIST_CAPACITY; }
+
+  /** @brief Events refused because the list was full, since the list was created
+   */
+  uint64_t get_dropped() const noexcept { return m_dropped; }
+
+  MidiEvent &operator[](size_t index) noexcept { return m_events[index]; }
+  const MidiEvent &operator[](size_t index) const noexcept { return m_events[index]; }
+  MidiEvent *begin() noexcept { return m_events.data(); }
+  MidiEvent *end() noexcept { return m_events.data() + m_size; }
+  const MidiEvent *begin() const noexcept { return m_events.data(); }
+  const MidiEvent *end() const noexcept { return m_events.data() + m_size; }
+
+  /** @brief Remove the events the predicate returns true for, keeping the order of the rest.
+   *  The predicate may modify the events it keeps.
+   */
+  template <typename Predicate>
+  void remove_if(Predicate &&predicate) noexcept
+  {
+    size_t kept = 0;
+    for (size_t i = 0; i < m_size; ++i)
+    {
+      if (!predicate(m_events[i]))
+      {
+        m_events[kept++] = m_events[i];
+      }
+    }
+    m_size = kept;
+  }
+
+  /** @brief Stable sort by offset. An insertion sort: lists are short and nearly sorted already.
+   */
+  void sort() noexcept
+  {
+    for (size_t i = 1; i < m_size; ++i)
+    {
+      const MidiEvent event = m_events[i];
+      size_t j = i;
+      for (; j > 0 && m_events[j - 1].offset > event.offset; --j)
+      {
+        m_events[j] = m_events[j - 1];
+      }
+      m_events[j] = event;
+    }
+  }
+
+private:
+  std::array<MidiEvent, MIDI_EVENT_LIST_CAPACITY> m_events{};
+  size_t m_size = 0;
+  uint64_t m_dropped = 0;
+};
+
+/** @class IMidiEffect
+ *  @brief A MIDI effect as a track runs it: once per block, on the audio thread.
+ */
+class IMidiEffect
+{
+public:
+  virtual ~IMidiEffect() = default;
+
+  /** @brief Process the block's events in place. Must not allocate, lock or block.
+   */
+  virtual void process(MidiEventList &events, const MidiBlockContext &context) noexcept = 0;
+};
+
+/** @brief A stage that maps one event at a time: it edits the event and returns false to remove it.
+ */
+template <typename Stage>
+concept MidiTransform = requires(const Stage &stage, MidiEvent &event) {
+  { stage.transform(event) } noexcept -> std::same_as<bool>;
+};
+
+/** @brief A stage that needs the whole block, e.g. to add events or to keep state across blocks.
+ */
+template <typename Stage>
+concept MidiProcessor = requires(Stage &stage, MidiEventList &events, const MidiBlockContext &context) {
+  { stage.process(events, context) } noexcept;
+};
+
+template <typename Stage>
+concept MidiEffectStage = MidiTransform<Stage> || MidiProcessor<Stage>;
+
+/** @class MidiEffectChain
+ *  @brief Stages composed at compile time into one effect.
+ *  Consecutive transforms are fused into a single pass over the events, with each event going
+ *  through all of them before the next; processors run on the whole list in between.
+ */
+template <MidiEffectStage... Stages>
+class MidiEffectChain : public IMidiEffect
+{
+public:
+  explicit MidiEffectChain(Stages... stages) : m_stages(std::move(stages)...) {}
+
+  void process(MidiEventList &events, const MidiBlockContext &context) noexcept override
+  {
+    run<0>(events, context);
+  }
+
+  /** @brief Access a stage, e.g. to inspect its state in tests. Not while the track runs the chain.
+   */
+  template <size_t Index>
+  auto &get() noexcept
+  {
+    return std::get<Index>(m_stages);
+  }
+
+private:
+  // Which stages are transforms, with a sentinel so a run of transforms always ends
+  static constexpr std::array<bool, sizeof...(Stages) + 1> s_transforms{{MidiTransform<Stages>..., false}};
+
+  static constexpr size_t get_run_end(size_t index)
+  {
+    while (s_transforms[index])
+    {
+      ++index;
+    }
+    return index;
+  }
+
+  template <size_t Begin, size_t... Offsets>
+  void run_fused(MidiEventList &events, std::index_sequence<Offsets...>) noexcept
+  {
+    events.remove_if([this](MidiEvent &event) { return !(std::get<Begin + Offsets>(m_stages).transform(event) && ...); });
+  }
+
+  template <size_t Index>
+  void run(MidiEventList &events, const MidiBlockContext &context) noexcept
+  {
+    if constexpr (Index < sizeof...(Stages))
+    {
+      if constexpr (s_transforms[Index])
+      {
+        constexpr size_t end = get_run_end(Index);
+        run_fused<Index>(events, std::make_index_sequence<end - Index>{});
+        run<end>(events, context);
+      }
+      else
+      {
+        std::get<Index>(m_stages).process(events, context);
+        run<Index + 1>(events, context);
+      }
+    }
+  }
+
+  std::tuple<Stages...> m_stages;
+};
+
+/** @brief Build a chain for Track::set_midi_effect()
+ */
+template <MidiEffectStage... Stages>
+std::unique_ptr<IMidiEffect> make_midi_effect_chain(Stages... stages)
+{
+  return std::make_unique<MidiEffectChain<Stages...>>(std::move(stages)...);
+}
+
+/** @class MidiTranspose
+ *  @brief Shift notes and polyphonic pressure by semitones; notes shifted out of range are removed.
+ */
+class MidiTranspose
+{
+public:
+  explicit MidiTranspose(int semitones) : m_semitones(semitones) {}
+
+  bool transform(MidiEvent &event) const noexcept
+  {
+    const uint8_t type = event.get_type();
+    if (type != 0x80 && type != 0x90 && type != 0xA0)
+      return true;
+
+    const int note = event.data1 + m_semitones;
+    if (note < 0 || note > 127)
+      return false;
+
+    event.data1 = static_cast<uint8_t>(note);
+    return true;
+  }
+
+private:
+  int m_semitones;
+};
+
+/** @class MidiVelocityCurve
+ *  @brief Reshape note-on velocities through a table: an exponent below 1 lifts soft notes, above 1 softens them,
+ *  and the result is scaled into [minimum, maximum].
+ */
+class MidiVelocityCurve
+{
+public:
+  explicit MidiVelocityCurve(float exponent = 1.0f, uint8_t minimum = 1, uint8_t maximum = 127)
+  {
+    minimum = std::clamp<uint8_t>(minimum, 1, 127);
+    maximum = std::clamp<uint8_t>(maximum, minimum, 127);
+    exponent = exponent > 0.0f ? exponent : 1.0f;
+
+    m_table[0] = 0;  // Still a note-off
+    for (size_t velocity = 1; velocity < m_table.size(); ++velocity)
+    {
+      const float shaped = std::pow(static_cast<float>(velocity) / 127.0f, exponent);
+      m_table[velocity] = static_cast<uint8_t>(std::lround(minimum + shaped * (maximum - minimum)));
+    }
+  }
+
+  bool transform(MidiEvent &event) const noexcept
+  {
+    if (event.is_note_on())
+    {
+      event.data2 = m_table[event.data2 & 0x7F];
+    }
+    return true;
+  }
+
+private:
+  std::array<uint8_t, 128> m_table{};
+};
+
+/** @class MidiChannelFilter
+ *  @brief Pass channel messages on the channels in a mask, optionally moving them all to one channel.
+ */
+class MidiChannelFilter
+{
+public:
+  /** @param channels Bit n passes channel n (0-based)
+   *  @param output_channel Channel to move passed events to, or -1 to keep theirs
+   */
+  explicit MidiChannelFilter(uint16_t channels, int output_channel = -1)
+      : m_channels(channels), m_output_channel(output_channel)
+  {
+  }
+
+  bool transform(MidiEvent &event) const noexcept
+  {
+    if (event.status < 0x80 || event.status >= 0xF0)
+      return true;
+
+    if ((m_channels & (1u << event.get_channel())) == 0)
+      return false;
+
+    if (m_output_channel >= 0 && m_output_channel < 16)
+    {
+      event.status = static_cast<uint8_t>(event.get_type() | m_output_channel);
+    }
+    return true;
+  }
+
+private:
+  uint16_t m_channels;
+  int m_output_channel;
+};
+
+/** @struct MidiHeldNote
+ *  @brief A note held down at the input of note repeat or the arpeggiator
+ */
+struct MidiHeldNote
+{
+  uint64_t start = 0;  // Transport sample of its note-on
+  uint8_t channel = 0;
+  uint8_t note = 0;
+  uint8_t velocity = 0;
+};
+
+/** @class MidiHeldNotes
+ *  @brief The held notes in the order they were played. Past MIDI_EFFECT_MAX_NOTES new notes are ignored.
+ */
+class MidiHeldNotes
+{
+public:
+  /** @brief Track a note-on or note-off; other events are ignored
+   */
+  void apply(const MidiEvent &event, uint64_t sample_time) noexcept
+  {
+    if (event.is_note_on())
+    {
+      add(event.get_channel(), event.data1, event.data2, sample_time);
+    }
+    else if (event.is_note_off())
+    {
+      remove(event.get_channel(), event.data1);
+    }
+  }
+
+  void add(uint8_t channel, uint8_t note, uint8_t velocity, uint64_t start) noexcept
+  {
+    remove(channel, note);
+    if (m_size < m_notes.size())
+    {
+      m_notes[m_size++] = {start, channel, note, velocity};
+    }
+  }
+
+  void remove(uint8_t channel, uint8_t note) noexcept
+  {
+    for (size_t i = 0; i < m_size; ++i)
+    {
+      if (m_notes[i].channel == channel && m_notes[i].note == note)
+      {
+        std::copy(m_notes.begin() + i + 1, m_notes.begin() + m_size, m_notes.begin() + i);
+        --m_size;
+        return;
+      }
+    }
+  }
+
+  void clear() noexcept { m_size = 0; }
+  size_t size() const noexcept { return m_size; }
+  bool empty() const noexcept { return m_size == 0; }
+  const MidiHeldNote &operator[](size_t index) const noexcept { return m_notes[index]; }
+
+private:
+  std::array<MidiHeldNote, MIDI_EFFECT_MAX_NOTES> m_notes{};
+  size_t m_size = 0;
+};
+
+/** @brief Frames per step of a tempo-synced effect, at least one
+ */
+inline uint64_t get_midi_step_frames(double beats_per_minute, double beats, uint32_t sample_rate) noexcept
+{
+  if (beats_per_minute <= 0.0 || beats <= 0.0)
+    return 1;
+  return std::max<uint64_t>(1, static_cast<uint64_t>(std::llround(beats * 60.0 * sample_rate / beats_per_minute)));
+}
+
+/** @class MidiNoteRepeat
+ *  @brief Retrigger held notes on a tempo grid, like a drum machine's note repeat.
+ *  The grid is aligned to the transport, so repeats land on the same samples however the blocks fall.
+ *  Each repeat is a note-off and a new note-on at the note's velocity; the played events pass through.
+ */
+class MidiNoteRepeat
+{
+public:
+  /** @param beats_per_minute Tempo
+   *  @param beats Repeat interval in beats, e.g. 0.25 for sixteenths
+   */
+  MidiNoteRepeat(double beats_per_minute, double beats = 0.25) : m_beats_per_minute(beats_per_minute), m_beats(beats) {}
+
+  void process(MidiEventList &events, const MidiBlockContext &context) noexcept
+  {
+    const uint64_t interval = get_midi_step_frames(m_beats_per_minute, m_beats, context.sample_rate);
+    const uint64_t block_end = context.sample_time + context.frames;
+    const size_t played = events.size();
+
+    size_t next = 0;
+    for (uint64_t step = (context.sample_time + interval - 1) / interval * interval; step < block_end; step += interval)
+    {
+      const auto offset = static_cast<uint32_t>(step - context.sample_time);
+      for (; next < played && events[next].offset <= offset; ++next)
+      {
+        m_held.apply(events[next], context.sample_time + events[next].offset);
+      }
+
+      for (size_t i = 0; i < m_held.size(); ++i)
+      {
+        const MidiHeldNote &held = m_held[i];
+        if (held.start == step)
+          continue;  // Played on the step itself
+
+        events.push({offset, static_cast<uint8_t>(0x80 | held.channel), held.note, 0});
+        events.push({offset, static_cast<uint8_t>(0x90 | held.channel), held.note, held.velocity});
+      }
+    }
+
+    for (; next < played; ++next)
+    {
+      m_held.apply(events[next], context.sample_time + events[next].offset);
+    }
+
+    if (events.size() != played)
+    {
+      events.sort();
+    }
+  }
+
+  const MidiHeldNotes &get_held_notes() const noexcept { return m_held; }
+
+private:
+  double m_beats_per_minute;
+  double m_beats;
+  MidiHeldNotes m_held;
+};
+
+/** @enum eArpeggiatorMode
+ *  @brief Order the arpeggiator steps through the held notes
+ */
+enum class eArpeggiatorMode
+{
+  Up,
+  Down,
+  UpDown,
+  AsPlayed,
+};
+
+/** @class MidiArpeggiator
+ *  @brief Play the held notes one at a time on a tempo grid aligned to the transport.
+ *  The played notes are consumed; other events pass through. A note still sounding at the end of
+ *  a block is released in a later one, and the pattern restarts once every note is let go.
+ */
+class MidiArpeggiator
+{
+public:
+  /** @param beats_per_minute Tempo
+   *  @param beats Step length in beats
+   *  @param mode Order of the notes
+   *  @param gate Fraction of a step each note sounds for, up to 1
+   */
+  MidiArpeggiator(double beats_per_minute, double beats = 0.25, eArpeggiatorMode mode = eArpeggiatorMode::Up,
+                  double gate = 0.5)
+      : m_beats_per_minute(beats_per_minute), m_beats(beats), m_mode(mode), m_gate(std::clamp(gate, 0.0, 1.0))
+  {
+  }
+
+  void process(MidiEventList &events, const MidiBlockContext &context) noexcept
+  {
+    const uint64_t interval = get_midi_step_frames(m_beats_per_minute, m_beats, context.sample_rate);
+    const uint64_t gate = std::clamp<uint64_t>(static_cast<uint64_t>(interval * m_gate), 1, interval);
+    const uint64_t block_end = context.sample_time + context.frames;
+
+    // Take the notes out; the rest stays in order
+    std::array<MidiEvent, MIDI_EVENT_LIST_CAPACITY> notes;
+    size_t note_count = 0;
+    events.remove_if([&](MidiEvent &event) {
+      if (!event.is_note())
+        return false;
+      notes[note_count++] = event;
+      return true;
+    });
+
+    size_t next = 0;
+    uint64_t step = (context.sample_time + interval - 1) / interval * interval;
+    while (true)
+    {
+      // The sounding note ends first if it is due by the next step
+      if (m_sounding && m_release_time < block_end && m_release_time <= step)
+      {
+        release(events, std::max(m_release_time, context.sample_time) - context.sample_time);
+        continue;
+      }
+
+      if (step >= block_end)
+        break;
+
+      const auto offset = static_cast<uint32_t>(step - context.sample_time);
+      for (; next < note_count && notes[next].offset <= offset; ++next)
+      {
+        m_held.apply(notes[next], context.sample_time + notes[next].offset);
+      }
+
+      if (m_held.empty())
+      {
+        m_step = 0;
+      }
+      else
+      {
+        if (m_sounding)
+        {
+          release(events, offset);  // Gate of a whole step
+        }
+        const MidiHeldNote &held = get_step_note();
+        events.push({offset, static_cast<uint8_t>(0x90 | held.channel), held.note, held.velocity});
+        m_sounding = true;
+        m_sounding_channel = held.channel;
+        m_sounding_note = held.note;
+        m_release_time = step + gate;
+      }
+      step += interval;
+    }
+
+    for (; next < note_count; ++next)
+    {
+      m_held.apply(notes[next], context.sample_time + notes[next].offset);
+    }
+
+    events.sort();
+  }
+
+  const MidiHeldNotes &get_held_notes() const noexcept { return m_held; }
+
+private:
+  void release(MidiEventList &events, uint64_t offset) noexcept
+  {
+    events.push({static_cast<uint32_t>(offset), static_cast<uint8_t>(0x80 | m_sounding_channel), m_sounding_note, 0});
+    m_sounding = false;
+  }
+
+  /** @brief The held note for the current step, advancing the pattern
+   */
+  const MidiHeldNote &get_step_note() noexcept
+  {
+    const size_t count = m_held.size();
+    const size_t step = m_step++;
+    if (m_mode == eArpeggiatorMode::AsPlayed)
+      return m_held[step % count];
+
+    // Held notes by pitch
+    std::array<size_t, MIDI_EFFECT_MAX_NOTES> order;
+    for (size_t i = 0; i < count; ++i)
+    {
+      order[i] = i;
+    }
+    std::sort(order.begin(), order.begin() + count,
+              [this](size_t a, size_t b) { return m_held[a].note < m_held[b].note; });
+
+    size_t index = step % count;
+    if (m_mode == eArpeggiatorMode::Down)
+    {
+      index = count - 1 - index;
+    }
+    else if (m_mode == eArpeggiatorMode::UpDown && count > 1)
+    {
+      const size_t period = 2 * count - 2;
+      index = step % period;
+      index = index < count ? index : period - index;
+    }
+    return m_held[order[index]];
+  }
+
+  double m_beats_per_minute;
+  double m_beats;
+  eArpeggiatorMode m_mode;
+  double m_gate;
+
+  MidiHeldNotes m_held;
+  size_t m_step = 0;
+  bool m_sounding = false;
+  uint8_t m_sounding_channel = 0;
+  uint8_t m_sounding_note = 0;
+  uint64_t m_release_time = 0;
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // _MIDI_EFFECTS_H_
@@ -1,10 +1,16 @@
 #ifndef _MIDI_ENGINE_H
 #define _MIDI_ENGINE_H
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <vector>
 
 #include "miditypes.h"
+#include "midilearn.h"
+#include "midirecorder.h"
+#include "mpevoicemap.h"
 #include "engine.h"
 #include "subject.h"
 
@@ -13,11 +19,15 @@ class RtMidiIn;  // Forward declaration for RtMidiIn class
 namespace MinimalAudioEngine
 {
 
+class EngineContext;
+
 /** @class MidiEngine
  *  @brief The MidiEngine class is responsible for managing MIDI input.
  */
 class MidiEngine : public IEngine<MidiMessage>, public Subject<MidiMessage>
 {
+  friend class MinimalAudioEngine::EngineContext;
+
 public:
   static MidiEngine& instance()
   {
@@ -32,24 +42,76 @@ public:
 
   void receive_midi_message(const MidiMessage& message) noexcept
   {
+    record_midi_message(message);
+    m_mpe_voice_map.process(message);
+    m_midi_learn.process(message);
     push_message(message);
   }
 
+  bool receive_sysex(double deltatime, const unsigned char *bytes, size_t size) noexcept;
+
+  inline SysexPoolStatistics get_sysex_statistics() const
+  {
+    return p_sysex_pool->get_statistics();
+  }
+
+  /** @brief Set the MPE zones; controllers that send the MPE Configuration Message set them themselves
+   */
+  inline void set_mpe_layout(const MpeZoneLayout &layout) noexcept
+  {
+    m_mpe_voice_map.set_layout(layout);
+  }
+
+  /** @brief Voices and per-note expression of MPE input; readable from the audio callback
+   */
+  inline const MpeVoiceMap &get_mpe_voice_map() const noexcept
+  {
+    return m_mpe_voice_map;
+  }
+
+  /** @brief Controller bindings to registry parameters, applied as MIDI is received
+   */
+  inline MidiLearn &get_midi_learn() noexcept
+  {
+    return m_midi_learn;
+  }
+
+  bool start_recording(const MidiRecordingOptions &options);
+  std::optional<MidiRecordingStatistics> stop_recording();
+
+  inline bool is_recording() const noexcept
+  {
+    return m_recorder_slot.load(std::memory_order_acquire) != nullptr;
+  }
+
+  ~MidiEngine() override;
+
 private:
   MidiEngine();
-  ~MidiEngine() override;
 
   void run() override
   {
     while (is_running())
     {
-      std::this_thread::yield();
+      handle_messages();
     }
   }
 
-  void handle_messages() override {}
+  void handle_messages() override;
+
+  void record_midi_message(const MidiMessage &message) noexcept;
+  void report_mpe_layout();
 
   std::unique_ptr<RtMidiIn> p_midi_in;
+  std::unique_ptr<SysexPool> p_sysex_pool;  // SysEx payloads; outlives the messages that reference it
+  MpeVoiceMap m_mpe_voice_map;
+  uint64_t m_mpe_layout_changes_reported = 0;  // Engine thread only
+  MidiLearn m_midi_learn;
+
+  std::mutex m_recording_mutex;                      // Serializes start_recording and stop_recording
+  std::unique_ptr<MidiRecorder> p_recorder;          // Owns the recorder published in m_recorder_slot
+  std::atomic<MidiRecorder *> m_recorder_slot{nullptr};
+  std::atomic<unsigned int> m_recorder_users{0};     // Input threads inside record_midi_message
 };
 
 }  // namespace MinimalAudioEngine
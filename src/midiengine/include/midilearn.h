@@ -0,0 +1,125 @@
+#ifndef _MIDI_LEARN_H_
+#define _MIDI_LEARN_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "miditypes.h"
+#include "parameterregistry.h"
+
+namespace MinimalAudioEngine
+{
+
+constexpr size_t MIDI_LEARN_CHANNELS = 16;
+constexpr size_t MIDI_LEARN_CONTROLLERS = 128;
+constexpr size_t MIDI_LEARN_NRPN_SLOTS = 512;  // NRPN bindings, a power of two
+
+/** @enum eMidiBindingType
+ *  @brief What a binding listens to
+ */
+enum class eMidiBindingType
+{
+  ControlChange,
+  Nrpn,
+};
+
+/** @struct MidiBinding
+ *  @brief A controller bound to a parameter.
+ */
+struct MidiBinding
+{
+  eMidiBindingType type = eMidiBindingType::ControlChange;
+  uint8_t channel = 0;  // 0-based
+  uint16_t number = 0;  // Controller, or 14-bit NRPN number
+  ParameterId parameter = PARAMETER_NO_ID;
+
+  std::string to_string() const
+  {
+    return std::string(type == eMidiBindingType::Nrpn ? "NRPN " : "CC ") + std::to_string(number) +
+           " on channel " + std::to_string(channel + 1) + " -> parameter " + std::to_string(parameter);
+  }
+};
+
+/** @class MidiLearn
+ *  @brief Binds controllers and NRPNs to registry parameters, and sets the parameters as MIDI arrives.
+ *
+ *  process() runs where MIDI is dispatched. A controller finds its parameter in a table indexed by
+ *  channel and controller number; an NRPN in a fixed open-addressed table keyed by channel and
+ *  number. Both tables are atomics and bindings are only ever added in place, so binding from
+ *  another thread or learning on the input thread never takes a lock.
+ *  After learn(), the next controller or NRPN to move is bound to the parameter.
+ */
+class MidiLearn
+{
+public:
+  MidiLearn();
+
+  bool process(const MidiMessage &message) noexcept;
+
+  void learn(ParameterId parameter) noexcept;
+  void cancel_learn() noexcept;
+
+  /** @brief The parameter waiting for a controller to move, or PARAMETER_NO_ID
+   */
+  ParameterId get_learning() const noexcept { return m_learning.load(std::memory_order_acquire); }
+
+  bool bind_cc(uint8_t channel, uint8_t controller, ParameterId parameter) noexcept;
+  bool bind_nrpn(uint8_t channel, uint16_t number, ParameterId parameter) noexcept;
+  void unbind(ParameterId parameter) noexcept;
+  std::vector<MidiBinding> get_bindings() const;
+
+  /** @brief Controller and NRPN values that set a parameter
+   */
+  uint64_t get_values_applied() const noexcept { return m_applied.load(std::memory_order_relaxed); }
+
+  // Disable copy constructor and assignment operator
+  MidiLearn(const MidiLearn &) = delete;
+  MidiLearn &operator=(const MidiLearn &) = delete;
+
+private:
+  static constexpr uint32_t NO_KEY = UINT32_MAX;
+  static constexpr uint16_t NO_NRPN = UINT16_MAX;
+
+  /** @struct NrpnSlot
+   *  @brief An NRPN binding; once claimed, a slot keeps its key and only its parameter changes
+   */
+  struct NrpnSlot
+  {
+    std::atomic<uint32_t> key{NO_KEY};  // channel << 14 | number
+    std::atomic<ParameterId> parameter{PARAMETER_NO_ID};
+  };
+
+  /** @struct ChannelState
+   *  @brief Input-thread view of a channel's parameter number selection
+   */
+  struct ChannelState
+  {
+    uint8_t nrpn_msb = 0x7F;
+    uint8_t nrpn_lsb = 0x7F;
+    uint16_t nrpn = NO_NRPN;  // Selected NRPN, NO_NRPN while none or an RPN is selected
+    uint8_t data_msb = 0;
+    bool data_lsb = false;  // The selected NRPN has had an LSB, so its data entry is 14-bit
+  };
+
+  bool control_change(uint8_t channel, uint8_t controller, uint8_t value) noexcept;
+  bool apply_nrpn(uint8_t channel, uint16_t number, float normalized) noexcept;
+  bool apply(ParameterId parameter, float normalized) noexcept;
+  NrpnSlot *find_nrpn(uint32_t key) noexcept;
+  NrpnSlot *claim_nrpn(uint32_t key) noexcept;
+
+  std::array<std::atomic<ParameterId>, MIDI_LEARN_CHANNELS * MIDI_LEARN_CONTROLLERS> m_cc_bindings;
+  std::array<NrpnSlot, MIDI_LEARN_NRPN_SLOTS> m_nrpn_bindings;
+  std::atomic<ParameterId> m_learning{PARAMETER_NO_ID};
+  std::atomic<uint64_t> m_applied{0};
+
+  // Input thread only
+  std::array<ChannelState, MIDI_LEARN_CHANNELS> m_channels{};
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // _MIDI_LEARN_H_
@@ -0,0 +1,146 @@
+#ifndef _MIDI_RECORDER_H_
+#define _MIDI_RECORDER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "taskscheduler.h"
+
+namespace MinimalAudioEngine
+{
+
+constexpr size_t MIDI_RECORDER_DEFAULT_CAPACITY = 1 << 16;
+constexpr unsigned int MIDI_RECORDER_DEFAULT_PPQ = 960;
+constexpr double MIDI_RECORDER_GESTURE_GAP = 0.05;  // Seconds of quiet after which a thinned stream's last value is kept
+
+/** @struct MidiRecordingOptions
+ *  @brief Where and how incoming MIDI is recorded.
+ */
+struct MidiRecordingOptions
+{
+  std::filesystem::path path;       // Standard MIDI File (type 1) written when recording stops
+  unsigned int sample_rate = 48000;
+  unsigned int ppq = MIDI_RECORDER_DEFAULT_PPQ;  // Ticks per quarter note
+  double tempo_bpm = 120.0;         // Written as the file's only tempo; converts samples to ticks
+  size_t capacity = MIDI_RECORDER_DEFAULT_CAPACITY;  // Events held until the file is written; later events are dropped
+
+  // Thin controller, pressure and pitch bend streams: an event is dropped when it moves the
+  // value by no more than this from the last event kept. 0 keeps every event. Pitch bend is
+  // compared in the same 7-bit steps. Switch, data entry and mode controllers are never thinned.
+  unsigned int controller_tolerance = 0;
+
+  // Transport sample of an arrival time, e.g. AudioEngine::get_sample_time_at. Only set it while
+  // that transport runs. Either way, events are timed from the start of the recording.
+  std::function<uint64_t(std::chrono::steady_clock::time_point)> sample_clock;
+};
+
+/** @struct RecordedMidiEvent
+ *  @brief A channel message and the transport sample it arrived at. 16 bytes, no heap.
+ */
+struct RecordedMidiEvent
+{
+  uint64_t sample_time = 0;
+  uint8_t status = 0;
+  uint8_t data1 = 0;
+  uint8_t data2 = 0;
+  uint8_t size = 0;  // Bytes used in status, data1 and data2
+};
+
+/** @struct MidiRecordingStatistics
+ *  @brief Counters of a running or finished MIDI recording.
+ */
+struct MidiRecordingStatistics
+{
+  uint64_t events_recorded = 0;
+  uint64_t events_dropped = 0;   // Arrived with the buffer full
+  uint64_t events_ignored = 0;   // Not channel messages: SysEx, system common and real-time
+  uint64_t events_thinned = 0;   // Left out of the file by controller thinning
+  uint64_t events_written = 0;
+  unsigned int tracks = 0;       // Including the tempo track
+  uint64_t bytes_written = 0;
+  bool write_failed = false;
+
+  std::string to_string() const
+  {
+    return "MidiRecordingStatistics(Recorded=" + std::to_string(events_recorded) +
+           ", Dropped=" + std::to_string(events_dropped) +
+           ", Ignored=" + std::to_string(events_ignored) +
+           ", Thinned=" + std::to_string(events_thinned) +
+           ", Written=" + std::to_string(events_written) +
+           ", Tracks=" + std::to_string(tracks) +
+           ", Bytes=" + std::to_string(bytes_written) +
+           ", WriteFailed=" + (write_failed ? "Yes" : "No") + ")";
+  }
+};
+
+/** @class MidiRecorder
+ *  @brief Records incoming MIDI with sample-accurate timestamps and writes it to a Standard MIDI File.
+ *
+ *  Events go into a buffer allocated when the recorder is created; record() only copies
+ *  16 bytes and never allocates or locks. It must be called from one thread at a time,
+ *  the MIDI input thread. stop() hands the buffer to the shared TaskScheduler, which
+ *  writes a type 1 file: a tempo track plus one track per MIDI channel, with running
+ *  status, and optionally thins dense controller streams.
+ */
+class MidiRecorder
+{
+public:
+  static std::unique_ptr<MidiRecorder> create(const MidiRecordingOptions &options);
+  ~MidiRecorder();
+
+  void record(const unsigned char *bytes, size_t size, std::chrono::steady_clock::time_point arrival) noexcept;
+  void record_at(const unsigned char *bytes, size_t size, uint64_t sample_time) noexcept;
+
+  void stop();
+  MidiRecordingStatistics wait();
+
+  inline bool is_stopped() const noexcept
+  {
+    return m_stopped.load(std::memory_order_acquire);
+  }
+
+  MidiRecordingStatistics get_statistics() const;
+  const MidiRecordingOptions &get_options() const noexcept { return m_options; }
+  std::string to_string() const;
+
+  static std::vector<RecordedMidiEvent> thin(const std::vector<RecordedMidiEvent> &events, unsigned int tolerance,
+                                             uint64_t gesture_gap);
+
+  // Disable copy constructor and assignment operator
+  MidiRecorder(const MidiRecorder &) = delete;
+  MidiRecorder &operator=(const MidiRecorder &) = delete;
+
+private:
+  MidiRecorder() = default;
+
+  void write_file();
+  uint64_t get_tick(uint64_t sample_time) const noexcept;
+
+  MidiRecordingOptions m_options;
+  std::unique_ptr<RecordedMidiEvent[]> m_events;
+  std::chrono::steady_clock::time_point m_start;
+  uint64_t m_start_sample = 0;  // Transport sample of m_start, with a sample clock
+  std::atomic<size_t> m_count{0};
+  std::atomic<uint64_t> m_dropped{0};
+  std::atomic<uint64_t> m_ignored{0};
+  std::atomic<bool> m_stopped{false};
+
+  // Set by the write task
+  std::atomic<uint64_t> m_thinned{0};
+  std::atomic<uint64_t> m_written{0};
+  std::atomic<unsigned int> m_tracks{0};
+  std::atomic<uint64_t> m_bytes_written{0};
+  std::atomic<bool> m_write_failed{false};
+  TaskGroup m_write_group;
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // _MIDI_RECORDER_H_
@@ -6,6 +6,8 @@
 #include <array>
 #include <iostream>
 
+#include "sysexpool.h"
+
 namespace MinimalAudioEngine
 {
 
@@ -79,6 +81,7 @@ struct MidiMessage
   unsigned char data1;   // First data byte (e.g., note number, control change number)
   unsigned char data2;   // Second data byte (e.g., velocity, control change value)
   std::string_view type_name; // Human-readable name of the MIDI message type
+  SysexBuffer sysex;     // Whole message, F0 to F7, for System Exclusive; empty otherwise
 };
 
 inline std::ostream& operator<<(std::ostream& os, const MidiMessage& msg)
@@ -89,8 +92,12 @@ inline std::ostream& operator<<(std::ostream& os, const MidiMessage& msg)
       << ", type: " << msg.type_name
       << ", channel: " << static_cast<int>(msg.channel)
       << ", data1: " << static_cast<int>(msg.data1)
-      << ", data2: " << static_cast<int>(msg.data2)
-      << " }";
+      << ", data2: " << static_cast<int>(msg.data2);
+  if (msg.sysex)
+  {
+    os << ", sysex: " << msg.sysex.size() << " bytes";
+  }
+  os << " }";
   return os;
 }
 
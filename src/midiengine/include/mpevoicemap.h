@@ -0,0 +1,200 @@
+#ifndef _MPE_VOICE_MAP_H_
+#define _MPE_VOICE_MAP_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "miditypes.h"
+
+namespace MinimalAudioEngine
+{
+
+constexpr unsigned int MPE_MAX_VOICES = 32;
+constexpr unsigned int MPE_CHANNELS = 16;
+constexpr unsigned int MPE_MAX_MEMBERS = 15;
+constexpr float MPE_DEFAULT_NOTE_BEND_RANGE = 48.0f;    // Semitones, member channels
+constexpr float MPE_DEFAULT_MANAGER_BEND_RANGE = 2.0f;  // Semitones, manager channels
+constexpr uint8_t MPE_TIMBRE_CONTROLLER = 74;
+constexpr int MPE_NO_VOICE = -1;
+
+/** @struct MpeZoneLayout
+ *  @brief Member channels of the lower zone (manager channel 1) and the upper zone (manager channel 16).
+ *  A zone with no members is off; the lower zone takes precedence where the two would overlap.
+ */
+struct MpeZoneLayout
+{
+  unsigned int lower_members = 0;  // Channels 2 and up
+  unsigned int upper_members = 0;  // Channels 15 and down
+  float note_bend_range = MPE_DEFAULT_NOTE_BEND_RANGE;
+  float manager_bend_range = MPE_DEFAULT_MANAGER_BEND_RANGE;
+
+  std::string to_string() const
+  {
+    return "MpeZoneLayout(Lower=" + std::to_string(lower_members) +
+           ", Upper=" + std::to_string(upper_members) +
+           ", NoteBendRange=" + std::to_string(note_bend_range) +
+           ", ManagerBendRange=" + std::to_string(manager_bend_range) + ")";
+  }
+};
+
+/** @struct MpeVoice
+ *  @brief Snapshot of one voice and its per-note expression.
+ */
+struct MpeVoice
+{
+  uint32_t generation = 0;  // Changes with every note-on, so a reader can tell a reused voice apart
+  uint8_t channel = 0;
+  uint8_t note = 0;
+  uint8_t velocity = 0;
+  uint8_t release_velocity = 0;
+  bool active = false;
+  float pitch_bend = 0.0f;  // Semitones from the note, member and manager bend combined
+  float pressure = 0.0f;    // 0 to 1
+  float timbre = 0.5f;      // CC74, 0 to 1
+};
+
+/** @struct MpeStatistics
+ *  @brief Counters since the map was created.
+ */
+struct MpeStatistics
+{
+  uint64_t notes = 0;
+  uint64_t expression = 0;           // Per-note and zone-wide expression messages applied
+  uint64_t voices_stolen = 0;        // Note-ons that found every voice busy
+  uint64_t unmatched_note_offs = 0;
+  uint64_t layout_changes = 0;       // From set_layout() or the MPE Configuration Message
+
+  std::string to_string() const
+  {
+    return "MpeStatistics(Notes=" + std::to_string(notes) +
+           ", Expression=" + std::to_string(expression) +
+           ", Stolen=" + std::to_string(voices_stolen) +
+           ", UnmatchedNoteOffs=" + std::to_string(unmatched_note_offs) +
+           ", LayoutChanges=" + std::to_string(layout_changes) + ")";
+  }
+};
+
+/** @class MpeVoiceMap
+ *  @brief Maps MPE input onto a fixed set of voices.
+ *
+ *  process() runs on the MIDI input thread: a note table per channel finds the voice of a
+ *  note-off, and a voice mask per channel finds the voices a member channel's pitch bend,
+ *  pressure or timbre applies to, so expression costs the same table lookup as a note.
+ *  Expression sent on a member channel before its note-on is carried into the new voice.
+ *  Zones come from set_layout() or the MPE Configuration Message (RPN 6), and pitch bend
+ *  ranges from RPN 0. Voices are published with a sequence count per voice, so the audio
+ *  callback reads consistent snapshots without locking.
+ */
+class MpeVoiceMap
+{
+public:
+  MpeVoiceMap();
+
+  void set_layout(const MpeZoneLayout &layout) noexcept;
+  MpeZoneLayout get_layout() const noexcept;
+
+  /** @brief Number of layouts applied so far. The input thread never logs, so whoever reports the layout polls this.
+   */
+  uint64_t get_layout_changes() const noexcept { return m_layout_changes.load(std::memory_order_acquire); }
+
+  bool process(const MidiMessage &message) noexcept;
+
+  int get_voice_index(uint8_t channel, uint8_t note) const noexcept;
+  bool get_voice(unsigned int index, MpeVoice &voice) const noexcept;
+  size_t get_active_voices(MpeVoice *voices, size_t capacity) const noexcept;
+
+  MpeStatistics get_statistics() const noexcept;
+
+  // Disable copy constructor and assignment operator
+  MpeVoiceMap(const MpeVoiceMap &) = delete;
+  MpeVoiceMap &operator=(const MpeVoiceMap &) = delete;
+
+private:
+  /** @enum eChannelRole
+   *  @brief What a channel is in the current layout
+   */
+  enum class eChannelRole : uint8_t
+  {
+    None,
+    LowerManager,
+    LowerMember,
+    UpperManager,
+    UpperMember,
+  };
+
+  /** @struct VoiceSlot
+   *  @brief A voice as the callback reads it; odd sequence while the input thread writes it.
+   */
+  struct VoiceSlot
+  {
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<uint32_t> generation{0};
+    std::atomic<uint8_t> channel{0};
+    std::atomic<uint8_t> note{0};
+    std::atomic<uint8_t> velocity{0};
+    std::atomic<uint8_t> release_velocity{0};
+    std::atomic<bool> active{false};
+    std::atomic<float> pitch_bend{0.0f};
+    std::atomic<float> pressure{0.0f};
+    std::atomic<float> timbre{0.5f};
+  };
+
+  /** @struct ChannelState
+   *  @brief Input-thread view of a channel: its latest expression, voices and RPN selection
+   */
+  struct ChannelState
+  {
+    float bend = 0.0f;  // -1 to 1
+    float pressure = 0.0f;
+    float timbre = 0.5f;
+    uint32_t voices = 0;  // Mask of the voices sounding on the channel
+    uint8_t rpn_msb = 0x7F;
+    uint8_t rpn_lsb = 0x7F;
+    std::array<std::atomic<int8_t>, 128> note_voice;  // Voice of each note, MPE_NO_VOICE if none
+  };
+
+  void apply_pending_layout() noexcept;
+  void apply_layout(unsigned int lower_members, unsigned int upper_members) noexcept;
+  void release_all() noexcept;
+  void release_voice(unsigned int index, uint8_t release_velocity) noexcept;
+
+  void note_on(uint8_t channel, uint8_t note, uint8_t velocity) noexcept;
+  void note_off(uint8_t channel, uint8_t note, uint8_t velocity) noexcept;
+  void control_change(uint8_t channel, uint8_t controller, uint8_t value) noexcept;
+  void update_channel_voices(uint8_t channel) noexcept;
+  void update_zone_voices(eChannelRole manager) noexcept;
+  float get_voice_pitch_bend(uint8_t channel) const noexcept;
+  unsigned int allocate_voice() noexcept;
+
+  void begin_write(VoiceSlot &slot) noexcept;
+  void end_write(VoiceSlot &slot) noexcept;
+
+  std::array<VoiceSlot, MPE_MAX_VOICES> m_voices;
+
+  // Input thread only
+  std::array<ChannelState, MPE_CHANNELS> m_channels;
+  std::array<eChannelRole, MPE_CHANNELS> m_roles;
+  uint32_t m_free_voices = 0;  // Mask of the free voices
+  uint32_t m_next_generation = 1;
+
+  // Written by set_layout, picked up by the input thread with its next message
+  std::atomic<uint32_t> m_pending_layout;
+  std::atomic<float> m_pending_note_bend_range{MPE_DEFAULT_NOTE_BEND_RANGE};
+  std::atomic<float> m_pending_manager_bend_range{MPE_DEFAULT_MANAGER_BEND_RANGE};
+  std::atomic<uint32_t> m_layout{0};  // Applied layout, lower members | upper members << 8
+  std::atomic<float> m_note_bend_range{MPE_DEFAULT_NOTE_BEND_RANGE};  // Shared by both zones
+  std::atomic<float> m_manager_bend_range{MPE_DEFAULT_MANAGER_BEND_RANGE};
+  std::atomic<uint64_t> m_layout_changes{0};
+
+  std::atomic<uint64_t> m_notes{0};
+  std::atomic<uint64_t> m_expression{0};
+  std::atomic<uint64_t> m_stolen{0};
+  std::atomic<uint64_t> m_unmatched{0};
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // _MPE_VOICE_MAP_H_
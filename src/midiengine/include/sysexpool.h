@@ -0,0 +1,176 @@
+#ifndef _SYSEX_POOL_H_
+#define _SYSEX_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace MinimalAudioEngine
+{
+
+constexpr size_t SYSEX_POOL_DEFAULT_BLOCK_SIZE = 256;
+constexpr size_t SYSEX_POOL_DEFAULT_BLOCKS = 4096;  // 1 MiB, several large patch dumps in flight
+constexpr uint32_t SYSEX_NO_BLOCK = UINT32_MAX;
+
+class SysexPool;
+
+/** @class SysexBuffer
+ *  @brief Handle to a complete SysEx message, F0 to F7, held in a SysexPool.
+ *
+ *  Copies share the payload; the last one to go returns its blocks to the pool, from any
+ *  thread. Nothing is copied or allocated. The pool must outlive every buffer taken from it.
+ */
+class SysexBuffer
+{
+  friend class SysexPool;
+
+public:
+  SysexBuffer() noexcept = default;
+  SysexBuffer(const SysexBuffer &other) noexcept;
+  SysexBuffer(SysexBuffer &&other) noexcept;
+  SysexBuffer &operator=(const SysexBuffer &other) noexcept;
+  SysexBuffer &operator=(SysexBuffer &&other) noexcept;
+  ~SysexBuffer();
+
+  explicit operator bool() const noexcept { return p_pool != nullptr; }
+
+  size_t size() const noexcept;
+  size_t copy_to(uint8_t *destination, size_t capacity) const noexcept;
+  std::vector<uint8_t> to_vector() const;
+
+  /** @brief Visit the payload in place, one contiguous chunk at a time
+   *  @param function Called with a std::span<const uint8_t> per chunk, in order
+   */
+  template <typename Function>
+  void for_each_chunk(Function &&function) const;
+
+private:
+  SysexBuffer(SysexPool *pool, uint32_t head) noexcept : p_pool(pool), m_head(head) {}
+
+  void reset() noexcept;
+
+  SysexPool *p_pool = nullptr;
+  uint32_t m_head = SYSEX_NO_BLOCK;
+};
+
+/** @struct SysexPoolStatistics
+ *  @brief Counters of a SysexPool since it was created.
+ */
+struct SysexPoolStatistics
+{
+  uint64_t messages = 0;            // Complete messages handed out
+  uint64_t bytes = 0;               // Bytes in those messages
+  uint64_t messages_dropped = 0;    // Did not fit in the free blocks
+  uint64_t messages_truncated = 0;  // Cut off by another status byte before their F7
+  uint64_t fragments_ignored = 0;   // Continuations with no message started
+  size_t blocks = 0;
+  size_t blocks_free = 0;
+
+  std::string to_string() const
+  {
+    return "SysexPoolStatistics(Messages=" + std::to_string(messages) +
+           ", Bytes=" + std::to_string(bytes) +
+           ", Dropped=" + std::to_string(messages_dropped) +
+           ", Truncated=" + std::to_string(messages_truncated) +
+           ", Ignored=" + std::to_string(fragments_ignored) +
+           ", Free=" + std::to_string(blocks_free) + "/" + std::to_string(blocks) + ")";
+  }
+};
+
+/** @class SysexPool
+ *  @brief Fixed arena of blocks that System Exclusive messages are assembled into.
+ *
+ *  The MIDI input thread passes each fragment to assemble(), which copies its bytes once
+ *  into a chain of blocks taken from a lock-free free list, and hands out a SysexBuffer
+ *  when the F7 arrives. Only one thread may assemble; buffers can be released anywhere.
+ *  Neither assembling nor releasing allocates or locks.
+ */
+class SysexPool
+{
+  friend class SysexBuffer;
+
+public:
+  static std::unique_ptr<SysexPool> create(size_t block_size = SYSEX_POOL_DEFAULT_BLOCK_SIZE,
+                                           size_t blocks = SYSEX_POOL_DEFAULT_BLOCKS);
+
+  SysexBuffer assemble(const uint8_t *bytes, size_t size) noexcept;
+  void abort() noexcept;
+
+  /** @brief Whether a message has started and its F7 has not arrived yet
+   */
+  inline bool is_assembling() const noexcept
+  {
+    return m_assembling;
+  }
+
+  SysexPoolStatistics get_statistics() const;
+  std::string to_string() const;
+
+  // Disable copy constructor and assignment operator
+  SysexPool(const SysexPool &) = delete;
+  SysexPool &operator=(const SysexPool &) = delete;
+
+private:
+  SysexPool() = default;
+
+  /** @struct Block
+   *  @brief Bookkeeping of one block; the bytes live in the arena.
+   */
+  struct Block
+  {
+    std::atomic<uint32_t> references{0};  // Head block only
+    uint32_t next = SYSEX_NO_BLOCK;
+    uint32_t length = 0;                  // Bytes used in this block
+    uint32_t total = 0;                   // Bytes in the whole message, head block only
+  };
+
+  inline const uint8_t *get_data(uint32_t block) const noexcept
+  {
+    return m_arena.get() + static_cast<size_t>(block) * m_block_size;
+  }
+
+  uint32_t pop_free() noexcept;
+  void push_free(uint32_t head) noexcept;
+  bool append(uint8_t byte) noexcept;
+  void discard(bool truncated) noexcept;
+
+  size_t m_block_size = 0;
+  size_t m_block_count = 0;
+  std::unique_ptr<uint8_t[]> m_arena;
+  std::unique_ptr<Block[]> m_blocks;
+  std::atomic<uint32_t> m_free_head{SYSEX_NO_BLOCK};  // Popped only by the assembling thread, so no ABA
+  std::atomic<size_t> m_free_count{0};
+
+  // Assembling thread only
+  bool m_assembling = false;
+  bool m_discarding = false;  // Out of blocks: swallow the rest of the message
+  uint32_t m_head = SYSEX_NO_BLOCK;
+  uint32_t m_tail = SYSEX_NO_BLOCK;
+  uint32_t m_size = 0;
+
+  std::atomic<uint64_t> m_messages{0};
+  std::atomic<uint64_t> m_bytes{0};
+  std::atomic<uint64_t> m_dropped{0};
+  std::atomic<uint64_t> m_truncated{0};
+  std::atomic<uint64_t> m_ignored{0};
+};
+
+template <typename Function>
+void SysexBuffer::for_each_chunk(Function &&function) const
+{
+  if (p_pool == nullptr)
+    return;
+
+  for (uint32_t block = m_head; block != SYSEX_NO_BLOCK; block = p_pool->m_blocks[block].next)
+  {
+    function(std::span<const uint8_t>(p_pool->get_data(block), p_pool->m_blocks[block].length));
+  }
+}
+
+}  // namespace MinimalAudioEngine
+
+#endif  // _SYSEX_POOL_H_
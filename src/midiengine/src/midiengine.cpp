@@ -31,6 +31,12 @@ void midi_callback(double deltatime, std::vector<unsigned char> *message, void *
       return;
     }
   
+    // SysEx, possibly in fragments, goes to the pool instead of the two data bytes
+    if (midi_engine->receive_sysex(deltatime, message->data(), message->size()))
+    {
+      return;
+    }
+
     // Parse incoming MIDI messages
     MidiMessage midi_message;
   
@@ -71,6 +77,12 @@ MidiEngine::MidiEngine(): IEngine("MidiEngine")
     LOG_ERROR("Failed to create MIDI input instance.");
     throw std::runtime_error("Failed to create MIDI input instance");
   }
+
+  p_sysex_pool = SysexPool::create();
+  if (!p_sysex_pool)
+  {
+    throw std::runtime_error("Failed to create the SysEx pool");
+  }
 }
 
 /** @brief Destructor for the MidiEngine class.
@@ -78,6 +90,137 @@ MidiEngine::MidiEngine(): IEngine("MidiEngine")
 MidiEngine::~MidiEngine()
 {
   close_input_port();
+  stop_thread();
+
+  // Queued messages may hold SysEx payloads, which must go back before the pool does
+  while (try_pop_message().has_value())
+  {
+  }
+}
+
+/** @brief Deliver the next queued message to the observers. Blocks until one arrives or the thread stops.
+ */
+void MidiEngine::handle_messages()
+{
+  report_mpe_layout();
+
+  auto message = pop_message();
+  if (message.has_value())
+  {
+    notify(*message);
+  }
+  else
+  {
+    std::this_thread::yield();
+  }
+}
+
+/** @brief Log the MPE zones once the input thread has changed them. Engine thread only.
+ */
+void MidiEngine::report_mpe_layout()
+{
+  const uint64_t layout_changes = m_mpe_voice_map.get_layout_changes();
+  if (layout_changes != m_mpe_layout_changes_reported)
+  {
+    m_mpe_layout_changes_reported = layout_changes;
+    LOG_INFO("MidiEngine: MPE layout ", m_mpe_voice_map.get_layout().to_string());
+  }
+}
+
+/** @brief Assemble System Exclusive input into the SysEx pool. Called from the MIDI input thread.
+ *  A complete message is delivered like any other, with its payload in MidiMessage::sysex.
+ *  @param deltatime Seconds since the previous input, as reported by RtMidi
+ *  @param bytes A whole message, or a fragment of a SysEx message
+ *  @param size Bytes received
+ *  @return True if the bytes were SysEx, false if they are another message to parse as usual.
+ */
+bool MidiEngine::receive_sysex(double deltatime, const unsigned char *bytes, size_t size) noexcept
+{
+  if (bytes == nullptr || size == 0)
+    return false;
+
+  if (bytes[0] != static_cast<unsigned char>(eMidiMessageType::SystemExclusive) &&
+      !(bytes[0] < 0x80 && p_sysex_pool->is_assembling()))
+  {
+    // Real-time messages may interleave with a dump; anything else ends it
+    if (bytes[0] < static_cast<unsigned char>(eMidiMessageType::TimingClock))
+    {
+      p_sysex_pool->abort();
+    }
+    return false;
+  }
+
+  SysexBuffer sysex = p_sysex_pool->assemble(bytes, size);
+  if (sysex)
+  {
+    MidiMessage message{};
+    message.deltatime = deltatime;
+    message.status = static_cast<unsigned char>(eMidiMessageType::SystemExclusive);
+    message.type = eMidiMessageType::SystemExclusive;
+    message.type_name = "System Exclusive";
+    message.sysex = std::move(sysex);
+    receive_midi_message(message);
+  }
+  return true;
+}
+
+/** @brief Start recording incoming MIDI.
+ *  @param options File, timing and capacity of the recording; see MidiRecorder.
+ *  @return True if recording started, false if already recording or the options are invalid.
+ */
+bool MidiEngine::start_recording(const MidiRecordingOptions &options)
+{
+  std::lock_guard<std::mutex> lock(m_recording_mutex);
+  if (p_recorder)
+  {
+    LOG_ERROR("MidiEngine: Already recording to ", p_recorder->get_options().path.string());
+    return false;
+  }
+
+  p_recorder = MidiRecorder::create(options);
+  if (!p_recorder)
+    return false;
+
+  m_recorder_slot.store(p_recorder.get(), std::memory_order_release);
+  return true;
+}
+
+/** @brief Stop recording and wait for the file to be written.
+ *  @return The statistics of the recording, or nullopt if nothing was recording.
+ */
+std::optional<MidiRecordingStatistics> MidiEngine::stop_recording()
+{
+  std::lock_guard<std::mutex> lock(m_recording_mutex);
+  if (!p_recorder)
+    return std::nullopt;
+
+  // Unpublish, then let an input thread that already picked the recorder up finish with it
+  m_recorder_slot.store(nullptr, std::memory_order_release);
+  while (m_recorder_users.load(std::memory_order_acquire) != 0)
+  {
+    std::this_thread::yield();
+  }
+
+  p_recorder->stop();
+  MidiRecordingStatistics statistics = p_recorder->wait();
+  p_recorder.reset();
+  LOG_INFO("MidiEngine: Recording stopped, ", statistics.to_string());
+  return statistics;
+}
+
+/** @brief Hand an incoming message to the recorder, if one is running. Called from the MIDI input thread.
+ */
+void MidiEngine::record_midi_message(const MidiMessage &message) noexcept
+{
+  const auto arrival = std::chrono::steady_clock::now();
+  m_recorder_users.fetch_add(1, std::memory_order_acq_rel);
+  MidiRecorder *recorder = m_recorder_slot.load(std::memory_order_acquire);
+  if (recorder != nullptr)
+  {
+    const unsigned char bytes[] = {message.status, message.data1, message.data2};
+    recorder->record(bytes, sizeof(bytes), arrival);
+  }
+  m_recorder_users.fetch_sub(1, std::memory_order_release);
 }
 
 /** @brief Lists all available MIDI input ports.
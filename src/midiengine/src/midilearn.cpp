@@ -0,0 +1,250 @@
+#include "midilearn.h"
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+constexpr uint8_t CC_DATA_ENTRY_MSB = 6;
+constexpr uint8_t CC_DATA_ENTRY_LSB = 38;
+constexpr uint8_t CC_NRPN_LSB = 98;
+constexpr uint8_t CC_NRPN_MSB = 99;
+constexpr uint8_t CC_RPN_LSB = 100;
+constexpr uint8_t CC_RPN_MSB = 101;
+constexpr uint16_t NRPN_NUMBERS = 1 << 14;
+constexpr float NRPN_MAX_VALUE = 16383.0f;
+
+static_assert((MIDI_LEARN_NRPN_SLOTS & (MIDI_LEARN_NRPN_SLOTS - 1)) == 0, "NRPN slots must be a power of two");
+
+uint32_t make_nrpn_key(uint8_t channel, uint16_t number)
+{
+  return static_cast<uint32_t>(channel) << 14 | number;
+}
+
+size_t hash_nrpn_key(uint32_t key)
+{
+  return static_cast<size_t>((key * 2654435761u) >> 16) & (MIDI_LEARN_NRPN_SLOTS - 1);
+}
+
+}  // namespace
+
+MidiLearn::MidiLearn()
+{
+  for (auto &binding : m_cc_bindings)
+  {
+    binding.store(PARAMETER_NO_ID, std::memory_order_relaxed);
+  }
+}
+
+/** @brief Set the parameter a controller or NRPN is bound to, or bind it while learning.
+ *  Called where MIDI is dispatched; never locks or allocates.
+ *  @param message A MIDI message; only control changes are used.
+ *  @return True if a parameter was set.
+ */
+bool MidiLearn::process(const MidiMessage &message) noexcept
+{
+  if ((message.status & 0xF0) != 0xB0)
+    return false;
+
+  return control_change(message.status & 0x0F, message.data1 & 0x7F, message.data2 & 0x7F);
+}
+
+/** @brief Bind the next controller or NRPN to move to a parameter, replacing the parameter's bindings
+ */
+void MidiLearn::learn(ParameterId parameter) noexcept
+{
+  m_learning.store(parameter, std::memory_order_release);
+}
+
+void MidiLearn::cancel_learn() noexcept
+{
+  m_learning.store(PARAMETER_NO_ID, std::memory_order_release);
+}
+
+/** @brief Bind a controller to a parameter; it keeps any other bindings. Any thread.
+ *  @param channel 0-based channel
+ *  @param controller Controller number
+ *  @param parameter Registry id of the parameter
+ *  @return False for an invalid channel or controller.
+ */
+bool MidiLearn::bind_cc(uint8_t channel, uint8_t controller, ParameterId parameter) noexcept
+{
+  if (channel >= MIDI_LEARN_CHANNELS || controller >= MIDI_LEARN_CONTROLLERS)
+    return false;
+
+  m_cc_bindings[channel * MIDI_LEARN_CONTROLLERS + controller].store(parameter, std::memory_order_release);
+  return true;
+}
+
+/** @brief Bind an NRPN to a parameter; it keeps any other bindings. Any thread.
+ *  @param channel 0-based channel
+ *  @param number 14-bit parameter number
+ *  @param parameter Registry id of the parameter
+ *  @return False for an invalid channel or number, or once MIDI_LEARN_NRPN_SLOTS NRPNs are bound.
+ */
+bool MidiLearn::bind_nrpn(uint8_t channel, uint16_t number, ParameterId parameter) noexcept
+{
+  if (channel >= MIDI_LEARN_CHANNELS || number >= NRPN_NUMBERS)
+    return false;
+
+  NrpnSlot *slot = claim_nrpn(make_nrpn_key(channel, number));
+  if (slot == nullptr)
+    return false;
+
+  slot->parameter.store(parameter, std::memory_order_release);
+  return true;
+}
+
+/** @brief Remove every binding to a parameter. Any thread.
+ */
+void MidiLearn::unbind(ParameterId parameter) noexcept
+{
+  for (auto &binding : m_cc_bindings)
+  {
+    ParameterId expected = parameter;
+    binding.compare_exchange_strong(expected, PARAMETER_NO_ID, std::memory_order_acq_rel);
+  }
+  for (auto &slot : m_nrpn_bindings)
+  {
+    ParameterId expected = parameter;
+    slot.parameter.compare_exchange_strong(expected, PARAMETER_NO_ID, std::memory_order_acq_rel);
+  }
+}
+
+std::vector<MidiBinding> MidiLearn::get_bindings() const
+{
+  std::vector<MidiBinding> bindings;
+  for (size_t i = 0; i < m_cc_bindings.size(); ++i)
+  {
+    const ParameterId parameter = m_cc_bindings[i].load(std::memory_order_acquire);
+    if (parameter != PARAMETER_NO_ID)
+    {
+      bindings.push_back({eMidiBindingType::ControlChange, static_cast<uint8_t>(i / MIDI_LEARN_CONTROLLERS),
+                          static_cast<uint16_t>(i % MIDI_LEARN_CONTROLLERS), parameter});
+    }
+  }
+  for (const auto &slot : m_nrpn_bindings)
+  {
+    const uint32_t key = slot.key.load(std::memory_order_acquire);
+    const ParameterId parameter = slot.parameter.load(std::memory_order_acquire);
+    if (key != NO_KEY && parameter != PARAMETER_NO_ID)
+    {
+      bindings.push_back({eMidiBindingType::Nrpn, static_cast<uint8_t>(key >> 14),
+                          static_cast<uint16_t>(key & (NRPN_NUMBERS - 1)), parameter});
+    }
+  }
+  return bindings;
+}
+
+/** @brief Follow the NRPN selection and data entry, and apply plain controllers
+ *  @return True if a parameter was set.
+ */
+bool MidiLearn::control_change(uint8_t channel, uint8_t controller, uint8_t value) noexcept
+{
+  ChannelState &state = m_channels[channel];
+  switch (controller)
+  {
+    case CC_NRPN_MSB:
+    case CC_NRPN_LSB:
+      (controller == CC_NRPN_MSB ? state.nrpn_msb : state.nrpn_lsb) = value;
+      // 127/127 is the null parameter number
+      state.nrpn = (state.nrpn_msb == 0x7F && state.nrpn_lsb == 0x7F)
+                       ? NO_NRPN
+                       : static_cast<uint16_t>(state.nrpn_msb << 7 | state.nrpn_lsb);
+      state.data_lsb = false;
+      return false;
+    case CC_RPN_MSB:
+    case CC_RPN_LSB:
+      state.nrpn = NO_NRPN;
+      return false;
+    case CC_DATA_ENTRY_MSB:
+      if (state.nrpn != NO_NRPN)
+      {
+        // Until an LSB arrives the MSB alone is the value, so 127 reaches the top of the range
+        state.data_msb = value;
+        return apply_nrpn(channel, state.nrpn,
+                          state.data_lsb ? static_cast<float>(value << 7) / NRPN_MAX_VALUE
+                                         : static_cast<float>(value) / 127.0f);
+      }
+      break;
+    case CC_DATA_ENTRY_LSB:
+      if (state.nrpn != NO_NRPN)
+      {
+        state.data_lsb = true;
+        return apply_nrpn(channel, state.nrpn, static_cast<float>(state.data_msb << 7 | value) / NRPN_MAX_VALUE);
+      }
+      break;
+    default:
+      break;
+  }
+
+  ParameterId learning = m_learning.load(std::memory_order_acquire);
+  if (learning != PARAMETER_NO_ID && m_learning.compare_exchange_strong(learning, PARAMETER_NO_ID))
+  {
+    unbind(learning);
+    bind_cc(channel, controller, learning);
+  }
+
+  return apply(m_cc_bindings[channel * MIDI_LEARN_CONTROLLERS + controller].load(std::memory_order_acquire),
+               static_cast<float>(value) / 127.0f);
+}
+
+bool MidiLearn::apply_nrpn(uint8_t channel, uint16_t number, float normalized) noexcept
+{
+  const uint32_t key = make_nrpn_key(channel, number);
+  ParameterId learning = m_learning.load(std::memory_order_acquire);
+  if (learning != PARAMETER_NO_ID && m_learning.compare_exchange_strong(learning, PARAMETER_NO_ID))
+  {
+    unbind(learning);
+    bind_nrpn(channel, number, learning);
+  }
+
+  NrpnSlot *slot = find_nrpn(key);
+  return slot != nullptr && apply(slot->parameter.load(std::memory_order_acquire), normalized);
+}
+
+bool MidiLearn::apply(ParameterId parameter, float normalized) noexcept
+{
+  if (parameter == PARAMETER_NO_ID || !ParameterRegistry::instance().set_normalized(parameter, normalized))
+    return false;
+
+  m_applied.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+/** @brief Find the slot of a bound NRPN
+ *  @return The slot, or nullptr if the NRPN was never bound.
+ */
+MidiLearn::NrpnSlot *MidiLearn::find_nrpn(uint32_t key) noexcept
+{
+  size_t index = hash_nrpn_key(key);
+  for (size_t probe = 0; probe < MIDI_LEARN_NRPN_SLOTS; ++probe)
+  {
+    const uint32_t slot_key = m_nrpn_bindings[index].key.load(std::memory_order_acquire);
+    if (slot_key == key)
+      return &m_nrpn_bindings[index];
+    if (slot_key == NO_KEY)
+      return nullptr;
+    index = (index + 1) & (MIDI_LEARN_NRPN_SLOTS - 1);
+  }
+  return nullptr;
+}
+
+/** @brief Find or claim the slot of an NRPN. Safe against concurrent claims.
+ *  @return The slot, or nullptr if the table is full.
+ */
+MidiLearn::NrpnSlot *MidiLearn::claim_nrpn(uint32_t key) noexcept
+{
+  size_t index = hash_nrpn_key(key);
+  for (size_t probe = 0; probe < MIDI_LEARN_NRPN_SLOTS; ++probe)
+  {
+    NrpnSlot &slot = m_nrpn_bindings[index];
+    uint32_t slot_key = slot.key.load(std::memory_order_acquire);
+    if (slot_key == NO_KEY && slot.key.compare_exchange_strong(slot_key, key, std::memory_order_acq_rel))
+      return &slot;
+    if (slot_key == key)
+      return &slot;
+    index = (index + 1) & (MIDI_LEARN_NRPN_SLOTS - 1);
+  }
+  return nullptr;
+}
@@ -0,0 +1,402 @@
+#include "midirecorder.h"
+
+#include "logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+constexpr unsigned int CHANNEL_COUNT = 16;
+constexpr size_t STREAMS_PER_CHANNEL = 258;  // 128 controllers, 128 poly pressure keys, channel pressure, pitch bend
+constexpr size_t NO_STREAM = static_cast<size_t>(-1);
+
+/** @brief Length of a channel message from its status byte, 0 for anything else
+ */
+uint8_t get_message_size(uint8_t status) noexcept
+{
+  if (status < 0x80 || status >= 0xF0)
+    return 0;
+  const uint8_t type = status & 0xF0;
+  return (type == 0xC0 || type == 0xD0) ? 2 : 3;
+}
+
+/** @brief Controllers whose every value matters: bank select, data entry, switches, RPN/NRPN and channel mode
+ */
+bool is_unthinnable_controller(uint8_t controller) noexcept
+{
+  return controller == 0 || controller == 6 || controller == 32 || controller == 38 ||
+         (controller >= 64 && controller <= 69) || (controller >= 96 && controller <= 101) || controller >= 120;
+}
+
+/** @brief The continuous stream an event belongs to, or NO_STREAM if it is never thinned
+ */
+size_t get_stream(const RecordedMidiEvent &event) noexcept
+{
+  const size_t base = static_cast<size_t>(event.status & 0x0F) * STREAMS_PER_CHANNEL;
+  switch (event.status & 0xF0)
+  {
+    case 0xB0:
+      return is_unthinnable_controller(event.data1) ? NO_STREAM : base + event.data1;
+    case 0xA0:
+      return base + 128 + event.data1;
+    case 0xD0:
+      return base + 256;
+    case 0xE0:
+      return base + 257;
+    default:
+      return NO_STREAM;
+  }
+}
+
+/** @brief Value of a continuous event on a 14-bit scale, so pitch bend and 7-bit values share a tolerance
+ */
+int get_stream_value(const RecordedMidiEvent &event) noexcept
+{
+  switch (event.status & 0xF0)
+  {
+    case 0xD0:
+      return event.data1 << 7;
+    case 0xE0:
+      return event.data1 | (event.data2 << 7);
+    default:
+      return event.data2 << 7;
+  }
+}
+
+void write_variable_length(std::vector<uint8_t> &out, uint64_t value)
+{
+  uint8_t bytes[10];
+  size_t count = 0;
+  do
+  {
+    bytes[count++] = static_cast<uint8_t>(value & 0x7F);
+    value >>= 7;
+  } while (value != 0 && count < sizeof(bytes));
+
+  while (count > 0)
+  {
+    --count;
+    out.push_back(static_cast<uint8_t>(bytes[count] | (count > 0 ? 0x80 : 0x00)));
+  }
+}
+
+void write_big_endian(std::vector<uint8_t> &out, uint32_t value, unsigned int bytes)
+{
+  for (unsigned int i = bytes; i > 0; --i)
+  {
+    out.push_back(static_cast<uint8_t>(value >> (8 * (i - 1))));
+  }
+}
+
+void write_meta_event(std::vector<uint8_t> &out, uint8_t type, const std::vector<uint8_t> &data)
+{
+  out.push_back(0x00);  // Delta time
+  out.push_back(0xFF);
+  out.push_back(type);
+  write_variable_length(out, data.size());
+  out.insert(out.end(), data.begin(), data.end());
+}
+
+void write_track(std::vector<uint8_t> &file, const std::vector<uint8_t> &track)
+{
+  file.insert(file.end(), {'M', 'T', 'r', 'k'});
+  write_big_endian(file, static_cast<uint32_t>(track.size()), 4);
+  file.insert(file.end(), track.begin(), track.end());
+}
+
+}  // namespace
+
+/** @brief Allocate the event buffer. Nothing is allocated once recording has started.
+ *  @param options File, timing and capacity of the recording.
+ *  @return The recorder, or nullptr if the options cannot be recorded.
+ */
+std::unique_ptr<MidiRecorder> MidiRecorder::create(const MidiRecordingOptions &options)
+{
+  if (options.path.empty() || options.capacity == 0)
+  {
+    LOG_ERROR("MidiRecorder: A file path and a non-zero capacity are required");
+    return nullptr;
+  }
+  if (options.sample_rate == 0 || options.ppq == 0 || options.ppq > 0x7FFF || !(options.tempo_bpm > 0.0))
+  {
+    LOG_ERROR("MidiRecorder: Invalid timing, ", options.sample_rate, " Hz, ", options.ppq, " PPQ, ",
+              options.tempo_bpm, " BPM");
+    return nullptr;
+  }
+
+  std::unique_ptr<MidiRecorder> recorder(new MidiRecorder());
+  recorder->m_options = options;
+  recorder->m_events = std::make_unique<RecordedMidiEvent[]>(options.capacity);
+  recorder->m_start = std::chrono::steady_clock::now();
+  if (options.sample_clock)
+  {
+    recorder->m_start_sample = options.sample_clock(recorder->m_start);
+  }
+  LOG_INFO("MidiRecorder: Recording to ", options.path.string(), ", room for ", options.capacity, " events");
+  return recorder;
+}
+
+/** @brief Destructor. Writes the file here if the recording was never stopped, else waits for the write.
+ */
+MidiRecorder::~MidiRecorder()
+{
+  if (!m_stopped.exchange(true, std::memory_order_acq_rel))
+  {
+    write_file();
+  }
+  m_write_group.wait();
+}
+
+/** @brief Record a message at the sample its arrival time maps to, counted from the start of the recording.
+ *  Called from the MIDI input thread.
+ *  @param bytes The message
+ *  @param size Bytes in the message
+ *  @param arrival When the message arrived
+ */
+void MidiRecorder::record(const unsigned char *bytes, size_t size, std::chrono::steady_clock::time_point arrival) noexcept
+{
+  uint64_t sample_time = 0;
+  if (m_options.sample_clock)
+  {
+    const uint64_t transport_sample = m_options.sample_clock(arrival);
+    sample_time = transport_sample > m_start_sample ? transport_sample - m_start_sample : 0;
+  }
+  else if (arrival > m_start)
+  {
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(arrival - m_start).count();
+    sample_time = static_cast<uint64_t>(static_cast<double>(elapsed) * m_options.sample_rate / 1e9);
+  }
+  record_at(bytes, size, sample_time);
+}
+
+/** @brief Record a message at a transport sample. Never blocks or allocates; single producer.
+ *  Only channel messages are kept. Once the buffer is full, further messages are counted as dropped.
+ *  @param bytes The message
+ *  @param size Bytes in the message
+ *  @param sample_time Sample of the message, counted from the start of the recording
+ */
+void MidiRecorder::record_at(const unsigned char *bytes, size_t size, uint64_t sample_time) noexcept
+{
+  if (m_stopped.load(std::memory_order_relaxed))
+    return;
+
+  const uint8_t message_size = (bytes != nullptr && size > 0) ? get_message_size(bytes[0]) : 0;
+  if (message_size == 0 || size < message_size)
+  {
+    m_ignored.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  const size_t index = m_count.load(std::memory_order_relaxed);
+  if (index >= m_options.capacity)
+  {
+    m_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  RecordedMidiEvent &event = m_events[index];
+  event.sample_time = sample_time;
+  event.status = bytes[0];
+  event.data1 = bytes[1] & 0x7F;
+  event.data2 = message_size > 2 ? (bytes[2] & 0x7F) : 0;
+  event.size = message_size;
+  m_count.store(index + 1, std::memory_order_release);
+}
+
+/** @brief Stop recording and write the file on the shared TaskScheduler. Later messages are ignored.
+ */
+void MidiRecorder::stop()
+{
+  if (m_stopped.exchange(true, std::memory_order_acq_rel))
+    return;
+
+  TaskScheduler::instance().submit(m_write_group, [this]() { write_file(); }, eTaskPriority::High);
+}
+
+/** @brief Wait for the file to be written.
+ *  @return The statistics of the finished recording.
+ */
+MidiRecordingStatistics MidiRecorder::wait()
+{
+  m_write_group.wait();
+  return get_statistics();
+}
+
+MidiRecordingStatistics MidiRecorder::get_statistics() const
+{
+  MidiRecordingStatistics statistics;
+  statistics.events_recorded = m_count.load(std::memory_order_acquire);
+  statistics.events_dropped = m_dropped.load(std::memory_order_relaxed);
+  statistics.events_ignored = m_ignored.load(std::memory_order_relaxed);
+  statistics.events_thinned = m_thinned.load(std::memory_order_relaxed);
+  statistics.events_written = m_written.load(std::memory_order_relaxed);
+  statistics.tracks = m_tracks.load(std::memory_order_relaxed);
+  statistics.bytes_written = m_bytes_written.load(std::memory_order_relaxed);
+  statistics.write_failed = m_write_failed.load(std::memory_order_relaxed);
+  return statistics;
+}
+
+std::string MidiRecorder::to_string() const
+{
+  return "MidiRecorder(Path=" + m_options.path.string() +
+         ", Stopped=" + (is_stopped() ? "Yes" : "No") + ", " + get_statistics().to_string() + ")";
+}
+
+/** @brief Drop the events of dense controller, pressure and pitch bend streams that barely move the value.
+ *  An event is kept when it is the first of its stream, moves the value by more than the tolerance
+ *  from the last event kept, or is the last before the stream goes quiet, so every gesture still
+ *  ends on its final value. Notes, program changes and unthinnable controllers are always kept.
+ *  @param events Events sorted by sample time
+ *  @param tolerance Largest change, in 7-bit steps, that is left out
+ *  @param gesture_gap Samples without an event after which a stream counts as quiet
+ *  @return The events kept, in their original order.
+ */
+std::vector<RecordedMidiEvent> MidiRecorder::thin(const std::vector<RecordedMidiEvent> &events, unsigned int tolerance,
+                                                  uint64_t gesture_gap)
+{
+  if (tolerance == 0)
+    return events;
+
+  constexpr uint64_t NEVER = UINT64_MAX;
+  const int threshold = static_cast<int>(std::min(tolerance, 127u)) << 7;
+
+  // When the next event of each event's stream comes, found walking backwards
+  std::vector<uint64_t> next_time(events.size(), NEVER);
+  std::vector<uint64_t> following(CHANNEL_COUNT * STREAMS_PER_CHANNEL, NEVER);
+  for (size_t i = events.size(); i > 0; --i)
+  {
+    const size_t stream = get_stream(events[i - 1]);
+    if (stream != NO_STREAM)
+    {
+      next_time[i - 1] = following[stream];
+      following[stream] = events[i - 1].sample_time;
+    }
+  }
+
+  std::vector<int> last_kept(CHANNEL_COUNT * STREAMS_PER_CHANNEL, -1);
+  std::vector<RecordedMidiEvent> kept;
+  kept.reserve(events.size());
+  for (size_t i = 0; i < events.size(); ++i)
+  {
+    const RecordedMidiEvent &event = events[i];
+    const size_t stream = get_stream(event);
+    if (stream != NO_STREAM)
+    {
+      const int value = get_stream_value(event);
+      const bool gesture_end = next_time[i] == NEVER || next_time[i] - event.sample_time > gesture_gap;
+      if (last_kept[stream] >= 0 && std::abs(value - last_kept[stream]) <= threshold && !gesture_end)
+        continue;
+      last_kept[stream] = value;
+    }
+    kept.push_back(event);
+  }
+  return kept;
+}
+
+uint64_t MidiRecorder::get_tick(uint64_t sample_time) const noexcept
+{
+  const double ticks_per_sample = m_options.ppq * m_options.tempo_bpm / (60.0 * m_options.sample_rate);
+  return static_cast<uint64_t>(std::llround(static_cast<double>(sample_time) * ticks_per_sample));
+}
+
+/** @brief Sort, thin and write the recorded events as a type 1 Standard MIDI File. Runs on the TaskScheduler.
+ *  Track 0 holds the tempo and time signature; each MIDI channel used gets its own track.
+ */
+void MidiRecorder::write_file()
+{
+  const size_t count = m_count.load(std::memory_order_acquire);
+  std::vector<RecordedMidiEvent> events(m_events.get(), m_events.get() + count);
+  std::stable_sort(events.begin(), events.end(),
+                   [](const RecordedMidiEvent &a, const RecordedMidiEvent &b) { return a.sample_time < b.sample_time; });
+
+  const auto gesture_gap = static_cast<uint64_t>(MIDI_RECORDER_GESTURE_GAP * m_options.sample_rate);
+  std::vector<RecordedMidiEvent> kept = thin(events, m_options.controller_tolerance, gesture_gap);
+  m_thinned.store(events.size() - kept.size(), std::memory_order_relaxed);
+
+  std::vector<std::vector<uint8_t>> channel_tracks(CHANNEL_COUNT);
+  std::vector<uint64_t> last_tick(CHANNEL_COUNT, 0);
+  std::vector<uint8_t> running_status(CHANNEL_COUNT, 0);
+  for (const RecordedMidiEvent &event : kept)
+  {
+    const unsigned int channel = event.status & 0x0F;
+    std::vector<uint8_t> &track = channel_tracks[channel];
+    if (track.empty())
+    {
+      const std::string name = "Channel " + std::to_string(channel + 1);
+      write_meta_event(track, 0x03, std::vector<uint8_t>(name.begin(), name.end()));
+    }
+
+    const uint64_t tick = get_tick(event.sample_time);
+    write_variable_length(track, tick - last_tick[channel]);
+    last_tick[channel] = tick;
+
+    // Running status: repeated status bytes are left out
+    if (event.status != running_status[channel])
+    {
+      track.push_back(event.status);
+      running_status[channel] = event.status;
+    }
+    track.push_back(event.data1);
+    if (event.size > 2)
+    {
+      track.push_back(event.data2);
+    }
+  }
+
+  std::vector<uint8_t> tempo_track;
+  const auto tempo = static_cast<uint32_t>(std::llround(60000000.0 / m_options.tempo_bpm));
+  write_meta_event(tempo_track, 0x51, {static_cast<uint8_t>(tempo >> 16), static_cast<uint8_t>(tempo >> 8),
+                                       static_cast<uint8_t>(tempo)});
+  write_meta_event(tempo_track, 0x58, {4, 2, 24, 8});  // 4/4, a click per quarter note
+  write_meta_event(tempo_track, 0x2F, {});
+
+  unsigned int tracks = 1;
+  for (auto &track : channel_tracks)
+  {
+    if (!track.empty())
+    {
+      write_meta_event(track, 0x2F, {});
+      ++tracks;
+    }
+  }
+
+  std::vector<uint8_t> file = {'M', 'T', 'h', 'd', 0, 0, 0, 6};
+  write_big_endian(file, 1, 2);  // Format 1: simultaneous tracks
+  write_big_endian(file, tracks, 2);
+  write_big_endian(file, m_options.ppq, 2);
+  write_track(file, tempo_track);
+  for (const auto &track : channel_tracks)
+  {
+    if (!track.empty())
+    {
+      write_track(file, track);
+    }
+  }
+
+  std::error_code error;
+  if (m_options.path.has_parent_path())
+  {
+    std::filesystem::create_directories(m_options.path.parent_path(), error);
+  }
+
+  std::ofstream stream(m_options.path, std::ios::binary | std::ios::trunc);
+  stream.write(reinterpret_cast<const char *>(file.data()), static_cast<std::streamsize>(file.size()));
+  stream.close();
+  if (!stream)
+  {
+    LOG_ERROR("MidiRecorder: Failed to write ", m_options.path.string());
+    m_write_failed.store(true, std::memory_order_relaxed);
+    return;
+  }
+
+  m_written.store(kept.size(), std::memory_order_relaxed);
+  m_tracks.store(tracks, std::memory_order_relaxed);
+  m_bytes_written.store(file.size(), std::memory_order_relaxed);
+  LOG_INFO("MidiRecorder: Wrote ", m_options.path.string(), ", ", kept.size(), " events on ", tracks, " tracks",
+           (events.size() != kept.size() ? ", " + std::to_string(events.size() - kept.size()) + " thinned" : ""));
+}
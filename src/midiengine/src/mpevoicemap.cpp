@@ -0,0 +1,464 @@
+#include "mpevoicemap.h"
+
+#include <algorithm>
+#include <bit>
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+constexpr uint32_t NO_PENDING_LAYOUT = UINT32_MAX;
+constexpr uint32_t ALL_VOICES = MPE_MAX_VOICES >= 32 ? UINT32_MAX : (1u << MPE_MAX_VOICES) - 1;
+constexpr uint8_t LOWER_MANAGER_CHANNEL = 0;
+constexpr uint8_t UPPER_MANAGER_CHANNEL = 15;
+
+// Registered parameter numbers
+constexpr uint8_t RPN_PITCH_BEND_SENSITIVITY = 0;
+constexpr uint8_t RPN_MPE_CONFIGURATION = 6;
+
+static_assert(MPE_MAX_VOICES <= 32, "Voice masks are 32 bits");
+
+}  // namespace
+
+MpeVoiceMap::MpeVoiceMap() : m_pending_layout(NO_PENDING_LAYOUT)
+{
+  for (auto &channel : m_channels)
+  {
+    for (auto &voice : channel.note_voice)
+    {
+      voice.store(MPE_NO_VOICE, std::memory_order_relaxed);
+    }
+  }
+  m_roles.fill(eChannelRole::None);
+  m_free_voices = ALL_VOICES;
+}
+
+/** @brief Choose the zones and pitch bend ranges. Any thread; takes effect with the next message processed.
+ *  Changing the layout releases every voice.
+ */
+void MpeVoiceMap::set_layout(const MpeZoneLayout &layout) noexcept
+{
+  m_pending_note_bend_range.store(layout.note_bend_range, std::memory_order_relaxed);
+  m_pending_manager_bend_range.store(layout.manager_bend_range, std::memory_order_relaxed);
+  const uint32_t lower = std::min(layout.lower_members, MPE_MAX_MEMBERS);
+  const uint32_t upper = std::min(layout.upper_members, MPE_MAX_MEMBERS);
+  m_pending_layout.store(lower | (upper << 8), std::memory_order_release);
+}
+
+MpeZoneLayout MpeVoiceMap::get_layout() const noexcept
+{
+  const uint32_t layout = m_layout.load(std::memory_order_acquire);
+  MpeZoneLayout zones;
+  zones.lower_members = layout & 0xFF;
+  zones.upper_members = (layout >> 8) & 0xFF;
+  zones.note_bend_range = m_note_bend_range.load(std::memory_order_relaxed);
+  zones.manager_bend_range = m_manager_bend_range.load(std::memory_order_relaxed);
+  return zones;
+}
+
+void MpeVoiceMap::apply_pending_layout() noexcept
+{
+  if (m_pending_layout.load(std::memory_order_relaxed) == NO_PENDING_LAYOUT)
+    return;
+
+  const uint32_t layout = m_pending_layout.exchange(NO_PENDING_LAYOUT, std::memory_order_acquire);
+  if (layout == NO_PENDING_LAYOUT)
+    return;
+
+  m_note_bend_range.store(m_pending_note_bend_range.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  m_manager_bend_range.store(m_pending_manager_bend_range.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  apply_layout(layout & 0xFF, (layout >> 8) & 0xFF);
+}
+
+/** @brief Assign the channel roles and release every voice. Input thread only.
+ *  The lower zone keeps its channels where the upper zone would overlap them.
+ */
+void MpeVoiceMap::apply_layout(unsigned int lower_members, unsigned int upper_members) noexcept
+{
+  lower_members = std::min(lower_members, MPE_MAX_MEMBERS);
+  if (lower_members > 0)
+  {
+    upper_members = std::min(upper_members, lower_members >= MPE_MAX_MEMBERS - 1 ? 0u : MPE_MAX_MEMBERS - 1 - lower_members);
+  }
+  upper_members = std::min(upper_members, MPE_MAX_MEMBERS);
+
+  release_all();
+  m_roles.fill(eChannelRole::None);
+  if (lower_members > 0)
+  {
+    m_roles[LOWER_MANAGER_CHANNEL] = eChannelRole::LowerManager;
+    for (unsigned int channel = 1; channel <= lower_members; ++channel)
+    {
+      m_roles[channel] = eChannelRole::LowerMember;
+    }
+  }
+  if (upper_members > 0)
+  {
+    m_roles[UPPER_MANAGER_CHANNEL] = eChannelRole::UpperManager;
+    for (unsigned int channel = UPPER_MANAGER_CHANNEL - upper_members; channel < UPPER_MANAGER_CHANNEL; ++channel)
+    {
+      m_roles[channel] = eChannelRole::UpperMember;
+    }
+  }
+
+  for (auto &channel : m_channels)
+  {
+    channel.bend = 0.0f;
+    channel.pressure = 0.0f;
+    channel.timbre = 0.5f;
+  }
+
+  m_layout.store(lower_members | (upper_members << 8), std::memory_order_release);
+  m_layout_changes.fetch_add(1, std::memory_order_release);
+}
+
+void MpeVoiceMap::release_all() noexcept
+{
+  for (unsigned int index = 0; index < MPE_MAX_VOICES; ++index)
+  {
+    if ((m_free_voices & (1u << index)) == 0)
+    {
+      release_voice(index, 0);
+    }
+  }
+}
+
+/** @brief End a voice and take it out of its channel's tables. Input thread only.
+ */
+void MpeVoiceMap::release_voice(unsigned int index, uint8_t release_velocity) noexcept
+{
+  VoiceSlot &slot = m_voices[index];
+  ChannelState &channel = m_channels[slot.channel.load(std::memory_order_relaxed)];
+  channel.note_voice[slot.note.load(std::memory_order_relaxed)].store(MPE_NO_VOICE, std::memory_order_relaxed);
+  channel.voices &= ~(1u << index);
+  m_free_voices |= 1u << index;
+
+  begin_write(slot);
+  slot.release_velocity.store(release_velocity, std::memory_order_relaxed);
+  slot.active.store(false, std::memory_order_relaxed);
+  end_write(slot);
+}
+
+/** @brief Apply a message to the voices. Called from the MIDI input thread; never blocks or allocates.
+ *  @return True if the message belongs to an MPE zone.
+ */
+bool MpeVoiceMap::process(const MidiMessage &message) noexcept
+{
+  apply_pending_layout();
+
+  const uint8_t status = message.status;
+  if (status < 0x80 || status >= 0xF0)
+    return false;
+
+  const uint8_t channel = status & 0x0F;
+  const uint8_t type = status & 0xF0;
+
+  // The configuration message arrives while its zone is still off
+  if (type == static_cast<uint8_t>(eMidiMessageType::ControlChange))
+  {
+    control_change(channel, message.data1, message.data2);
+    return m_roles[channel] != eChannelRole::None;
+  }
+
+  if (m_roles[channel] == eChannelRole::None)
+    return false;
+
+  ChannelState &state = m_channels[channel];
+  switch (static_cast<eMidiMessageType>(type))
+  {
+    case eMidiMessageType::NoteOn:
+      if (message.data2 > 0)
+      {
+        note_on(channel, message.data1, message.data2);
+      }
+      else
+      {
+        note_off(channel, message.data1, 0);
+      }
+      break;
+    case eMidiMessageType::NoteOff:
+      note_off(channel, message.data1, message.data2);
+      break;
+    case eMidiMessageType::PitchBendChange:
+    {
+      const int value = (message.data1 | (message.data2 << 7)) - 8192;
+      state.bend = static_cast<float>(value) / (value < 0 ? 8192.0f : 8191.0f);
+      if (m_roles[channel] == eChannelRole::LowerManager || m_roles[channel] == eChannelRole::UpperManager)
+      {
+        update_zone_voices(m_roles[channel]);
+      }
+      else
+      {
+        update_channel_voices(channel);
+      }
+      m_expression.fetch_add(1, std::memory_order_relaxed);
+      break;
+    }
+    case eMidiMessageType::ChannelPressure:
+      state.pressure = message.data1 / 127.0f;
+      update_channel_voices(channel);
+      m_expression.fetch_add(1, std::memory_order_relaxed);
+      break;
+    default:
+      break;
+  }
+  return true;
+}
+
+void MpeVoiceMap::note_on(uint8_t channel, uint8_t note, uint8_t velocity) noexcept
+{
+  ChannelState &state = m_channels[channel];
+  const int8_t retriggered = state.note_voice[note].load(std::memory_order_relaxed);
+  if (retriggered != MPE_NO_VOICE)
+  {
+    release_voice(static_cast<unsigned int>(retriggered), 0);
+  }
+
+  const unsigned int index = allocate_voice();
+  VoiceSlot &slot = m_voices[index];
+  begin_write(slot);
+  slot.generation.store(m_next_generation++, std::memory_order_relaxed);
+  slot.channel.store(channel, std::memory_order_relaxed);
+  slot.note.store(note, std::memory_order_relaxed);
+  slot.velocity.store(velocity, std::memory_order_relaxed);
+  slot.release_velocity.store(0, std::memory_order_relaxed);
+  slot.pitch_bend.store(get_voice_pitch_bend(channel), std::memory_order_relaxed);
+  slot.pressure.store(state.pressure, std::memory_order_relaxed);
+  slot.timbre.store(state.timbre, std::memory_order_relaxed);
+  slot.active.store(true, std::memory_order_relaxed);
+  end_write(slot);
+
+  state.note_voice[note].store(static_cast<int8_t>(index), std::memory_order_relaxed);
+  state.voices |= 1u << index;
+  m_notes.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MpeVoiceMap::note_off(uint8_t channel, uint8_t note, uint8_t velocity) noexcept
+{
+  const int8_t index = m_channels[channel].note_voice[note].load(std::memory_order_relaxed);
+  if (index == MPE_NO_VOICE)
+  {
+    m_unmatched.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  release_voice(static_cast<unsigned int>(index), velocity);
+}
+
+/** @brief Timbre, registered parameters and the MPE Configuration Message
+ */
+void MpeVoiceMap::control_change(uint8_t channel, uint8_t controller, uint8_t value) noexcept
+{
+  ChannelState &state = m_channels[channel];
+  const eChannelRole role = m_roles[channel];
+  switch (controller)
+  {
+    case 101:
+      state.rpn_msb = value;
+      return;
+    case 100:
+      state.rpn_lsb = value;
+      return;
+    case 6:
+      break;
+    case MPE_TIMBRE_CONTROLLER:
+      if (role != eChannelRole::None)
+      {
+        state.timbre = value / 127.0f;
+        update_channel_voices(channel);
+        m_expression.fetch_add(1, std::memory_order_relaxed);
+      }
+      return;
+    default:
+      return;
+  }
+
+  // Data entry for the selected registered parameter
+  if (state.rpn_msb != 0)
+    return;
+
+  if (state.rpn_lsb == RPN_MPE_CONFIGURATION &&
+      (channel == LOWER_MANAGER_CHANNEL || channel == UPPER_MANAGER_CHANNEL))
+  {
+    // The zone being configured wins; the other one shrinks to make room
+    const uint32_t layout = m_layout.load(std::memory_order_relaxed);
+    unsigned int lower = layout & 0xFF;
+    unsigned int upper = (layout >> 8) & 0xFF;
+    const unsigned int members = std::min<unsigned int>(value, MPE_MAX_MEMBERS);
+    if (channel == LOWER_MANAGER_CHANNEL)
+    {
+      lower = members;
+    }
+    else
+    {
+      upper = members;
+      lower = upper == 0 ? lower : std::min(lower, upper >= MPE_MAX_MEMBERS - 1 ? 0u : MPE_MAX_MEMBERS - 1 - upper);
+    }
+    apply_layout(lower, upper);
+  }
+  else if (state.rpn_lsb == RPN_PITCH_BEND_SENSITIVITY && role != eChannelRole::None)
+  {
+    const bool manager = role == eChannelRole::LowerManager || role == eChannelRole::UpperManager;
+    (manager ? m_manager_bend_range : m_note_bend_range).store(static_cast<float>(value), std::memory_order_relaxed);
+  }
+}
+
+/** @brief Semitones of bend for a voice on a channel: its own bend plus, on a member channel, its zone manager's
+ */
+float MpeVoiceMap::get_voice_pitch_bend(uint8_t channel) const noexcept
+{
+  const float manager_range = m_manager_bend_range.load(std::memory_order_relaxed);
+  switch (m_roles[channel])
+  {
+    case eChannelRole::LowerMember:
+      return m_channels[channel].bend * m_note_bend_range.load(std::memory_order_relaxed) +
+             m_channels[LOWER_MANAGER_CHANNEL].bend * manager_range;
+    case eChannelRole::UpperMember:
+      return m_channels[channel].bend * m_note_bend_range.load(std::memory_order_relaxed) +
+             m_channels[UPPER_MANAGER_CHANNEL].bend * manager_range;
+    default:
+      return m_channels[channel].bend * manager_range;
+  }
+}
+
+/** @brief Publish a channel's expression to the voices sounding on it
+ */
+void MpeVoiceMap::update_channel_voices(uint8_t channel) noexcept
+{
+  const ChannelState &state = m_channels[channel];
+  const float pitch_bend = get_voice_pitch_bend(channel);
+  for (uint32_t voices = state.voices; voices != 0; voices &= voices - 1)
+  {
+    VoiceSlot &slot = m_voices[std::countr_zero(voices)];
+    begin_write(slot);
+    slot.pitch_bend.store(pitch_bend, std::memory_order_relaxed);
+    slot.pressure.store(state.pressure, std::memory_order_relaxed);
+    slot.timbre.store(state.timbre, std::memory_order_relaxed);
+    end_write(slot);
+  }
+}
+
+/** @brief A manager channel's pitch bend moves every voice in its zone
+ */
+void MpeVoiceMap::update_zone_voices(eChannelRole manager) noexcept
+{
+  const eChannelRole member = manager == eChannelRole::LowerManager ? eChannelRole::LowerMember
+                                                                    : eChannelRole::UpperMember;
+  for (uint8_t channel = 0; channel < MPE_CHANNELS; ++channel)
+  {
+    if ((m_roles[channel] == manager || m_roles[channel] == member) && m_channels[channel].voices != 0)
+    {
+      update_channel_voices(channel);
+    }
+  }
+}
+
+/** @brief A free voice, or the oldest one when all are sounding
+ */
+unsigned int MpeVoiceMap::allocate_voice() noexcept
+{
+  if (m_free_voices != 0)
+  {
+    const auto index = static_cast<unsigned int>(std::countr_zero(m_free_voices));
+    m_free_voices &= ~(1u << index);
+    return index;
+  }
+
+  unsigned int oldest = 0;
+  for (unsigned int index = 1; index < MPE_MAX_VOICES; ++index)
+  {
+    if (m_voices[index].generation.load(std::memory_order_relaxed) -
+          m_voices[oldest].generation.load(std::memory_order_relaxed) > UINT32_MAX / 2)
+    {
+      oldest = index;
+    }
+  }
+  release_voice(oldest, 0);
+  m_free_voices &= ~(1u << oldest);
+  m_stolen.fetch_add(1, std::memory_order_relaxed);
+  return oldest;
+}
+
+void MpeVoiceMap::begin_write(VoiceSlot &slot) noexcept
+{
+  slot.sequence.store(slot.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+void MpeVoiceMap::end_write(VoiceSlot &slot) noexcept
+{
+  slot.sequence.store(slot.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+/** @brief The voice sounding a note on a channel
+ *  @return The voice index, or MPE_NO_VOICE.
+ */
+int MpeVoiceMap::get_voice_index(uint8_t channel, uint8_t note) const noexcept
+{
+  if (channel >= MPE_CHANNELS || note > 127)
+    return MPE_NO_VOICE;
+  return m_channels[channel].note_voice[note].load(std::memory_order_relaxed);
+}
+
+/** @brief Read a consistent snapshot of a voice. Any thread, including the audio callback; never blocks.
+ *  @param index Voice index, below MPE_MAX_VOICES
+ *  @param voice Filled with the voice
+ *  @return True if the voice is sounding.
+ */
+bool MpeVoiceMap::get_voice(unsigned int index, MpeVoice &voice) const noexcept
+{
+  if (index >= MPE_MAX_VOICES)
+    return false;
+
+  const VoiceSlot &slot = m_voices[index];
+  while (true)
+  {
+    const uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence & 1)
+      continue;  // The input thread is in the middle of a few stores
+
+    voice.generation = slot.generation.load(std::memory_order_relaxed);
+    voice.channel = slot.channel.load(std::memory_order_relaxed);
+    voice.note = slot.note.load(std::memory_order_relaxed);
+    voice.velocity = slot.velocity.load(std::memory_order_relaxed);
+    voice.release_velocity = slot.release_velocity.load(std::memory_order_relaxed);
+    voice.active = slot.active.load(std::memory_order_relaxed);
+    voice.pitch_bend = slot.pitch_bend.load(std::memory_order_relaxed);
+    voice.pressure = slot.pressure.load(std::memory_order_relaxed);
+    voice.timbre = slot.timbre.load(std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) == sequence)
+      return voice.active;
+  }
+}
+
+/** @brief Snapshot the sounding voices, e.g. once per block in the audio callback
+ *  @param voices Where to write them
+ *  @param capacity Room at voices
+ *  @return Number of voices written.
+ */
+size_t MpeVoiceMap::get_active_voices(MpeVoice *voices, size_t capacity) const noexcept
+{
+  size_t count = 0;
+  MpeVoice voice;
+  for (unsigned int index = 0; index < MPE_MAX_VOICES && count < capacity; ++index)
+  {
+    if (get_voice(index, voice))
+    {
+      voices[count++] = voice;
+    }
+  }
+  return count;
+}
+
+MpeStatistics MpeVoiceMap::get_statistics() const noexcept
+{
+  MpeStatistics statistics;
+  statistics.notes = m_notes.load(std::memory_order_relaxed);
+  statistics.expression = m_expression.load(std::memory_order_relaxed);
+  statistics.voices_stolen = m_stolen.load(std::memory_order_relaxed);
+  statistics.unmatched_note_offs = m_unmatched.load(std::memory_order_relaxed);
+  statistics.layout_changes = m_layout_changes.load(std::memory_order_relaxed);
+  return statistics;
+}
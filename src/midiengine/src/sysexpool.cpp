@@ -0,0 +1,319 @@
+#include "sysexpool.h"
+
+#include "logger.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+constexpr uint8_t SYSEX_START = 0xF0;
+constexpr uint8_t SYSEX_END = 0xF7;
+constexpr uint8_t REAL_TIME_FIRST = 0xF8;
+
+}  // namespace
+
+SysexBuffer::SysexBuffer(const SysexBuffer &other) noexcept : p_pool(other.p_pool), m_head(other.m_head)
+{
+  if (p_pool != nullptr)
+  {
+    p_pool->m_blocks[m_head].references.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+SysexBuffer::SysexBuffer(SysexBuffer &&other) noexcept : p_pool(other.p_pool), m_head(other.m_head)
+{
+  other.p_pool = nullptr;
+  other.m_head = SYSEX_NO_BLOCK;
+}
+
+SysexBuffer &SysexBuffer::operator=(const SysexBuffer &other) noexcept
+{
+  if (this != &other)
+  {
+    if (other.p_pool != nullptr)
+    {
+      other.p_pool->m_blocks[other.m_head].references.fetch_add(1, std::memory_order_relaxed);
+    }
+    reset();
+    p_pool = other.p_pool;
+    m_head = other.m_head;
+  }
+  return *this;
+}
+
+SysexBuffer &SysexBuffer::operator=(SysexBuffer &&other) noexcept
+{
+  if (this != &other)
+  {
+    reset();
+    p_pool = other.p_pool;
+    m_head = other.m_head;
+    other.p_pool = nullptr;
+    other.m_head = SYSEX_NO_BLOCK;
+  }
+  return *this;
+}
+
+SysexBuffer::~SysexBuffer()
+{
+  reset();
+}
+
+/** @brief Drop this reference; the last one returns the message's blocks to the pool.
+ */
+void SysexBuffer::reset() noexcept
+{
+  if (p_pool == nullptr)
+    return;
+
+  if (p_pool->m_blocks[m_head].references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+  {
+    p_pool->push_free(m_head);
+  }
+  p_pool = nullptr;
+  m_head = SYSEX_NO_BLOCK;
+}
+
+/** @brief Bytes in the message, including the F0 and F7
+ */
+size_t SysexBuffer::size() const noexcept
+{
+  return p_pool != nullptr ? p_pool->m_blocks[m_head].total : 0;
+}
+
+/** @brief Copy the message out.
+ *  @param destination Where to copy to
+ *  @param capacity Bytes available at the destination
+ *  @return Bytes copied; less than size() if the destination is too small.
+ */
+size_t SysexBuffer::copy_to(uint8_t *destination, size_t capacity) const noexcept
+{
+  size_t copied = 0;
+  for_each_chunk([&](std::span<const uint8_t> chunk) {
+    const size_t count = std::min(chunk.size(), capacity - copied);
+    std::memcpy(destination + copied, chunk.data(), count);
+    copied += count;
+  });
+  return copied;
+}
+
+std::vector<uint8_t> SysexBuffer::to_vector() const
+{
+  std::vector<uint8_t> bytes;
+  bytes.reserve(size());
+  for_each_chunk([&bytes](std::span<const uint8_t> chunk) { bytes.insert(bytes.end(), chunk.begin(), chunk.end()); });
+  return bytes;
+}
+
+/** @brief Allocate the arena. Nothing is allocated afterwards.
+ *  @param block_size Bytes per block; a message takes as many blocks as it needs.
+ *  @param blocks Number of blocks.
+ *  @return The pool, or nullptr for an empty or oversized arena.
+ */
+std::unique_ptr<SysexPool> SysexPool::create(size_t block_size, size_t blocks)
+{
+  if (block_size == 0 || blocks == 0 || blocks >= SYSEX_NO_BLOCK || block_size > UINT32_MAX / blocks)
+  {
+    LOG_ERROR("SysexPool: Cannot create ", blocks, " blocks of ", block_size, " bytes");
+    return nullptr;
+  }
+
+  std::unique_ptr<SysexPool> pool(new SysexPool());
+  pool->m_block_size = block_size;
+  pool->m_block_count = blocks;
+  pool->m_arena = std::make_unique<uint8_t[]>(block_size * blocks);
+  pool->m_blocks = std::make_unique<Block[]>(blocks);
+  for (size_t i = 0; i + 1 < blocks; ++i)
+  {
+    pool->m_blocks[i].next = static_cast<uint32_t>(i + 1);
+  }
+  pool->m_free_head.store(0, std::memory_order_release);
+  pool->m_free_count.store(blocks, std::memory_order_release);
+  return pool;
+}
+
+/** @brief Take a block off the free list. Assembling thread only.
+ *  @return The block, or SYSEX_NO_BLOCK if none is free.
+ */
+uint32_t SysexPool::pop_free() noexcept
+{
+  uint32_t head = m_free_head.load(std::memory_order_acquire);
+  while (head != SYSEX_NO_BLOCK &&
+         !m_free_head.compare_exchange_weak(head, m_blocks[head].next, std::memory_order_acquire,
+                                            std::memory_order_acquire))
+  {
+  }
+
+  if (head != SYSEX_NO_BLOCK)
+  {
+    m_free_count.fetch_sub(1, std::memory_order_relaxed);
+    m_blocks[head].next = SYSEX_NO_BLOCK;
+    m_blocks[head].length = 0;
+  }
+  return head;
+}
+
+/** @brief Return a chain of blocks to the free list in one step. Any thread.
+ */
+void SysexPool::push_free(uint32_t head) noexcept
+{
+  uint32_t tail = head;
+  size_t count = 1;
+  while (m_blocks[tail].next != SYSEX_NO_BLOCK)
+  {
+    tail = m_blocks[tail].next;
+    ++count;
+  }
+
+  uint32_t free_head = m_free_head.load(std::memory_order_relaxed);
+  do
+  {
+    m_blocks[tail].next = free_head;
+  } while (!m_free_head.compare_exchange_weak(free_head, head, std::memory_order_release, std::memory_order_relaxed));
+  m_free_count.fetch_add(count, std::memory_order_relaxed);
+}
+
+/** @brief Add a byte to the message being assembled, starting a block when the last one is full
+ *  @return False if no block was free.
+ */
+bool SysexPool::append(uint8_t byte) noexcept
+{
+  if (m_tail == SYSEX_NO_BLOCK || m_blocks[m_tail].length == m_block_size)
+  {
+    const uint32_t block = pop_free();
+    if (block == SYSEX_NO_BLOCK)
+      return false;
+
+    if (m_tail == SYSEX_NO_BLOCK)
+    {
+      m_head = block;
+    }
+    else
+    {
+      m_blocks[m_tail].next = block;
+    }
+    m_tail = block;
+  }
+
+  m_arena[static_cast<size_t>(m_tail) * m_block_size + m_blocks[m_tail].length++] = byte;
+  ++m_size;
+  return true;
+}
+
+/** @brief Give back the blocks of the message being assembled
+ *  @param truncated Count it as cut off rather than dropped for lack of room
+ */
+void SysexPool::discard(bool truncated) noexcept
+{
+  if (m_head != SYSEX_NO_BLOCK)
+  {
+    push_free(m_head);
+  }
+  m_head = SYSEX_NO_BLOCK;
+  m_tail = SYSEX_NO_BLOCK;
+  m_size = 0;
+  (truncated ? m_truncated : m_dropped).fetch_add(1, std::memory_order_relaxed);
+}
+
+/** @brief Add a fragment of a SysEx message. Assembling thread only; never blocks or allocates.
+ *  A fragment starting with F0 begins a new message, anything else continues the current one.
+ *  Interleaved real-time bytes are skipped. A message that does not fit in the free blocks is
+ *  dropped as a whole, and one cut off by another status byte is discarded.
+ *  @param bytes The fragment
+ *  @param size Bytes in the fragment
+ *  @return The message once its F7 has arrived, else an empty buffer.
+ */
+SysexBuffer SysexPool::assemble(const uint8_t *bytes, size_t size) noexcept
+{
+  if (bytes == nullptr || size == 0)
+    return {};
+
+  if (bytes[0] == SYSEX_START)
+  {
+    abort();
+    m_assembling = true;
+  }
+  else if (!m_assembling)
+  {
+    m_ignored.fetch_add(1, std::memory_order_relaxed);
+    return {};
+  }
+
+  for (size_t i = 0; i < size; ++i)
+  {
+    const uint8_t byte = bytes[i];
+    if (byte >= REAL_TIME_FIRST)
+      continue;
+
+    if (byte >= 0x80 && byte != SYSEX_END && !(byte == SYSEX_START && i == 0))
+    {
+      abort();
+      return {};
+    }
+
+    if (!m_discarding && !append(byte))
+    {
+      discard(false);
+      m_discarding = true;
+    }
+
+    if (byte == SYSEX_END)
+    {
+      const bool complete = !m_discarding;
+      m_assembling = false;
+      m_discarding = false;
+      if (!complete)
+        return {};
+
+      Block &head = m_blocks[m_head];
+      head.total = m_size;
+      head.references.store(1, std::memory_order_relaxed);
+      m_messages.fetch_add(1, std::memory_order_relaxed);
+      m_bytes.fetch_add(m_size, std::memory_order_relaxed);
+
+      SysexBuffer buffer(this, m_head);
+      m_head = SYSEX_NO_BLOCK;
+      m_tail = SYSEX_NO_BLOCK;
+      m_size = 0;
+      return buffer;
+    }
+  }
+  return {};
+}
+
+/** @brief Abandon an unfinished message, e.g. when another status byte arrives. Assembling thread only.
+ */
+void SysexPool::abort() noexcept
+{
+  if (!m_assembling)
+    return;
+
+  if (!m_discarding)
+  {
+    discard(true);
+  }
+  m_assembling = false;
+  m_discarding = false;
+}
+
+SysexPoolStatistics SysexPool::get_statistics() const
+{
+  SysexPoolStatistics statistics;
+  statistics.messages = m_messages.load(std::memory_order_relaxed);
+  statistics.bytes = m_bytes.load(std::memory_order_relaxed);
+  statistics.messages_dropped = m_dropped.load(std::memory_order_relaxed);
+  statistics.messages_truncated = m_truncated.load(std::memory_order_relaxed);
+  statistics.fragments_ignored = m_ignored.load(std::memory_order_relaxed);
+  statistics.blocks = m_block_count;
+  statistics.blocks_free = m_free_count.load(std::memory_order_relaxed);
+  return statistics;
+}
+
+std::string SysexPool::to_string() const
+{
+  return "SysexPool(BlockSize=" + std::to_string(m_block_size) + ", " + get_statistics().to_string() + ")";
+}
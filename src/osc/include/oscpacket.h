@@ -0,0 +1,147 @@
+#ifndef __OSC_PACKET_H__
+#define __OSC_PACKET_H__
+
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace MinimalAudioEngine
+{
+
+constexpr uint64_t OSC_TIMETAG_IMMEDIATE = 1;
+constexpr int OSC_MAX_BUNDLE_DEPTH = 8;
+constexpr std::string_view OSC_BUNDLE_TAG = "#bundle";
+
+/** @struct OscArgument
+ *  @brief One message argument. Strings and blobs point into the packet.
+ */
+struct OscArgument
+{
+  char type = 'N';
+  int64_t int_value = 0;      // i, h, T, F
+  double float_value = 0.0;   // f, d
+  uint64_t timetag = 0;       // t
+  std::string_view string;    // s, S
+  std::span<const uint8_t> blob;  // b
+
+  bool to_float(float &value) const;
+  bool to_int(int32_t &value) const;
+};
+
+/** @class OscMessageView
+ *  @brief A parsed OSC message that references the packet it was parsed from.
+ */
+class OscMessageView
+{
+public:
+  static std::optional<OscMessageView> parse(std::span<const uint8_t> data);
+
+  std::string_view get_address() const { return m_address; }
+  std::string_view get_type_tags() const { return m_type_tags; }
+  size_t get_argument_count() const { return m_type_tags.size(); }
+
+  /** @class ArgumentReader
+   *  @brief Reads arguments in order without copying
+   */
+  class ArgumentReader
+  {
+  public:
+    ArgumentReader(std::string_view type_tags, std::span<const uint8_t> data) : m_type_tags(type_tags), m_data(data) {}
+    bool next(OscArgument &argument);
+
+  private:
+    std::string_view m_type_tags;
+    std::span<const uint8_t> m_data;
+    size_t m_tag_index = 0;
+    size_t m_offset = 0;
+  };
+
+  ArgumentReader get_arguments() const { return ArgumentReader(m_type_tags, m_arguments); }
+
+  bool get_first_float(float &value) const;
+
+private:
+  std::string_view m_address;
+  std::string_view m_type_tags;  // Without the leading ','
+  std::span<const uint8_t> m_arguments;
+};
+
+bool read_osc_string(std::span<const uint8_t> data, size_t &offset, std::string_view &value);
+bool read_osc_u32(std::span<const uint8_t> data, size_t &offset, uint32_t &value);
+bool read_osc_u64(std::span<const uint8_t> data, size_t &offset, uint64_t &value);
+
+/** @brief Parse a packet and call the visitor for every message it contains.
+ *  Bundles are walked recursively; each message is passed with the timetag of its
+ *  innermost bundle, or OSC_TIMETAG_IMMEDIATE for a bare message.
+ *  @param data The packet, which must outlive the visitor calls.
+ *  @param visitor Callable as visitor(const OscMessageView &, uint64_t timetag).
+ *  @return False if any part of the packet is malformed. Messages before the error are still visited.
+ */
+template <typename Visitor>
+bool parse_osc_packet(std::span<const uint8_t> data, Visitor &&visitor, uint64_t timetag = OSC_TIMETAG_IMMEDIATE, int depth = 0)
+{
+  if (data.empty() || data.size() % 4 != 0)
+    return false;
+
+  if (data[0] != '#')
+  {
+    auto message = OscMessageView::parse(data);
+    if (!message)
+      return false;
+
+    visitor(*message, timetag);
+    return true;
+  }
+
+  size_t offset = 0;
+  std::string_view tag;
+  uint64_t bundle_timetag;
+  if (depth >= OSC_MAX_BUNDLE_DEPTH || !read_osc_string(data, offset, tag) || tag != OSC_BUNDLE_TAG ||
+      !read_osc_u64(data, offset, bundle_timetag))
+    return false;
+
+  while (offset < data.size())
+  {
+    uint32_t element_size;
+    if (!read_osc_u32(data, offset, element_size) || element_size > data.size() - offset)
+      return false;
+
+    if (!parse_osc_packet(data.subspan(offset, element_size), visitor, bundle_timetag, depth + 1))
+      return false;
+
+    offset += element_size;
+  }
+
+  return true;
+}
+
+/** @class OscMessageBuilder
+ *  @brief Encodes an OSC message, for clients and tests
+ */
+class OscMessageBuilder
+{
+public:
+  explicit OscMessageBuilder(std::string_view address) : m_address(address) {}
+
+  OscMessageBuilder &add_int32(int32_t value);
+  OscMessageBuilder &add_float(float value);
+  OscMessageBuilder &add_string(std::string_view value);
+  OscMessageBuilder &add_bool(bool value);
+
+  std::vector<uint8_t> build() const;
+
+private:
+  std::string m_address;
+  std::string m_type_tags = ",";
+  std::vector<uint8_t> m_arguments;
+};
+
+std::vector<uint8_t> build_osc_bundle(uint64_t timetag, const std::vector<std::vector<uint8_t>> &elements);
+
+}  // namespace MinimalAudioEngine
+
+#endif  // __OSC_PACKET_H__
@@ -0,0 +1,130 @@
+#ifndef __OSC_SERVER_H__
+#define __OSC_SERVER_H__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <queue>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audiointerface.h"
+#include "coreengine.h"
+#include "oscpacket.h"
+
+namespace MinimalAudioEngine
+{
+
+constexpr const char *OSC_SERVER_THREAD_NAME = "OscServerThread";
+constexpr size_t OSC_MAX_PACKET_SIZE = 65536;
+constexpr int OSC_RECEIVE_BUFFER_SIZE = 1 << 20;
+constexpr std::chrono::milliseconds OSC_SCHEDULE_HORIZON{100};  // How far ahead changes are handed to the audio thread
+constexpr std::chrono::milliseconds OSC_POLL_INTERVAL{5};
+constexpr size_t OSC_MAX_SCHEDULED = 65536;
+
+/** @struct OscServerStatistics
+ *  @brief Counters for the OSC server
+ */
+struct OscServerStatistics
+{
+  uint64_t packets_received = 0;
+  uint64_t messages_received = 0;
+  uint64_t parameter_changes = 0;
+  uint64_t malformed_packets = 0;
+  uint64_t unknown_addresses = 0;
+  uint64_t dropped_changes = 0;
+
+  std::string to_string() const
+  {
+    return "OscServerStatistics(Packets=" + std::to_string(packets_received) +
+           ", Messages=" + std::to_string(messages_received) +
+           ", ParameterChanges=" + std::to_string(parameter_changes) +
+           ", Malformed=" + std::to_string(malformed_packets) +
+           ", UnknownAddresses=" + std::to_string(unknown_addresses) +
+           ", Dropped=" + std::to_string(dropped_changes) + ")";
+  }
+};
+
+/** @class OscServer
+ *  @brief Receives Open Sound Control packets over UDP.
+ *
+ *  Supported addresses:
+ *    /master/gain f          /track/<n>/gain f       /track/<n>/mute i|T|F
+ *    /track/<n>/play         /track/<n>/stop         /transport/play    /transport/stop
+ *
+ *  Gain and mute changes are converted to ParameterChanges on the transport clock and
+ *  delivered through the AudioInterface's lock-free ring, so bundle timetags apply on
+ *  the exact sample. Changes further ahead than OSC_SCHEDULE_HORIZON are held by the
+ *  server thread until they come due. Track play and stop, and untimed transport play
+ *  and stop, are posted to the CoreEngine queue. Timed /track and /transport play and
+ *  stop apply on their sample; untimed ones on the next block.
+ */
+class OscServer
+{
+public:
+  OscServer(CoreEngine &engine, uint16_t port, std::string bind_address = "127.0.0.1");
+  ~OscServer();
+
+  bool start();
+  void stop();
+
+  bool is_running() const noexcept { return m_running.load(std::memory_order_acquire); }
+  uint16_t get_port() const noexcept { return m_port; }
+  OscServerStatistics get_statistics() const;
+
+  static std::chrono::system_clock::time_point timetag_to_time(uint64_t timetag);
+  static uint64_t time_to_timetag(std::chrono::system_clock::time_point time);
+
+  // Disable copy constructor and assignment operator
+  OscServer(const OscServer &) = delete;
+  OscServer &operator=(const OscServer &) = delete;
+
+private:
+  struct ScheduledChange
+  {
+    ParameterChange change;
+    uint64_t sequence;  // Keeps changes for the same sample in arrival order
+  };
+
+  struct LaterChange
+  {
+    bool operator()(const ScheduledChange &a, const ScheduledChange &b) const
+    {
+      return a.change.sample_time != b.change.sample_time ? a.change.sample_time > b.change.sample_time
+                                                          : a.sequence > b.sequence;
+    }
+  };
+
+  void run(std::stop_token stop_token);
+  void handle_packet(std::span<const uint8_t> packet);
+  void handle_message(const OscMessageView &message, uint64_t timetag);
+  void schedule(const ParameterChange &change);
+  void flush_scheduled();
+  uint64_t timetag_to_sample_time(uint64_t timetag) const;
+
+  CoreEngine &m_engine;
+  uint16_t m_port;
+  std::string m_bind_address;
+  int m_socket_fd = -1;
+
+  std::jthread m_thread;
+  std::atomic<bool> m_running{false};
+
+  // Server thread only
+  std::vector<uint8_t> m_receive_buffer;
+  std::priority_queue<ScheduledChange, std::vector<ScheduledChange>, LaterChange> m_scheduled;
+  uint64_t m_schedule_sequence = 0;
+
+  std::atomic<uint64_t> m_packets_received{0};
+  std::atomic<uint64_t> m_messages_received{0};
+  std::atomic<uint64_t> m_parameter_changes{0};
+  std::atomic<uint64_t> m_malformed_packets{0};
+  std::atomic<uint64_t> m_unknown_addresses{0};
+  std::atomic<uint64_t> m_dropped_changes{0};
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // __OSC_SERVER_H__
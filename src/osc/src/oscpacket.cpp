@@ -0,0 +1,286 @@
+#include "oscpacket.h"
+
+#include <bit>
+#include <cstring>
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+constexpr size_t osc_padded(size_t size)
+{
+  return (size + 3) & ~size_t(3);
+}
+
+void write_osc_u32(std::vector<uint8_t> &buffer, uint32_t value)
+{
+  for (int shift = 24; shift >= 0; shift -= 8)
+  {
+    buffer.push_back(static_cast<uint8_t>(value >> shift));
+  }
+}
+
+void write_osc_string(std::vector<uint8_t> &buffer, std::string_view value)
+{
+  buffer.insert(buffer.end(), value.begin(), value.end());
+  buffer.resize(buffer.size() + osc_padded(value.size() + 1) - value.size(), 0);
+}
+
+}  // namespace
+
+/** @brief Read a null-terminated, 4-byte padded OSC string in place
+ */
+bool MinimalAudioEngine::read_osc_string(std::span<const uint8_t> data, size_t &offset, std::string_view &value)
+{
+  if (offset >= data.size())
+    return false;
+
+  const void *terminator = std::memchr(data.data() + offset, 0, data.size() - offset);
+  if (terminator == nullptr)
+    return false;
+
+  size_t length = static_cast<const uint8_t *>(terminator) - (data.data() + offset);
+  size_t padded = osc_padded(length + 1);
+  if (padded > data.size() - offset)
+    return false;
+
+  value = std::string_view(reinterpret_cast<const char *>(data.data() + offset), length);
+  offset += padded;
+  return true;
+}
+
+/** @brief Read a big-endian u32
+ */
+bool MinimalAudioEngine::read_osc_u32(std::span<const uint8_t> data, size_t &offset, uint32_t &value)
+{
+  if (offset > data.size() || data.size() - offset < 4)
+    return false;
+
+  value = (static_cast<uint32_t>(data[offset]) << 24) | (static_cast<uint32_t>(data[offset + 1]) << 16) |
+          (static_cast<uint32_t>(data[offset + 2]) << 8) | static_cast<uint32_t>(data[offset + 3]);
+  offset += 4;
+  return true;
+}
+
+/** @brief Read a big-endian u64
+ */
+bool MinimalAudioEngine::read_osc_u64(std::span<const uint8_t> data, size_t &offset, uint64_t &value)
+{
+  uint32_t high;
+  uint32_t low;
+  if (!read_osc_u32(data, offset, high) || !read_osc_u32(data, offset, low))
+    return false;
+
+  value = (static_cast<uint64_t>(high) << 32) | low;
+  return true;
+}
+
+/** @brief Convert a numeric or boolean argument to a float
+ */
+bool OscArgument::to_float(float &value) const
+{
+  switch (type)
+  {
+    case 'f':
+    case 'd':
+      value = static_cast<float>(float_value);
+      return true;
+    case 'i':
+    case 'h':
+    case 'T':
+    case 'F':
+      value = static_cast<float>(int_value);
+      return true;
+    default:
+      return false;
+  }
+}
+
+/** @brief Convert a numeric or boolean argument to an int
+ */
+bool OscArgument::to_int(int32_t &value) const
+{
+  switch (type)
+  {
+    case 'f':
+    case 'd':
+      value = static_cast<int32_t>(float_value);
+      return true;
+    case 'i':
+    case 'h':
+    case 'T':
+    case 'F':
+      value = static_cast<int32_t>(int_value);
+      return true;
+    default:
+      return false;
+  }
+}
+
+/** @brief Parse a message without copying it.
+ *  @param data The message bytes, which must outlive the view.
+ *  @return The message, or nullopt if it is malformed.
+ */
+std::optional<OscMessageView> OscMessageView::parse(std::span<const uint8_t> data)
+{
+  OscMessageView message;
+  size_t offset = 0;
+  if (!read_osc_string(data, offset, message.m_address) || message.m_address.empty() || message.m_address[0] != '/')
+    return std::nullopt;
+
+  // Very old senders omit the type tag string for messages without arguments
+  if (offset < data.size())
+  {
+    std::string_view type_tags;
+    if (!read_osc_string(data, offset, type_tags) || type_tags.empty() || type_tags[0] != ',')
+      return std::nullopt;
+
+    message.m_type_tags = type_tags.substr(1);
+  }
+
+  message.m_arguments = data.subspan(offset);
+
+  // Validate the arguments up front so handlers can read them without error paths
+  ArgumentReader reader = message.get_arguments();
+  OscArgument argument;
+  size_t count = 0;
+  while (reader.next(argument))
+  {
+    ++count;
+  }
+  if (count != message.m_type_tags.size())
+    return std::nullopt;
+
+  return message;
+}
+
+/** @brief Read the next argument.
+ *  @return False at the end of the arguments or if an argument is truncated or of unknown type.
+ */
+bool OscMessageView::ArgumentReader::next(OscArgument &argument)
+{
+  if (m_tag_index >= m_type_tags.size())
+    return false;
+
+  argument = OscArgument{};
+  argument.type = m_type_tags[m_tag_index];
+
+  uint32_t u32;
+  uint64_t u64;
+  switch (argument.type)
+  {
+    case 'i':
+      if (!read_osc_u32(m_data, m_offset, u32))
+        return false;
+      argument.int_value = static_cast<int32_t>(u32);
+      break;
+    case 'f':
+      if (!read_osc_u32(m_data, m_offset, u32))
+        return false;
+      argument.float_value = std::bit_cast<float>(u32);
+      break;
+    case 'h':
+      if (!read_osc_u64(m_data, m_offset, u64))
+        return false;
+      argument.int_value = static_cast<int64_t>(u64);
+      break;
+    case 'd':
+      if (!read_osc_u64(m_data, m_offset, u64))
+        return false;
+      argument.float_value = std::bit_cast<double>(u64);
+      break;
+    case 't':
+      if (!read_osc_u64(m_data, m_offset, argument.timetag))
+        return false;
+      break;
+    case 's':
+    case 'S':
+      if (!read_osc_string(m_data, m_offset, argument.string))
+        return false;
+      break;
+    case 'b':
+      if (!read_osc_u32(m_data, m_offset, u32) || osc_padded(u32) > m_data.size() - m_offset)
+        return false;
+      argument.blob = m_data.subspan(m_offset, u32);
+      m_offset += osc_padded(u32);
+      break;
+    case 'T':
+      argument.int_value = 1;
+      break;
+    case 'F':
+    case 'N':
+    case 'I':
+      break;
+    default:
+      return false;
+  }
+
+  ++m_tag_index;
+  return true;
+}
+
+/** @brief Get the first argument as a float
+ *  @return False if there is no numeric first argument.
+ */
+bool OscMessageView::get_first_float(float &value) const
+{
+  ArgumentReader reader = get_arguments();
+  OscArgument argument;
+  return reader.next(argument) && argument.to_float(value);
+}
+
+OscMessageBuilder &OscMessageBuilder::add_int32(int32_t value)
+{
+  m_type_tags += 'i';
+  write_osc_u32(m_arguments, static_cast<uint32_t>(value));
+  return *this;
+}
+
+OscMessageBuilder &OscMessageBuilder::add_float(float value)
+{
+  m_type_tags += 'f';
+  write_osc_u32(m_arguments, std::bit_cast<uint32_t>(value));
+  return *this;
+}
+
+OscMessageBuilder &OscMessageBuilder::add_string(std::string_view value)
+{
+  m_type_tags += 's';
+  write_osc_string(m_arguments, value);
+  return *this;
+}
+
+OscMessageBuilder &OscMessageBuilder::add_bool(bool value)
+{
+  m_type_tags += value ? 'T' : 'F';
+  return *this;
+}
+
+/** @brief Encode the message
+ */
+std::vector<uint8_t> OscMessageBuilder::build() const
+{
+  std::vector<uint8_t> packet;
+  write_osc_string(packet, m_address);
+  write_osc_string(packet, m_type_tags);
+  packet.insert(packet.end(), m_arguments.begin(), m_arguments.end());
+  return packet;
+}
+
+/** @brief Encode a bundle of already encoded messages or bundles
+ *  @param timetag NTP timetag, or OSC_TIMETAG_IMMEDIATE
+ */
+std::vector<uint8_t> MinimalAudioEngine::build_osc_bundle(uint64_t timetag, const std::vector<std::vector<uint8_t>> &elements)
+{
+  std::vector<uint8_t> packet;
+  write_osc_string(packet, OSC_BUNDLE_TAG);
+  write_osc_u32(packet, static_cast<uint32_t>(timetag >> 32));
+  write_osc_u32(packet, static_cast<uint32_t>(timetag));
+  for (const auto &element : elements)
+  {
+    write_osc_u32(packet, static_cast<uint32_t>(element.size()));
+    packet.insert(packet.end(), element.begin(), element.end());
+  }
+  return packet;
+}
@@ -0,0 +1,377 @@
+#include "oscserver.h"
+
+#include "audioengine.h"
+#include "trackmanager.h"
+#include "logger.h"
+
+#include <charconv>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+// Seconds between the NTP epoch (1900) and the Unix epoch (1970)
+constexpr uint64_t NTP_UNIX_OFFSET_SECONDS = 2208988800ull;
+
+/** @brief Split the next path component off an OSC address
+ */
+std::string_view next_component(std::string_view &address)
+{
+  if (!address.empty() && address[0] == '/')
+    address.remove_prefix(1);
+
+  size_t end = address.find('/');
+  std::string_view component = address.substr(0, end);
+  address.remove_prefix(end == std::string_view::npos ? address.size() : end);
+  return component;
+}
+
+}  // namespace
+
+/** @brief OscServer constructor
+ *  @param engine CoreEngine whose thread executes play and stop requests.
+ *  @param port UDP port, or 0 to pick a free one (see get_port()).
+ *  @param bind_address IPv4 address to bind, loopback by default.
+ */
+OscServer::OscServer(CoreEngine &engine, uint16_t port, std::string bind_address)
+  : m_engine(engine),
+    m_port(port),
+    m_bind_address(std::move(bind_address)),
+    m_receive_buffer(OSC_MAX_PACKET_SIZE)
+{
+}
+
+OscServer::~OscServer()
+{
+  stop();
+}
+
+/** @brief Get a snapshot of the server counters
+ */
+OscServerStatistics OscServer::get_statistics() const
+{
+  OscServerStatistics statistics;
+  statistics.packets_received = m_packets_received.load(std::memory_order_relaxed);
+  statistics.messages_received = m_messages_received.load(std::memory_order_relaxed);
+  statistics.parameter_changes = m_parameter_changes.load(std::memory_order_relaxed);
+  statistics.malformed_packets = m_malformed_packets.load(std::memory_order_relaxed);
+  statistics.unknown_addresses = m_unknown_addresses.load(std::memory_order_relaxed);
+  statistics.dropped_changes = m_dropped_changes.load(std::memory_order_relaxed);
+  return statistics;
+}
+
+/** @brief Convert an NTP timetag to wall clock time
+ */
+std::chrono::system_clock::time_point OscServer::timetag_to_time(uint64_t timetag)
+{
+  uint64_t seconds = timetag >> 32;
+  uint64_t fraction = timetag & 0xFFFFFFFFull;
+  auto since_unix = std::chrono::seconds(static_cast<int64_t>(seconds) - static_cast<int64_t>(NTP_UNIX_OFFSET_SECONDS)) +
+                    std::chrono::nanoseconds((fraction * 1000000000ull) >> 32);
+  return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(since_unix));
+}
+
+/** @brief Convert wall clock time to an NTP timetag
+ */
+uint64_t OscServer::time_to_timetag(std::chrono::system_clock::time_point time)
+{
+  auto since_unix = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+  uint64_t seconds = static_cast<uint64_t>(since_unix / 1000000000) + NTP_UNIX_OFFSET_SECONDS;
+  uint64_t fraction = (static_cast<uint64_t>(since_unix % 1000000000) << 32) / 1000000000ull;
+  return (seconds << 32) | fraction;
+}
+
+/** @brief Map a timetag to the transport sample it should play at.
+ *  @return 0 for immediate or past timetags, meaning the next audio block.
+ */
+uint64_t OscServer::timetag_to_sample_time(uint64_t timetag) const
+{
+  if (timetag == OSC_TIMETAG_IMMEDIATE)
+    return 0;
+
+  auto delay = timetag_to_time(timetag) - std::chrono::system_clock::now();
+  if (delay <= std::chrono::system_clock::duration::zero())
+    return 0;
+
+  auto steady_time = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(delay);
+  return AudioEngine::instance().get_sample_time_at(steady_time);
+}
+
+/** @brief Dispatch one message by address
+ *  @param timetag Timetag of the enclosing bundle
+ */
+void OscServer::handle_message(const OscMessageView &message, uint64_t timetag)
+{
+  m_messages_received.fetch_add(1, std::memory_order_relaxed);
+
+  std::string_view address = message.get_address();
+  std::string_view root = next_component(address);
+
+  ParameterChange change;
+  float value = 0.0f;
+
+  if (root == "master" && next_component(address) == "gain" && address.empty() && message.get_first_float(value))
+  {
+    change.target = eParameterTarget::MasterGain;
+    change.value = value;
+  }
+  else if (root == "track")
+  {
+    std::string_view index_str = next_component(address);
+    std::string_view action = next_component(address);
+    uint32_t index = 0;
+    auto [end, ec] = std::from_chars(index_str.data(), index_str.data() + index_str.size(), index);
+    if (ec != std::errc() || end != index_str.data() + index_str.size() || !address.empty())
+    {
+      m_unknown_addresses.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    if ((action == "gain" || action == "mute") && message.get_first_float(value))
+    {
+      change.target = action == "gain" ? eParameterTarget::TrackGain : eParameterTarget::TrackMute;
+      change.track_index = index;
+      change.value = value;
+    }
+    else if (action == "play" || action == "stop")
+    {
+      // Timed bundles start or stop the track on their sample
+      bool play = action == "play";
+      uint64_t sample_time = timetag_to_sample_time(timetag);
+      m_engine.push_message({CoreEngineMessage::eType::Command, "OSC track transport", [index, play, sample_time]() {
+        auto track = TrackManager::instance().get_track(index);
+        play ? track->play_at(sample_time) : track->stop_at(sample_time);
+      }});
+      return;
+    }
+    else
+    {
+      m_unknown_addresses.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  }
+  else if (root == "transport")
+  {
+    std::string_view action = next_component(address);
+    if ((action != "play" && action != "stop") || !address.empty())
+    {
+      m_unknown_addresses.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    bool play = action == "play";
+    uint64_t sample_time = timetag_to_sample_time(timetag);
+    if (sample_time != 0)
+    {
+      // Timed transport goes straight to the audio callback so it lands on its sample
+      play ? AudioEngine::instance().play_at(sample_time) : AudioEngine::instance().stop_at(sample_time);
+      return;
+    }
+
+    m_engine.push_message({CoreEngineMessage::eType::Command, "OSC transport", [play]() {
+      play ? AudioEngine::instance().play() : AudioEngine::instance().stop();
+    }});
+    return;
+  }
+  else
+  {
+    m_unknown_addresses.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  change.sample_time = timetag_to_sample_time(timetag);
+  m_parameter_changes.fetch_add(1, std::memory_order_relaxed);
+  schedule(change);
+}
+
+/** @brief Hand a change to the audio thread, or hold it if it is not due yet.
+ *  Changes that do not fit in the ring are held and retried on the next poll.
+ */
+void OscServer::schedule(const ParameterChange &change)
+{
+  auto &audio_engine = AudioEngine::instance();
+  uint64_t horizon = audio_engine.get_sample_time() +
+                     static_cast<uint64_t>(audio_engine.get_sample_rate()) * OSC_SCHEDULE_HORIZON.count() / 1000;
+
+  if (change.sample_time <= horizon && m_scheduled.empty() && audio_engine.push_parameter_change(change))
+    return;
+
+  if (m_scheduled.size() >= OSC_MAX_SCHEDULED)
+  {
+    m_dropped_changes.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  m_scheduled.push({change, m_schedule_sequence++});
+}
+
+/** @brief Hand held changes that have come within the horizon to the audio thread
+ */
+void OscServer::flush_scheduled()
+{
+  auto &audio_engine = AudioEngine::instance();
+  uint64_t horizon = audio_engine.get_sample_time() +
+                     static_cast<uint64_t>(audio_engine.get_sample_rate()) * OSC_SCHEDULE_HORIZON.count() / 1000;
+
+  while (!m_scheduled.empty() && m_scheduled.top().change.sample_time <= horizon)
+  {
+    if (!audio_engine.push_parameter_change(m_scheduled.top().change))
+      return;
+
+    m_scheduled.pop();
+  }
+}
+
+/** @brief Parse a datagram and dispatch its messages
+ */
+void OscServer::handle_packet(std::span<const uint8_t> packet)
+{
+  m_packets_received.fetch_add(1, std::memory_order_relaxed);
+
+  bool valid = parse_osc_packet(packet, [this](const OscMessageView &message, uint64_t timetag) {
+    handle_message(message, timetag);
+  });
+
+  if (!valid)
+  {
+    m_malformed_packets.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+#ifndef _WIN32
+
+/** @brief Bind the UDP socket and start the server thread
+ *  @return True if the server is receiving.
+ */
+bool OscServer::start()
+{
+  if (is_running())
+    return true;
+
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(m_port);
+  if (inet_pton(AF_INET, m_bind_address.c_str(), &address.sin_addr) != 1)
+  {
+    LOG_ERROR("OscServer: Invalid bind address: ", m_bind_address);
+    return false;
+  }
+
+  m_socket_fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+  if (m_socket_fd < 0)
+  {
+    LOG_ERROR("OscServer: Failed to create socket: ", std::strerror(errno));
+    return false;
+  }
+
+  // A large kernel buffer absorbs bursts from control surfaces
+  int receive_buffer_size = OSC_RECEIVE_BUFFER_SIZE;
+  setsockopt(m_socket_fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer_size, sizeof(receive_buffer_size));
+
+  int flags = fcntl(m_socket_fd, F_GETFL, 0);
+  if (flags < 0 || fcntl(m_socket_fd, F_SETFL, flags | O_NONBLOCK) != 0 ||
+      ::bind(m_socket_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+  {
+    LOG_ERROR("OscServer: Failed to bind ", m_bind_address, ":", m_port, ": ", std::strerror(errno));
+    ::close(m_socket_fd);
+    m_socket_fd = -1;
+    return false;
+  }
+
+  socklen_t address_size = sizeof(address);
+  if (getsockname(m_socket_fd, reinterpret_cast<sockaddr *>(&address), &address_size) == 0)
+  {
+    m_port = ntohs(address.sin_port);
+  }
+
+  m_running.store(true, std::memory_order_release);
+  m_thread = std::jthread([this](std::stop_token stop_token) { run(stop_token); });
+
+  LOG_INFO("OscServer: Listening on ", m_bind_address, ":", m_port);
+  return true;
+}
+
+/** @brief Stop the server thread and close the socket.
+ *  Changes still held for the future are discarded.
+ */
+void OscServer::stop()
+{
+  if (!is_running())
+    return;
+
+  m_thread.request_stop();
+  if (m_thread.joinable())
+  {
+    m_thread.join();
+  }
+
+  ::close(m_socket_fd);
+  m_socket_fd = -1;
+  m_scheduled = {};
+  m_running.store(false, std::memory_order_release);
+
+  LOG_INFO("OscServer: Stopped. ", get_statistics().to_string());
+}
+
+/** @brief Server thread main loop
+ */
+void OscServer::run(std::stop_token stop_token)
+{
+  pollfd poll_fd{m_socket_fd, POLLIN, 0};
+
+  while (!stop_token.stop_requested())
+  {
+    // Wake regularly to see stop requests and release held changes
+    int timeout_ms = static_cast<int>(m_scheduled.empty() ? OSC_POLL_INTERVAL.count() * 10 : OSC_POLL_INTERVAL.count());
+    if (::poll(&poll_fd, 1, timeout_ms) < 0 && errno != EINTR)
+    {
+      LOG_ERROR("OscServer: poll failed: ", std::strerror(errno));
+      break;
+    }
+
+    if (poll_fd.revents & POLLIN)
+    {
+      // Drain everything queued so a burst costs one wakeup
+      while (true)
+      {
+        ssize_t received = ::recv(m_socket_fd, m_receive_buffer.data(), m_receive_buffer.size(), 0);
+        if (received < 0)
+        {
+          if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+          {
+            LOG_ERROR("OscServer: recv failed: ", std::strerror(errno));
+          }
+          break;
+        }
+
+        handle_packet(std::span<const uint8_t>(m_receive_buffer.data(), static_cast<size_t>(received)));
+      }
+    }
+
+    flush_scheduled();
+  }
+}
+
+#else
+
+bool OscServer::start()
+{
+  LOG_ERROR("OscServer: Not supported on this platform");
+  return false;
+}
+
+void OscServer::stop() {}
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef __OFFLINE_RENDERER_H__
+#define __OFFLINE_RENDERER_H__
+
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "track.h"
+
+namespace MinimalAudioEngine
+{
+
+/** @struct OfflineRenderConfig
+ *  @brief Parameters for an offline render.
+ */
+struct OfflineRenderConfig
+{
+  std::filesystem::path output_directory = ".";
+  unsigned int channels = 2;
+  unsigned int sample_rate = 0;           // 0 uses the first track's file sample rate
+  unsigned int segment_frames = 1 << 18;  // Work unit: frames of one track rendered as one task
+  unsigned int thread_count = 0;          // Parallel render tasks; 0 uses every TaskScheduler worker
+  int format = 0;                         // libsndfile format flags, 0 for 32-bit float WAV
+  bool export_stems = true;
+  bool export_mix = true;
+  std::string stem_prefix = "track_";
+  std::string mix_filename = "mix.wav";
+};
+
+/** @struct OfflineRenderStatistics
+ *  @brief Results and throughput of an offline render.
+ */
+struct OfflineRenderStatistics
+{
+  unsigned int tracks_rendered = 0;
+  unsigned int files_written = 0;
+  unsigned int segments_rendered = 0;
+  unsigned int threads_used = 0;
+  uint64_t session_frames = 0;
+  uint64_t frames_rendered = 0;   // Summed over all stems
+  double elapsed_seconds = 0.0;
+  double frames_per_second = 0.0;
+  double realtime_factor = 0.0;   // Seconds of stem audio rendered per wall-clock second
+
+  std::string to_string() const
+  {
+    return "OfflineRenderStatistics(Tracks=" + std::to_string(tracks_rendered) +
+           ", Files=" + std::to_string(files_written) +
+           ", Segments=" + std::to_string(segments_rendered) +
+           ", Threads=" + std::to_string(threads_used) +
+           ", SessionFrames=" + std::to_string(session_frames) +
+           ", FramesRendered=" + std::to_string(frames_rendered) +
+           ", ElapsedSeconds=" + std::to_string(elapsed_seconds) +
+           ", FramesPerSecond=" + std::to_string(frames_per_second) +
+           ", RealtimeFactor=" + std::to_string(realtime_factor) + ")";
+  }
+};
+
+/** @class OfflineRenderer
+ *  @brief Renders tracks to per-track stem files and a mix, faster than real time.
+ *  Work is split across tracks and time segments, which render independently since a
+ *  track's offline output depends only on the read position, and processed on the
+ *  shared TaskScheduler. Each output file is written in
+ *  order by its own encoder thread so disk I/O overlaps with rendering.
+ */
+class OfflineRenderer
+{
+public:
+  explicit OfflineRenderer(const OfflineRenderConfig &config);
+  ~OfflineRenderer() = default;
+
+  OfflineRenderer(const OfflineRenderer &) = delete;
+  OfflineRenderer &operator=(const OfflineRenderer &) = delete;
+
+  OfflineRenderStatistics render(const std::vector<TrackPtr> &tracks);
+
+private:
+  class OrderedWriter;
+
+  OfflineRenderConfig m_config;
+};
+
+}  // namespace MinimalAudioEngine
+
+#endif  // __OFFLINE_RENDERER_H__
@@ -0,0 +1,423 @@
+#include "offlinerenderer.h"
+
+#include "wavfile.h"
+#include "wavwriter.h"
+#include "logger.h"
+#include "taskscheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+using namespace MinimalAudioEngine;
+
+/** @class OfflineRenderer::OrderedWriter
+ *  @brief Encoder thread for one output file.
+ *  Segments may be submitted in any order from any thread; they are written
+ *  strictly in segment order. Submitters block once too many out-of-order
+ *  segments are pending, which bounds memory use.
+ */
+class OfflineRenderer::OrderedWriter
+{
+public:
+  OrderedWriter(WavWriterPtr writer, size_t segment_count, size_t max_pending):
+    m_writer(writer),
+    m_segment_count(segment_count),
+    m_max_pending(std::max<size_t>(max_pending, 1))
+  {
+    m_thread = std::jthread(&OrderedWriter::run, this);
+  }
+
+  ~OrderedWriter()
+  {
+    // Unblocks the encoder if the render was abandoned part way through
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_aborted = true;
+    }
+    m_condition.notify_all();
+
+    finish();
+  }
+
+  /** @brief Hands a rendered segment to the encoder thread.
+   *  @param segment Index of the segment in the file.
+   *  @param samples Interleaved samples; ownership is taken.
+   *  @param frames Number of valid frames in samples.
+   */
+  void submit(size_t segment, std::vector<float> &&samples, unsigned int frames)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    // The next expected segment is always admitted so the writer can make progress
+    m_condition.wait(lock, [this, segment] {
+      return segment == m_next_segment || m_pending.size() < m_max_pending;
+    });
+
+    m_pending.emplace(segment, Segment{std::move(samples), frames});
+    m_condition.notify_all();
+  }
+
+  /** @brief Waits for all segments to be written and closes the file.
+   */
+  void finish()
+  {
+    if (m_thread.joinable())
+    {
+      m_thread.join();
+    }
+
+    if (m_writer)
+    {
+      m_writer->close();
+    }
+  }
+
+private:
+  struct Segment
+  {
+    std::vector<float> samples;
+    unsigned int frames;
+  };
+
+  void run()
+  {
+    set_thread_name("RenderWriter");
+
+    while (true)
+    {
+      Segment segment;
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_next_segment >= m_segment_count)
+        {
+          break;
+        }
+
+        m_condition.wait(lock, [this] { return m_aborted || m_pending.count(m_next_segment) > 0; });
+        if (m_aborted)
+        {
+          break;
+        }
+
+        auto it = m_pending.find(m_next_segment);
+        segment = std::move(it->second);
+        m_pending.erase(it);
+      }
+
+      m_writer->write_frames(segment.samples.data(), segment.frames);
+
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_next_segment;
+      }
+      m_condition.notify_all();
+    }
+  }
+
+  WavWriterPtr m_writer;
+  size_t m_segment_count;
+  size_t m_max_pending;
+  size_t m_next_segment = 0;
+  bool m_aborted = false;
+
+  std::map<size_t, Segment> m_pending;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::jthread m_thread;
+};
+
+/** @brief OfflineRenderer constructor
+ *  @param config Render parameters.
+ */
+OfflineRenderer::OfflineRenderer(const OfflineRenderConfig &config):
+  m_config(config)
+{
+  if (m_config.channels == 0)
+  {
+    throw std::invalid_argument("OfflineRenderer: Channel count must be non-zero");
+  }
+
+  if (m_config.segment_frames == 0)
+  {
+    throw std::invalid_argument("OfflineRenderer: Segment size must be non-zero");
+  }
+}
+
+/** @brief Renders the given tracks to stem files and/or a mix file.
+ *  Blocks until all files are written.
+ *  @param tracks The tracks to render. Tracks without a file input are skipped.
+ *  @return Render statistics, including throughput.
+ *  @throws std::runtime_error if an output file cannot be created.
+ */
+OfflineRenderStatistics OfflineRenderer::render(const std::vector<TrackPtr> &tracks)
+{
+  OfflineRenderStatistics statistics;
+  auto start_time = std::chrono::steady_clock::now();
+
+  const unsigned int channels = m_config.channels;
+  const uint64_t segment_frames = m_config.segment_frames;
+
+  // Collect renderable tracks and the session length
+  struct RenderTrack
+  {
+    size_t index;
+    TrackPtr track;
+    uint64_t length;
+    size_t segment_count;
+  };
+
+  std::vector<RenderTrack> render_tracks;
+  unsigned int sample_rate = m_config.sample_rate;
+
+  for (size_t i = 0; i < tracks.size(); ++i)
+  {
+    const TrackPtr &track = tracks[i];
+    if (!track || !track->can_render_offline())
+    {
+      LOG_WARNING("OfflineRenderer: Skipping track ", i, " - no file input.");
+      continue;
+    }
+
+    uint64_t length = track->get_length_frames();
+    if (length == 0)
+    {
+      LOG_WARNING("OfflineRenderer: Skipping track ", i, " - input is empty or missing.");
+      continue;
+    }
+
+    if (sample_rate == 0)
+    {
+      sample_rate = track->get_input_sample_rate();
+    }
+    else if (track->get_input_sample_rate() != sample_rate)
+    {
+      LOG_WARNING("OfflineRenderer: Track ", i, " sample rate ", track->get_input_sample_rate(),
+                  " does not match render sample rate ", sample_rate, ". Rendering without resampling.");
+    }
+
+    size_t segment_count = static_cast<size_t>((length + segment_frames - 1) / segment_frames);
+    render_tracks.push_back({i, track, length, segment_count});
+    statistics.session_frames = std::max(statistics.session_frames, length);
+  }
+
+  if (render_tracks.empty())
+  {
+    LOG_WARNING("OfflineRenderer: Nothing to render.");
+    return statistics;
+  }
+
+  const size_t session_segments = static_cast<size_t>((statistics.session_frames + segment_frames - 1) / segment_frames);
+
+  // Build the work list segment-major so early segments finish first and
+  // writers can drain while later segments are still rendering
+  struct RenderTask
+  {
+    size_t render_track;
+    size_t segment;
+  };
+
+  std::vector<RenderTask> tasks;
+  for (size_t segment = 0; segment < session_segments; ++segment)
+  {
+    for (size_t t = 0; t < render_tracks.size(); ++t)
+    {
+      if (segment < render_tracks[t].segment_count)
+      {
+        tasks.push_back({t, segment});
+      }
+    }
+  }
+
+  // File handles are reused across tasks instead of being opened per segment. Since the
+  // work list is segment-major, a file is rarely read by more than one worker at a time,
+  // so each pool usually holds a single handle.
+  struct ReaderPool
+  {
+    std::mutex mutex;
+    std::vector<WavFileReaderPtr> readers;
+  };
+  std::vector<ReaderPool> reader_pools(render_tracks.size());
+
+  TaskScheduler &scheduler = TaskScheduler::instance();
+  unsigned int thread_count = m_config.thread_count != 0 ? m_config.thread_count : scheduler.get_thread_count();
+  thread_count = std::min<unsigned int>(thread_count, static_cast<unsigned int>(tasks.size()));
+  statistics.threads_used = thread_count;
+
+  LOG_INFO("OfflineRenderer: Rendering ", render_tracks.size(), " tracks, ", statistics.session_frames,
+           " frames at ", sample_rate, " Hz in ", tasks.size(), " tasks on ", thread_count, " threads.");
+
+  // One encoder per output file
+  auto create_writer = [&](const std::filesystem::path &filename, size_t segment_count) {
+    auto writer = FileManager::instance().create_wav_file(m_config.output_directory / filename,
+                                                          channels, sample_rate, m_config.format);
+    if (!writer.has_value())
+    {
+      throw std::runtime_error("OfflineRenderer: Failed to create output file: " + filename.string());
+    }
+
+    return std::make_unique<OrderedWriter>(writer.value(), segment_count, 2 * thread_count);
+  };
+
+  std::vector<std::unique_ptr<OrderedWriter>> stem_writers(render_tracks.size());
+  if (m_config.export_stems)
+  {
+    for (size_t t = 0; t < render_tracks.size(); ++t)
+    {
+      stem_writers[t] = create_writer(m_config.stem_prefix + std::to_string(render_tracks[t].index) + ".wav",
+                                      render_tracks[t].segment_count);
+    }
+  }
+
+  // Mix segments are accumulated by whichever workers render that segment,
+  // and handed to the mix writer by the last contributor
+  struct MixSegment
+  {
+    std::mutex mutex;
+    std::vector<float> samples;
+    std::atomic<size_t> remaining{0};
+  };
+
+  std::unique_ptr<OrderedWriter> mix_writer;
+  std::vector<MixSegment> mix_segments(m_config.export_mix ? session_segments : 0);
+  if (m_config.export_mix)
+  {
+    mix_writer = create_writer(m_config.mix_filename, session_segments);
+    for (const auto &render_track : render_tracks)
+    {
+      for (size_t segment = 0; segment < render_track.segment_count; ++segment)
+      {
+        mix_segments[segment].remaining.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  std::atomic<size_t> next_task{0};
+  std::atomic<uint64_t> frames_rendered{0};
+  std::atomic<unsigned int> segments_rendered{0};
+
+  auto worker = [&]() {
+    size_t task_index;
+    while ((task_index = next_task.fetch_add(1, std::memory_order_relaxed)) < tasks.size())
+    {
+      const RenderTask &task = tasks[task_index];
+      const RenderTrack &render_track = render_tracks[task.render_track];
+      ReaderPool &reader_pool = reader_pools[task.render_track];
+      const size_t segment = task.segment;
+
+      uint64_t position = segment * segment_frames;
+      unsigned int frames = static_cast<unsigned int>(std::min(segment_frames, render_track.length - position));
+
+      WavFileReaderPtr reader;
+      {
+        std::lock_guard<std::mutex> lock(reader_pool.mutex);
+        if (!reader_pool.readers.empty())
+        {
+          reader = std::move(reader_pool.readers.back());
+          reader_pool.readers.pop_back();
+        }
+      }
+
+      std::vector<float> samples(static_cast<size_t>(frames) * channels, 0.0f);
+      try
+      {
+        if (!reader)
+        {
+          reader = render_track.track->open_offline_reader();
+        }
+        render_track.track->render_frames_at(samples.data(), position, frames, channels, reader.get());
+      }
+      catch (const std::exception &e)
+      {
+        // Keep the segment so the writers stay in step; it is written as silence
+        LOG_ERROR("OfflineRenderer: Failed to render track ", render_track.index, " segment ", segment, ": ", e.what());
+      }
+
+      if (reader)
+      {
+        std::lock_guard<std::mutex> lock(reader_pool.mutex);
+        reader_pool.readers.push_back(std::move(reader));
+      }
+
+      if (mix_writer)
+      {
+        MixSegment &mix_segment = mix_segments[segment];
+        bool last_contributor = false;
+        {
+          std::lock_guard<std::mutex> lock(mix_segment.mutex);
+          if (mix_segment.samples.empty())
+          {
+            uint64_t mix_frames = std::min(segment_frames, statistics.session_frames - position);
+            mix_segment.samples.assign(static_cast<size_t>(mix_frames) * channels, 0.0f);
+          }
+
+          for (size_t i = 0; i < samples.size(); ++i)
+          {
+            mix_segment.samples[i] += samples[i];
+          }
+
+          last_contributor = mix_segment.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1;
+        }
+
+        if (last_contributor)
+        {
+          unsigned int mix_frames = static_cast<unsigned int>(mix_segment.samples.size() / channels);
+          mix_writer->submit(segment, std::move(mix_segment.samples), mix_frames);
+        }
+      }
+
+      if (stem_writers[task.render_track])
+      {
+        stem_writers[task.render_track]->submit(segment, std::move(samples), frames);
+      }
+
+      frames_rendered.fetch_add(frames, std::memory_order_relaxed);
+      segments_rendered.fetch_add(1, std::memory_order_relaxed);
+    }
+  };
+
+  // Workers come from the shared scheduler, so a render does not oversubscribe the machine
+  {
+    TaskGroup workers;
+    for (unsigned int i = 0; i < thread_count; ++i)
+    {
+      scheduler.submit(workers, worker, eTaskPriority::Normal);
+    }
+    workers.wait();
+  }
+
+  // Wait for the encoders to flush
+  for (auto &stem_writer : stem_writers)
+  {
+    if (stem_writer)
+    {
+      stem_writer->finish();
+      statistics.files_written++;
+    }
+  }
+
+  if (mix_writer)
+  {
+    mix_writer->finish();
+    statistics.files_written++;
+  }
+
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time);
+
+  statistics.tracks_rendered = static_cast<unsigned int>(render_tracks.size());
+  statistics.segments_rendered = segments_rendered.load();
+  statistics.frames_rendered = frames_rendered.load();
+  statistics.elapsed_seconds = elapsed.count();
+  if (statistics.elapsed_seconds > 0.0)
+  {
+    statistics.frames_per_second = static_cast<double>(statistics.frames_rendered) / statistics.elapsed_seconds;
+    statistics.realtime_factor = statistics.frames_per_second / static_cast<double>(sample_rate);
+  }
+
+  LOG_INFO("OfflineRenderer: Finished. ", statistics.to_string());
+  return statistics;
+}
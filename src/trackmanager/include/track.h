@@ -1,6 +1,7 @@
 #ifndef __TRACK_H__
 #define __TRACK_H__
 
+#include <array>
 #include <queue>
 #include <mutex>
 #include <memory>
@@ -9,24 +10,30 @@
 #include <atomic>
 #include <string>
 #include <functional>
+#include <cstdint>
 
 #include "observer.h"
 #include "midiengine.h"
 #include "filemanager.h"
 #include "devicemanager.h"
 #include "audiodevice.h"
+#include "midieffects.h"
+#include "parameterregistry.h"
+#include "ringbuffer.h"
 
 namespace MinimalAudioEngine
 {
 
 // Forward declarations
 struct AudioMessage;
+class AudioEngine;
+class MidiEngine;
 class WavFile;
 class MidiFile;
   
 // Type definitions
 typedef std::shared_ptr<class Track> TrackPtr;
-typedef std::variant<AudioDevice, WavFilePtr, std::nullopt_t> AudioIOVariant;
+typedef std::variant<AudioDevice, WavFilePtr, PcmInputStreamPtr, PcmOutputStreamPtr, std::nullopt_t> AudioIOVariant;
 typedef std::variant<MidiDevice, MidiFilePtr, std::nullopt_t> MidiIOVariant;
 
 /** @enum eTrackEvent
@@ -39,6 +46,11 @@ enum class eTrackEvent
 
 typedef std::function<void(eTrackEvent)> TrackEventCallback;
 
+constexpr size_t TRACK_READ_BUFFER_SAMPLES = 4096;  // Input read per chunk in the audio callback
+constexpr float TRACK_FADE_MS = 5.0f;                // Ramp applied when a track starts or stops
+constexpr size_t TRACK_MIDI_QUEUE_SIZE = 1024;      // MIDI events waiting for the audio callback
+constexpr float TRACK_GAIN_PARAMETER_MAX = 2.0f;     // Top of the registry range of a track's gain
+
 /** @class Track
  *  @brief The Track can one handle audio or MIDI input and output.
  *  It implements the Observer pattern to receive MIDI and audio messages.
@@ -55,11 +67,29 @@ public:
     m_midi_output(std::nullopt)
   {}
 
+  /** @brief Construct a track that plays through a context's engines
+   *  @param audio_engine AudioEngine to play through, or nullptr for the default.
+   *  @param midi_engine MidiEngine to receive from, or nullptr for the default.
+   *  @param id Identifier that stays with the track when others are removed.
+   */
+  Track(AudioEngine *audio_engine, MidiEngine *midi_engine, size_t id):
+    m_audio_input(std::nullopt),
+    m_midi_input(std::nullopt),
+    m_audio_output(std::nullopt),
+    m_midi_output(std::nullopt),
+    m_audio_engine(audio_engine),
+    m_midi_engine(midi_engine),
+    m_id(id)
+  {}
+
   ~Track() = default;
 
+  size_t get_id() const { return m_id; }
+
   // Audio/MIDI Inputs
   void add_audio_device_input(const AudioDevice &device);
   void add_audio_file_input(const WavFilePtr wav_file);
+  void add_audio_stream_input(const PcmInputStreamPtr stream);
   void add_midi_device_input(const MidiDevice &device);
   void add_midi_file_input(const MidiFilePtr midi_file);
 
@@ -83,6 +113,35 @@ public:
 
   void play();
   void stop();
+  void play_at(uint64_t sample_time);
+  void stop_at(uint64_t sample_time);
+
+  /** @brief True unless the track has been stopped or is cued for a later start.
+   *  Tracks start out playing, so they follow the transport.
+   */
+  bool is_playing() const
+  {
+    return m_playing.load(std::memory_order_acquire) && !m_cued.load(std::memory_order_acquire);
+  }
+
+  // Mix parameters, written by the audio thread when changed remotely
+  void set_gain(float gain) { m_gain.store(gain, std::memory_order_relaxed); }
+  float get_gain() const { return m_gain.load(std::memory_order_relaxed); }
+  void set_muted(bool muted) { m_muted.store(muted, std::memory_order_relaxed); }
+  bool is_muted() const { return m_muted.load(std::memory_order_relaxed); }
+
+  /** @brief Follow a registry parameter with the track's gain, or PARAMETER_NO_ID to stop.
+   *  The callback applies the parameter whenever its smoothed value moves, so set_gain() still
+   *  works in between; the value the parameter has when it is bound is not applied.
+   */
+  void bind_gain_parameter(ParameterId parameter) { m_gain_parameter.store(parameter, std::memory_order_release); }
+  ParameterId get_gain_parameter() const { return m_gain_parameter.load(std::memory_order_acquire); }
+  void apply_gain_parameter(unsigned int frames, unsigned int sample_rate) noexcept;
+
+  /** @brief Armed tracks are recorded by the next AudioEngine::start_recording()
+   */
+  void set_record_armed(bool armed) { m_record_armed.store(armed, std::memory_order_relaxed); }
+  bool is_record_armed() const { return m_record_armed.load(std::memory_order_relaxed); }
 
   void set_event_callback(TrackEventCallback callback)
   {
@@ -95,7 +154,33 @@ public:
 
   void handle_midi_message();
 
-  void get_next_audio_frame(float *output_buffer, unsigned int frames, unsigned int channels, unsigned int sample_rate);
+  bool get_next_audio_frame(float *output_buffer, unsigned int frames, unsigned int channels, unsigned int sample_rate,
+                            uint64_t sample_time = 0);
+
+  // MIDI effects, run on the block's events in the audio callback
+  void set_midi_effect(std::unique_ptr<IMidiEffect> effect);
+  bool has_midi_effect() const { return m_midi_effect_slot.load(std::memory_order_acquire) != nullptr; }
+  void process_midi_block(unsigned int frames, unsigned int sample_rate, uint64_t sample_time) noexcept;
+
+  /** @brief Events of the device block being rendered, after the MIDI effect, with offsets from its first frame.
+   *  Audio callback only.
+   */
+  const MidiEventList &get_block_midi_events() const noexcept { return m_block_events; }
+
+  /** @brief MIDI events lost because the queue to the callback or the block's list was full
+   */
+  uint64_t get_midi_events_dropped() const noexcept
+  {
+    return m_midi_events_dropped.load(std::memory_order_relaxed) + m_block_events.get_dropped();
+  }
+
+  // Offline rendering
+  bool can_render_offline() const;
+  uint64_t get_length_frames() const;
+  unsigned int get_input_sample_rate() const;
+  MinimalAudioEngine::WavFileReaderPtr open_offline_reader() const;
+  unsigned int render_frames_at(float *output_buffer, uint64_t position, unsigned int frames, unsigned int channels,
+                                MinimalAudioEngine::WavFileReader *reader = nullptr) const;
 
   std::string to_string() const;
 
@@ -110,6 +195,54 @@ private:
   AudioIOVariant m_audio_output;
   MidiIOVariant m_midi_output;
 
+  AudioEngine *m_audio_engine = nullptr;  // nullptr for the default engines
+  MidiEngine *m_midi_engine = nullptr;
+  size_t m_id = 0;
+  AudioEngine &get_audio_engine() const;
+  MidiEngine &get_midi_engine() const;
+
+  std::atomic<float> m_gain{1.0f};
+  std::atomic<bool> m_muted{false};
+  std::atomic<bool> m_record_armed{false};
+
+  float get_effective_gain() const { return is_muted() ? 0.0f : get_gain(); }
+
+  // Gain parameter. The callback remembers the binding and value it last saw, so only moves are applied.
+  std::atomic<ParameterId> m_gain_parameter{PARAMETER_NO_ID};
+  ParameterId m_applied_gain_parameter = PARAMETER_NO_ID;
+  float m_applied_parameter_gain = 0.0f;
+
+  // Play state. The latest play_at()/stop_at() waits here, packed as (sample_time << 1) | play,
+  // until the callback reaches its sample; the fade is owned by the callback.
+  static constexpr uint64_t NO_SCHEDULED_COMMAND = UINT64_MAX;
+  void schedule_play_state(bool play, uint64_t sample_time);
+  bool mix_audio_input(float *output_buffer, unsigned int frames, unsigned int channels, unsigned int sample_rate);
+  float next_fade_gain(bool playing, float fade_step) noexcept;
+  std::atomic<uint64_t> m_scheduled_command{NO_SCHEDULED_COMMAND};
+  std::atomic<bool> m_playing{true};
+  std::atomic<bool> m_cued{false};     // Silent until a future play_at() is reached
+  std::atomic<bool> m_audible{false};  // Written by the callback: the track was heard in its last block
+  float m_fade_gain = 1.0f;
+
+  // Audio callback only: input read ahead of mixing, so no block allocates
+  std::array<float, TRACK_READ_BUFFER_SAMPLES> m_read_buffer{};
+
+  // MIDI input on its way to the callback, stamped with the transport sample it arrived at
+  struct TimedMidiEvent
+  {
+    uint64_t sample_time = 0;
+    MidiEvent event;
+  };
+  SpscRingBuffer<TimedMidiEvent, TRACK_MIDI_QUEUE_SIZE> m_midi_queue;
+  std::atomic<uint64_t> m_midi_events_dropped{0};
+
+  // The callback runs the effect in the slot; the epoch is odd while it does
+  std::atomic<IMidiEffect *> m_midi_effect_slot{nullptr};
+  std::atomic<uint64_t> m_midi_epoch{0};
+  std::unique_ptr<IMidiEffect> p_midi_effect;
+  std::mutex m_midi_effect_mutex;
+  MidiEventList m_block_events;  // Audio callback only
+
   // TEST
   std::atomic<double> m_test_tone_phase{0.0};
 };
@@ -9,11 +9,17 @@
 namespace MinimalAudioEngine
 {
 
+class AudioEngine;
+class MidiEngine;
+class EngineContext;
+
 /** @class TrackManager
  *  @brief The TrackManager class is responsible for managing tracks in the application.
  */
 class TrackManager
 {
+  friend class MinimalAudioEngine::EngineContext;
+
 public:
   static TrackManager& instance()
   {
@@ -30,11 +36,26 @@ public:
 
   size_t get_track_count() const { return m_tracks.size(); }
 
+  virtual ~TrackManager() = default;
+
 private:
   TrackManager() = default;
-  virtual ~TrackManager() = default;
+
+  /** @brief Bind new tracks to a context's engines instead of the default ones
+   */
+  void set_engines(AudioEngine *audio_engine, MidiEngine *midi_engine)
+  {
+    m_audio_engine = audio_engine;
+    m_midi_engine = midi_engine;
+  }
+
+  AudioEngine &get_audio_engine() const;
+  void bind_track_parameters(const TrackPtr &track);
 
   std::vector<TrackPtr> m_tracks;
+  size_t m_next_track_id = 0;
+  AudioEngine *m_audio_engine = nullptr;  // nullptr for the default engines
+  MidiEngine *m_midi_engine = nullptr;
 };
 
 }  // namespace MinimalAudioEngine
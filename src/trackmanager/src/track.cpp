@@ -2,11 +2,15 @@
 
 #include "wavfile.h"
 #include "midifile.h"
+#include "pcmstream.h"
 #include "audioengine.h"
 
 #include <iostream>
 #include <stdexcept>
 #include <memory>
+#include <algorithm>
+#include <chrono>
+#include <thread>
 
 // Define M_PI if not already defined (Windows MSVC compatibility)
 #ifndef M_PI
@@ -15,6 +19,20 @@
 
 using namespace MinimalAudioEngine;
 
+/** @brief Get the AudioEngine the track plays through
+ */
+AudioEngine &Track::get_audio_engine() const
+{
+  return m_audio_engine != nullptr ? *m_audio_engine : AudioEngine::instance();
+}
+
+/** @brief Get the MidiEngine the track receives from
+ */
+MidiEngine &Track::get_midi_engine() const
+{
+  return m_midi_engine != nullptr ? *m_midi_engine : MidiEngine::instance();
+}
+
 /** @brief Adds an audio input to the track.
  *  @param device The audio input device.
  */
@@ -52,6 +70,22 @@ void Track::add_audio_file_input(const MinimalAudioEngine::WavFilePtr wav_file)
   LOG_INFO("Track: Added audio input file: ", wav_file->to_string());
 }
 
+/** @brief Adds a raw PCM stream input to the track.
+ *  The stream starts reading when the track plays.
+ *  @param stream The PCM stream.
+ */
+void Track::add_audio_stream_input(const MinimalAudioEngine::PcmInputStreamPtr stream)
+{
+  if (has_audio_input())
+  {
+    throw std::runtime_error("This track already has an audio input.");
+  }
+
+  m_audio_input = stream;
+
+  LOG_INFO("Track: Added audio input stream: ", stream->to_string());
+}
+
 /** @brief Adds a MIDI input device to the track.
  *  @param device The MIDI input device.
  */
@@ -92,7 +126,7 @@ void Track::add_audio_device_output(const MinimalAudioEngine::AudioDevice &devic
   }
 
   m_audio_output = device;
-  MinimalAudioEngine::AudioEngine::instance().set_output_device(device);
+  get_audio_engine().set_output_device(device);
 
   LOG_INFO("Track: Added audio output device: ", device.name);
 }
@@ -124,7 +158,7 @@ void Track::remove_audio_input()
 void Track::remove_midi_input()
 {
   m_midi_input = std::nullopt;
-  MinimalAudioEngine::MidiEngine::instance().close_input_port();
+  get_midi_engine().close_input_port();
 }
 
 /** @brief Removes the audio output from the track.
@@ -205,16 +239,69 @@ MidiIOVariant Track::get_midi_output() const
   return m_midi_output;
 }
 
+/** @brief Start the track on the next block and make sure the engine is playing.
+ */
 void Track::play()
 {
-  LOG_INFO("Track: Play...");
-  MinimalAudioEngine::AudioEngine::instance().play();
+  play_at(0);
 }
 
+/** @brief Stop the track on the next block with a short fade.
+ *  The stream keeps running, so the track can be started again on any sample.
+ */
 void Track::stop()
 {
-  LOG_INFO("Track: Stop...");
-  MinimalAudioEngine::AudioEngine::instance().stop();
+  stop_at(0);
+}
+
+/** @brief Start the track at a transport sample, fading in, and make sure the engine is playing.
+ *  Tracks scheduled for the same sample start together without restarting the output.
+ *  @param sample_time Transport sample to start at (see AudioEngine::get_quantized_sample_time);
+ *  0 or a past sample means the next block.
+ */
+void Track::play_at(uint64_t sample_time)
+{
+  LOG_INFO("Track: Play at ", sample_time, "...");
+
+  // Open a deferred file input here rather than in the audio callback
+  if (std::holds_alternative<MinimalAudioEngine::WavFilePtr>(m_audio_input))
+  {
+    auto wav_file = std::get<MinimalAudioEngine::WavFilePtr>(m_audio_input);
+    if (!wav_file->prefetch())
+    {
+      LOG_WARNING("Track: Audio input file is missing: ", wav_file->get_filepath().string());
+    }
+  }
+  else if (std::holds_alternative<MinimalAudioEngine::PcmInputStreamPtr>(m_audio_input))
+  {
+    std::get<MinimalAudioEngine::PcmInputStreamPtr>(m_audio_input)->start();
+  }
+
+  // A track that is not audible yet stays silent until its start, instead of playing from now
+  if (!m_audible.load(std::memory_order_acquire) && sample_time > get_audio_engine().get_sample_time())
+  {
+    m_cued.store(true, std::memory_order_release);
+  }
+
+  schedule_play_state(true, sample_time);
+  get_audio_engine().play();
+}
+
+/** @brief Stop the track at a transport sample, fading out. Its input holds its position.
+ *  @param sample_time Transport sample to stop at; 0 or a past sample means the next block.
+ */
+void Track::stop_at(uint64_t sample_time)
+{
+  LOG_INFO("Track: Stop at ", sample_time, "...");
+  schedule_play_state(false, sample_time);
+}
+
+/** @brief Hand a play state change to the audio callback. Replaces one that has not been reached yet.
+ */
+void Track::schedule_play_state(bool play, uint64_t sample_time)
+{
+  sample_time = std::min(sample_time, (NO_SCHEDULED_COMMAND >> 1) - 1);
+  m_scheduled_command.store((sample_time << 1) | (play ? 1u : 0u), std::memory_order_release);
 }
 
 /** @brief Updates the track with a new MIDI message.
@@ -223,10 +310,78 @@ void Track::stop()
  */
 void Track::update(const MinimalAudioEngine::MidiMessage& message)
 {
+  // Channel messages also go to the audio callback, placed on the sample they arrived at
+  if (message.status >= 0x80 && message.status < 0xF0)
+  {
+    TimedMidiEvent timed;
+    timed.sample_time = get_audio_engine().get_sample_time_at(std::chrono::steady_clock::now());
+    timed.event = {0, message.status, message.data1, message.data2};
+    if (!m_midi_queue.try_push(timed))
+    {
+      m_midi_events_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
   std::lock_guard<std::mutex> lock(m_queue_mutex);
   m_message_queue.push(message);
 }
 
+/** @brief Set the MIDI effect the track runs on each block's events, replacing the current one.
+ *  Returns once the audio callback has stopped using the old effect, which is then destroyed.
+ *  @param effect The effect, e.g. from make_midi_effect_chain(), or nullptr for none.
+ */
+void Track::set_midi_effect(std::unique_ptr<IMidiEffect> effect)
+{
+  std::lock_guard<std::mutex> lock(m_midi_effect_mutex);
+  m_midi_effect_slot.store(effect.get(), std::memory_order_release);
+
+  // A block that picked up the old effect finishes with it first. The fence orders the slot
+  // store before the epoch load, and pairs with the one in process_midi_block()
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const uint64_t epoch = m_midi_epoch.load(std::memory_order_acquire);
+  while ((epoch & 1) != 0 && m_midi_epoch.load(std::memory_order_acquire) == epoch)
+  {
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  p_midi_effect = std::move(effect);
+}
+
+/** @brief Collect the MIDI events due in a block and run the track's MIDI effect on them.
+ *  Called from the audio callback once per device block, before the block is split into segments,
+ *  so the events keep their offsets from its first frame. Events that arrived late are placed on
+ *  the first frame; those due after the block wait for a later one.
+ *  @param frames Frames in the block.
+ *  @param sample_rate Sample rate of the block.
+ *  @param sample_time Transport sample of the first frame.
+ */
+void Track::process_midi_block(unsigned int frames, unsigned int sample_rate, uint64_t sample_time) noexcept
+{
+  m_midi_epoch.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  m_block_events.clear();
+  const uint64_t block_end = sample_time + frames;
+  while (const TimedMidiEvent *timed = m_midi_queue.front())
+  {
+    if (timed->sample_time >= block_end || m_block_events.full())
+      break;
+
+    MidiEvent event = timed->event;
+    event.offset = timed->sample_time > sample_time ? static_cast<uint32_t>(timed->sample_time - sample_time) : 0;
+    m_block_events.push(event);
+
+    TimedMidiEvent discarded;
+    m_midi_queue.try_pop(discarded);
+  }
+
+  if (IMidiEffect *effect = m_midi_effect_slot.load(std::memory_order_acquire))
+  {
+    effect->process(m_block_events, {sample_time, frames, sample_rate});
+  }
+
+  m_midi_epoch.fetch_add(1, std::memory_order_release);
+}
+
 /** @brief Updates the track with a new audio message.
  *  This function is called by the AudioEngine when a new audio message is received.
  *  @param message The audio message to process.
@@ -282,90 +437,302 @@ void Track::handle_midi_message()
   }
 }
 
-/** @brief Fill the audio output buffer with the next available data
- *  @param output_buffer Pointer to the output buffer where audio data will be written.
- *  @param frames Number of frames to fill in the output buffer.
+/** @brief Mix the next block of the track's input into the output buffer.
+ *  Called from the audio callback: it does not allocate, lock or log on the normal path.
+ *  A scheduled play or stop is applied on its exact sample within the block.
+ *  @param output_buffer Interleaved buffer the track is added to.
+ *  @param frames Number of frames to mix.
  *  @param channels Number of output audio channels.
  *  @param sample_rate Sample rate of the audio data.
+ *  @param sample_time Transport sample of the first frame.
+ *  @return False once the input has nothing more to play or there is no input. A stopped track
+ *  still returns true: it can be started again while the stream runs.
  */
-void Track::get_next_audio_frame(float *output_buffer, unsigned int frames, unsigned int channels, unsigned int sample_rate)
+bool Track::get_next_audio_frame(float *output_buffer, unsigned int frames, unsigned int channels, unsigned int sample_rate,
+                                 uint64_t sample_time)
 {
-  LOG_INFO("Track: get_next_audio_frame with ", frames, " frames.", 
-           " Channels: ", channels, 
-           " Sample Rate: ", sample_rate);
+  // The input is read in chunks of the read buffer, which must hold at least one frame
+  if (output_buffer == nullptr || frames == 0 || channels == 0 || channels > TRACK_READ_BUFFER_SAMPLES || sample_rate == 0)
+  {
+    LOG_ERROR("Track: Invalid buffer in get_next_audio_frame");
+    return false;
+  }
 
-  if (output_buffer == nullptr)
+  if (!has_audio_input())
   {
-    LOG_ERROR("Track: Null output buffer in get_next_audio_frame");
-    return;
+    return false;
   }
 
-  if (frames == 0)
+  bool more = true;
+  unsigned int offset = 0;
+  while (offset < frames)
   {
-    LOG_ERROR("Track: Zero frames requested in get_next_audio_frame");
-    return;
+    unsigned int end = frames;
+    uint64_t command = m_scheduled_command.load(std::memory_order_acquire);
+    if (command != NO_SCHEDULED_COMMAND)
+    {
+      uint64_t due = command >> 1;
+      if (due <= sample_time + offset)
+      {
+        // A newer command stored meanwhile stays for the next pass
+        if (m_scheduled_command.compare_exchange_strong(command, NO_SCHEDULED_COMMAND, std::memory_order_acq_rel))
+        {
+          m_playing.store((command & 1) != 0, std::memory_order_release);
+          m_cued.store(false, std::memory_order_release);
+        }
+        continue;
+      }
+      if (due < sample_time + frames)
+      {
+        end = static_cast<unsigned int>(due - sample_time);
+      }
+    }
+
+    // An input that ran out in an earlier segment stays finished
+    more = mix_audio_input(output_buffer + static_cast<size_t>(offset) * channels, end - offset, channels, sample_rate) &&
+           more;
+    offset = end;
   }
 
-  if (channels == 0)
+  // An input that ran out still counts while a command waits for its sample
+  return more || m_scheduled_command.load(std::memory_order_acquire) != NO_SCHEDULED_COMMAND;
+}
+
+/** @brief Glide the gain parameter over a block and apply it if it moved.
+ *  Called from the audio callback once per device block, before the block is split into segments,
+ *  so the glide does not depend on how many parameter changes land in the block.
+ *  @param frames Frames in the block.
+ *  @param sample_rate Sample rate of the block.
+ */
+void Track::apply_gain_parameter(unsigned int frames, unsigned int sample_rate) noexcept
+{
+  const ParameterId parameter = m_gain_parameter.load(std::memory_order_acquire);
+  if (parameter == PARAMETER_NO_ID)
   {
-    LOG_ERROR("Track: Zero channels requested in get_next_audio_frame");
+    m_applied_gain_parameter = PARAMETER_NO_ID;
     return;
   }
 
-  if (sample_rate == 0)
+  const float value = ParameterRegistry::instance().advance(parameter, frames, sample_rate);
+  if (parameter != m_applied_gain_parameter)
   {
-    LOG_ERROR("Track: Zero sample rate requested in get_next_audio_frame");
+    // A new binding starts from the parameter's current value without applying it
+    m_applied_gain_parameter = parameter;
+    m_applied_parameter_gain = value;
     return;
   }
 
-  if (!has_audio_input())
+  if (value != m_applied_parameter_gain)
   {
-    // No audio input configured, fill with silence
-    LOG_INFO("Track: No audio input configured, filling output buffer with silence.");
-    std::fill(output_buffer, output_buffer + frames * channels, 0.0f);
-    return;
+    m_applied_parameter_gain = value;
+    set_gain(value);
   }
+}
 
-  // If audio input is a WAV file, read data from it
-  if (std::holds_alternative<MinimalAudioEngine::WavFilePtr>(m_audio_input))
+/** @brief Step the start/stop fade by one frame
+ *  @return Gain for the frame
+ */
+float Track::next_fade_gain(bool playing, float fade_step) noexcept
+{
+  if (playing && m_fade_gain < 1.0f)
+  {
+    m_fade_gain = std::min(1.0f, m_fade_gain + fade_step);
+  }
+  else if (!playing && m_fade_gain > 0.0f)
+  {
+    m_fade_gain = std::max(0.0f, m_fade_gain - fade_step);
+  }
+  return m_fade_gain;
+}
+
+/** @brief Mix part of a block in the current play state.
+ *  Once a stop has faded out the input is no longer read, so it resumes where it stopped.
+ *  @return False once the input has nothing more to play.
+ */
+bool Track::mix_audio_input(float *output_buffer, unsigned int frames, unsigned int channels, unsigned int sample_rate)
+{
+  // A cued track holds silent and in place until its start fades it in
+  if (m_cued.load(std::memory_order_acquire))
   {
-    MinimalAudioEngine::WavFilePtr wav_file = std::get<MinimalAudioEngine::WavFilePtr>(m_audio_input);
+    m_fade_gain = 0.0f;
+    m_audible.store(false, std::memory_order_release);
+    return true;
+  }
 
-    unsigned int file_channels = wav_file->get_channels();
-    unsigned int samples_to_read = frames * file_channels;
+  const bool playing = m_playing.load(std::memory_order_relaxed);
+  if (!playing && m_fade_gain == 0.0f)
+  {
+    m_audible.store(false, std::memory_order_release);
+    return true;
+  }
+  m_audible.store(true, std::memory_order_release);
 
-    std::vector<float> file_buffer(samples_to_read, 0.0f);
-    sf_count_t read_frames = wav_file->read_frames(file_buffer, frames);
+  float gain = get_effective_gain();
+  const float fade_step = 1000.0f / (TRACK_FADE_MS * static_cast<float>(sample_rate));
 
-    if (read_frames != frames)
+  // A PCM stream converts into the read buffer; an empty stream plays silence
+  if (std::holds_alternative<MinimalAudioEngine::PcmInputStreamPtr>(m_audio_input))
+  {
+    auto &stream = std::get<MinimalAudioEngine::PcmInputStreamPtr>(m_audio_input);
+    unsigned int chunk_frames = static_cast<unsigned int>(m_read_buffer.size() / channels);
+
+    for (unsigned int offset = 0; offset < frames; offset += chunk_frames)
     {
-      LOG_INFO("Track: Reached end of WAV file or read less frames than requested. Stopping playback.");
-      // Fill remaining buffer with silence
-      for (unsigned int i = read_frames * channels; i < frames * channels; ++i)
+      unsigned int chunk = std::min(chunk_frames, frames - offset);
+      unsigned int read_frames = stream->read_frames(m_read_buffer.data(), chunk, channels);
+
+      float *output = output_buffer + static_cast<size_t>(offset) * channels;
+      for (unsigned int i = 0; i < read_frames; ++i)
       {
-        output_buffer[i] = 0.0f;
+        float frame_gain = gain * next_fade_gain(playing, fade_step);
+        for (unsigned int ch = 0; ch < channels; ++ch)
+        {
+          output[i * channels + ch] += m_read_buffer[i * channels + ch] * frame_gain;
+        }
       }
+    }
 
-      // Stop playback if end of file reached
-      stop();
+    return !stream->is_finished();
+  }
+
+  // If audio input is a WAV file, read data from it
+  if (std::holds_alternative<MinimalAudioEngine::WavFilePtr>(m_audio_input))
+  {
+    const MinimalAudioEngine::WavFilePtr &wav_file = std::get<MinimalAudioEngine::WavFilePtr>(m_audio_input);
+
+    unsigned int file_channels = wav_file->get_channels();
+    if (file_channels == 0 || file_channels > m_read_buffer.size())
+    {
+      return false;
     }
 
     // Add data to output buffer, handling channel mismatch
-    for (unsigned int i = 0; i < static_cast<unsigned int>(read_frames); ++i)
+    unsigned int mapped_channels = std::min(channels, file_channels);
+    unsigned int chunk_frames = static_cast<unsigned int>(m_read_buffer.size() / file_channels);
+    for (unsigned int offset = 0; offset < frames; offset += chunk_frames)
     {
-      for (unsigned int ch = 0; ch < channels; ++ch)
+      unsigned int chunk = std::min(chunk_frames, frames - offset);
+      sf_count_t read_frames = wav_file->read_frames(m_read_buffer.data(), chunk);
+
+      float *output = output_buffer + static_cast<size_t>(offset) * channels;
+      for (sf_count_t i = 0; i < read_frames; ++i)
       {
-        if (ch < file_channels)
-        {
-          output_buffer[i * channels + ch] = file_buffer[i * file_channels + ch];
-        }
-        else
+        float frame_gain = gain * next_fade_gain(playing, fade_step);
+        for (unsigned int ch = 0; ch < mapped_channels; ++ch)
         {
-          output_buffer[i * channels + ch] = 0.0f; // Fill extra channels with silence
+          output[i * channels + ch] += m_read_buffer[i * file_channels + ch] * frame_gain;
         }
       }
+
+      if (read_frames < static_cast<sf_count_t>(chunk))
+      {
+        // End of file; the rest of the block stays as it was
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Live inputs never run out
+  return true;
+}
+
+/** @brief Checks if the track can be rendered without a running audio device.
+ *  @return True if the track plays from a file.
+ */
+bool Track::can_render_offline() const
+{
+  return std::holds_alternative<MinimalAudioEngine::WavFilePtr>(m_audio_input);
+}
+
+/** @brief Gets the length of the track's file input.
+ *  @return Length in frames, or 0 if the track has no file input.
+ */
+uint64_t Track::get_length_frames() const
+{
+  if (!can_render_offline())
+  {
+    return 0;
+  }
+
+  sf_count_t frames = std::get<MinimalAudioEngine::WavFilePtr>(m_audio_input)->get_frame_count();
+  return frames > 0 ? static_cast<uint64_t>(frames) : 0;
+}
+
+/** @brief Gets the sample rate of the track's file input.
+ *  @return Sample rate, or 0 if the track has no file input.
+ */
+unsigned int Track::get_input_sample_rate() const
+{
+  if (!can_render_offline())
+  {
+    return 0;
+  }
+
+  return std::get<MinimalAudioEngine::WavFilePtr>(m_audio_input)->get_sample_rate();
+}
+
+/** @brief Opens a handle on the track's file input for repeated render_frames_at() calls.
+ *  @return The handle, or nullptr if the track has no file input or it cannot be opened.
+ */
+MinimalAudioEngine::WavFileReaderPtr Track::open_offline_reader() const
+{
+  if (!can_render_offline())
+  {
+    return nullptr;
+  }
+
+  return std::get<MinimalAudioEngine::WavFilePtr>(m_audio_input)->open_reader();
+}
+
+/** @brief Renders frames from an absolute position without touching playback state.
+ *  The output depends only on the position, file and gain, so it is safe to call
+ *  concurrently for different positions.
+ *  @param output_buffer Interleaved output, frames * channels long. Overwritten.
+ *  @param position Frame position in the track's input.
+ *  @param frames Number of frames to render.
+ *  @param channels Number of output channels.
+ *  @param reader Handle from open_offline_reader() used by this thread only, or nullptr to open one for this call.
+ *  @return Number of frames rendered; the remainder of the buffer is silenced.
+ */
+unsigned int Track::render_frames_at(float *output_buffer, uint64_t position, unsigned int frames, unsigned int channels,
+                                     MinimalAudioEngine::WavFileReader *reader) const
+{
+  if (output_buffer == nullptr || frames == 0 || channels == 0)
+  {
+    return 0;
+  }
+
+  std::fill(output_buffer, output_buffer + static_cast<size_t>(frames) * channels, 0.0f);
+
+  if (!can_render_offline())
+  {
+    return 0;
+  }
+
+  MinimalAudioEngine::WavFilePtr wav_file = std::get<MinimalAudioEngine::WavFilePtr>(m_audio_input);
+  unsigned int file_channels = wav_file->get_channels();
+  if (file_channels == 0)
+  {
+    return 0;
+  }
+
+  std::vector<float> file_buffer(static_cast<size_t>(frames) * file_channels, 0.0f);
+  sf_count_t read_frames = reader != nullptr
+                             ? reader->read_frames_at(file_buffer.data(), static_cast<sf_count_t>(position), frames)
+                             : wav_file->read_frames_at(file_buffer.data(), static_cast<sf_count_t>(position), frames);
+
+  unsigned int mapped_channels = std::min(channels, file_channels);
+  float gain = get_effective_gain();
+  for (sf_count_t i = 0; i < read_frames; ++i)
+  {
+    for (unsigned int ch = 0; ch < mapped_channels; ++ch)
+    {
+      output_buffer[i * channels + ch] = file_buffer[i * file_channels + ch] * gain;
     }
   }
+
+  return static_cast<unsigned int>(read_frames);
 }
 
 std::string Track::to_string() const
@@ -375,24 +742,35 @@ std::string Track::to_string() const
   AudioIOVariant audio_output = get_audio_output();
   MidiIOVariant midi_output = get_midi_output();
 
-  std::string audio_input_str = std::holds_alternative<std::nullopt_t>(audio_input) ? "None" :
-                                std::holds_alternative<MinimalAudioEngine::AudioDevice>(audio_input) ? std::get<MinimalAudioEngine::AudioDevice>(audio_input).to_string() :
-                                std::get<MinimalAudioEngine::WavFilePtr>(audio_input)->to_string();
+  auto audio_io_to_string = [](const AudioIOVariant &io) -> std::string {
+    if (std::holds_alternative<std::nullopt_t>(io))
+      return "None";
+    if (std::holds_alternative<MinimalAudioEngine::AudioDevice>(io))
+      return std::get<MinimalAudioEngine::AudioDevice>(io).to_string();
+    if (std::holds_alternative<MinimalAudioEngine::PcmInputStreamPtr>(io))
+      return std::get<MinimalAudioEngine::PcmInputStreamPtr>(io)->to_string();
+    if (std::holds_alternative<MinimalAudioEngine::PcmOutputStreamPtr>(io))
+      return std::get<MinimalAudioEngine::PcmOutputStreamPtr>(io)->to_string();
+    return std::get<MinimalAudioEngine::WavFilePtr>(io)->to_string();
+  };
+
+  std::string audio_input_str = audio_io_to_string(audio_input);
 
   std::string midi_input_str = std::holds_alternative<std::nullopt_t>(midi_input) ? "None" :
                                std::holds_alternative<MinimalAudioEngine::MidiDevice>(midi_input) ? std::get<MinimalAudioEngine::MidiDevice>(midi_input).to_string() :
                                std::get<MinimalAudioEngine::MidiFilePtr>(midi_input)->to_string();
 
-  std::string audio_output_str = std::holds_alternative<std::nullopt_t>(audio_output) ? "None" :
-                                 std::holds_alternative<MinimalAudioEngine::AudioDevice>(audio_output) ? std::get<MinimalAudioEngine::AudioDevice>(audio_output).to_string() :
-                                 std::get<MinimalAudioEngine::WavFilePtr>(audio_output)->to_string();
+  std::string audio_output_str = audio_io_to_string(audio_output);
 
   std::string midi_output_str = std::holds_alternative<std::nullopt_t>(midi_output) ? "None" :
                                 std::holds_alternative<MinimalAudioEngine::MidiDevice>(midi_output) ? std::get<MinimalAudioEngine::MidiDevice>(midi_output).to_string() :
                                 std::get<MinimalAudioEngine::MidiFilePtr>(midi_output)->to_string();
   
-  return "Track(AudioInput=" + audio_input_str +
+  return "Track(Id=" + std::to_string(m_id) +
+         ", AudioInput=" + audio_input_str +
          ", MidiInput=" + midi_input_str +
          ", AudioOutput=" + audio_output_str +
-         ", MidiOutput=" + midi_output_str + ")";
+         ", MidiOutput=" + midi_output_str +
+         ", Gain=" + std::to_string(get_gain()) +
+         ", Muted=" + (is_muted() ? "Yes" : "No") + ")";
 }
\ No newline at end of file
@@ -4,15 +4,23 @@
 
 using namespace MinimalAudioEngine;
 
+/** @brief Get the AudioEngine the tracks play through
+ */
+AudioEngine &TrackManager::get_audio_engine() const
+{
+  return m_audio_engine != nullptr ? *m_audio_engine : AudioEngine::instance();
+}
+
 /** @brief Add a Track to the TrackManager.
  *  @return The index of the newly added track.
  */
 size_t TrackManager::add_track()
 {
-  auto new_track = std::make_shared<Track>();
+  auto new_track = std::make_shared<Track>(m_audio_engine, m_midi_engine, m_next_track_id++);
   m_tracks.push_back(new_track);
 
-  AudioEngine::instance().attach(new_track);
+  get_audio_engine().attach(new_track);
+  bind_track_parameters(new_track);
 
   LOG_INFO("Adding a new track. Total tracks: ", m_tracks.size());
   return m_tracks.size() - 1; // Return the index of the newly added track
@@ -30,12 +38,32 @@ void TrackManager::remove_track(size_t index)
     throw std::out_of_range("Track index out of range");
   }
 
-  AudioEngine::instance().detach(m_tracks[index]);
+  get_audio_engine().detach(m_tracks[index]);
 
   m_tracks.erase(m_tracks.begin() + index);
   LOG_INFO("Removed track at index: ", index, ". Total tracks: ", m_tracks.size());
 }
 
+/** @brief Bind a track's gain to the registry parameter "track<id>.gain".
+ *  Parameters are named by track id rather than position, so removing a track leaves the
+ *  others, and any MIDI bound to them, where they were.
+ *  Only tracks of the default engines are bound; the registry is global, and a context's
+ *  tracks would otherwise share parameters with the default ones.
+ *  @param track The track.
+ */
+void TrackManager::bind_track_parameters(const TrackPtr &track)
+{
+  if (m_audio_engine != nullptr)
+    return;
+
+  ParameterInfo info;
+  info.name = "track" + std::to_string(track->get_id()) + ".gain";
+  info.maximum = TRACK_GAIN_PARAMETER_MAX;
+  info.default_value = 1.0f;
+  auto parameter = ParameterRegistry::instance().register_parameter(info);
+  track->bind_gain_parameter(parameter.value_or(PARAMETER_NO_ID));
+}
+
 /** @brief Get a Track from the TrackManager by index.
  *  @param index The index of the track to retrieve.
  *  @return A shared pointer to the Track at the specified index.
@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "audiotap.h"
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+std::string unique_tap_name(const char *suffix)
+{
+  return "/mae_test_" + std::to_string(getpid()) + "_" + suffix;
+}
+
+std::vector<float> make_block(unsigned int frames, unsigned int channels, float start)
+{
+  std::vector<float> block(static_cast<size_t>(frames) * channels);
+  for (size_t i = 0; i < block.size(); ++i)
+  {
+    block[i] = start + static_cast<float>(i);
+  }
+  return block;
+}
+
+}  // namespace
+
+/** @brief Blocks written by the engine arrive unchanged at a reader, including across the wrap point
+ */
+TEST(AudioTapTest, RoundTripAcrossWrap)
+{
+  std::string name = unique_tap_name("roundtrip");
+  auto tap = AudioTap::create(name, 2, 48000, 1024, AUDIO_TAP_SOURCE_MASTER, 0);
+  ASSERT_NE(tap, nullptr);
+
+  auto reader = AudioTapReader::open(name);
+  ASSERT_NE(reader, nullptr);
+  EXPECT_EQ(reader->get_channels(), 2u);
+  EXPECT_EQ(reader->get_sample_rate(), 48000u);
+  EXPECT_EQ(reader->get_source(), AUDIO_TAP_SOURCE_MASTER);
+
+  // 300-frame blocks do not divide the ring size, so later blocks straddle the end
+  std::vector<float> received(600);
+  float next = 0.0f;
+  for (int block_index = 0; block_index < 20; ++block_index)
+  {
+    auto block = make_block(300, 2, next);
+    tap->write(block.data(), 300, 2);
+
+    ASSERT_EQ(reader->read(received.data(), 300), 300u);
+    EXPECT_EQ(received, block);
+    next += static_cast<float>(block.size());
+  }
+
+  EXPECT_EQ(reader->get_dropped_frames(), 0u);
+  EXPECT_EQ(tap->get_frames_written(), 6000u);
+}
+
+/** @brief A reader that falls behind loses the oldest audio and the writer is unaffected
+ */
+TEST(AudioTapTest, SlowReaderDropsOldestFrames)
+{
+  std::string name = unique_tap_name("overrun");
+  auto tap = AudioTap::create(name, 1, 48000, 1024, 0, 0);
+  ASSERT_NE(tap, nullptr);
+
+  auto reader = AudioTapReader::open(name);
+  ASSERT_NE(reader, nullptr);
+
+  for (int block_index = 0; block_index < 10; ++block_index)
+  {
+    auto block = make_block(256, 1, static_cast<float>(block_index * 256));
+    tap->write(block.data(), 256, 1);
+  }
+
+  std::vector<float> received(4096);
+  size_t frames = reader->read(received.data(), received.size());
+  EXPECT_GT(frames, 0u);
+  EXPECT_LT(frames, 1024u);
+  EXPECT_EQ(frames + reader->get_dropped_frames(), 2560u);
+
+  // What is left is the newest audio, in order
+  EXPECT_EQ(received[frames - 1], 2559.0f);
+  EXPECT_EQ(received[0], static_cast<float>(2560 - frames));
+}
+
+/** @brief The ring holds several of the largest expected blocks, and readers keep the largest block written
+ *  clear of the writer
+ */
+TEST(AudioTapTest, MarginFollowsLargestBlock)
+{
+  std::string name = unique_tap_name("margin");
+  auto sized = AudioTap::create(name, 1, 48000, 1024, AUDIO_TAP_SOURCE_MASTER, 1024);
+  ASSERT_NE(sized, nullptr);
+  auto sized_reader = AudioTapReader::open(name);
+  ASSERT_NE(sized_reader, nullptr);
+  EXPECT_EQ(sized_reader->get_safe_capacity(), 8192u - 1024u);
+  sized_reader.reset();
+  sized.reset();
+
+  auto tap = AudioTap::create(name, 1, 48000, 1024, AUDIO_TAP_SOURCE_MASTER, 0);
+  ASSERT_NE(tap, nullptr);
+  auto reader = AudioTapReader::open(name, true);
+  ASSERT_NE(reader, nullptr);
+  EXPECT_EQ(reader->get_safe_capacity(), 1024u - 128u);
+
+  // Blocks of half the ring leave only half of it safe to read
+  for (int block_index = 0; block_index < 3; ++block_index)
+  {
+    auto block = make_block(512, 1, static_cast<float>(block_index * 512));
+    tap->write(block.data(), 512, 1);
+  }
+  EXPECT_EQ(reader->get_safe_capacity(), 512u);
+
+  std::vector<float> received(2048);
+  EXPECT_EQ(reader->read(received.data(), received.size()), 512u);
+  EXPECT_EQ(reader->get_dropped_frames(), 1024u);
+  EXPECT_EQ(received[0], 1024.0f);
+  EXPECT_EQ(received[511], 1535.0f);
+}
+
+/** @brief A sleeping reader is woken by the next block, and times out without one
+ */
+TEST(AudioTapTest, WaitForBlock)
+{
+  std::string name = unique_tap_name("wait");
+  auto tap = AudioTap::create(name, 1, 48000, 1024, AUDIO_TAP_SOURCE_MASTER, 64);
+  ASSERT_NE(tap, nullptr);
+
+  auto reader = AudioTapReader::open(name);
+  ASSERT_NE(reader, nullptr);
+  EXPECT_FALSE(reader->wait(std::chrono::milliseconds(10)));
+
+  std::thread writer([&tap]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto block = make_block(64, 1, 0.0f);
+    tap->write(block.data(), 64, 1);
+  });
+
+  bool woken = false;
+  for (int attempt = 0; attempt < 100 && !woken; ++attempt)
+  {
+    woken = reader->wait(std::chrono::milliseconds(50));
+  }
+  writer.join();
+
+  EXPECT_TRUE(woken);
+  EXPECT_EQ(reader->get_available_frames(), 64u);
+}
+
+/** @brief Readers cannot attach to a tap that was removed
+ */
+TEST(AudioTapTest, OpenAfterRemove)
+{
+  std::string name = unique_tap_name("removed");
+  auto tap = AudioTap::create(name, 2, 48000, 1024, AUDIO_TAP_SOURCE_MASTER, 0);
+  ASSERT_NE(tap, nullptr);
+  tap.reset();
+
+  EXPECT_EQ(AudioTapReader::open(name), nullptr);
+}
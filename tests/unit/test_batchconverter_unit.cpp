@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <filesystem>
+#include <vector>
+
+#include "batchconverter.h"
+#include "resampler.h"
+#include "loudnessmeter.h"
+#include "filemanager.h"
+#include "wavfile.h"
+#include "logger.h"
+
+// Define M_PI if not already defined (Windows MSVC compatibility)
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+using namespace MinimalAudioEngine;
+
+static std::vector<float> make_sine(unsigned int sample_rate, unsigned int channels, double seconds, float amplitude)
+{
+  size_t frames = static_cast<size_t>(sample_rate * seconds);
+  std::vector<float> samples(frames * channels);
+  for (size_t i = 0; i < frames; ++i)
+  {
+    float value = amplitude * static_cast<float>(std::sin(2.0 * M_PI * 997.0 * i / sample_rate));
+    for (unsigned int ch = 0; ch < channels; ++ch)
+    {
+      samples[i * channels + ch] = value;
+    }
+  }
+  return samples;
+}
+
+/** @brief Loudness of a -20 dBFS mono sine is -23 LUFS
+ */
+TEST(LoudnessMeterTest, ReferenceSine)
+{
+  auto samples = make_sine(48000, 1, 5.0, 0.1f);
+  EXPECT_NEAR(LoudnessMeter::measure(samples, 1, 48000), -23.0, 0.1);
+}
+
+/** @brief Silence is below the absolute gate
+ */
+TEST(LoudnessMeterTest, Silence)
+{
+  std::vector<float> samples(48000 * 2, 0.0f);
+  EXPECT_TRUE(std::isinf(LoudnessMeter::measure(samples, 2, 48000)));
+}
+
+/** @brief Resampling changes length by the rate ratio and preserves a tone
+ */
+TEST(ResamplerTest, PreservesTone)
+{
+  auto input = make_sine(48000, 2, 1.0, 0.5f);
+  Resampler resampler(48000, 44100);
+  auto output = resampler.process(input, 2);
+
+  ASSERT_EQ(output.size(), 44100u * 2);
+
+  // Ignore the edges where the kernel runs off the buffer
+  for (size_t i = 1000; i < 43100; ++i)
+  {
+    float expected = 0.5f * static_cast<float>(std::sin(2.0 * M_PI * 997.0 * i / 44100.0));
+    ASSERT_NEAR(output[i * 2], expected, 1e-3f);
+  }
+}
+
+/** @brief Convert the samples directory to 48 kHz 16-bit with loudness normalization
+ */
+TEST(BatchConverterTest, ConvertDirectory)
+{
+  std::filesystem::path output_directory = std::filesystem::temp_directory_path() / "minimal_audio_engine_convert_test";
+  std::filesystem::remove_all(output_directory);
+
+  BatchConvertConfig config;
+  config.output_directory = output_directory;
+  config.sample_rate = 48000;
+  config.format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+  config.normalization = eNormalization::Loudness;
+  config.target_level = -23.0;
+  config.memory_budget_bytes = 1024 * 1024;
+
+  size_t callbacks = 0;
+  BatchConverter converter(config);
+  auto progress = converter.convert_directory("./samples", [&](const BatchConvertProgress &) { callbacks++; });
+  LOG_INFO(progress.to_string());
+
+  auto inputs = FileManager::instance().list_wav_files_in_directory("./samples");
+  EXPECT_EQ(progress.files_total, inputs.size());
+  EXPECT_EQ(progress.files_converted, inputs.size());
+  EXPECT_EQ(progress.files_failed, 0u);
+  EXPECT_EQ(callbacks, inputs.size());
+
+  for (const auto &input : inputs)
+  {
+    auto output = FileManager::instance().read_wav_file(converter.get_output_path(input));
+    ASSERT_TRUE(output.has_value());
+    EXPECT_EQ(output.value()->get_sample_rate(), 48000u);
+    EXPECT_EQ(output.value()->get_format() & SF_FORMAT_SUBMASK, static_cast<unsigned int>(SF_FORMAT_PCM_16));
+  }
+
+  std::filesystem::remove_all(output_directory);
+}
@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "controlprotocol.h"
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+ControlRequest make_request(eControlMessageType type, uint32_t request_id, uint32_t track_id = 0, uint32_t device_id = 0)
+{
+  ControlRequest request;
+  request.type = type;
+  request.request_id = request_id;
+  request.track_id = track_id;
+  request.device_id = device_id;
+  return request;
+}
+
+}  // namespace
+
+/** @brief Encode a request and decode it from the frame payload
+ */
+TEST(ControlProtocolTest, RequestRoundTrip)
+{
+  ControlRequest request;
+  request.type = eControlMessageType::TrackSetAudioInputFile;
+  request.request_id = 42;
+  request.track_id = 3;
+  request.path = "./samples/test.wav";
+
+  std::vector<uint8_t> buffer;
+  size_t frame_size = encode_control_request(buffer, request);
+  ASSERT_EQ(frame_size, buffer.size());
+
+  ControlFrameDecoder decoder;
+  decoder.feed(buffer);
+  auto payload = decoder.next_frame();
+  ASSERT_TRUE(payload.has_value());
+
+  ControlRequest decoded;
+  ASSERT_EQ(decode_control_request(*payload, decoded), eControlStatus::Ok);
+  EXPECT_EQ(decoded.type, eControlMessageType::TrackSetAudioInputFile);
+  EXPECT_EQ(decoded.request_id, 42u);
+  EXPECT_EQ(decoded.track_id, 3u);
+  EXPECT_EQ(decoded.path, "./samples/test.wav");
+  EXPECT_FALSE(decoder.next_frame().has_value());
+}
+
+/** @brief Frames split at every byte boundary are reassembled
+ */
+TEST(ControlProtocolTest, PartialFrames)
+{
+  std::vector<uint8_t> stream;
+  encode_control_request(stream, make_request(eControlMessageType::Ping, 1));
+  encode_control_request(stream, make_request(eControlMessageType::TrackPlay, 2, 7));
+
+  ControlFrameDecoder decoder;
+  std::vector<ControlRequest> received;
+  for (uint8_t byte : stream)
+  {
+    decoder.feed(std::span<const uint8_t>(&byte, 1));
+    while (auto payload = decoder.next_frame())
+    {
+      ControlRequest request;
+      ASSERT_EQ(decode_control_request(*payload, request), eControlStatus::Ok);
+      received.push_back(request);
+    }
+  }
+
+  ASSERT_EQ(received.size(), 2u);
+  EXPECT_EQ(received[0].type, eControlMessageType::Ping);
+  EXPECT_EQ(received[1].type, eControlMessageType::TrackPlay);
+  EXPECT_EQ(received[1].track_id, 7u);
+  EXPECT_EQ(decoder.buffered(), 0u);
+}
+
+/** @brief Batches carry nested requests, and truncated or unknown requests are rejected
+ */
+TEST(ControlProtocolTest, BatchAndErrors)
+{
+  std::vector<uint8_t> buffer;
+  encode_control_batch(buffer, 9, {
+    make_request(eControlMessageType::TrackAdd, 10),
+    make_request(eControlMessageType::TrackSetAudioOutputDevice, 11, 0, 2),
+    make_request(eControlMessageType::TransportPlay, 12),
+  });
+
+  ControlFrameDecoder decoder;
+  decoder.feed(buffer);
+  auto payload = decoder.next_frame();
+  ASSERT_TRUE(payload.has_value());
+
+  ControlRequest batch;
+  ASSERT_EQ(decode_control_request(*payload, batch), eControlStatus::Ok);
+  EXPECT_EQ(batch.type, eControlMessageType::Batch);
+  ASSERT_EQ(batch.batch.size(), 3u);
+
+  ControlRequest nested;
+  ASSERT_EQ(decode_control_request(batch.batch[1], nested), eControlStatus::Ok);
+  EXPECT_EQ(nested.request_id, 11u);
+  EXPECT_EQ(nested.device_id, 2u);
+
+  // Truncated body
+  std::vector<uint8_t> truncated(payload->begin(), payload->end() - 1);
+  EXPECT_EQ(decode_control_request(truncated, batch), eControlStatus::Malformed);
+
+  // Server-to-client types are not requests
+  std::vector<uint8_t> response;
+  encode_control_response(response, 5, eControlStatus::Ok);
+  ControlRequest unknown;
+  EXPECT_EQ(decode_control_request(std::span<const uint8_t>(response).subspan(CONTROL_FRAME_HEADER_SIZE), unknown),
+            eControlStatus::UnknownRequest);
+  EXPECT_EQ(unknown.request_id, 5u);
+
+  // Oversized frames put the decoder in an error state
+  ControlFrameDecoder oversized;
+  std::vector<uint8_t> header = {0xFF, 0xFF, 0xFF, 0x7F};
+  oversized.feed(header);
+  EXPECT_FALSE(oversized.next_frame().has_value());
+  EXPECT_TRUE(oversized.has_error());
+}
+
+/** @brief Responses, statistics and meter events decode to what was encoded
+ */
+TEST(ControlProtocolTest, ResponsesAndEvents)
+{
+  std::vector<uint8_t> buffer;
+  encode_control_statistics(buffer, 77, ControlStatistics{2, 1234567890123ull, 5, 2});
+  encode_control_response(buffer, 78, eControlStatus::Error, "Track index out of range");
+  std::vector<float> peaks = {0.5f, 0.25f};
+  encode_control_event(buffer, eControlEvent::Meters, peaks);
+
+  ControlFrameDecoder decoder;
+  decoder.feed(buffer);
+
+  ControlResponse response;
+  ASSERT_TRUE(decode_control_response(*decoder.next_frame(), response));
+  EXPECT_EQ(response.request_id, 77u);
+  EXPECT_EQ(response.status, eControlStatus::Ok);
+
+  ControlStatistics statistics;
+  ASSERT_TRUE(decode_control_statistics(response.body, statistics));
+  EXPECT_EQ(statistics.tracks_playing, 2u);
+  EXPECT_EQ(statistics.total_frames_processed, 1234567890123ull);
+  EXPECT_EQ(statistics.track_count, 5u);
+
+  ASSERT_TRUE(decode_control_response(*decoder.next_frame(), response));
+  EXPECT_EQ(response.status, eControlStatus::Error);
+  EXPECT_EQ(response.message, "Track index out of range");
+
+  ControlEvent event;
+  ASSERT_TRUE(decode_control_event(*decoder.next_frame(), event));
+  EXPECT_EQ(event.event, eControlEvent::Meters);
+  EXPECT_EQ(event.peaks, peaks);
+}
@@ -0,0 +1,660 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "enginecontext.h"
+#include "audioengine.h"
+#include "midiengine.h"
+#include "trackmanager.h"
+#include "filemanager.h"
+#include "devicemanager.h"
+#include "pcmstream.h"
+
+using namespace MinimalAudioEngine;
+
+/** @brief Engine Context - The default context refers to the singletons
+ */
+TEST(EngineContextTest, DefaultWrapsSingletons)
+{
+  EngineContext &context = EngineContext::get_default();
+
+  EXPECT_TRUE(context.is_default());
+  EXPECT_EQ(&context.get_audio_engine(), &AudioEngine::instance());
+  EXPECT_EQ(&context.get_midi_engine(), &MidiEngine::instance());
+  EXPECT_EQ(&context.get_track_manager(), &TrackManager::instance());
+  EXPECT_EQ(&context.get_file_manager(), &FileManager::instance());
+  EXPECT_EQ(&context.get_device_manager(), &DeviceManager::instance());
+}
+
+/** @brief Engine Context - Tracks added to one session are not visible in another
+ */
+TEST(EngineContextTest, SessionsAreIsolated)
+{
+  TrackManager::instance().clear_tracks();
+
+  EngineContext first;
+  EngineContext second;
+  EXPECT_FALSE(first.is_default());
+  EXPECT_NE(&first.get_audio_engine(), &second.get_audio_engine());
+  EXPECT_NE(&first.get_audio_engine(), &AudioEngine::instance());
+  EXPECT_NE(&first.get_track_manager(), &second.get_track_manager());
+
+  first.get_track_manager().add_track();
+  first.get_track_manager().add_track();
+  second.get_track_manager().add_track();
+
+  EXPECT_EQ(first.get_track_manager().get_track_count(), 2u);
+  EXPECT_EQ(second.get_track_manager().get_track_count(), 1u);
+  EXPECT_EQ(TrackManager::instance().get_track_count(), 0u);
+}
+
+/** @brief Engine Context - Each session runs and stops its own threads
+ */
+TEST(EngineContextTest, StartAndStop)
+{
+  EngineContext context;
+  context.start();
+
+  EXPECT_TRUE(context.get_core_engine().is_running());
+  EXPECT_TRUE(context.get_audio_engine().is_running());
+
+  context.stop();
+  EXPECT_FALSE(context.get_core_engine().is_running());
+  EXPECT_FALSE(context.get_audio_engine().is_running());
+}
+
+/** @brief Engine Context - A host pulls blocks with render() and gets the track's audio, planar
+ */
+TEST(EngineContextTest, HostRender)
+{
+  const unsigned int frames = 300;
+  PcmStreamFormat format{ePcmSampleFormat::Float32, 2, 48000};
+  auto path = std::filesystem::temp_directory_path() / "test_enginecontext_render.raw";
+  std::vector<float> input(frames * 2);
+  for (unsigned int i = 0; i < frames; ++i)
+  {
+    input[i * 2] = 0.001f * static_cast<float>(i + 1);
+    input[i * 2 + 1] = -0.001f * static_cast<float>(i + 1);
+  }
+  {
+    auto output = FileManager::instance().open_pcm_output(path.string(), format, ePcmPacing::Freewheel);
+    ASSERT_TRUE(output.has_value());
+    ASSERT_TRUE((*output)->write_frames(input.data(), frames, 2));
+  }
+
+  EngineContext context;
+  context.start();
+
+  std::vector<float> left(64, 1.0f);
+  std::vector<float> right(64, 1.0f);
+  float *buffers[] = {left.data(), right.data()};
+
+  // Nothing plays before the host output is started
+  EXPECT_FALSE(context.render(buffers, 64));
+  EXPECT_EQ(left, std::vector<float>(64, 0.0f));
+
+  auto stream = context.get_file_manager().open_pcm_input(path.string(), format);
+  ASSERT_TRUE(stream.has_value());
+  size_t index = context.get_track_manager().add_track();
+  auto track = context.get_track_manager().get_track(index);
+  track->add_audio_stream_input(*stream);
+
+  context.set_host_output(2, 48000);
+  track->play();
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (context.get_audio_engine().get_state() != eAudioEngineState::Running && std::chrono::steady_clock::now() < deadline)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(context.get_audio_engine().get_state(), eAudioEngineState::Running);
+
+  // Collect until the stream ends; blocks before the reader thread catches up are silent
+  std::vector<float> rendered_left;
+  std::vector<float> rendered_right;
+  while (context.render(buffers, 64) && std::chrono::steady_clock::now() < deadline)
+  {
+    rendered_left.insert(rendered_left.end(), left.begin(), left.end());
+    rendered_right.insert(rendered_right.end(), right.begin(), right.end());
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+
+  auto first = std::find_if(rendered_left.begin(), rendered_left.end(), [](float sample) { return sample != 0.0f; });
+  ASSERT_NE(first, rendered_left.end());
+  size_t offset = static_cast<size_t>(first - rendered_left.begin());
+  ASSERT_GE(rendered_left.size(), offset + frames);
+  for (unsigned int i = 0; i < frames; ++i)
+  {
+    ASSERT_FLOAT_EQ(rendered_left[offset + i], input[i * 2]) << "frame " << i;
+    ASSERT_FLOAT_EQ(rendered_right[offset + i], input[i * 2 + 1]) << "frame " << i;
+  }
+  EXPECT_GE(context.get_audio_engine().get_sample_time(), offset + frames);
+
+  // Playback stays pending until the engine has seen the end of input and gone back to Idle
+  while (context.get_audio_engine().is_playback_pending() && std::chrono::steady_clock::now() < deadline)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_FALSE(context.get_audio_engine().is_playback_pending());
+  EXPECT_EQ(context.get_audio_engine().get_state(), eAudioEngineState::Idle);
+
+  std::filesystem::remove(path);
+}
+
+/** @brief Engine Context - Transport commands apply on their exact sample without closing the output
+ */
+TEST(EngineContextTest, SampleAccurateTransport)
+{
+  const unsigned int frames = 48000;
+  const unsigned int block = 64;
+  PcmStreamFormat format{ePcmSampleFormat::Float32, 1, 48000};
+  auto path = std::filesystem::temp_directory_path() / "test_enginecontext_transport.raw";
+  {
+    std::vector<float> input(frames, 0.5f);
+    auto output = FileManager::instance().open_pcm_output(path.string(), format, ePcmPacing::Freewheel);
+    ASSERT_TRUE(output.has_value());
+    ASSERT_TRUE((*output)->write_frames(input.data(), frames, 1));
+  }
+
+  EngineContext context;
+  context.start();
+  AudioEngine &audio_engine = context.get_audio_engine();
+
+  auto stream = context.get_file_manager().open_pcm_input(path.string(), format);
+  ASSERT_TRUE(stream.has_value());
+  size_t index = context.get_track_manager().add_track();
+  context.get_track_manager().get_track(index)->add_audio_stream_input(*stream);
+
+  context.set_host_output(1, 48000);
+  context.get_track_manager().get_track(index)->play();
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (audio_engine.get_state() != eAudioEngineState::Running && std::chrono::steady_clock::now() < deadline)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(audio_engine.get_state(), eAudioEngineState::Running);
+
+  // Wait for the stream reader to deliver audio
+  std::vector<float> output(block);
+  float *buffers[] = {output.data()};
+  while (std::chrono::steady_clock::now() < deadline)
+  {
+    ASSERT_TRUE(context.render(buffers, block));
+    if (output.back() != 0.0f)
+      break;
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  ASSERT_EQ(output.back(), 0.5f);
+
+  // Stop part way into the next block
+  audio_engine.stop_at(audio_engine.get_sample_time() + 10);
+  ASSERT_TRUE(context.render(buffers, block));
+  for (unsigned int i = 0; i < block; ++i)
+  {
+    ASSERT_EQ(output[i], i < 10 ? 0.5f : 0.0f) << "frame " << i;
+  }
+  EXPECT_FALSE(audio_engine.is_transport_rolling());
+
+  // The output stays open, so playing again starts within the next block
+  ASSERT_TRUE(context.render(buffers, block));
+  EXPECT_EQ(output, std::vector<float>(block, 0.0f));
+  audio_engine.play_at(audio_engine.get_sample_time() + 20);
+  ASSERT_TRUE(context.render(buffers, block));
+  for (unsigned int i = 0; i < block; ++i)
+  {
+    ASSERT_EQ(output[i], i < 20 ? 0.0f : 0.5f) << "frame " << i;
+  }
+  EXPECT_EQ(audio_engine.get_state(), eAudioEngineState::Running);
+
+  std::filesystem::remove(path);
+}
+
+/** @brief Engine Context - Immediate commands are timed until the end of the block that applies them
+ */
+TEST(EngineContextTest, CommandLatency)
+{
+  EngineContext context;
+  context.start();
+  AudioEngine &audio_engine = context.get_audio_engine();
+  EXPECT_EQ(audio_engine.get_statistics().command_latency.count, 0u);
+
+  // The host output change is heard by the first block, together with the transport start
+  context.set_host_output(2, 48000);
+  audio_engine.play();
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (audio_engine.get_state() != eAudioEngineState::Running && std::chrono::steady_clock::now() < deadline)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(audio_engine.get_state(), eAudioEngineState::Running);
+
+  std::vector<float> left(64);
+  std::vector<float> right(64);
+  float *buffers[] = {left.data(), right.data()};
+  context.render(buffers, 64);
+  EXPECT_EQ(audio_engine.get_statistics().command_latency.count, 2u);
+
+  // Scheduled commands are not timed; immediate ones are
+  audio_engine.stop_at(audio_engine.get_sample_time() + 10);
+  context.render(buffers, 64);
+  EXPECT_EQ(audio_engine.get_statistics().command_latency.count, 2u);
+
+  ParameterChange change;
+  change.target = eParameterTarget::MasterGain;
+  change.value = 0.5f;
+  ASSERT_TRUE(audio_engine.push_parameter_change(change));
+  context.render(buffers, 64);
+
+  auto latency = audio_engine.get_statistics().command_latency;
+  EXPECT_EQ(latency.count, 3u);
+  EXPECT_GT(latency.max_us, 0u);
+}
+
+/** @brief Engine Context - Time spent idle between a configuration change and the next start is not latency
+ */
+TEST(EngineContextTest, ConfigLatencyFromStartRequest)
+{
+  EngineContext context;
+  context.start();
+  AudioEngine &audio_engine = context.get_audio_engine();
+
+  const auto idle = std::chrono::milliseconds(300);
+  context.set_host_output(2, 48000);
+  std::this_thread::sleep_for(idle);
+  audio_engine.play_at(audio_engine.get_sample_time() + 48000);  // Scheduled, so only the start is timed
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (audio_engine.get_state() != eAudioEngineState::Running && std::chrono::steady_clock::now() < deadline)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(audio_engine.get_state(), eAudioEngineState::Running);
+
+  std::vector<float> left(64);
+  std::vector<float> right(64);
+  float *buffers[] = {left.data(), right.data()};
+  context.render(buffers, 64);
+
+  auto latency = audio_engine.get_statistics().command_latency;
+  EXPECT_EQ(latency.count, 1u);
+  EXPECT_LT(latency.max_us, static_cast<uint64_t>(std::chrono::microseconds(idle).count()));
+}
+
+/** @brief Engine Context - Tracks start and stop on their own scheduled samples, with fades
+ */
+TEST(EngineContextTest, TrackScheduling)
+{
+  const unsigned int block = 64;
+  const unsigned int fade_frames = 240;  // TRACK_FADE_MS at 48 kHz
+  PcmStreamFormat format{ePcmSampleFormat::Float32, 1, 48000};
+
+  EngineContext context;
+  context.start();
+  AudioEngine &audio_engine = context.get_audio_engine();
+  TrackManager &track_manager = context.get_track_manager();
+
+  // One track keeps playing throughout; the other two are stopped and relaunched together
+  std::vector<std::filesystem::path> paths;
+  std::vector<TrackPtr> tracks;
+  for (float level : {0.5f, 0.125f, 0.125f})
+  {
+    auto path = std::filesystem::temp_directory_path() / ("test_enginecontext_track" + std::to_string(paths.size()) + ".raw");
+    {
+      std::vector<float> input(48000, level);
+      auto output = FileManager::instance().open_pcm_output(path.string(), format, ePcmPacing::Freewheel);
+      ASSERT_TRUE(output.has_value());
+      ASSERT_TRUE((*output)->write_frames(input.data(), input.size(), 1));
+    }
+    auto stream = context.get_file_manager().open_pcm_input(path.string(), format);
+    ASSERT_TRUE(stream.has_value());
+    tracks.push_back(track_manager.get_track(track_manager.add_track()));
+    tracks.back()->add_audio_stream_input(*stream);
+    paths.push_back(path);
+  }
+
+  context.set_host_output(1, 48000);
+  for (auto &track : tracks)
+  {
+    track->play();
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (audio_engine.get_state() != eAudioEngineState::Running && std::chrono::steady_clock::now() < deadline)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(audio_engine.get_state(), eAudioEngineState::Running);
+
+  std::vector<float> output(block);
+  float *buffers[] = {output.data()};
+  while (std::chrono::steady_clock::now() < deadline)
+  {
+    ASSERT_TRUE(context.render(buffers, block));
+    if (output.back() == 0.75f)
+      break;
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  ASSERT_EQ(output.back(), 0.75f);
+
+  // Render from the current position until a sample, keeping every frame
+  const uint64_t origin = audio_engine.get_sample_time();
+  std::vector<float> rendered;
+  auto render_until = [&](uint64_t sample_time) {
+    while (origin + rendered.size() < sample_time)
+    {
+      ASSERT_TRUE(context.render(buffers, block));
+      rendered.insert(rendered.end(), output.begin(), output.end());
+    }
+  };
+
+  const uint64_t stop_time = origin + 100;
+  tracks[1]->stop_at(stop_time);
+  tracks[2]->stop_at(stop_time);
+  render_until(stop_time + fade_frames + block);
+  EXPECT_FALSE(tracks[1]->is_playing());
+
+  const uint64_t start_time = audio_engine.get_quantized_sample_time(120.0, 0.25);
+  EXPECT_EQ(start_time % 6000, 0u);
+  ASSERT_GT(start_time, origin + rendered.size());
+  tracks[1]->play_at(start_time);
+  tracks[2]->play_at(start_time);
+  render_until(start_time + fade_frames + block);
+  EXPECT_EQ(audio_engine.get_state(), eAudioEngineState::Running);
+
+  auto at = [&](uint64_t sample_time) { return rendered[sample_time - origin]; };
+  EXPECT_EQ(at(stop_time - 1), 0.75f);
+  EXPECT_NEAR(at(stop_time), 0.5f + 0.25f * (1.0f - 1.0f / fade_frames), 1e-4f);
+  EXPECT_NEAR(at(stop_time + 119), 0.625f, 1e-4f);
+  EXPECT_EQ(at(stop_time + fade_frames + 1), 0.5f);
+  EXPECT_EQ(at(start_time - 1), 0.5f);
+  EXPECT_NEAR(at(start_time), 0.5f + 0.25f / fade_frames, 1e-4f);
+  EXPECT_NEAR(at(start_time + 119), 0.625f, 1e-4f);
+  EXPECT_EQ(at(start_time + fade_frames + 1), 0.75f);
+
+  context.stop();
+  for (const auto &path : paths)
+  {
+    std::filesystem::remove(path);
+  }
+}
+
+/** @brief Engine Context - Fresh tracks launched on a future sample stay silent until it, and stopping
+ *  every track leaves the stream running so they can be launched again
+ */
+TEST(EngineContextTest, LaunchFreshTracks)
+{
+  const unsigned int block = 64;
+  const unsigned int fade_frames = 240;  // TRACK_FADE_MS at 48 kHz
+  PcmStreamFormat format{ePcmSampleFormat::Float32, 1, 48000};
+
+  EngineContext context;
+  context.start();
+  AudioEngine &audio_engine = context.get_audio_engine();
+  TrackManager &track_manager = context.get_track_manager();
+
+  std::vector<std::filesystem::path> paths;
+  std::vector<TrackPtr> tracks;
+  for (float level : {0.25f, 0.5f})
+  {
+    auto path = std::filesystem::temp_directory_path() / ("test_enginecontext_launch" + std::to_string(paths.size()) + ".raw");
+    {
+      std::vector<float> input(48000, level);
+      auto output = FileManager::instance().open_pcm_output(path.string(), format, ePcmPacing::Freewheel);
+      ASSERT_TRUE(output.has_value());
+      ASSERT_TRUE((*output)->write_frames(input.data(), input.size(), 1));
+    }
+    auto stream = context.get_file_manager().open_pcm_input(path.string(), format);
+    ASSERT_TRUE(stream.has_value());
+    tracks.push_back(track_manager.get_track(track_manager.add_track()));
+    tracks.back()->add_audio_stream_input(*stream);
+    paths.push_back(path);
+  }
+
+  context.set_host_output(1, 48000);
+  const uint64_t start_time = 6000;
+  for (auto &track : tracks)
+  {
+    track->play_at(start_time);
+    EXPECT_FALSE(track->is_playing());  // Cued
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (audio_engine.get_state() != eAudioEngineState::Running && std::chrono::steady_clock::now() < deadline)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(audio_engine.get_state(), eAudioEngineState::Running);
+
+  std::vector<float> output(block);
+  float *buffers[] = {output.data()};
+  const uint64_t origin = audio_engine.get_sample_time();
+  ASSERT_LT(origin, start_time);
+  std::vector<float> rendered;
+  auto render_until = [&](uint64_t sample_time) {
+    while (origin + rendered.size() < sample_time)
+    {
+      ASSERT_TRUE(context.render(buffers, block));
+      rendered.insert(rendered.end(), output.begin(), output.end());
+    }
+  };
+  auto at = [&](uint64_t sample_time) { return rendered[sample_time - origin]; };
+
+  render_until(start_time + fade_frames + block);
+  EXPECT_EQ(at(origin), 0.0f);
+  EXPECT_EQ(at(start_time - 1), 0.0f);
+  EXPECT_NEAR(at(start_time), 0.75f / fade_frames, 1e-4f);
+  EXPECT_EQ(at(start_time + fade_frames + 1), 0.75f);
+  EXPECT_TRUE(tracks[0]->is_playing());
+
+  // Stopping every track keeps the stream running
+  const uint64_t stop_time = start_time + 2000;
+  for (auto &track : tracks)
+  {
+    track->stop_at(stop_time);
+  }
+  render_until(stop_time + fade_frames + 4 * block);
+  EXPECT_EQ(at(stop_time + fade_frames + 1), 0.0f);
+  EXPECT_EQ(audio_engine.get_state(), eAudioEngineState::Running);
+
+  const uint64_t relaunch_time = stop_time + 6000;
+  for (auto &track : tracks)
+  {
+    track->play_at(relaunch_time);
+  }
+  render_until(relaunch_time + fade_frames + block);
+  EXPECT_EQ(at(relaunch_time - 1), 0.0f);
+  EXPECT_EQ(at(relaunch_time + fade_frames + 1), 0.75f);
+  EXPECT_EQ(audio_engine.get_state(), eAudioEngineState::Running);
+
+  context.stop();
+  for (const auto &path : paths)
+  {
+    std::filesystem::remove(path);
+  }
+}
+
+/** @brief Engine Context - An input that runs out before a scheduled stop in the same block still ends the track
+ */
+TEST(EngineContextTest, InputEndsBeforeScheduledStop)
+{
+  const unsigned int block = 256;
+  const unsigned int input_frames = 100;
+  PcmStreamFormat format{ePcmSampleFormat::Float32, 1, 48000};
+
+  auto path = std::filesystem::temp_directory_path() / "test_enginecontext_input_end.raw";
+  {
+    std::vector<float> input(input_frames, 0.5f);
+    auto output = FileManager::instance().open_pcm_output(path.string(), format, ePcmPacing::Freewheel);
+    ASSERT_TRUE(output.has_value());
+    ASSERT_TRUE((*output)->write_frames(input.data(), input.size(), 1));
+  }
+  auto stream = FileManager::instance().open_pcm_input(path.string(), format);
+  ASSERT_TRUE(stream.has_value());
+
+  // Let the reader reach the end of the file; the buffered frames stay readable
+  (*stream)->start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  (*stream)->close();
+
+  Track track;
+  track.add_audio_stream_input(*stream);
+  track.stop_at(150);
+
+  std::vector<float> output(block, 0.0f);
+  EXPECT_FALSE(track.get_next_audio_frame(output.data(), block, 1, 48000, 0));
+  EXPECT_FALSE(track.is_playing());
+  EXPECT_EQ(output[input_frames - 1], 0.5f);
+  EXPECT_EQ(output[input_frames], 0.0f);
+
+  std::filesystem::remove(path);
+}
+
+/** @brief Engine Context - Armed tracks and the master output are recorded from the callback
+ */
+TEST(EngineContextTest, RecordArmedTracks)
+{
+  const unsigned int block = 64;
+  const unsigned int blocks = 100;
+  PcmStreamFormat format{ePcmSampleFormat::Float32, 1, 48000};
+  auto directory = std::filesystem::temp_directory_path() / "test_enginecontext_recording";
+  std::filesystem::remove_all(directory);
+
+  EngineContext context;
+  context.start();
+  AudioEngine &audio_engine = context.get_audio_engine();
+  TrackManager &track_manager = context.get_track_manager();
+
+  std::vector<std::filesystem::path> paths;
+  std::vector<TrackPtr> tracks;
+  for (float level : {0.5f, 0.25f})
+  {
+    auto path = std::filesystem::temp_directory_path() / ("test_enginecontext_record" + std::to_string(paths.size()) + ".raw");
+    {
+      std::vector<float> input(48000, level);
+      auto output = FileManager::instance().open_pcm_output(path.string(), format, ePcmPacing::Freewheel);
+      ASSERT_TRUE(output.has_value());
+      ASSERT_TRUE((*output)->write_frames(input.data(), input.size(), 1));
+    }
+    auto stream = context.get_file_manager().open_pcm_input(path.string(), format);
+    ASSERT_TRUE(stream.has_value());
+    tracks.push_back(track_manager.get_track(track_manager.add_track()));
+    tracks.back()->add_audio_stream_input(*stream);
+    paths.push_back(path);
+  }
+  tracks[1]->set_record_armed(true);
+
+  context.set_host_output(1, 48000);
+  tracks[0]->play();
+  tracks[1]->play();
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  std::vector<float> output(block);
+  float *buffers[] = {output.data()};
+  while (std::chrono::steady_clock::now() < deadline)
+  {
+    context.render(buffers, block);
+    if (audio_engine.get_state() == eAudioEngineState::Running && output.front() == 0.75f)
+      break;
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  ASSERT_EQ(output.front(), 0.75f);
+
+  RecordingOptions options;
+  options.directory = directory;
+  options.include_master = true;
+  ASSERT_TRUE(audio_engine.start_recording(options));
+  EXPECT_TRUE(audio_engine.is_recording());
+  EXPECT_FALSE(audio_engine.start_recording(options));
+
+  for (unsigned int i = 0; i < blocks; ++i)
+  {
+    ASSERT_TRUE(context.render(buffers, block));
+  }
+
+  auto statistics = audio_engine.stop_recording();
+  ASSERT_TRUE(statistics.has_value());
+  EXPECT_EQ(statistics->takes, 2u);
+  EXPECT_EQ(statistics->blocks_dropped, 0u);
+  EXPECT_EQ(statistics->blocks_recorded, 2u * blocks);
+  EXPECT_FALSE(audio_engine.is_recording());
+  EXPECT_FALSE(audio_engine.stop_recording().has_value());
+
+  auto read_samples = [](const std::filesystem::path &path) {
+    std::ifstream file(path, std::ios::binary);
+    file.seekg(RECORDING_FILE_HEADER_SIZE);
+    std::vector<float> samples;
+    float sample;
+    while (file.read(reinterpret_cast<char *>(&sample), sizeof(sample)))
+    {
+      samples.push_back(sample);
+    }
+    return samples;
+  };
+  EXPECT_FALSE(std::filesystem::exists(directory / "track0.wav"));
+  EXPECT_EQ(read_samples(directory / "track1.wav"), std::vector<float>(block * blocks, 0.25f));
+  EXPECT_EQ(read_samples(directory / "master.wav"), std::vector<float>(block * blocks, 0.75f));
+
+  context.stop();
+  for (const auto &path : paths)
+  {
+    std::filesystem::remove(path);
+  }
+  std::filesystem::remove_all(directory);
+}
+
+/** @brief Engine Context - The round trip through the virtual loopback ends up in the device profile
+ */
+TEST(EngineContextTest, MeasureRoundTripLatency)
+{
+  EngineContext context;
+  context.start();
+  AudioEngine &audio_engine = context.get_audio_engine();
+  context.set_host_output(2, 48000);
+  audio_engine.play();
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (audio_engine.get_state() != eAudioEngineState::Running && std::chrono::steady_clock::now() < deadline)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(audio_engine.get_state(), eAudioEngineState::Running);
+
+  // A host output has no input of its own
+  EXPECT_FALSE(audio_engine.measure_round_trip_latency().has_value());
+  ASSERT_TRUE(audio_engine.enable_virtual_loopback(777));
+
+  // The host keeps pulling blocks while the measurement waits for its capture
+  std::atomic<bool> rendering{true};
+  std::thread host([&]() {
+    std::vector<float> left(480);
+    std::vector<float> right(480);
+    float *buffers[] = {left.data(), right.data()};
+    while (rendering.load())
+    {
+      context.render(buffers, 480);
+    }
+  });
+
+  LatencyMeterOptions options;
+  options.mls_order = 12;
+  options.max_latency_seconds = 0.1;
+  auto profile = context.get_device_manager().measure_audio_device_latency(options);
+  rendering.store(false);
+  host.join();
+  audio_engine.disable_virtual_loopback();
+
+  ASSERT_TRUE(profile.has_value());
+  EXPECT_EQ(profile->round_trip_latency, 777u);
+  EXPECT_EQ(profile->sample_rate, 48000u);
+  EXPECT_TRUE(profile->is_virtual);
+
+  // A simulated round trip is not the device's
+  EXPECT_FALSE(context.get_device_manager().get_audio_device_profile(audio_engine.get_output_device().name).has_value());
+}
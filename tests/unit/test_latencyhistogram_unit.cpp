@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+#include <chrono>
+
+#include "latencyhistogram.h"
+
+using namespace MinimalAudioEngine;
+
+/** @brief Latencies land in log2 microsecond buckets and the summary follows them
+ */
+TEST(LatencyHistogramTest, BucketsAndPercentiles)
+{
+  LatencyHistogram histogram;
+  histogram.record(std::chrono::nanoseconds(500));          // 0 us, bucket 0
+  histogram.record(std::chrono::microseconds(3));           // bucket 1
+  histogram.record(std::chrono::microseconds(1000));        // bucket 9
+  histogram.record(std::chrono::microseconds(1000));
+  histogram.record(std::chrono::seconds(100));              // beyond the last limit
+
+  auto snapshot = histogram.snapshot();
+  EXPECT_EQ(snapshot.count, 5u);
+  EXPECT_EQ(snapshot.buckets[0], 1u);
+  EXPECT_EQ(snapshot.buckets[1], 1u);
+  EXPECT_EQ(snapshot.buckets[9], 2u);
+  EXPECT_EQ(snapshot.buckets[LATENCY_HISTOGRAM_BUCKETS - 1], 1u);
+  EXPECT_EQ(snapshot.max_us, 100000000u);
+
+  EXPECT_EQ(snapshot.get_percentile_us(0.5), 1024u);
+  EXPECT_EQ(snapshot.get_percentile_us(1.0), snapshot.max_us);
+  EXPECT_NEAR(snapshot.get_mean_us(), (3.0 + 2000.0 + 100000000.0) / 5.0, 1.0);
+}
+
+/** @brief Reset clears every counter
+ */
+TEST(LatencyHistogramTest, Reset)
+{
+  LatencyHistogram histogram;
+  histogram.record(std::chrono::milliseconds(5));
+  histogram.reset();
+
+  auto snapshot = histogram.snapshot();
+  EXPECT_EQ(snapshot.count, 0u);
+  EXPECT_EQ(snapshot.max_us, 0u);
+  EXPECT_EQ(snapshot.get_percentile_us(0.99), 0u);
+}
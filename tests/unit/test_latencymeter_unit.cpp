@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "latencymeter.h"
+#include "virtualloopback.h"
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+/** @brief Run a meter against a loopback the way the audio callback does, in blocks
+ *  @param noise Peak level of uniform noise added to the input
+ */
+std::optional<LatencyMeasurement> run_meter(LatencyMeter &meter, VirtualLoopback &loopback, unsigned int channels,
+                                            unsigned int block, float noise = 0.0f)
+{
+  std::vector<float> output(static_cast<size_t>(block) * channels);
+  std::vector<float> input(output.size());
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<float> distribution(-noise, noise);
+
+  for (unsigned int i = 0; i < 1000 && !meter.is_complete(); ++i)
+  {
+    std::fill(output.begin(), output.end(), 0.9f);  // Whatever the mix was; the meter replaces it
+    meter.generate(output.data(), block);
+    const float *returned = loopback.process(output.data(), block);
+    for (size_t s = 0; s < input.size(); ++s)
+    {
+      input[s] = returned[s] + distribution(generator);
+    }
+    meter.capture(input.data(), block, channels);
+  }
+  return meter.analyze();
+}
+
+}  // namespace
+
+/** @brief A maximum length sequence has 2^order - 1 samples, balanced to within one
+ */
+TEST(LatencyMeterTest, MaximumLengthSequence)
+{
+  for (unsigned int order = 10; order <= 18; ++order)
+  {
+    auto sequence = LatencyMeter::generate_mls(order, 1.0f);
+    ASSERT_EQ(sequence.size(), (size_t{1} << order) - 1) << order;
+
+    int64_t sum = 0;
+    for (float sample : sequence)
+    {
+      sum += sample > 0.0f ? 1 : -1;
+    }
+    EXPECT_EQ(sum, 1) << order;  // One more +1 than -1 only for a full period
+  }
+  EXPECT_TRUE(LatencyMeter::generate_mls(9, 1.0f).empty());
+}
+
+/** @brief The round trip through the virtual loopback is found to the frame, across block boundaries
+ */
+TEST(LatencyMeterTest, MeasuresLoopbackDelay)
+{
+  for (uint32_t delay : {0u, 1u, 300u, 1234u, 4097u})
+  {
+    LatencyMeterOptions options;
+    options.mls_order = 12;
+    options.max_latency_seconds = 0.25;
+    options.output_channel = 1;
+    options.input_channel = 1;
+    auto meter = LatencyMeter::create(options, 2, 48000);
+    ASSERT_NE(meter, nullptr);
+
+    VirtualLoopback loopback(delay, 2);
+    auto measurement = run_meter(*meter, loopback, 2, 256);
+    ASSERT_TRUE(measurement.has_value()) << delay;
+    EXPECT_EQ(measurement->round_trip_frames, delay);
+    EXPECT_EQ(measurement->sample_rate, 48000u);
+  }
+}
+
+/** @brief Noise and inverted polarity do not move the peak
+ */
+TEST(LatencyMeterTest, NoiseAndInversion)
+{
+  LatencyMeterOptions options;
+  options.level = 0.05f;
+  auto meter = LatencyMeter::create(options, 1, 44100);
+  ASSERT_NE(meter, nullptr);
+
+  VirtualLoopback loopback(2048, 1, -0.5f);
+  auto measurement = run_meter(*meter, loopback, 1, VIRTUAL_LOOPBACK_CHUNK_FRAMES, 0.1f);
+  ASSERT_TRUE(measurement.has_value());
+  EXPECT_EQ(measurement->round_trip_frames, 2048u);
+  EXPECT_NEAR(measurement->get_milliseconds(), 2048 * 1000.0 / 44100, 1e-9);
+}
+
+/** @brief Silence on the input, or a channel the input does not have, gives no result
+ */
+TEST(LatencyMeterTest, NothingReturned)
+{
+  LatencyMeterOptions options;
+  options.mls_order = 10;
+  options.max_latency_seconds = 0.1;
+  auto meter = LatencyMeter::create(options, 2, 48000);
+  ASSERT_NE(meter, nullptr);
+  EXPECT_FALSE(meter->analyze().has_value());  // Nothing captured yet
+
+  std::vector<float> output(128 * 2);
+  while (!meter->is_complete())
+  {
+    meter->generate(output.data(), 128);
+    meter->capture(nullptr, 128, 0);
+  }
+  EXPECT_FALSE(meter->analyze().has_value());
+
+  options.output_channel = 2;
+  EXPECT_EQ(LatencyMeter::create(options, 2, 48000), nullptr);
+  options.output_channel = 0;
+  options.mls_order = 20;
+  EXPECT_EQ(LatencyMeter::create(options, 2, 48000), nullptr);
+}
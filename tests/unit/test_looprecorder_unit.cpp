@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#include "looprecorder.h"
+#include "recordingfile.h"
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+std::vector<uint8_t> read_file(const std::filesystem::path &path)
+{
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+/** @brief Feed blocks whose samples hold pass * 1000 + offset within the loop, and -1 before it
+ */
+void run_passes(LoopRecorder &recorder, uint32_t track, uint64_t from, uint64_t to, unsigned int frames,
+                uint64_t loop_start, uint64_t loop_length, std::vector<float> *output = nullptr)
+{
+  std::vector<float> block(frames);
+  for (uint64_t sample_time = from; sample_time < to; sample_time += frames)
+  {
+    for (unsigned int i = 0; i < frames; ++i)
+    {
+      uint64_t time = sample_time + i;
+      block[i] = time < loop_start ? -1.0f
+                                   : static_cast<float>((time - loop_start) / loop_length * 1000 +
+                                                        (time - loop_start) % loop_length);
+    }
+    recorder.process(track, block.data(), frames, 1, sample_time);
+    if (output != nullptr)
+    {
+      output->insert(output->end(), block.begin(), block.end());
+    }
+  }
+}
+
+}  // namespace
+
+/** @brief Every pass becomes a take, cut at the exact loop boundary even mid-block, and is saved to disk
+ */
+TEST(LoopRecorderTest, TakePerPass)
+{
+  auto directory = std::filesystem::temp_directory_path() / "test_loop_recorder_takes";
+  std::filesystem::remove_all(directory);
+
+  LoopRecordingOptions options;
+  options.directory = directory;
+  options.loop_start = 150;
+  options.loop_length = 1000;
+  options.max_takes = 4;
+  options.auto_select = false;
+
+  auto recorder = LoopRecorder::create(options, {2}, 1, 48000);
+  ASSERT_NE(recorder, nullptr);
+
+  // Blocks of 64 never line up with the loop boundaries; three full passes and a partial fourth
+  run_passes(*recorder, 2, 0, 3648, 64, 150, 1000);
+
+  auto takes = recorder->get_takes(2);
+  ASSERT_EQ(takes.size(), 4u);
+  for (unsigned int i = 0; i < 3; ++i)
+  {
+    EXPECT_EQ(takes[i].start_sample, 150u + i * 1000u);
+    EXPECT_EQ(takes[i].frames, 1000u);
+    EXPECT_TRUE(takes[i].complete);
+  }
+  EXPECT_FALSE(takes[3].complete);
+  EXPECT_EQ(recorder->get_selected_take(2), LOOP_TAKE_NONE);
+  EXPECT_FALSE(recorder->select_take(2, 3));  // Still recording
+  EXPECT_FALSE(recorder->select_take(7, 0));  // Not loop recorded
+
+  LoopRecordingStatistics statistics = recorder->finish();
+  EXPECT_EQ(statistics.takes, 4u);
+  EXPECT_EQ(statistics.takes_written, 4u);
+  EXPECT_EQ(statistics.passes_dropped, 0u);
+  EXPECT_FALSE(statistics.write_failed);
+
+  for (unsigned int i = 0; i < 4; ++i)
+  {
+    auto data = read_file(directory / ("track2_take" + std::to_string(i) + ".wav"));
+    const uint64_t frames = i < 3 ? 1000 : 3648 - 3150;
+    ASSERT_EQ(data.size(), RECORDING_FILE_HEADER_SIZE + frames * sizeof(float)) << i;
+
+    uint32_t time_reference;
+    std::memcpy(&time_reference, data.data() + 72 + 346, sizeof(time_reference));
+    EXPECT_EQ(time_reference, 150u + i * 1000u);
+
+    const float *samples = reinterpret_cast<const float *>(data.data() + RECORDING_FILE_HEADER_SIZE);
+    size_t mismatches = 0;
+    for (uint64_t f = 0; f < frames; ++f)
+    {
+      mismatches += samples[f] != static_cast<float>(i * 1000 + f);
+    }
+    EXPECT_EQ(mismatches, 0u) << i;
+  }
+
+  std::filesystem::remove_all(directory);
+}
+
+/** @brief The selected take plays back at the loop position; switching takes applies to the next block
+ */
+TEST(LoopRecorderTest, SelectTakeForPlayback)
+{
+  auto directory = std::filesystem::temp_directory_path() / "test_loop_recorder_select";
+  std::filesystem::remove_all(directory);
+
+  LoopRecordingOptions options;
+  options.directory = directory;
+  options.loop_length = 512;
+  options.max_takes = 2;
+
+  auto recorder = LoopRecorder::create(options, {0}, 1, 48000);
+  ASSERT_NE(recorder, nullptr);
+
+  // Two passes; with auto_select the first plays during the second as soon as it ends
+  std::vector<float> output;
+  run_passes(*recorder, 0, 0, 1024, 128, 0, 512, &output);
+  EXPECT_EQ(output[100], 100.0f);
+  EXPECT_EQ(output[512 + 100], 1000.0f + 100.0f + 100.0f);
+  EXPECT_EQ(recorder->get_selected_take(0), 0);  // The second pass ends with the next block
+
+  // A third pass is dropped, the pool holds two takes; it plays take 1 until switched to take 0
+  output.clear();
+  run_passes(*recorder, 0, 1024, 1280, 128, 0, 512, &output);
+  EXPECT_EQ(output[10], 2000.0f + 10.0f + 1000.0f + 10.0f);
+
+  ASSERT_TRUE(recorder->select_take(0, 0));
+  output.clear();
+  run_passes(*recorder, 0, 1280, 1536, 128, 0, 512, &output);
+  EXPECT_EQ(output[0], 2000.0f + 256.0f + 256.0f);
+
+  ASSERT_TRUE(recorder->select_take(0, LOOP_TAKE_NONE));
+  output.clear();
+  run_passes(*recorder, 0, 1536, 1664, 128, 0, 512, &output);
+  EXPECT_EQ(output[0], 3000.0f);
+
+  LoopRecordingStatistics statistics = recorder->finish();
+  EXPECT_EQ(statistics.takes, 2u);
+  EXPECT_EQ(statistics.passes_dropped, 2u);
+  EXPECT_EQ(statistics.takes_written, 2u);
+
+  std::filesystem::remove_all(directory);
+}
+
+/** @brief Invalid loops and empty track lists are refused
+ */
+TEST(LoopRecorderTest, RejectsInvalidOptions)
+{
+  LoopRecordingOptions options;
+  options.directory = std::filesystem::temp_directory_path() / "test_loop_recorder_invalid";
+  EXPECT_EQ(LoopRecorder::create(options, {0}, 2, 44100), nullptr);
+
+  options.loop_length = 100;
+  EXPECT_EQ(LoopRecorder::create(options, {}, 2, 44100), nullptr);
+  EXPECT_EQ(LoopRecorder::create(options, {0}, 0, 44100), nullptr);
+
+  std::filesystem::remove_all(options.directory);
+}
@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "audioengine.h"
+#include "midieffects.h"
+#include "track.h"
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+constexpr uint32_t SAMPLE_RATE = 48000;
+constexpr double TEMPO = 120.0;  // A sixteenth is 6000 frames
+
+/** @brief A transform that records the order it sees events in
+ */
+struct LoggingTransform
+{
+  int id;
+  std::vector<int> *log;
+
+  bool transform(MidiEvent &event) const noexcept
+  {
+    log->push_back(id * 100 + event.data1);
+    return true;
+  }
+};
+
+MidiMessage make_message(uint8_t status, uint8_t data1, uint8_t data2 = 0)
+{
+  MidiMessage message{};
+  message.status = status;
+  message.type = static_cast<eMidiMessageType>(status & 0xF0);
+  message.channel = status & 0x0F;
+  message.data1 = data1;
+  message.data2 = data2;
+  return message;
+}
+
+}  // namespace
+
+/** @brief Consecutive transforms run in one pass; events they remove are gone for the later stages
+ */
+TEST(MidiEffectsTest, FusesTransforms)
+{
+  std::vector<int> log;
+  MidiEffectChain chain(LoggingTransform{1, &log}, MidiChannelFilter(0x0003, 5), LoggingTransform{2, &log},
+                        MidiTranspose(12), MidiVelocityCurve(1.0f, 64, 64));
+
+  MidiEventList events;
+  events.push({0, 0x90, 60, 100});
+  events.push({10, 0x92, 61, 100});  // Channel 3 is filtered out
+  events.push({20, 0x91, 120, 100}); // Transposed out of range
+  events.push({30, 0xB0, 7, 90});
+  chain.process(events, {0, 64, SAMPLE_RATE});
+
+  EXPECT_EQ(log, (std::vector<int>{160, 260, 161, 220, 320, 107, 207}));
+  ASSERT_EQ(events.size(), 2u);
+  EXPECT_EQ(events[0].status, 0x95);
+  EXPECT_EQ(events[0].data1, 72);
+  EXPECT_EQ(events[0].data2, 64);
+  EXPECT_EQ(events[1].offset, 30u);
+  EXPECT_EQ(events[1].status, 0xB5);
+  EXPECT_EQ(events[1].data2, 90);  // Not a note
+}
+
+/** @brief The velocity curve keeps note-offs and maps the ends of the range onto its limits
+ */
+TEST(MidiEffectsTest, VelocityCurve)
+{
+  MidiVelocityCurve soft(2.0f, 10, 100);
+  MidiEvent event{0, 0x90, 60, 127};
+  EXPECT_TRUE(soft.transform(event));
+  EXPECT_EQ(event.data2, 100);
+  event.data2 = 1;
+  soft.transform(event);
+  EXPECT_EQ(event.data2, 10);
+  event.data2 = 64;
+  soft.transform(event);
+  EXPECT_LT(event.data2, 55);  // Below the linear midpoint
+
+  event.data2 = 0;
+  soft.transform(event);
+  EXPECT_EQ(event.data2, 0);
+  MidiEvent off{0, 0x80, 60, 64};
+  soft.transform(off);
+  EXPECT_EQ(off.data2, 64);
+}
+
+/** @brief Repeats land on the transport grid across blocks and stop with the note-off
+ */
+TEST(MidiEffectsTest, NoteRepeat)
+{
+  MidiNoteRepeat repeat(TEMPO, 0.25);
+
+  MidiEventList events;
+  events.push({100, 0x99, 36, 110});
+  repeat.process(events, {0, 16000, SAMPLE_RATE});
+  ASSERT_EQ(events.size(), 5u);
+  EXPECT_EQ(events[0].offset, 100u);
+  EXPECT_EQ(events[1].offset, 6000u);
+  EXPECT_EQ(events[1].status, 0x89);
+  EXPECT_EQ(events[2].offset, 6000u);
+  EXPECT_EQ(events[2].status, 0x99);
+  EXPECT_EQ(events[2].data2, 110);
+  EXPECT_EQ(events[4].offset, 12000u);
+
+  events.clear();
+  events.push({500, 0x89, 36, 0});
+  repeat.process(events, {16000, 4000, SAMPLE_RATE});
+  EXPECT_EQ(events.size(), 1u);
+  EXPECT_TRUE(repeat.get_held_notes().empty());
+}
+
+/** @brief The arpeggiator steps through the chord and releases a note in the block its gate ends in
+ */
+TEST(MidiEffectsTest, ArpeggiatorAcrossBlocks)
+{
+  MidiArpeggiator arpeggiator(TEMPO, 0.25, eArpeggiatorMode::Up, 0.5);
+
+  MidiEventList events;
+  events.push({0, 0x90, 64, 90});
+  events.push({0, 0x90, 60, 100});
+  events.push({0, 0xB0, 1, 20});
+  arpeggiator.process(events, {0, 4096, SAMPLE_RATE});
+  ASSERT_EQ(events.size(), 3u);
+  EXPECT_EQ(events[0].status, 0xB0);  // Passed through
+  EXPECT_EQ(events[1].data1, 60);
+  EXPECT_EQ(events[1].data2, 100);
+  EXPECT_EQ(events[2].status, 0x80);
+  EXPECT_EQ(events[2].offset, 3000u);
+
+  events.clear();
+  arpeggiator.process(events, {4096, 4096, SAMPLE_RATE});
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].offset, 6000u - 4096u);
+  EXPECT_EQ(events[0].data1, 64);
+
+  events.clear();
+  events.push({0, 0x80, 60, 0});
+  events.push({0, 0x80, 64, 0});
+  arpeggiator.process(events, {8192, 4096, SAMPLE_RATE});
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].status, 0x80);
+  EXPECT_EQ(events[0].data1, 64);
+  EXPECT_EQ(events[0].offset, 9000u - 8192u);
+}
+
+/** @brief A track's MIDI input reaches the block through its effect chain
+ */
+TEST(MidiEffectsTest, TrackRunsEffect)
+{
+  auto track = std::make_shared<Track>();
+  track->set_midi_effect(make_midi_effect_chain(MidiTranspose(-12), MidiChannelFilter(0x0001)));
+  EXPECT_TRUE(track->has_midi_effect());
+
+  track->update(make_message(0x90, 72, 100));
+  track->update(make_message(0x91, 72, 100));
+  track->update(make_message(0xF8, 0));  // Not a channel message
+
+  const uint64_t now = AudioEngine::instance().get_sample_time_at(std::chrono::steady_clock::now());
+  track->process_midi_block(1u << 20, SAMPLE_RATE, now);
+  const MidiEventList &events = track->get_block_midi_events();
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].offset, 0u);
+  EXPECT_EQ(events[0].data1, 60);
+
+  track->set_midi_effect(nullptr);
+  EXPECT_FALSE(track->has_midi_effect());
+  track->process_midi_block(256, SAMPLE_RATE, now + (1u << 20));
+  EXPECT_TRUE(track->get_block_midi_events().empty());
+  EXPECT_EQ(track->get_midi_events_dropped(), 0u);
+}
+
+/** @brief A block's events stay in place while the block is rendered in segments
+ */
+TEST(MidiEffectsTest, BlockEventsSurviveSegments)
+{
+  auto track = std::make_shared<Track>();
+  track->update(make_message(0x90, 60, 100));
+
+  const uint64_t now = AudioEngine::instance().get_sample_time_at(std::chrono::steady_clock::now());
+  track->process_midi_block(1u << 20, SAMPLE_RATE, now);
+  ASSERT_EQ(track->get_block_midi_events().size(), 1u);
+
+  // The engine splits the block at parameter changes; rendering a segment leaves the events alone
+  std::vector<float> buffer(64 * 2, 0.0f);
+  track->get_next_audio_frame(buffer.data(), 64, 2, SAMPLE_RATE, now);
+  track->get_next_audio_frame(buffer.data(), 64, 2, SAMPLE_RATE, now + 64);
+  ASSERT_EQ(track->get_block_midi_events().size(), 1u);
+  EXPECT_EQ(track->get_block_midi_events()[0].data1, 60);
+}
@@ -0,0 +1,246 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "midiengine.h"
+#include "midilearn.h"
+#include "parameterregistry.h"
+#include "track.h"
+#include "trackmanager.h"
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+MidiMessage make_cc(uint8_t channel, uint8_t controller, uint8_t value)
+{
+  MidiMessage message{};
+  message.status = 0xB0 | channel;
+  message.type = eMidiMessageType::ControlChange;
+  message.channel = channel;
+  message.data1 = controller;
+  message.data2 = value;
+  return message;
+}
+
+ParameterId register_test_parameter(const std::string &name, float minimum = 0.0f, float maximum = 1.0f,
+                                    float smoothing_ms = 0.0f)
+{
+  ParameterInfo info;
+  info.name = name;
+  info.minimum = minimum;
+  info.maximum = maximum;
+  info.smoothing_ms = smoothing_ms;
+  auto id = ParameterRegistry::instance().register_parameter(info);
+  EXPECT_TRUE(id.has_value());
+  return id.value_or(PARAMETER_NO_ID);
+}
+
+}  // namespace
+
+/** @brief Ids are dense and stable; values are clamped to the range
+ */
+TEST(ParameterRegistryTest, RegistersAndClamps)
+{
+  auto &registry = ParameterRegistry::instance();
+  const ParameterId first = register_test_parameter("test.registry.first", -10.0f, 10.0f);
+  const ParameterId second = register_test_parameter("test.registry.second");
+  EXPECT_EQ(second, first + 1);
+  EXPECT_EQ(register_test_parameter("test.registry.first"), first);  // Same name, same parameter
+  EXPECT_EQ(registry.find_parameter("test.registry.second"), second);
+  EXPECT_FALSE(registry.find_parameter("test.registry.missing").has_value());
+
+  ParameterInfo invalid;
+  invalid.name = "test.registry.invalid";
+  invalid.minimum = 1.0f;
+  invalid.maximum = 1.0f;
+  EXPECT_FALSE(registry.register_parameter(invalid).has_value());
+
+  EXPECT_TRUE(registry.set_value(first, 25.0f));
+  EXPECT_EQ(registry.get_value(first), 10.0f);
+  EXPECT_TRUE(registry.set_normalized(first, 0.25f));
+  EXPECT_EQ(registry.get_value(first), -5.0f);
+  EXPECT_FALSE(registry.set_value(PARAMETER_NO_ID, 1.0f));
+}
+
+/** @brief advance() glides towards the target with the parameter's time constant and settles on it
+ */
+TEST(ParameterRegistryTest, SmoothsPerParameter)
+{
+  auto &registry = ParameterRegistry::instance();
+  const ParameterId smoothed = register_test_parameter("test.smoothing.ten", 0.0f, 1.0f, 10.0f);
+  const ParameterId immediate = register_test_parameter("test.smoothing.none", 0.0f, 1.0f, 0.0f);
+
+  registry.set_value(smoothed, 1.0f);
+  registry.set_value(immediate, 1.0f);
+  EXPECT_EQ(registry.advance(immediate, 64, 48000), 1.0f);
+
+  // One time constant gets about 63% of the way
+  const float value = registry.advance(smoothed, 480, 48000);
+  EXPECT_NEAR(value, 0.632f, 0.01f);
+  EXPECT_EQ(registry.get_smoothed_value(smoothed), value);
+
+  for (int block = 0; block < 100; ++block)
+  {
+    registry.advance(smoothed, 480, 48000);
+  }
+  EXPECT_EQ(registry.get_smoothed_value(smoothed), 1.0f);
+}
+
+/** @brief A bound controller sets its parameter; learning takes the next controller and replaces old bindings
+ */
+TEST(MidiLearnTest, BindsControllers)
+{
+  auto &registry = ParameterRegistry::instance();
+  const ParameterId parameter = register_test_parameter("test.learn.cc", 0.0f, 2.0f);
+  MidiLearn midi_learn;
+
+  EXPECT_TRUE(midi_learn.bind_cc(0, 7, parameter));
+  EXPECT_TRUE(midi_learn.process(make_cc(0, 7, 127)));
+  EXPECT_EQ(registry.get_value(parameter), 2.0f);
+  EXPECT_FALSE(midi_learn.process(make_cc(1, 7, 0)));  // Another channel
+
+  midi_learn.learn(parameter);
+  EXPECT_EQ(midi_learn.get_learning(), parameter);
+  EXPECT_TRUE(midi_learn.process(make_cc(2, 74, 0)));
+  EXPECT_EQ(midi_learn.get_learning(), PARAMETER_NO_ID);
+  EXPECT_EQ(registry.get_value(parameter), 0.0f);
+  EXPECT_FALSE(midi_learn.process(make_cc(0, 7, 127)));  // The old binding is gone
+
+  auto bindings = midi_learn.get_bindings();
+  ASSERT_EQ(bindings.size(), 1u);
+  EXPECT_EQ(bindings[0].type, eMidiBindingType::ControlChange);
+  EXPECT_EQ(bindings[0].channel, 2);
+  EXPECT_EQ(bindings[0].number, 74);
+
+  midi_learn.unbind(parameter);
+  EXPECT_TRUE(midi_learn.get_bindings().empty());
+  EXPECT_EQ(midi_learn.get_values_applied(), 2u);
+}
+
+/** @brief NRPNs follow the parameter number selection and take 14-bit data entry
+ */
+TEST(MidiLearnTest, BindsNrpns)
+{
+  auto &registry = ParameterRegistry::instance();
+  const ParameterId parameter = register_test_parameter("test.learn.nrpn");
+  const ParameterId other = register_test_parameter("test.learn.nrpn.other");
+  MidiLearn midi_learn;
+
+  EXPECT_TRUE(midi_learn.bind_nrpn(3, 0x0102, parameter));
+  EXPECT_TRUE(midi_learn.bind_nrpn(3, 0x0103, other));
+  EXPECT_FALSE(midi_learn.bind_nrpn(3, 1 << 14, other));
+
+  EXPECT_FALSE(midi_learn.process(make_cc(3, 99, 0x02)));
+  EXPECT_FALSE(midi_learn.process(make_cc(3, 98, 0x02)));
+  EXPECT_TRUE(midi_learn.process(make_cc(3, 6, 0x40)));
+  EXPECT_NEAR(registry.get_value(parameter), 0x40 / 127.0f, 1e-6f);  // MSB only
+  EXPECT_TRUE(midi_learn.process(make_cc(3, 38, 0x7F)));
+  EXPECT_NEAR(registry.get_value(parameter), ((0x40 << 7) | 0x7F) / 16383.0f, 1e-6f);
+  EXPECT_TRUE(midi_learn.process(make_cc(3, 6, 0x41)));  // 14-bit from here on, the LSB follows
+  EXPECT_NEAR(registry.get_value(parameter), (0x41 << 7) / 16383.0f, 1e-6f);
+  EXPECT_TRUE(midi_learn.process(make_cc(3, 38, 0x00)));
+  EXPECT_NEAR(registry.get_value(parameter), (0x41 << 7) / 16383.0f, 1e-6f);
+
+  // Selecting an RPN ends the NRPN, so data entry is a plain controller again
+  midi_learn.process(make_cc(3, 101, 0));
+  midi_learn.process(make_cc(3, 100, 0));
+  EXPECT_FALSE(midi_learn.process(make_cc(3, 6, 0)));
+  EXPECT_NEAR(registry.get_value(parameter), (0x41 << 7) / 16383.0f, 1e-6f);
+
+  // Learn an NRPN
+  midi_learn.learn(other);
+  midi_learn.process(make_cc(5, 99, 0x7E));
+  midi_learn.process(make_cc(5, 98, 0x00));
+  EXPECT_TRUE(midi_learn.process(make_cc(5, 6, 0x7F)));
+  EXPECT_EQ(registry.get_value(other), 1.0f);  // A full MSB is the top of the range
+  auto bindings = midi_learn.get_bindings();
+  ASSERT_EQ(bindings.size(), 2u);  // The learned one replaced the earlier binding of the parameter
+}
+
+/** @brief Binding from one thread while MIDI is dispatched on another never loses a binding
+ */
+TEST(MidiLearnTest, ConcurrentBindAndDispatch)
+{
+  const ParameterId parameter = register_test_parameter("test.learn.concurrent");
+  MidiLearn midi_learn;
+
+  std::atomic<bool> done{false};
+  std::thread dispatcher([&]() {
+    uint8_t value = 0;
+    while (!done.load(std::memory_order_acquire))
+    {
+      midi_learn.process(make_cc(0, 99, 0));
+      midi_learn.process(make_cc(0, 98, value & 0x7F));
+      midi_learn.process(make_cc(0, 6, value++ & 0x7F));
+    }
+  });
+
+  for (uint16_t number = 0; number < 256; ++number)
+  {
+    EXPECT_TRUE(midi_learn.bind_nrpn(number % 16, number, parameter));
+  }
+  done.store(true, std::memory_order_release);
+  dispatcher.join();
+  EXPECT_EQ(midi_learn.get_bindings().size(), 256u);
+}
+
+/** @brief A controller moved on the MidiEngine reaches a managed track's gain with the next block,
+ *  which glides the parameter once for the whole device block
+ */
+TEST(MidiLearnTest, ControllerDrivesTrackGain)
+{
+  auto &track_manager = TrackManager::instance();
+  track_manager.clear_tracks();
+  const size_t index = track_manager.add_track();
+  auto track = track_manager.get_track(index);
+
+  auto parameter = ParameterRegistry::instance().find_parameter("track" + std::to_string(track->get_id()) + ".gain");
+  ASSERT_TRUE(parameter.has_value());
+  EXPECT_EQ(track->get_gain_parameter(), *parameter);
+
+  auto &midi_engine = MidiEngine::instance();
+  midi_engine.get_midi_learn().bind_cc(0, 7, *parameter);
+
+  track->apply_gain_parameter(256, 48000);  // Picks up the binding
+  track->set_gain(0.8f);
+  track->apply_gain_parameter(256, 48000);
+  EXPECT_EQ(track->get_gain(), 0.8f);  // The knob has not moved
+
+  midi_engine.receive_midi_message(make_cc(0, 7, 0));
+  for (int block = 0; block < 200; ++block)
+  {
+    track->apply_gain_parameter(256, 48000);
+  }
+  EXPECT_EQ(track->get_gain(), 0.0f);
+
+  midi_engine.get_midi_learn().unbind(*parameter);
+  while (midi_engine.try_pop_message().has_value())
+  {
+  }
+  track_manager.clear_tracks();
+}
+
+/** @brief Track parameters are named by track id, so removing a track leaves the others' bindings alone
+ */
+TEST(MidiLearnTest, RemovingTrackKeepsParameters)
+{
+  auto &track_manager = TrackManager::instance();
+  track_manager.clear_tracks();
+  track_manager.add_track();
+  auto track = track_manager.get_track(track_manager.add_track());
+  const ParameterId parameter = track->get_gain_parameter();
+  ASSERT_NE(parameter, PARAMETER_NO_ID);
+  EXPECT_EQ(ParameterRegistry::instance().find_parameter("track" + std::to_string(track->get_id()) + ".gain"), parameter);
+
+  track_manager.remove_track(0);
+  EXPECT_EQ(track_manager.get_track(0), track);
+  EXPECT_EQ(track->get_gain_parameter(), parameter);
+
+  // A new track gets a parameter of its own
+  auto added = track_manager.get_track(track_manager.add_track());
+  EXPECT_NE(added->get_gain_parameter(), parameter);
+  track_manager.clear_tracks();
+}
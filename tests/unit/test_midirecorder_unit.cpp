@@ -0,0 +1,252 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "midiengine.h"
+#include "midirecorder.h"
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+std::vector<uint8_t> read_file(const std::filesystem::path &path)
+{
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void append(std::vector<uint8_t> &out, std::initializer_list<uint8_t> bytes)
+{
+  out.insert(out.end(), bytes);
+}
+
+void append_track(std::vector<uint8_t> &out, const std::vector<uint8_t> &track)
+{
+  append(out, {'M', 'T', 'r', 'k', 0, 0, 0, static_cast<uint8_t>(track.size())});
+  out.insert(out.end(), track.begin(), track.end());
+}
+
+void append_name(std::vector<uint8_t> &track, const std::string &name)
+{
+  append(track, {0x00, 0xFF, 0x03, static_cast<uint8_t>(name.size())});
+  track.insert(track.end(), name.begin(), name.end());
+}
+
+RecordedMidiEvent controller(uint64_t sample_time, uint8_t number, uint8_t value)
+{
+  return RecordedMidiEvent{sample_time, 0xB0, number, value, 3};
+}
+
+}  // namespace
+
+/** @brief The file is type 1 with a tempo track and one track per channel, timed in ticks, with running status
+ */
+TEST(MidiRecorderTest, WritesStandardMidiFile)
+{
+  auto path = std::filesystem::temp_directory_path() / "test_midi_recorder" / "take.mid";
+  std::filesystem::remove_all(path.parent_path());
+
+  MidiRecordingOptions options;
+  options.path = path;  // 48 kHz, 960 PPQ and 120 BPM: 25 samples per tick
+  auto recorder = MidiRecorder::create(options);
+  ASSERT_NE(recorder, nullptr);
+
+  const unsigned char program[] = {0xC1, 0x05};
+  const unsigned char first_note[] = {0x90, 0x3C, 0x64};
+  const unsigned char second_note[] = {0x90, 0x3E, 0x64};
+  const unsigned char note_off[] = {0x80, 0x3C, 0x00};
+  const unsigned char clock[] = {0xF8};
+  recorder->record_at(program, sizeof(program), 24000);  // Out of order: sorted before writing
+  recorder->record_at(first_note, sizeof(first_note), 0);
+  recorder->record_at(clock, sizeof(clock), 100);
+  recorder->record_at(second_note, sizeof(second_note), 6000);
+  recorder->record_at(note_off, sizeof(note_off), 12000);
+
+  recorder->stop();
+  auto statistics = recorder->wait();
+  EXPECT_EQ(statistics.events_recorded, 4u);
+  EXPECT_EQ(statistics.events_ignored, 1u);
+  EXPECT_EQ(statistics.events_written, 4u);
+  EXPECT_EQ(statistics.tracks, 3u);
+  EXPECT_FALSE(statistics.write_failed);
+
+  std::vector<uint8_t> expected = {'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 1, 0, 3, 0x03, 0xC0};
+  append_track(expected, {0x00, 0xFF, 0x51, 0x03, 0x07, 0xA1, 0x20,    // 500000 us per quarter note
+                          0x00, 0xFF, 0x58, 0x04, 0x04, 0x02, 0x18, 0x08,
+                          0x00, 0xFF, 0x2F, 0x00});
+
+  std::vector<uint8_t> channel_1;
+  append_name(channel_1, "Channel 1");
+  append(channel_1, {0x00, 0x90, 0x3C, 0x64});
+  append(channel_1, {0x81, 0x70, 0x3E, 0x64});        // 240 ticks, running status
+  append(channel_1, {0x81, 0x70, 0x80, 0x3C, 0x00});  // 240 ticks
+  append(channel_1, {0x00, 0xFF, 0x2F, 0x00});
+  append_track(expected, channel_1);
+
+  std::vector<uint8_t> channel_2;
+  append_name(channel_2, "Channel 2");
+  append(channel_2, {0x87, 0x40, 0xC1, 0x05});  // 960 ticks
+  append(channel_2, {0x00, 0xFF, 0x2F, 0x00});
+  append_track(expected, channel_2);
+
+  EXPECT_EQ(read_file(path), expected);
+  EXPECT_EQ(statistics.bytes_written, expected.size());
+  std::filesystem::remove_all(path.parent_path());
+}
+
+/** @brief With a sample clock, events are timed from the transport sample the recording started at
+ */
+TEST(MidiRecorderTest, TimesFromRecordingStart)
+{
+  auto path = std::filesystem::temp_directory_path() / "test_midi_recorder_start.mid";
+  uint64_t transport_sample = 480000;
+
+  MidiRecordingOptions options;
+  options.path = path;
+  options.sample_clock = [&transport_sample](std::chrono::steady_clock::time_point) { return transport_sample; };
+  auto recorder = MidiRecorder::create(options);
+  ASSERT_NE(recorder, nullptr);
+
+  transport_sample += 24000;
+  const unsigned char program[] = {0xC0, 0x05};
+  recorder->record(program, sizeof(program), std::chrono::steady_clock::now());
+  recorder->stop();
+  EXPECT_EQ(recorder->wait().events_written, 1u);
+
+  std::vector<uint8_t> expected = {'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 1, 0, 2, 0x03, 0xC0};
+  append_track(expected, {0x00, 0xFF, 0x51, 0x03, 0x07, 0xA1, 0x20,
+                          0x00, 0xFF, 0x58, 0x04, 0x04, 0x02, 0x18, 0x08,
+                          0x00, 0xFF, 0x2F, 0x00});
+  std::vector<uint8_t> channel_1;
+  append_name(channel_1, "Channel 1");
+  append(channel_1, {0x87, 0x40, 0xC0, 0x05});  // 960 ticks after the start, not after transport sample 0
+  append(channel_1, {0x00, 0xFF, 0x2F, 0x00});
+  append_track(expected, channel_1);
+
+  EXPECT_EQ(read_file(path), expected);
+  std::filesystem::remove(path);
+}
+
+/** @brief Thinning keeps the first value, real moves and the value each gesture ends on
+ */
+TEST(MidiRecorderTest, ThinsControllerStreams)
+{
+  const uint64_t gap = 2400;
+  std::vector<RecordedMidiEvent> events;
+  uint64_t time = 0;
+  for (uint8_t value = 0; value <= 12; ++value, time += 480)
+  {
+    events.push_back(controller(time, 1, value));
+    events.push_back(controller(time, 64, value % 2 ? 127 : 0));  // Sustain is never thinned
+  }
+  time += 48000;  // Quiet: the first gesture ended on 12
+  for (uint8_t value = 13; value <= 25; ++value, time += 480)
+  {
+    events.push_back(controller(time, 1, value));
+  }
+
+  EXPECT_EQ(MidiRecorder::thin(events, 0, gap).size(), events.size());
+
+  auto kept = MidiRecorder::thin(events, 4, gap);
+  std::vector<int> modulation;
+  size_t sustain = 0;
+  for (const auto &event : kept)
+  {
+    if (event.data1 == 1)
+      modulation.push_back(event.data2);
+    else
+      ++sustain;
+  }
+  EXPECT_EQ(modulation, (std::vector<int>{0, 5, 10, 12, 17, 22, 25}));
+  EXPECT_EQ(sustain, 13u);
+
+  // Pitch bend is compared in 7-bit steps of its 14-bit value
+  std::vector<RecordedMidiEvent> bends = {{0, 0xE0, 0x00, 0x40, 3}, {480, 0xE0, 0x7F, 0x40, 3},
+                                          {960, 0xE0, 0x00, 0x42, 3}, {1440, 0xE0, 0x00, 0x42, 3}};
+  EXPECT_EQ(MidiRecorder::thin(bends, 1, gap).size(), 3u);
+}
+
+/** @brief A full buffer drops events instead of growing; a stopped recorder takes no more
+ */
+TEST(MidiRecorderTest, DropsWhenFull)
+{
+  auto path = std::filesystem::temp_directory_path() / "test_midi_recorder_full.mid";
+
+  MidiRecordingOptions options;
+  options.path = path;
+  options.capacity = 4;
+  options.controller_tolerance = 8;
+  auto recorder = MidiRecorder::create(options);
+  ASSERT_NE(recorder, nullptr);
+
+  for (uint8_t note = 60; note < 66; ++note)
+  {
+    const unsigned char message[] = {0x92, note, 0x40};
+    recorder->record_at(message, sizeof(message), note * 100u);
+  }
+  const unsigned char sysex[] = {0xF0, 0x7E, 0x7F, 0xF7};
+  recorder->record_at(sysex, sizeof(sysex), 0);
+  const unsigned char truncated[] = {0x92, 0x40};
+  recorder->record_at(truncated, sizeof(truncated), 0);
+
+  recorder->stop();
+  const unsigned char late[] = {0x92, 0x50, 0x40};
+  recorder->record_at(late, sizeof(late), 10000);
+
+  auto statistics = recorder->wait();
+  EXPECT_EQ(statistics.events_recorded, 4u);
+  EXPECT_EQ(statistics.events_dropped, 2u);
+  EXPECT_EQ(statistics.events_ignored, 2u);
+  EXPECT_EQ(statistics.events_thinned, 0u);  // Notes are never thinned
+  EXPECT_EQ(statistics.events_written, 4u);
+  EXPECT_EQ(statistics.tracks, 2u);
+
+  options.capacity = 0;
+  EXPECT_EQ(MidiRecorder::create(options), nullptr);
+  options.capacity = 4;
+  options.tempo_bpm = 0.0;
+  EXPECT_EQ(MidiRecorder::create(options), nullptr);
+  std::filesystem::remove(path);
+}
+
+/** @brief Messages reaching the MidiEngine are recorded while a recording runs
+ */
+TEST(MidiRecorderTest, MidiEngineRecordsIncomingMessages)
+{
+  auto path = std::filesystem::temp_directory_path() / "test_midi_engine_recording.mid";
+  auto &midi_engine = MidiEngine::instance();
+
+  MidiRecordingOptions options;
+  options.path = path;
+  uint64_t sample_time = 0;
+  options.sample_clock = [&sample_time](std::chrono::steady_clock::time_point) { return sample_time += 25; };
+
+  EXPECT_FALSE(midi_engine.stop_recording().has_value());
+  ASSERT_TRUE(midi_engine.start_recording(options));
+  EXPECT_TRUE(midi_engine.is_recording());
+  EXPECT_FALSE(midi_engine.start_recording(options));
+
+  MidiMessage message{};
+  message.status = 0xB3;
+  message.data1 = 7;
+  message.data2 = 100;
+  midi_engine.receive_midi_message(message);
+  message.status = 0xD3;
+  message.data1 = 20;
+  midi_engine.receive_midi_message(message);
+
+  auto statistics = midi_engine.stop_recording();
+  ASSERT_TRUE(statistics.has_value());
+  EXPECT_FALSE(midi_engine.is_recording());
+  EXPECT_EQ(statistics->events_written, 2u);
+  EXPECT_EQ(statistics->tracks, 2u);
+
+  midi_engine.receive_midi_message(message);  // Not recording any more
+  EXPECT_TRUE(std::filesystem::exists(path));
+  std::filesystem::remove(path);
+}
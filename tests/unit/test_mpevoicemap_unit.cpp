@@ -0,0 +1,208 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "midiengine.h"
+#include "mpevoicemap.h"
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+MidiMessage make_message(uint8_t status, uint8_t data1, uint8_t data2 = 0)
+{
+  MidiMessage message{};
+  message.status = status;
+  message.type = static_cast<eMidiMessageType>(status & 0xF0);
+  message.channel = status & 0x0F;
+  message.data1 = data1;
+  message.data2 = data2;
+  return message;
+}
+
+void send_rpn(MpeVoiceMap &voice_map, uint8_t channel, uint8_t parameter, uint8_t value)
+{
+  voice_map.process(make_message(0xB0 | channel, 101, 0));
+  voice_map.process(make_message(0xB0 | channel, 100, parameter));
+  voice_map.process(make_message(0xB0 | channel, 6, value));
+}
+
+void send_bend(MpeVoiceMap &voice_map, uint8_t channel, int value)
+{
+  value += 8192;
+  voice_map.process(make_message(0xE0 | channel, value & 0x7F, (value >> 7) & 0x7F));
+}
+
+}  // namespace
+
+/** @brief The MPE Configuration Message sets the zones; the zone configured last wins any overlap
+ */
+TEST(MpeVoiceMapTest, ConfigurationMessage)
+{
+  MpeVoiceMap voice_map;
+  EXPECT_FALSE(voice_map.process(make_message(0x91, 60, 100)));  // No zones yet
+
+  send_rpn(voice_map, 0, 6, 15);
+  EXPECT_EQ(voice_map.get_layout().lower_members, 15u);
+  EXPECT_EQ(voice_map.get_layout().upper_members, 0u);
+  EXPECT_TRUE(voice_map.process(make_message(0x91, 60, 100)));
+
+  send_rpn(voice_map, 15, 6, 7);
+  EXPECT_EQ(voice_map.get_layout().lower_members, 7u);
+  EXPECT_EQ(voice_map.get_layout().upper_members, 7u);
+  EXPECT_EQ(voice_map.get_voice_index(1, 60), MPE_NO_VOICE);  // Reconfiguring releases every voice
+
+  // Pitch bend sensitivity on a member channel
+  send_rpn(voice_map, 1, 0, 24);
+  EXPECT_EQ(voice_map.get_layout().note_bend_range, 24.0f);
+
+  MpeZoneLayout layout;
+  layout.lower_members = 3;
+  voice_map.set_layout(layout);
+  EXPECT_EQ(voice_map.get_layout().lower_members, 7u);  // Applied with the next message
+  voice_map.process(make_message(0xF8, 0));
+  EXPECT_EQ(voice_map.get_layout().lower_members, 3u);
+  EXPECT_EQ(voice_map.get_layout().upper_members, 0u);
+  EXPECT_EQ(voice_map.get_layout().note_bend_range, MPE_DEFAULT_NOTE_BEND_RANGE);
+  EXPECT_EQ(voice_map.get_layout_changes(), 3u);
+  EXPECT_EQ(voice_map.get_statistics().layout_changes, 3u);
+}
+
+/** @brief Expression reaches only the voice on its channel, including values sent before the note
+ */
+TEST(MpeVoiceMapTest, PerNoteExpression)
+{
+  MpeVoiceMap voice_map;
+  MpeZoneLayout layout;
+  layout.lower_members = 15;
+  voice_map.set_layout(layout);
+
+  // Initial expression on channel 2, then the note
+  send_bend(voice_map, 1, 4096);
+  voice_map.process(make_message(0xD1, 64));
+  voice_map.process(make_message(0xB1, MPE_TIMBRE_CONTROLLER, 127));
+  voice_map.process(make_message(0x91, 60, 90));
+  voice_map.process(make_message(0x92, 60, 80));  // Same note on another channel is another voice
+
+  const int first = voice_map.get_voice_index(1, 60);
+  const int second = voice_map.get_voice_index(2, 60);
+  ASSERT_NE(first, MPE_NO_VOICE);
+  ASSERT_NE(second, MPE_NO_VOICE);
+  ASSERT_NE(first, second);
+
+  MpeVoice voice;
+  ASSERT_TRUE(voice_map.get_voice(first, voice));
+  EXPECT_EQ(voice.channel, 1);
+  EXPECT_EQ(voice.note, 60);
+  EXPECT_EQ(voice.velocity, 90);
+  EXPECT_NEAR(voice.pitch_bend, 24.0f, 0.01f);
+  EXPECT_FLOAT_EQ(voice.pressure, 64 / 127.0f);
+  EXPECT_FLOAT_EQ(voice.timbre, 1.0f);
+
+  ASSERT_TRUE(voice_map.get_voice(second, voice));
+  EXPECT_FLOAT_EQ(voice.pitch_bend, 0.0f);
+  send_bend(voice_map, 2, -8192);
+  ASSERT_TRUE(voice_map.get_voice(second, voice));
+  EXPECT_FLOAT_EQ(voice.pitch_bend, -48.0f);
+
+  // The manager channel bends the whole zone on top
+  send_bend(voice_map, 0, 8191);
+  ASSERT_TRUE(voice_map.get_voice(first, voice));
+  EXPECT_NEAR(voice.pitch_bend, 26.0f, 0.01f);
+  ASSERT_TRUE(voice_map.get_voice(second, voice));
+  EXPECT_FLOAT_EQ(voice.pitch_bend, -46.0f);
+
+  voice_map.process(make_message(0x81, 60, 33));
+  EXPECT_FALSE(voice_map.get_voice(first, voice));
+  EXPECT_EQ(voice.release_velocity, 33);
+  EXPECT_EQ(voice_map.get_voice_index(1, 60), MPE_NO_VOICE);
+
+  MpeVoice voices[MPE_MAX_VOICES];
+  EXPECT_EQ(voice_map.get_active_voices(voices, MPE_MAX_VOICES), 1u);
+  EXPECT_EQ(voices[0].channel, 2);
+
+  auto statistics = voice_map.get_statistics();
+  EXPECT_EQ(statistics.notes, 2u);
+  EXPECT_EQ(statistics.expression, 5u);
+}
+
+/** @brief Past the last voice the oldest note is stolen; a note-off without a voice is counted
+ */
+TEST(MpeVoiceMapTest, StealsOldestVoice)
+{
+  MpeVoiceMap voice_map;
+  MpeZoneLayout layout;
+  layout.lower_members = 15;
+  voice_map.set_layout(layout);
+
+  for (unsigned int i = 0; i <= MPE_MAX_VOICES; ++i)
+  {
+    voice_map.process(make_message(0x90 | (1 + i % 15), static_cast<uint8_t>(40 + i), 100));
+  }
+  EXPECT_EQ(voice_map.get_statistics().voices_stolen, 1u);
+  EXPECT_EQ(voice_map.get_voice_index(1, 40), MPE_NO_VOICE);
+  EXPECT_EQ(voice_map.get_voice_index(1 + MPE_MAX_VOICES % 15, 40 + MPE_MAX_VOICES), 0);
+
+  voice_map.process(make_message(0x81, 40, 0));
+  EXPECT_EQ(voice_map.get_statistics().unmatched_note_offs, 1u);
+}
+
+/** @brief A reader never sees half of a note-on, however often the voice is reused
+ */
+TEST(MpeVoiceMapTest, ConsistentSnapshots)
+{
+  MpeVoiceMap voice_map;
+  MpeZoneLayout layout;
+  layout.lower_members = 1;
+  voice_map.set_layout(layout);
+  voice_map.process(make_message(0xF8, 0));
+
+  std::atomic<bool> done{false};
+  std::atomic<unsigned int> torn{0};
+  std::thread reader([&]() {
+    MpeVoice voice;
+    while (!done.load(std::memory_order_acquire))
+    {
+      if (voice_map.get_voice(0, voice) && voice.note != voice.velocity)
+      {
+        torn.fetch_add(1);
+      }
+    }
+  });
+
+  for (unsigned int i = 0; i < 200000; ++i)
+  {
+    const auto value = static_cast<uint8_t>(1 + i % 127);
+    voice_map.process(make_message(0x91, value, value));
+    voice_map.process(make_message(0x81, value, 0));
+  }
+  done.store(true, std::memory_order_release);
+  reader.join();
+  EXPECT_EQ(torn.load(), 0u);
+}
+
+/** @brief Messages reaching the MidiEngine drive its voice map
+ */
+TEST(MpeVoiceMapTest, MidiEngineTracksVoices)
+{
+  auto &midi_engine = MidiEngine::instance();
+  MpeZoneLayout layout;
+  layout.upper_members = 4;
+  midi_engine.set_mpe_layout(layout);
+
+  midi_engine.receive_midi_message(make_message(0x9E, 72, 110));  // Channel 15, an upper zone member
+  const int index = midi_engine.get_mpe_voice_map().get_voice_index(14, 72);
+  ASSERT_NE(index, MPE_NO_VOICE);
+  MpeVoice voice;
+  EXPECT_TRUE(midi_engine.get_mpe_voice_map().get_voice(index, voice));
+  EXPECT_EQ(voice.velocity, 110);
+
+  midi_engine.set_mpe_layout(MpeZoneLayout{});
+  midi_engine.receive_midi_message(make_message(0xF8, 0));
+  EXPECT_EQ(midi_engine.get_mpe_voice_map().get_voice_index(14, 72), MPE_NO_VOICE);
+  while (midi_engine.try_pop_message().has_value())
+  {
+  }
+}
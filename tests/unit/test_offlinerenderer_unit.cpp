@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <memory>
+
+#include "offlinerenderer.h"
+#include "track.h"
+#include "filemanager.h"
+#include "wavfile.h"
+#include "logger.h"
+
+using namespace MinimalAudioEngine;
+
+class OfflineRendererTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    m_output_directory = std::filesystem::temp_directory_path() / "minimal_audio_engine_render_test";
+    std::filesystem::remove_all(m_output_directory);
+  }
+
+  void TearDown() override
+  {
+    std::filesystem::remove_all(m_output_directory);
+  }
+
+  TrackPtr make_file_track()
+  {
+    auto track = std::make_shared<Track>();
+    auto file = FileManager::instance().read_wav_file("./samples/test.wav");
+    EXPECT_TRUE(file.has_value()) << "Failed to read WAV file for testing";
+    track->add_audio_file_input(file.value());
+    return track;
+  }
+
+  std::filesystem::path m_output_directory;
+};
+
+/** @brief Render stems and mix for several tracks
+ */
+TEST_F(OfflineRendererTest, RenderStemsAndMix)
+{
+  std::vector<TrackPtr> tracks = {make_file_track(), make_file_track(), std::make_shared<Track>()};
+  uint64_t length = tracks[0]->get_length_frames();
+  ASSERT_GT(length, 0u);
+
+  OfflineRenderConfig config;
+  config.output_directory = m_output_directory;
+  config.segment_frames = 4096;
+  config.thread_count = 4;
+
+  OfflineRenderer renderer(config);
+  OfflineRenderStatistics statistics = renderer.render(tracks);
+  LOG_INFO(statistics.to_string());
+
+  // The empty track is skipped
+  EXPECT_EQ(statistics.tracks_rendered, 2u);
+  EXPECT_EQ(statistics.files_written, 3u);
+  EXPECT_EQ(statistics.session_frames, length);
+  EXPECT_EQ(statistics.frames_rendered, 2 * length);
+
+  for (const auto &filename : {"track_0.wav", "track_1.wav", "mix.wav"})
+  {
+    auto output = FileManager::instance().read_wav_file(m_output_directory / filename);
+    ASSERT_TRUE(output.has_value()) << filename << " should have been written";
+    EXPECT_EQ(static_cast<uint64_t>(output.value()->get_frame_count()), length);
+    EXPECT_EQ(output.value()->get_channels(), config.channels);
+  }
+}
+
+/** @brief Segmented parallel render matches a single-segment render
+ */
+TEST_F(OfflineRendererTest, SegmentedRenderMatchesSequential)
+{
+  std::vector<TrackPtr> tracks = {make_file_track()};
+
+  OfflineRenderConfig config;
+  config.output_directory = m_output_directory / "sequential";
+  config.export_mix = false;
+  config.segment_frames = static_cast<unsigned int>(tracks[0]->get_length_frames());
+  config.thread_count = 1;
+  OfflineRenderer(config).render(tracks);
+
+  config.output_directory = m_output_directory / "segmented";
+  config.segment_frames = 1000;
+  config.thread_count = 8;
+  OfflineRenderer(config).render(tracks);
+
+  auto sequential = FileManager::instance().read_wav_file(m_output_directory / "sequential" / "track_0.wav");
+  auto segmented = FileManager::instance().read_wav_file(m_output_directory / "segmented" / "track_0.wav");
+  ASSERT_TRUE(sequential.has_value());
+  ASSERT_TRUE(segmented.has_value());
+
+  sf_count_t frames = sequential.value()->get_frame_count();
+  ASSERT_EQ(frames, segmented.value()->get_frame_count());
+
+  std::vector<float> a(static_cast<size_t>(frames) * config.channels);
+  std::vector<float> b(a.size());
+  ASSERT_EQ(sequential.value()->read_frames(a, frames), frames);
+  ASSERT_EQ(segmented.value()->read_frames(b, frames), frames);
+  EXPECT_EQ(a, b);
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "oscpacket.h"
+#include "oscserver.h"
+
+using namespace MinimalAudioEngine;
+
+/** @brief Encode a message and read its arguments back in place
+ */
+TEST(OscPacketTest, ParseMessage)
+{
+  auto packet = OscMessageBuilder("/track/2/gain").add_float(0.5f).add_int32(-3).add_string("pad").add_bool(true).build();
+  ASSERT_EQ(packet.size() % 4, 0u);
+
+  auto message = OscMessageView::parse(packet);
+  ASSERT_TRUE(message.has_value());
+  EXPECT_EQ(message->get_address(), "/track/2/gain");
+  EXPECT_EQ(message->get_type_tags(), "fisT");
+
+  auto arguments = message->get_arguments();
+  OscArgument argument;
+  float float_value;
+  int32_t int_value;
+
+  ASSERT_TRUE(arguments.next(argument));
+  ASSERT_TRUE(argument.to_float(float_value));
+  EXPECT_FLOAT_EQ(float_value, 0.5f);
+
+  ASSERT_TRUE(arguments.next(argument));
+  ASSERT_TRUE(argument.to_int(int_value));
+  EXPECT_EQ(int_value, -3);
+
+  ASSERT_TRUE(arguments.next(argument));
+  EXPECT_EQ(argument.string, "pad");
+  // Zero-copy: the string points into the packet
+  EXPECT_GE(reinterpret_cast<const uint8_t *>(argument.string.data()), packet.data());
+  EXPECT_LT(reinterpret_cast<const uint8_t *>(argument.string.data()), packet.data() + packet.size());
+
+  ASSERT_TRUE(arguments.next(argument));
+  EXPECT_EQ(argument.type, 'T');
+  EXPECT_FALSE(arguments.next(argument));
+}
+
+/** @brief Messages in nested bundles carry their innermost bundle's timetag
+ */
+TEST(OscPacketTest, ParseNestedBundles)
+{
+  auto inner = build_osc_bundle(200, {OscMessageBuilder("/track/0/mute").add_int32(1).build()});
+  auto outer = build_osc_bundle(100, {OscMessageBuilder("/master/gain").add_float(0.25f).build(), inner});
+
+  std::vector<std::pair<std::string, uint64_t>> visited;
+  bool valid = parse_osc_packet(outer, [&visited](const OscMessageView &message, uint64_t timetag) {
+    visited.emplace_back(std::string(message.get_address()), timetag);
+  });
+
+  ASSERT_TRUE(valid);
+  ASSERT_EQ(visited.size(), 2u);
+  EXPECT_EQ(visited[0], std::make_pair(std::string("/master/gain"), uint64_t(100)));
+  EXPECT_EQ(visited[1], std::make_pair(std::string("/track/0/mute"), uint64_t(200)));
+
+  std::vector<std::string> bare;
+  ASSERT_TRUE(parse_osc_packet(OscMessageBuilder("/transport/play").build(), [&bare](const OscMessageView &message, uint64_t timetag) {
+    EXPECT_EQ(timetag, OSC_TIMETAG_IMMEDIATE);
+    bare.emplace_back(message.get_address());
+  }));
+  EXPECT_EQ(bare.size(), 1u);
+}
+
+/** @brief Truncated or inconsistent packets are rejected
+ */
+TEST(OscPacketTest, RejectMalformed)
+{
+  auto visitor = [](const OscMessageView &, uint64_t) {};
+
+  auto packet = OscMessageBuilder("/master/gain").add_float(1.0f).build();
+  std::vector<uint8_t> truncated(packet.begin(), packet.end() - 4);
+  EXPECT_FALSE(parse_osc_packet(truncated, visitor));
+
+  std::vector<uint8_t> unaligned(packet.begin(), packet.end() - 1);
+  EXPECT_FALSE(parse_osc_packet(unaligned, visitor));
+
+  auto bundle = build_osc_bundle(OSC_TIMETAG_IMMEDIATE, {packet});
+  bundle[19] = 0xFF;  // Element size larger than the bundle
+  EXPECT_FALSE(parse_osc_packet(bundle, visitor));
+
+  std::vector<uint8_t> no_slash = {'x', 0, 0, 0, ',', 0, 0, 0};
+  EXPECT_FALSE(parse_osc_packet(no_slash, visitor));
+}
+
+/** @brief NTP timetags convert to and from wall clock time
+ */
+TEST(OscPacketTest, TimetagConversion)
+{
+  auto now = std::chrono::system_clock::now();
+  uint64_t timetag = OscServer::time_to_timetag(now);
+  auto round_trip = OscServer::timetag_to_time(timetag);
+  EXPECT_LT(std::chrono::abs(round_trip - now), std::chrono::microseconds(1));
+}
@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "filemanager.h"
+#include "pcmstream.h"
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+std::filesystem::path temp_pcm_path(const char *name)
+{
+  return std::filesystem::temp_directory_path() / name;
+}
+
+/** @brief Read until the stream is finished, waiting for the reader thread
+ */
+std::vector<float> read_all(PcmInputStream &stream, unsigned int channels)
+{
+  std::vector<float> result;
+  std::vector<float> block(256 * channels);
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!stream.is_finished() && std::chrono::steady_clock::now() < deadline)
+  {
+    unsigned int frames = stream.read_frames(block.data(), 256, channels);
+    result.insert(result.end(), block.begin(), block.begin() + frames * channels);
+    if (frames == 0)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+/** @brief Sample format names with and without the endianness suffix
+ */
+TEST(PcmStreamTest, ParseSampleFormat)
+{
+  EXPECT_EQ(PcmStreamFormat::parse_sample_format("f32le"), ePcmSampleFormat::Float32);
+  EXPECT_EQ(PcmStreamFormat::parse_sample_format("s16"), ePcmSampleFormat::Int16);
+  EXPECT_EQ(PcmStreamFormat::parse_sample_format("s24le"), ePcmSampleFormat::Int24);
+  EXPECT_EQ(PcmStreamFormat::parse_sample_format("s32le"), ePcmSampleFormat::Int32);
+  EXPECT_FALSE(PcmStreamFormat::parse_sample_format("u8").has_value());
+}
+
+/** @brief Frames written by an output stream read back unchanged for every sample format
+ */
+TEST(PcmStreamTest, RoundTripThroughFile)
+{
+  const unsigned int channels = 2;
+  const unsigned int frames = 5000;  // Not a multiple of the read block
+  std::vector<float> input(frames * channels);
+  for (size_t i = 0; i < input.size(); ++i)
+  {
+    input[i] = 0.9f * static_cast<float>(std::sin(0.01 * static_cast<double>(i)));
+  }
+
+  for (auto sample_format : {ePcmSampleFormat::Float32, ePcmSampleFormat::Int16, ePcmSampleFormat::Int24, ePcmSampleFormat::Int32})
+  {
+    PcmStreamFormat format{sample_format, channels, 48000};
+    auto path = temp_pcm_path("test_pcmstream_roundtrip.raw");
+
+    auto output = FileManager::instance().open_pcm_output(path.string(), format, ePcmPacing::Freewheel);
+    ASSERT_TRUE(output.has_value());
+    ASSERT_TRUE((*output)->write_frames(input.data(), frames, channels));
+    (*output)->close();
+    EXPECT_EQ(std::filesystem::file_size(path), frames * format.get_bytes_per_frame());
+
+    auto stream = FileManager::instance().open_pcm_input(path.string(), format);
+    ASSERT_TRUE(stream.has_value());
+    (*stream)->start();
+    std::vector<float> result = read_all(**stream, channels);
+
+    ASSERT_EQ(result.size(), input.size());
+    float tolerance = sample_format == ePcmSampleFormat::Int16 ? 1.0f / 16384.0f : 1e-6f;
+    for (size_t i = 0; i < input.size(); ++i)
+    {
+      ASSERT_NEAR(result[i], input[i], tolerance) << "sample " << i;
+    }
+
+    std::filesystem::remove(path);
+  }
+}
+
+/** @brief Extra output channels are silenced and an empty stream reports underruns, not frames
+ */
+TEST(PcmStreamTest, ChannelMappingAndUnderrun)
+{
+  PcmStreamFormat mono{ePcmSampleFormat::Float32, 1, 48000};
+  auto path = temp_pcm_path("test_pcmstream_mono.raw");
+  {
+    auto output = FileManager::instance().open_pcm_output(path.string(), mono, ePcmPacing::Freewheel);
+    ASSERT_TRUE(output.has_value());
+    std::vector<float> samples = {0.25f, -0.5f, 0.75f};
+    ASSERT_TRUE((*output)->write_frames(samples.data(), 3, 1));
+  }
+
+  auto stream = FileManager::instance().open_pcm_input(path.string(), mono);
+  ASSERT_TRUE(stream.has_value());
+
+  // Not started: nothing buffered yet
+  std::vector<float> block(8, 1.0f);
+  EXPECT_EQ((*stream)->read_frames(block.data(), 4, 2), 0u);
+  EXPECT_EQ((*stream)->get_underruns(), 1u);
+  EXPECT_EQ(block, std::vector<float>(8, 0.0f));
+
+  (*stream)->start();
+  std::vector<float> result = read_all(**stream, 2);
+  EXPECT_EQ(result, (std::vector<float>{0.25f, 0.0f, -0.5f, 0.0f, 0.75f, 0.0f}));
+
+  std::filesystem::remove(path);
+}
+
+/** @brief Integer formats clip instead of wrapping around
+ */
+TEST(PcmStreamTest, IntegerOutputClips)
+{
+  PcmStreamFormat format{ePcmSampleFormat::Int16, 1, 48000};
+  auto path = temp_pcm_path("test_pcmstream_clip.raw");
+  {
+    auto output = FileManager::instance().open_pcm_output(path.string(), format, ePcmPacing::Freewheel);
+    ASSERT_TRUE(output.has_value());
+    std::vector<float> samples = {2.0f, -2.0f};
+    ASSERT_TRUE((*output)->write_frames(samples.data(), 2, 1));
+  }
+
+  auto stream = FileManager::instance().open_pcm_input(path.string(), format);
+  ASSERT_TRUE(stream.has_value());
+  (*stream)->start();
+  std::vector<float> result = read_all(**stream, 1);
+
+  ASSERT_EQ(result.size(), 2u);
+  EXPECT_NEAR(result[0], 1.0f, 1e-4f);
+  EXPECT_NEAR(result[1], -1.0f, 1e-4f);
+
+  std::filesystem::remove(path);
+}
+
+/** @brief Opening an output FIFO waits for its reader without blocking in open()
+ */
+TEST(PcmStreamTest, OutputFifoWaitsForReader)
+{
+  PcmStreamFormat format{ePcmSampleFormat::Float32, 1, 48000};
+  auto path = temp_pcm_path("test_pcmstream_fifo");
+  std::filesystem::remove(path);
+  ASSERT_EQ(mkfifo(path.c_str(), 0600), 0);
+
+  std::optional<PcmInputStreamPtr> input;
+  std::thread reader([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    input = FileManager::instance().open_pcm_input(path.string(), format);
+  });
+
+  auto output = FileManager::instance().open_pcm_output(path.string(), format, ePcmPacing::Freewheel);
+  reader.join();
+  ASSERT_TRUE(output.has_value());
+  ASSERT_TRUE(input.has_value());
+
+  std::vector<float> samples = {0.25f, -0.5f};
+  ASSERT_TRUE((*output)->write_frames(samples.data(), 2, 1));
+  output->reset();
+
+  (*input)->start();
+  EXPECT_EQ(read_all(**input, 1), samples);
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,214 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#include "recorder.h"
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+std::vector<uint8_t> read_file(const std::filesystem::path &path)
+{
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+uint32_t read_u32(const std::vector<uint8_t> &data, size_t offset)
+{
+  uint32_t value;
+  std::memcpy(&value, data.data() + offset, sizeof(value));
+  return value;
+}
+
+}  // namespace
+
+/** @brief Blocks written by the callback side end up in order in one WAV file per source
+ */
+TEST(RecorderTest, WritesTakes)
+{
+  auto directory = std::filesystem::temp_directory_path() / "test_recorder_takes";
+  std::filesystem::remove_all(directory);
+
+  RecordingOptions options;
+  options.directory = directory;
+  options.include_master = true;
+  options.ring_seconds = 2.0;
+  options.preallocate_seconds = 1.0;
+  options.direct_io = true;  // Falls back to buffered writes where unsupported
+  options.broadcast_info.description = "Session";
+
+  auto recorder = Recorder::create(options, {3}, 2, 48000);
+  ASSERT_NE(recorder, nullptr);
+
+  // Enough blocks to wrap each ring several times
+  const unsigned int frames = 100;
+  const unsigned int blocks = 2000;
+  std::vector<float> block(frames * 2);
+  for (unsigned int b = 0; b < blocks; ++b)
+  {
+    for (unsigned int i = 0; i < block.size(); ++i)
+    {
+      block[i] = static_cast<float>(b * block.size() + i);
+    }
+    recorder->write(3, block.data(), frames, 2, 1000 + b * frames);
+    recorder->write(RECORDER_SOURCE_MASTER, block.data(), frames, 2, 1000 + b * frames);
+    recorder->write(5, block.data(), frames, 2, 1000 + b * frames);  // Not recorded
+    if (b % 100 == 0)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+  }
+
+  RecordingStatistics statistics = recorder->finish();
+  EXPECT_EQ(statistics.takes, 2u);
+  EXPECT_EQ(statistics.blocks_dropped, 0u);
+  EXPECT_FALSE(statistics.write_failed);
+  EXPECT_EQ(statistics.blocks_recorded, 2u * blocks);
+
+  const uint64_t data_bytes = static_cast<uint64_t>(blocks) * frames * 2 * sizeof(float);
+  EXPECT_EQ(statistics.bytes_written, 2 * data_bytes);
+
+  for (const char *name : {"track3.wav", "master.wav"})
+  {
+    auto data = read_file(directory / name);
+    ASSERT_EQ(data.size(), RECORDING_FILE_HEADER_SIZE + data_bytes) << name;
+    EXPECT_EQ(std::memcmp(data.data(), "RIFF", 4), 0);
+    EXPECT_EQ(std::memcmp(data.data() + 8, "WAVE", 4), 0);
+    EXPECT_EQ(std::memcmp(data.data() + 12, "JUNK", 4), 0);  // Room for ds64
+    EXPECT_EQ(std::memcmp(data.data() + 48, "fmt ", 4), 0);
+    EXPECT_EQ(read_u32(data, 60), 48000u);
+    EXPECT_EQ(std::memcmp(data.data() + 72, "bext", 4), 0);
+    EXPECT_EQ(std::memcmp(data.data() + 80, "Session", 7), 0);
+    EXPECT_EQ(read_u32(data, 72 + 346), 1000u);  // Time reference of the first block
+    EXPECT_EQ(std::memcmp(data.data() + RECORDING_FILE_HEADER_SIZE - 8, "data", 4), 0);
+    EXPECT_EQ(read_u32(data, RECORDING_FILE_HEADER_SIZE - 4), data_bytes);
+
+    const float *samples = reinterpret_cast<const float *>(data.data() + RECORDING_FILE_HEADER_SIZE);
+    size_t mismatches = 0;
+    for (size_t i = 0; i < data_bytes / sizeof(float); ++i)
+    {
+      mismatches += samples[i] != static_cast<float>(i);
+    }
+    EXPECT_EQ(mismatches, 0u) << name;
+  }
+
+  std::filesystem::remove_all(directory);
+}
+
+/** @brief A take starts at the punch-in minus the pre-roll and ends at the punch-out, to the frame
+ */
+TEST(RecorderTest, PreRollAndPunch)
+{
+  auto directory = std::filesystem::temp_directory_path() / "test_recorder_punch";
+  std::filesystem::remove_all(directory);
+
+  RecordingOptions options;
+  options.directory = directory;
+  options.pre_roll_seconds = 4096.0 / 48000.0;
+  options.punch_in = RECORDER_NO_PUNCH;
+
+  auto recorder = Recorder::create(options, {0}, 1, 48000);
+  ASSERT_NE(recorder, nullptr);
+
+  // Each sample holds its transport position; the capture buffer wraps long before the punch-in
+  const unsigned int frames = 100;
+  std::vector<float> block(frames);
+  for (uint64_t sample_time = 0; sample_time < 220000; sample_time += frames)
+  {
+    if (sample_time == 100000)
+    {
+      recorder->punch_in(200000);
+      recorder->punch_out(210000);
+    }
+    for (unsigned int i = 0; i < frames; ++i)
+    {
+      block[i] = static_cast<float>(sample_time + i);
+    }
+    recorder->write(0, block.data(), frames, 1, sample_time);
+    if (sample_time % 10000 == 0)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  RecordingStatistics statistics = recorder->finish();
+  EXPECT_EQ(statistics.takes_punched_in, 1u);
+  EXPECT_EQ(statistics.blocks_dropped, 0u);
+
+  // 4096 frames of pre-roll, moved back to the previous page boundary
+  const uint64_t first = 195584;
+  auto data = read_file(directory / "track0.wav");
+  ASSERT_EQ(data.size(), RECORDING_FILE_HEADER_SIZE + (210000 - first) * sizeof(float));
+  EXPECT_EQ(read_u32(data, 72 + 346), first);
+
+  const float *samples = reinterpret_cast<const float *>(data.data() + RECORDING_FILE_HEADER_SIZE);
+  EXPECT_EQ(samples[0], static_cast<float>(first));
+  EXPECT_EQ(samples[200000 - first], 200000.0f);
+  EXPECT_EQ(samples[210000 - first - 1], 209999.0f);
+
+  std::filesystem::remove_all(directory);
+}
+
+/** @brief Without a punch-in nothing is written
+ */
+TEST(RecorderTest, StandbyWritesNothing)
+{
+  auto directory = std::filesystem::temp_directory_path() / "test_recorder_standby";
+  std::filesystem::remove_all(directory);
+
+  RecordingOptions options;
+  options.directory = directory;
+  options.pre_roll_seconds = 1.0;
+  options.punch_in = RECORDER_NO_PUNCH;
+
+  auto recorder = Recorder::create(options, {0}, 2, 48000);
+  ASSERT_NE(recorder, nullptr);
+
+  std::vector<float> block(256 * 2, 0.5f);
+  for (uint64_t sample_time = 0; sample_time < 48000 * 3; sample_time += 256)
+  {
+    recorder->write(0, block.data(), 256, 2, sample_time);
+  }
+
+  RecordingStatistics statistics = recorder->finish();
+  EXPECT_EQ(statistics.takes_punched_in, 0u);
+  EXPECT_EQ(statistics.blocks_recorded, 0u);
+  EXPECT_EQ(statistics.blocks_dropped, 0u);
+  EXPECT_EQ(std::filesystem::file_size(directory / "track0.wav"), RECORDING_FILE_HEADER_SIZE);
+
+  std::filesystem::remove_all(directory);
+}
+
+/** @brief A block in the wrong format is dropped and counted, not written
+ */
+TEST(RecorderTest, CountsDroppedBlocks)
+{
+  auto directory = std::filesystem::temp_directory_path() / "test_recorder_dropped";
+  std::filesystem::remove_all(directory);
+
+  RecordingOptions options;
+  options.directory = directory;
+
+  auto recorder = Recorder::create(options, {0}, 2, 44100);
+  ASSERT_NE(recorder, nullptr);
+
+  std::vector<float> block(64 * 2, 0.5f);
+  recorder->write(0, block.data(), 64, 2, 0);
+  recorder->write(0, block.data(), 64, 1, 64);
+
+  RecordingStatistics statistics = recorder->finish();
+  EXPECT_EQ(statistics.blocks_recorded, 1u);
+  EXPECT_EQ(statistics.blocks_dropped, 1u);
+  EXPECT_EQ(std::filesystem::file_size(directory / "track0.wav"), RECORDING_FILE_HEADER_SIZE + 64 * 2 * sizeof(float));
+
+  EXPECT_EQ(Recorder::create(RecordingOptions{}, {}, 2, 44100), nullptr);
+  std::filesystem::remove_all(directory);
+}
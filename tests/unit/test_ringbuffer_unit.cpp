@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "ringbuffer.h"
+
+using namespace MinimalAudioEngine;
+
+/** @brief Items come out in order and a full buffer rejects pushes
+ */
+TEST(RingBufferTest, FifoAndCapacity)
+{
+  SpscRingBuffer<int, 4> ring;
+  EXPECT_TRUE(ring.empty());
+
+  for (int i = 0; i < 4; ++i)
+  {
+    EXPECT_TRUE(ring.try_push(i));
+  }
+  EXPECT_FALSE(ring.try_push(4));
+  EXPECT_EQ(ring.size(), 4u);
+
+  int value;
+  for (int i = 0; i < 4; ++i)
+  {
+    ASSERT_TRUE(ring.try_pop(value));
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_FALSE(ring.try_pop(value));
+}
+
+/** @brief A producer and a consumer thread exchange a long sequence without loss
+ */
+TEST(RingBufferTest, ProducerConsumer)
+{
+  constexpr int count = 100000;
+  SpscRingBuffer<int, 64> ring;
+
+  std::thread producer([&ring]() {
+    for (int i = 0; i < count; ++i)
+    {
+      while (!ring.try_push(i))
+      {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  int expected = 0;
+  int value;
+  while (expected < count)
+  {
+    if (ring.try_pop(value))
+    {
+      ASSERT_EQ(value, expected);
+      ++expected;
+    }
+    else
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  producer.join();
+  EXPECT_TRUE(ring.empty());
+}
@@ -0,0 +1,188 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "midiengine.h"
+#include "sysexpool.h"
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+/** @brief F0, a manufacturer ID and a counting payload, F7
+ */
+std::vector<uint8_t> make_sysex(size_t size)
+{
+  std::vector<uint8_t> bytes(size);
+  bytes.front() = 0xF0;
+  for (size_t i = 1; i + 1 < size; ++i)
+  {
+    bytes[i] = static_cast<uint8_t>(i & 0x7F);
+  }
+  bytes.back() = 0xF7;
+  return bytes;
+}
+
+}  // namespace
+
+/** @brief A message spans blocks, is shared by its copies and returns its blocks when the last copy goes
+ */
+TEST(SysexPoolTest, AssemblesAcrossBlocks)
+{
+  auto pool = SysexPool::create(16, 32);
+  ASSERT_NE(pool, nullptr);
+
+  auto bytes = make_sysex(100);
+  SysexBuffer buffer = pool->assemble(bytes.data(), bytes.size());
+  ASSERT_TRUE(buffer);
+  EXPECT_EQ(buffer.size(), 100u);
+  EXPECT_EQ(buffer.to_vector(), bytes);
+  EXPECT_EQ(pool->get_statistics().blocks_free, 32u - 7u);
+
+  size_t chunks = 0;
+  buffer.for_each_chunk([&chunks](std::span<const uint8_t> chunk) {
+    EXPECT_LE(chunk.size(), 16u);
+    ++chunks;
+  });
+  EXPECT_EQ(chunks, 7u);
+
+  std::vector<uint8_t> copied(40);
+  EXPECT_EQ(buffer.copy_to(copied.data(), copied.size()), 40u);
+  EXPECT_TRUE(std::equal(copied.begin(), copied.end(), bytes.begin()));
+
+  {
+    SysexBuffer copy = buffer;
+    SysexBuffer moved = std::move(buffer);
+    EXPECT_FALSE(buffer);
+    EXPECT_EQ(copy.to_vector(), bytes);
+    EXPECT_EQ(pool->get_statistics().blocks_free, 32u - 7u);  // Copies share the blocks
+  }
+  EXPECT_EQ(pool->get_statistics().blocks_free, 32u);
+
+  auto statistics = pool->get_statistics();
+  EXPECT_EQ(statistics.messages, 1u);
+  EXPECT_EQ(statistics.bytes, 100u);
+
+  EXPECT_EQ(SysexPool::create(0, 32), nullptr);
+  EXPECT_EQ(SysexPool::create(16, 0), nullptr);
+}
+
+/** @brief Fragments are joined; real-time bytes are skipped and other status bytes cut a message off
+ */
+TEST(SysexPoolTest, ReassemblesFragments)
+{
+  auto pool = SysexPool::create(8, 64);
+  ASSERT_NE(pool, nullptr);
+
+  const uint8_t orphan[] = {0x10, 0x20, 0xF7};
+  EXPECT_FALSE(pool->assemble(orphan, sizeof(orphan)));
+  EXPECT_EQ(pool->get_statistics().fragments_ignored, 1u);
+
+  const uint8_t first[] = {0xF0, 0x43, 0x10, 0x4C};
+  const uint8_t second[] = {0x00, 0xF8, 0x00, 0x7E};  // A timing clock in the middle of the dump
+  const uint8_t last[] = {0x00, 0x41, 0xF7};
+  EXPECT_FALSE(pool->assemble(first, sizeof(first)));
+  EXPECT_TRUE(pool->is_assembling());
+  EXPECT_FALSE(pool->assemble(second, sizeof(second)));
+  SysexBuffer buffer = pool->assemble(last, sizeof(last));
+  ASSERT_TRUE(buffer);
+  EXPECT_FALSE(pool->is_assembling());
+  EXPECT_EQ(buffer.to_vector(), (std::vector<uint8_t>{0xF0, 0x43, 0x10, 0x4C, 0x00, 0x00, 0x7E, 0x00, 0x41, 0xF7}));
+
+  // A new F0 before the F7, then a note in the middle of a message
+  EXPECT_FALSE(pool->assemble(first, sizeof(first)));
+  EXPECT_FALSE(pool->assemble(first, sizeof(first)));
+  const uint8_t cut[] = {0x01, 0x90, 0x3C, 0xF7};
+  EXPECT_FALSE(pool->assemble(cut, sizeof(cut)));
+  EXPECT_FALSE(pool->is_assembling());
+
+  auto statistics = pool->get_statistics();
+  EXPECT_EQ(statistics.messages, 1u);
+  EXPECT_EQ(statistics.messages_truncated, 2u);
+  EXPECT_EQ(statistics.blocks_free, 64u - 2u);  // Only the delivered message holds blocks
+}
+
+/** @brief A message larger than the free blocks is dropped whole, and the pool recovers once buffers go
+ */
+TEST(SysexPoolTest, DropsWhatDoesNotFit)
+{
+  auto pool = SysexPool::create(16, 4);
+  ASSERT_NE(pool, nullptr);
+
+  auto small = make_sysex(30);
+  SysexBuffer held = pool->assemble(small.data(), small.size());
+  ASSERT_TRUE(held);
+
+  auto large = make_sysex(50);
+  EXPECT_FALSE(pool->assemble(large.data(), 20));
+  EXPECT_FALSE(pool->assemble(large.data() + 20, large.size() - 20));
+  EXPECT_FALSE(pool->is_assembling());
+  EXPECT_EQ(pool->get_statistics().messages_dropped, 1u);
+  EXPECT_EQ(pool->get_statistics().fragments_ignored, 0u);  // The rest of the dump was swallowed
+  EXPECT_EQ(pool->get_statistics().blocks_free, 2u);
+
+  held = SysexBuffer();
+  SysexBuffer buffer = pool->assemble(large.data(), large.size());
+  ASSERT_TRUE(buffer);
+  EXPECT_EQ(buffer.to_vector(), large);
+}
+
+/** @brief Buffers released on other threads all find their way back to the free list
+ */
+TEST(SysexPoolTest, ReleasesFromOtherThreads)
+{
+  auto pool = SysexPool::create(32, 64);
+  ASSERT_NE(pool, nullptr);
+
+  auto bytes = make_sysex(90);
+  for (int round = 0; round < 200; ++round)
+  {
+    std::vector<SysexBuffer> buffers;
+    for (int i = 0; i < 16; ++i)
+    {
+      SysexBuffer buffer = pool->assemble(bytes.data(), bytes.size());
+      ASSERT_TRUE(buffer);
+      buffers.push_back(buffer);
+      buffers.push_back(std::move(buffer));
+    }
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+      std::vector<SysexBuffer> share(buffers.begin() + t * 8, buffers.begin() + (t + 1) * 8);
+      threads.emplace_back([share = std::move(share)]() mutable { share.clear(); });
+    }
+    buffers.clear();
+    for (auto &thread : threads)
+    {
+      thread.join();
+    }
+    ASSERT_EQ(pool->get_statistics().blocks_free, 64u);
+  }
+}
+
+/** @brief The MidiEngine delivers a fragmented dump as one message carrying its payload
+ */
+TEST(SysexPoolTest, MidiEngineDeliversSysex)
+{
+  auto &midi_engine = MidiEngine::instance();
+  while (midi_engine.try_pop_message().has_value())
+  {
+  }
+
+  auto bytes = make_sysex(600);
+  EXPECT_TRUE(midi_engine.receive_sysex(0.0, bytes.data(), 250));
+  const unsigned char clock[] = {0xF8};
+  EXPECT_FALSE(midi_engine.receive_sysex(0.0, clock, sizeof(clock)));
+  EXPECT_TRUE(midi_engine.receive_sysex(0.001, bytes.data() + 250, bytes.size() - 250));
+  const unsigned char note[] = {0x90, 0x3C, 0x64};
+  EXPECT_FALSE(midi_engine.receive_sysex(0.0, note, sizeof(note)));
+
+  auto message = midi_engine.try_pop_message();
+  ASSERT_TRUE(message.has_value());
+  EXPECT_EQ(message->type, eMidiMessageType::SystemExclusive);
+  EXPECT_EQ(message->sysex.to_vector(), bytes);
+  EXPECT_FALSE(midi_engine.try_pop_message().has_value());
+}
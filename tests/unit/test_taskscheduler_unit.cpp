@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "taskscheduler.h"
+
+using namespace MinimalAudioEngine;
+
+namespace
+{
+
+/** @brief Occupies the only worker of a scheduler until released, so later tasks queue up
+ */
+class WorkerBlocker
+{
+public:
+  explicit WorkerBlocker(TaskScheduler &scheduler)
+  {
+    scheduler.submit([this]() {
+      m_started.set_value();
+      m_release.get_future().wait();
+    }, eTaskPriority::High);
+    m_started.get_future().wait();
+  }
+
+  void release()
+  {
+    m_release.set_value();
+  }
+
+private:
+  std::promise<void> m_started;
+  std::promise<void> m_release;
+};
+
+}  // namespace
+
+/** @brief Every task in a group has run when wait() returns
+ */
+TEST(TaskSchedulerTest, GroupWait)
+{
+  TaskScheduler scheduler(4);
+  std::atomic<int> count{0};
+
+  TaskGroup group;
+  for (int i = 0; i < 100; ++i)
+  {
+    scheduler.submit(group, [&count]() { count++; });
+  }
+  group.wait();
+
+  EXPECT_EQ(count.load(), 100);
+  EXPECT_GE(scheduler.get_statistics().tasks_run, 100u);
+}
+
+/** @brief Higher classes run first; deadlines run earliest first, ahead of tasks without one
+ */
+TEST(TaskSchedulerTest, PriorityAndDeadlineOrder)
+{
+  TaskScheduler scheduler(1);
+  WorkerBlocker blocker(scheduler);
+
+  std::mutex order_mutex;
+  std::vector<int> order;
+  auto record = [&](int id) {
+    return [&, id]() {
+      std::lock_guard<std::mutex> lock(order_mutex);
+      order.push_back(id);
+    };
+  };
+
+  auto now = std::chrono::steady_clock::now();
+  TaskGroup group;
+  scheduler.submit(group, record(1), eTaskPriority::Background);
+  scheduler.submit(group, record(2), eTaskPriority::Normal);
+  scheduler.submit(group, record(3), eTaskPriority::Normal, now + std::chrono::seconds(30));
+  scheduler.submit(group, record(4), eTaskPriority::High);
+  scheduler.submit(group, record(5), eTaskPriority::Normal, now + std::chrono::seconds(10));
+
+  blocker.release();
+  group.wait();
+
+  EXPECT_EQ(order, (std::vector<int>{4, 5, 3, 2, 1}));
+}
+
+/** @brief A task waiting on its own subtasks helps run them instead of deadlocking the pool
+ */
+TEST(TaskSchedulerTest, NestedWaitOnSingleWorker)
+{
+  TaskScheduler scheduler(1);
+  std::atomic<int> count{0};
+
+  TaskGroup outer;
+  scheduler.submit(outer, [&]() {
+    TaskGroup inner;
+    for (int i = 0; i < 8; ++i)
+    {
+      scheduler.submit(inner, [&count]() { count++; });
+    }
+    inner.wait();
+  });
+  outer.wait();
+
+  EXPECT_EQ(count.load(), 8);
+}
+
+/** @brief Idle workers take tasks queued on a busy worker
+ */
+TEST(TaskSchedulerTest, WorkStealing)
+{
+  TaskScheduler scheduler(2);
+  std::atomic<int> count{0};
+
+  TaskGroup outer;
+  scheduler.submit(outer, [&]() {
+    TaskGroup inner;
+    for (int i = 0; i < 32; ++i)
+    {
+      scheduler.submit(inner, [&count]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        count++;
+      });
+    }
+    inner.wait();
+  });
+  outer.wait();
+
+  EXPECT_EQ(count.load(), 32);
+  EXPECT_GT(scheduler.get_statistics().tasks_stolen, 0u);
+}
+
+/** @brief Under high audio load only High tasks start; the rest wait for headroom
+ */
+TEST(TaskSchedulerTest, YieldsToAudioLoad)
+{
+  TaskScheduler scheduler(1);
+  std::atomic<float> load{1.0f};
+  size_t probe = scheduler.add_load_probe([&load]() { return load.load(); });
+
+  std::atomic<bool> background_ran{false};
+  std::atomic<bool> high_ran{false};
+  TaskGroup group;
+  scheduler.submit(group, [&]() { background_ran = true; }, eTaskPriority::Background);
+  scheduler.submit(group, [&]() { high_ran = true; }, eTaskPriority::High);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_TRUE(high_ran.load());
+  EXPECT_FALSE(background_ran.load());
+  EXPECT_GT(scheduler.get_statistics().throttled_waits, 0u);
+
+  load = 0.1f;
+  group.wait();
+  EXPECT_TRUE(background_ran.load());
+
+  scheduler.remove_load_probe(probe);
+}